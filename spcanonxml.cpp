@@ -4,17 +4,76 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
 
 #include "spcanonxml.hpp"
 
 #include "spxmlnode.hpp"
 #include "spxmlutils.hpp"
 #include "spxmlcodec.hpp"
+#include "spxmlsink.hpp"
+#include "spxmlparser.hpp"
+#include "spxmlevent.hpp"
+
+typedef struct tagSP_CanonAttr {
+	const char * mName;
+	const char * mValue;
+} SP_CanonAttr_t;
+
+static int cmpCanonAttr( const void * item1, const void * item2 )
+{
+	const SP_CanonAttr_t * attr1 = (const SP_CanonAttr_t*)item1;
+	const SP_CanonAttr_t * attr2 = (const SP_CanonAttr_t*)item2;
+
+	int ret = strcmp( attr1->mName, attr2->mName );
+
+	return 0 != ret ? ret : strcmp( attr1->mValue, attr2->mValue );
+}
+
+// write the attributes of an element node or a start-tag event, sorted by name
+template< class T >
+static void writeCanonAttrs( const T * owner, SP_XmlOutputSink * sink )
+{
+	enum { eStackAttrs = 16 };
+
+	SP_CanonAttr_t stackAttrs[ eStackAttrs ];
+
+	int count = owner->getAttrCount();
+	if( count <= 0 ) return;
+
+	SP_CanonAttr_t * attrs = count > eStackAttrs
+			? (SP_CanonAttr_t*)malloc( count * sizeof( SP_CanonAttr_t ) ) : stackAttrs;
+
+	int total = 0;
+	for( int i = 0; i < count; i++ ) {
+		const char * value = NULL;
+		const char * name = owner->getAttr( i, &value );
+		if( NULL != name && NULL != value ) {
+			attrs[ total ].mName = name;
+			attrs[ total ].mValue = value;
+			total++;
+		}
+	}
+
+	if( total > 1 ) qsort( attrs, total, sizeof( SP_CanonAttr_t ), cmpCanonAttr );
+
+	for( int i = 0; i < total; i++ ) {
+		sink->append( ' ' );
+		sink->append( attrs[ i ].mName );
+		sink->append( "=\"" );
+		SP_XmlStringCodec::encode( "", attrs[ i ].mValue, sink );
+		sink->append( '"' );
+	}
+
+	if( attrs != stackAttrs ) free( attrs );
+}
 
 SP_CanonXmlBuffer :: SP_CanonXmlBuffer( const SP_XmlNode * node )
 {
 	mBuffer = new SP_XmlStringBuffer();
-	dump( node, mBuffer );
+
+	SP_XmlStringSink sink( mBuffer );
+	dump( node, &sink );
 }
 
 SP_CanonXmlBuffer :: ~SP_CanonXmlBuffer()
@@ -34,23 +93,15 @@ int SP_CanonXmlBuffer :: getSize() const
 }
 
 void SP_CanonXmlBuffer :: canonEncode( const char * value,
-		SP_XmlStringBuffer * buffer )
+		SP_XmlOutputSink * sink )
 {
-	SP_XmlStringBuffer temp;
-	SP_XmlStringCodec::encode( "", value, &temp );
-
-	for( const char * pos = temp.getBuffer(); '\0' != *pos; pos++ ) {
-		if( '\r' == *pos ) {
-		} else if( '\n' == *pos ) {
-			buffer->append( "&#10;" );
-		} else {
-			buffer->append( *pos );
-		}
-	}
+	// the default codec writes every byte below 0x20 as a character reference,
+	// which covers the &#9; &#10; &#13; of the canonical form
+	SP_XmlStringCodec::encode( "", value, sink );
 }
 
 void SP_CanonXmlBuffer :: dump(
-		const SP_XmlNode * node, SP_XmlStringBuffer * buffer )
+		const SP_XmlNode * node, SP_XmlOutputSink * sink )
 {
 	if( NULL == node ) return;
 
@@ -58,24 +109,24 @@ void SP_CanonXmlBuffer :: dump(
 		SP_XmlDocument * document = static_cast<SP_XmlDocument*>((SP_XmlNode*)node);
 		const SP_XmlNodeList * children = document->getChildren();
 		for( int j = 0; j < children->getLength(); j++ ) {
-			dump( children->get( j ), buffer );
+			dump( children->get( j ), sink );
 		}
 	} else if( SP_XmlNode::eCDATA == node->getType() ) {
 		SP_XmlCDataNode * cdata = static_cast<SP_XmlCDataNode*>((SP_XmlNode*)node);
 
-		canonEncode( cdata->getText(), buffer );
+		canonEncode( cdata->getText(), sink );
 	} else if( SP_XmlNode::ePI == node->getType() ) {
 		SP_XmlPINode * piNode = static_cast<SP_XmlPINode*>((SP_XmlNode*)node);
 
-		buffer->append( "<?" );
-		buffer->append( piNode->getTarget() );
-		if( '\0' != *( piNode->getTarget() ) ) buffer->append( ' ' );
-		buffer->append( piNode->getData() );
-		buffer->append( "?>" );
+		sink->append( "<?" );
+		sink->append( piNode->getTarget() );
+		if( '\0' != *( piNode->getTarget() ) ) sink->append( ' ' );
+		sink->append( piNode->getData() );
+		sink->append( "?>" );
 	} else if( SP_XmlNode::eCOMMENT == node->getType() ) {
 		// ignore
 	} else if( SP_XmlNode::eELEMENT == node->getType() ) {
-		dumpElement( node, buffer );
+		dumpElement( node, sink );
 	} else if( SP_XmlNode::eDOCDECL == node->getType() ) {
 		// ignore
 	} else if( SP_XmlNode::eDOCTYPE == node->getType() ) {
@@ -86,49 +137,118 @@ void SP_CanonXmlBuffer :: dump(
 }
 
 void SP_CanonXmlBuffer :: dumpElement(
-		const SP_XmlNode * node, SP_XmlStringBuffer * buffer )
+		const SP_XmlNode * node, SP_XmlOutputSink * sink )
 {
 	if( NULL == node ) return;
 
 	if( SP_XmlNode::eELEMENT == node->getType() ) {
 		SP_XmlElementNode * element = static_cast<SP_XmlElementNode*>((SP_XmlNode*)node);
-		buffer->append( "<" );
-		buffer->append( element->getName() );
+		sink->append( "<" );
+		sink->append( element->getName() );
 
-		int i = 0;
-
-		SP_XmlArrayList attrList;
-		for( i = 0; i < element->getAttrCount(); i++ ) {
-			attrList.append( (void*)element->getAttr( i, NULL ) );
-		}
-		attrList.sort( reinterpret_cast<int(*)(const void*, const void*)>(strcmp) );
-
-		const char * name = NULL, * value = NULL;
-		for( i = 0; i < attrList.getCount(); i++ ) {
-			name = (char*)attrList.getItem( i );
-			value = element->getAttrValue( name );
-			if( NULL != name && NULL != value ) {
-				buffer->append( ' ' );
-				buffer->append( name );
-				buffer->append( "=\"" );
-				canonEncode( value, buffer );
-				buffer->append( "\"" );
-			}
-		}
+		writeCanonAttrs( element, sink );
 
 		const SP_XmlNodeList * children = element->getChildren();
 
-		buffer->append( ">" );
+		sink->append( ">" );
 
 		for( int j = 0; j < children->getLength(); j++ ) {
-			dump( children->get( j ), buffer );
+			dump( children->get( j ), sink );
 		}
 
-		buffer->append( "</" );
-		buffer->append( element->getName() );
-		buffer->append( ">" );
+		sink->append( "</" );
+		sink->append( element->getName() );
+		sink->append( ">" );
 	} else {
-		dump( node, buffer );
+		dump( node, sink );
+	}
+}
+
+//=========================================================
+
+SP_CanonXmlStream :: SP_CanonXmlStream( SP_XmlOutputSink * sink )
+{
+	mSink = sink;
+	mParser = new SP_XmlPullParser();
+	mDepth = 0;
+}
+
+SP_CanonXmlStream :: ~SP_CanonXmlStream()
+{
+	delete mParser;
+	mParser = NULL;
+}
+
+SP_XmlPullParser * SP_CanonXmlStream :: getParser()
+{
+	return mParser;
+}
+
+int SP_CanonXmlStream :: append( const char * source, int len )
+{
+	int ret = mParser->append( source, len );
+
+	for( SP_XmlPullEvent * event = mParser->getNext();
+			NULL != event; event = mParser->getNext() ) {
+		write( event );
+		delete event;
+	}
+
+	return ret;
+}
+
+const char * SP_CanonXmlStream :: getError()
+{
+	return mParser->getError();
+}
+
+void SP_CanonXmlStream :: write( const SP_XmlPullEvent * event )
+{
+	switch( event->getEventType() ) {
+		case SP_XmlPullEvent::eStartTag:
+			{
+				const SP_XmlStartTagEvent * startTag = (const SP_XmlStartTagEvent*)event;
+
+				mSink->append( '<' );
+				mSink->append( startTag->getName() );
+				writeCanonAttrs( startTag, mSink );
+				mSink->append( '>' );
+
+				mDepth++;
+			}
+			break;
+		case SP_XmlPullEvent::eEndTag:
+			{
+				mSink->append( "</" );
+				mSink->append( ((const SP_XmlEndTagEvent*)event)->getText() );
+				mSink->append( '>' );
+
+				mDepth--;
+			}
+			break;
+		case SP_XmlPullEvent::eCData:
+			{
+				// same as the dom, text outside of the root element is dropped
+				if( mDepth > 0 ) {
+					SP_XmlStringCodec::encode( "",
+							((const SP_XmlCDataEvent*)event)->getText(), mSink );
+				}
+			}
+			break;
+		case SP_XmlPullEvent::ePI:
+			{
+				const SP_XmlPIEvent * pi = (const SP_XmlPIEvent*)event;
+
+				mSink->append( "<?" );
+				mSink->append( pi->getTarget() );
+				if( '\0' != *( pi->getTarget() ) ) mSink->append( ' ' );
+				mSink->append( pi->getData() );
+				mSink->append( "?>" );
+			}
+			break;
+		default:
+			// comment, doc decl, doc type : ignore
+			break;
 	}
 }
 
@@ -8,8 +8,11 @@
 
 class SP_XmlNode;
 class SP_XmlStringBuffer;
+class SP_XmlOutputSink;
 class SP_XmlDocDeclNode;
 class SP_XmlDocTypeNode;
+class SP_XmlPullParser;
+class SP_XmlPullEvent;
 
 /// XML Canonical, defined by James Clark.
 class SP_CanonXmlBuffer {
@@ -20,20 +23,62 @@ public:
 	const char * getBuffer() const;
 	int getSize() const;
 
+	/// write the canonical form to a sink, call sink->flush() when done
+	static void dump( const SP_XmlNode * node,
+			SP_XmlOutputSink * sink );
+
 private:
 	SP_CanonXmlBuffer( SP_CanonXmlBuffer & );
 	SP_CanonXmlBuffer & operator=( SP_CanonXmlBuffer & );
 
-	static void dump( const SP_XmlNode * node,
-			SP_XmlStringBuffer * buffer );
 	static void dumpElement( const SP_XmlNode * node,
-			SP_XmlStringBuffer * buffer );
+			SP_XmlOutputSink * sink );
 
 	static void canonEncode( const char * value,
-			SP_XmlStringBuffer * buffer );
+			SP_XmlOutputSink * sink );
 
 	SP_XmlStringBuffer * mBuffer;
 };
 
+/**
+ *  Write the canonical form while the source is pulled, no tree is built,
+ *  the memory is bounded by the element depth, not by the document size.
+ *  The output is the same as SP_CanonXmlBuffer.
+ *
+ *	@verbatim
+ *	SP_XmlFdSink sink( fd );
+ *	SP_CanonXmlStream canon( &sink );
+ *	canon.getParser()->setIgnoreWhitespace( 0 );
+ *	for( ... ) canon.append( buffer, len );
+ *	sink.flush();
+ *	@endverbatim
+ */
+class SP_CanonXmlStream {
+public:
+	SP_CanonXmlStream( SP_XmlOutputSink * sink );
+	~SP_CanonXmlStream();
+
+	/// the parser which feeds the stream, for setIgnoreWhitespace
+	SP_XmlPullParser * getParser();
+
+	/// parse more source and write the events pulled out
+	/// @return how much byte has been consumed
+	int append( const char * source, int len );
+
+	/// write one event, for the caller who pulls the events itself
+	void write( const SP_XmlPullEvent * event );
+
+	/// @return NOT NULL : the parser error
+	const char * getError();
+
+private:
+	SP_CanonXmlStream( SP_CanonXmlStream & );
+	SP_CanonXmlStream & operator=( SP_CanonXmlStream & );
+
+	SP_XmlOutputSink * mSink;
+	SP_XmlPullParser * mParser;
+	int mDepth;
+};
+
 #endif
 
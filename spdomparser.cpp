@@ -4,6 +4,7 @@
  */
 
 #include <assert.h>
+#include <string.h>
 
 #include "spdomparser.hpp"
 #include "spxmlparser.hpp"
@@ -11,6 +12,8 @@
 #include "spxmlutils.hpp"
 #include "spxmlnode.hpp"
 #include "spxmlcodec.hpp"
+#include "spxmlsink.hpp"
+#include "spxmlsource.hpp"
 
 //=========================================================
 
@@ -64,91 +67,122 @@ int SP_XmlDomParser :: append( const char * source, int len )
 	return consumed;
 }
 
+int SP_XmlDomParser :: parse( const char * source, int len )
+{
+	SP_XmlMemorySource memory( source, len );
+
+	mParser->setSource( &memory );
+	buildTree();
+	mParser->setSource( NULL );
+
+	return NULL == mParser->getError() ? 0 : -1;
+}
+
+int SP_XmlDomParser :: parseFile( const char * path )
+{
+	if( 0 != mParser->parseFile( path ) ) return -1;
+
+	// getNext reads the file as the tree grows
+	buildTree();
+
+	return NULL == mParser->getError() ? 0 : -1;
+}
+
 void SP_XmlDomParser :: buildTree()
 {
 	for( SP_XmlPullEvent * event = mParser->getNext();
 			NULL != event; event = mParser->getNext() ) {
+		addEvent( event );
+	}
+}
 
-		switch( event->getEventType() ) {
-			case SP_XmlPullEvent::eStartDocument:
-				// ignore
-				delete event;
+void SP_XmlDomParser :: addEvent( SP_XmlPullEvent * event )
+{
+	switch( event->getEventType() ) {
+		case SP_XmlPullEvent::eStartDocument:
+			// ignore
+			delete event;
+			break;
+		case SP_XmlPullEvent::eEndDocument:
+			// ignore
+			delete event;
+			break;
+		case SP_XmlPullEvent::eDocDecl:
+			{
+				mDocument->setDocDecl(
+						new SP_XmlDocDeclNode( (SP_XmlDocDeclEvent*)event ) );
 				break;
-			case SP_XmlPullEvent::eEndDocument:
-				// ignore
-				delete event;
+			}
+		case SP_XmlPullEvent::eDocType:
+			{
+				mDocument->setDocType(
+						new SP_XmlDocTypeNode( (SP_XmlDocTypeEvent*)event ) );
 				break;
-			case SP_XmlPullEvent::eDocDecl:
-				{
-					mDocument->setDocDecl(
-							new SP_XmlDocDeclNode( (SP_XmlDocDeclEvent*)event ) );
-					break;
+			}
+		case SP_XmlPullEvent::eStartTag:
+			{
+				SP_XmlElementNode * element =
+						new SP_XmlElementNode( (SP_XmlStartTagEvent*)event );
+				if( NULL == mCurrent ) {
+					mCurrent = element;
+					mDocument->setRootElement( element );
+				} else {
+					mCurrent->addChild( element );
+					mCurrent = element;
 				}
-			case SP_XmlPullEvent::eDocType:
-				{
-					mDocument->setDocType(
-							new SP_XmlDocTypeNode( (SP_XmlDocTypeEvent*)event ) );
-					break;
+				break;
+			}
+		case SP_XmlPullEvent::eEndTag:
+			{
+				if( mCurrent->getSourceOffset() >= 0 && event->getSourceOffset() >= 0 ) {
+					mCurrent->setSourceRange( mCurrent->getSourceOffset(),
+							event->getSourceOffset() + event->getSourceLength()
+							- mCurrent->getSourceOffset() );
 				}
-			case SP_XmlPullEvent::eStartTag:
-				{
-					SP_XmlElementNode * element =
-							new SP_XmlElementNode( (SP_XmlStartTagEvent*)event );
-					if( NULL == mCurrent ) {
-						mCurrent = element;
-						mDocument->setRootElement( element );
-					} else {
-						mCurrent->addChild( element );
-						mCurrent = element;
-					}
-					break;
+
+				SP_XmlNode * parent = (SP_XmlNode*)mCurrent->getParent();
+				if( NULL != parent && SP_XmlNode::eELEMENT == parent->getType() ) {
+					mCurrent = static_cast<SP_XmlElementNode*>((SP_XmlNode*)parent);
+				} else {
+					mCurrent = NULL;
 				}
-			case SP_XmlPullEvent::eEndTag:
-				{
-					SP_XmlNode * parent = (SP_XmlNode*)mCurrent->getParent();
-					if( NULL != parent && SP_XmlNode::eELEMENT == parent->getType() ) {
-						mCurrent = static_cast<SP_XmlElementNode*>((SP_XmlNode*)parent);
-					} else {
-						mCurrent = NULL;
-					}
 
+				delete event;
+				break;
+			}
+		case SP_XmlPullEvent::eCData:
+			{
+				if( NULL != mCurrent ) {
+					mCurrent->addChild( new SP_XmlCDataNode( (SP_XmlCDataEvent*)event ) );
+				} else {
 					delete event;
-					break;
-				}
-			case SP_XmlPullEvent::eCData:
-				{
-					if( NULL != mCurrent ) {
-						mCurrent->addChild( new SP_XmlCDataNode( (SP_XmlCDataEvent*)event ) );
-					} else {
-						delete event;
-					}
-					break;
-				}
-			case SP_XmlPullEvent::eComment:
-				{
-					if( NULL != mCurrent ) {
-						mCurrent->addChild( new SP_XmlCommentNode( (SP_XmlCommentEvent*)event ) );
-					} else {
-						delete event;
-					}
-					break;
 				}
-			case SP_XmlPIEvent::ePI:
-				{
-					if( NULL != mCurrent ) {
-						mCurrent->addChild( new SP_XmlPINode( (SP_XmlPIEvent*)event ) );
-					} else {
-						mDocument->getChildren()->append(
-								new SP_XmlPINode( (SP_XmlPIEvent*)event ) );
-					}
-					break;
+				break;
+			}
+		case SP_XmlPullEvent::eComment:
+			{
+				if( NULL != mCurrent ) {
+					mCurrent->addChild( new SP_XmlCommentNode( (SP_XmlCommentEvent*)event ) );
+				} else {
+					delete event;
 				}
-			default:
-				{
-					assert( 0 );
-					break;
+				break;
+			}
+		case SP_XmlPIEvent::ePI:
+			{
+				if( NULL != mCurrent ) {
+					mCurrent->addChild( new SP_XmlPINode( (SP_XmlPIEvent*)event ) );
+				} else {
+					mDocument->getChildren()->append(
+							new SP_XmlPINode( (SP_XmlPIEvent*)event ) );
 				}
-		}
+				break;
+			}
+		default:
+			{
+				assert( 0 );
+				break;
+			}
 	}
 }
 
@@ -162,8 +196,44 @@ const SP_XmlDocument * SP_XmlDomParser :: getDocument() const
 	return mDocument;
 }
 
+SP_XmlDocument * SP_XmlDomParser :: takeDocument()
+{
+	SP_XmlDocument * document = mDocument;
+
+	mDocument = new SP_XmlDocument();
+	mCurrent = NULL;
+
+	return document;
+}
+
+void SP_XmlDomParser :: reset()
+{
+	mParser->reset();
+
+	delete mDocument;
+	mDocument = new SP_XmlDocument();
+	mCurrent = NULL;
+}
+
 //=========================================================
 
+static const char TABS[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t"
+		"\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+
+static void appendTabs( SP_XmlOutputSink * sink, int count )
+{
+	for( ; count > 0; ) {
+		int len = count < (int)sizeof( TABS ) - 1 ? count : (int)sizeof( TABS ) - 1;
+		sink->append( TABS, len );
+		count -= len;
+	}
+}
+
+static inline int lengthOf( const char * value )
+{
+	return NULL != value ? strlen( value ) : 0;
+}
+
 SP_XmlDomBuffer :: SP_XmlDomBuffer( const SP_XmlNode * node, int indent )
 {
 	mBuffer = new SP_XmlStringBuffer();
@@ -192,57 +262,87 @@ int SP_XmlDomBuffer :: getSize() const
 	return mBuffer->getSize();
 }
 
+void SP_XmlDomBuffer :: dumpDocDecl( const char * encoding,
+		const SP_XmlDocDeclNode * docDecl,
+		SP_XmlStringBuffer * buffer, int level )
+{
+	SP_XmlStringSink sink( buffer );
+	dumpDocDecl( encoding, docDecl, &sink, level );
+}
+
+void SP_XmlDomBuffer :: dumpDocType( const char * encoding,
+		const SP_XmlDocTypeNode * docType,
+		SP_XmlStringBuffer * buffer, int level )
+{
+	SP_XmlStringSink sink( buffer );
+	dumpDocType( encoding, docType, &sink, level );
+}
+
 void SP_XmlDomBuffer :: dump( const char * encoding,
 		const SP_XmlNode * node, SP_XmlStringBuffer * buffer, int level )
+{
+	SP_XmlStringSink sink( buffer );
+	dump( encoding, node, &sink, level );
+}
+
+void SP_XmlDomBuffer :: dumpElement( const char * encoding,
+		const SP_XmlNode * node, SP_XmlStringBuffer * buffer, int level )
+{
+	SP_XmlStringSink sink( buffer );
+	dumpElement( encoding, node, &sink, level );
+}
+
+void SP_XmlDomBuffer :: dump( const char * encoding,
+		const SP_XmlNode * node, SP_XmlOutputSink * sink, int level )
 {
 	if( SP_XmlNode::eXMLDOC == node->getType() ) {
 		SP_XmlDocument * document = static_cast<SP_XmlDocument*>((SP_XmlNode*)node);
-		dumpDocDecl( encoding, document->getDocDecl(), buffer, level );
-		dumpDocType( encoding, document->getDocType(), buffer, level );
+		dumpDocDecl( encoding, document->getDocDecl(), sink, level );
+		dumpDocType( encoding, document->getDocType(), sink, level );
 
 		const SP_XmlNodeList * children = document->getChildren();
 		for( int j = 0; j < children->getLength(); j++ ) {
-			dump( encoding, children->get( j ), buffer, level );
+			dump( encoding, children->get( j ), sink, level );
 		}
 	} else if( SP_XmlNode::eCDATA == node->getType() ) {
 		SP_XmlCDataNode * cdata = static_cast<SP_XmlCDataNode*>((SP_XmlNode*)node);
-		SP_XmlStringCodec::encode( encoding, cdata->getText(), buffer );
+		SP_XmlStringCodec::encode( encoding, cdata->getText(), sink );
 	} else if( SP_XmlNode::eCOMMENT == node->getType() ) {
 		SP_XmlCommentNode * comment = static_cast<SP_XmlCommentNode*>((SP_XmlNode*)node);
 
 		if( level >= 0 ) {
-			buffer->append( '\n' );
-			for( int i = 0; i < level; i++ ) buffer->append( '\t' );
-			buffer->append( "<!--" );
-			buffer->append( comment->getText() );
-			buffer->append( "-->\n" );
+			sink->append( '\n' );
+			appendTabs( sink, level );
+			sink->append( "<!--" );
+			sink->append( comment->getText() );
+			sink->append( "-->\n" );
 		} else {
-			buffer->append( "<!--" );
-			buffer->append( comment->getText() );
-			buffer->append( "-->" );
+			sink->append( "<!--" );
+			sink->append( comment->getText() );
+			sink->append( "-->" );
 		}
 	} else if( SP_XmlNode::eELEMENT == node->getType() ) {
-		dumpElement( encoding, node, buffer, level );
+		dumpElement( encoding, node, sink, level );
 	} else if( SP_XmlNode::eDOCDECL == node->getType() ) {
-		dumpDocDecl( encoding, (SP_XmlDocDeclNode*)node, buffer, level );
+		dumpDocDecl( encoding, (SP_XmlDocDeclNode*)node, sink, level );
 	} else if( SP_XmlNode::eDOCTYPE == node->getType() ) {
-		dumpDocType( encoding, (SP_XmlDocTypeNode*)node, buffer, level );
+		dumpDocType( encoding, (SP_XmlDocTypeNode*)node, sink, level );
 	} else if( SP_XmlNode::ePI == node->getType() ) {
 		SP_XmlPINode * piNode = static_cast<SP_XmlPINode*>((SP_XmlNode*)node);
 
 		if( level >= 0 ) {
-			for( int i = 0; i < level; i++ ) buffer->append( '\t' );
-			buffer->append( "<?" );
-			buffer->append( piNode->getTarget() );
-			buffer->append( ' ' );
-			buffer->append( piNode->getData() );
-			buffer->append( "?>\n" );
+			appendTabs( sink, level );
+			sink->append( "<?" );
+			sink->append( piNode->getTarget() );
+			sink->append( ' ' );
+			sink->append( piNode->getData() );
+			sink->append( "?>\n" );
 		} else {
-			buffer->append( "<?" );
-			buffer->append( piNode->getTarget() );
-			if( '\0' != *( piNode->getTarget() ) ) buffer->append( ' ' );
-			buffer->append( piNode->getData() );
-			buffer->append( "?>" );
+			sink->append( "<?" );
+			sink->append( piNode->getTarget() );
+			if( '\0' != *( piNode->getTarget() ) ) sink->append( ' ' );
+			sink->append( piNode->getData() );
+			sink->append( "?>" );
 		}
 	} else {
 		// ignore
@@ -251,89 +351,87 @@ void SP_XmlDomBuffer :: dump( const char * encoding,
 
 void SP_XmlDomBuffer :: dumpDocDecl( const char * encoding,
 		const SP_XmlDocDeclNode * docDecl,
-		SP_XmlStringBuffer * buffer, int level )
+		SP_XmlOutputSink * sink, int level )
 {
 	if( NULL == docDecl ) return;
 
-	buffer->append( "<?xml version=\"" );
+	sink->append( "<?xml version=\"" );
 	if( '\0' != * ( docDecl->getVersion() ) ) {
-		buffer->append( docDecl->getVersion() );
+		sink->append( docDecl->getVersion() );
 	} else {
-		buffer->append( "1.0" );
+		sink->append( "1.0" );
 	}
-	buffer->append( "\" " );
+	sink->append( "\" " );
 
 	if( '\0' != * ( docDecl->getEncoding() ) ) {
-		buffer->append( "encoding=\"" );
-		buffer->append( docDecl->getEncoding() );
-		buffer->append( "\" " );
+		sink->append( "encoding=\"" );
+		sink->append( docDecl->getEncoding() );
+		sink->append( "\" " );
 	}
 
 	if( -1 != docDecl->getStandalone() ) {
-		char standalone[ 32 ];
-		snprintf( standalone, sizeof( standalone ), "standalone=\"%s\" ",
-				0 == docDecl->getStandalone() ? "no" : "yes" );
-		buffer->append( standalone );
+		sink->append( 0 == docDecl->getStandalone()
+				? "standalone=\"no\" " : "standalone=\"yes\" " );
 	}
 
-	buffer->append( level >= 0 ? "?>\n" : "?>" );
+	sink->append( level >= 0 ? "?>\n" : "?>" );
 }
 
 void SP_XmlDomBuffer :: dumpDocType( const char * encoding,
 		const SP_XmlDocTypeNode * docType,
-		SP_XmlStringBuffer * buffer, int level )
+		SP_XmlOutputSink * sink, int level )
 {
 	if( NULL == docType ) return;
 
-	buffer->append( "<!DOCTYPE " );
-	buffer->append( docType->getName() );
+	sink->append( "<!DOCTYPE " );
+	sink->append( docType->getName() );
 
 	if( '\0' != * ( docType->getPublicID() ) ) {
-		buffer->append( " PUBLIC " );
-		buffer->append( '"' );
-		buffer->append( docType->getPublicID() );
-		buffer->append( '"' );
+		sink->append( " PUBLIC " );
+		sink->append( '"' );
+		sink->append( docType->getPublicID() );
+		sink->append( '"' );
 	}
 
 	if( '\0' != * ( docType->getSystemID() ) ) {
-		buffer->append( " SYSTEM " );
-		buffer->append( '"' );
-		buffer->append( docType->getSystemID() );
-		buffer->append( '"' );
+		sink->append( " SYSTEM " );
+		sink->append( '"' );
+		sink->append( docType->getSystemID() );
+		sink->append( '"' );
 	}
 
 	if( '\0' != * ( docType->getDTD() ) ) {
-		buffer->append( " \"" );
-		buffer->append( docType->getDTD() );
-		buffer->append( '"' );
+		sink->append( " \"" );
+		sink->append( docType->getDTD() );
+		sink->append( '"' );
 	}
 
-	buffer->append( level >= 0 ? ">\n" : ">" );
+	sink->append( level >= 0 ? ">\n" : ">" );
 }
 
 void SP_XmlDomBuffer :: dumpElement( const char * encoding,
-		const SP_XmlNode * node, SP_XmlStringBuffer * buffer, int level )
+		const SP_XmlNode * node, SP_XmlOutputSink * sink, int level )
 {
 	if( NULL == node ) return;
 
 	if( SP_XmlNode::eELEMENT == node->getType() ) {
 		int i = 0;
 
-		for( i = 0; i < level; i++ ) buffer->append( '\t' );
+		appendTabs( sink, level );
 
 		SP_XmlElementNode * element = static_cast<SP_XmlElementNode*>((SP_XmlNode*)node);
-		buffer->append( "<" );
-		buffer->append( element->getName() );
+		sink->append( "<" );
+		sink->append( element->getName() );
 
 		const char * name = NULL, * value = NULL;
 		for( i = 0; i < element->getAttrCount(); i++ ) {
 			name = element->getAttr( i, &value );
 			if( NULL != name && NULL != value ) {
-				buffer->append( ' ' );
-				buffer->append( name );
-				buffer->append( "=\"" );
-				SP_XmlStringCodec::encode( encoding, value, buffer );
-				buffer->append( "\"" );
+				sink->append( ' ' );
+				sink->append( name );
+				sink->append( "=\"" );
+				SP_XmlStringCodec::encode( encoding, value, sink );
+				sink->append( "\"" );
 			}
 		}
 
@@ -341,26 +439,122 @@ void SP_XmlDomBuffer :: dumpElement( const char * encoding,
 
 		if( children->getLength() > 0 ) {
 			if( SP_XmlNode::eCDATA != children->get( 0 )->getType() ) {
-				buffer->append( level >= 0 ? ">\n" : ">" );
+				sink->append( level >= 0 ? ">\n" : ">" );
 			} else {
-				buffer->append( ">" );
+				sink->append( ">" );
 			}
 
 			for( int j = 0; j < children->getLength(); j++ ) {
-				dump( encoding, children->get( j ), buffer, level >= 0 ? level + 1 : -1 );
+				dump( encoding, children->get( j ), sink, level >= 0 ? level + 1 : -1 );
 			}
 
 			if( SP_XmlNode::eCDATA != children->get( 0 )->getType() ) {
-				for( int i = 0; i < level; i++ ) buffer->append( '\t' );
+				appendTabs( sink, level );
 			}
-			buffer->append( "</" );
-			buffer->append( element->getName() );
-			buffer->append( level >= 0 ? ">\n" : ">" );
+			sink->append( "</" );
+			sink->append( element->getName() );
+			sink->append( level >= 0 ? ">\n" : ">" );
 		} else {
-			buffer->append( level >= 0 ? "/>\n" : ">" );
+			sink->append( level >= 0 ? "/>\n" : "/>" );
 		}
 	} else {
-		dump( encoding, node, buffer, level );
+		dump( encoding, node, sink, level );
+	}
+}
+
+
+int SP_XmlDomBuffer :: getDumpSize( const char * encoding,
+		const SP_XmlNode * node, int level )
+{
+	if( NULL == node ) return 0;
+
+	int size = 0;
+
+	if( SP_XmlNode::eXMLDOC == node->getType() ) {
+		SP_XmlDocument * document = static_cast<SP_XmlDocument*>((SP_XmlNode*)node);
+		size += getDumpSize( encoding, document->getDocDecl(), level );
+		size += getDumpSize( encoding, document->getDocType(), level );
+
+		const SP_XmlNodeList * children = document->getChildren();
+		for( int j = 0; j < children->getLength(); j++ ) {
+			size += getDumpSize( encoding, children->get( j ), level );
+		}
+	} else if( SP_XmlNode::eCDATA == node->getType() ) {
+		SP_XmlCDataNode * cdata = static_cast<SP_XmlCDataNode*>((SP_XmlNode*)node);
+		size += SP_XmlStringCodec::getEncodedSize( encoding, cdata->getText() );
+	} else if( SP_XmlNode::eCOMMENT == node->getType() ) {
+		SP_XmlCommentNode * comment = static_cast<SP_XmlCommentNode*>((SP_XmlNode*)node);
+
+		size += lengthOf( comment->getText() ) + 7;
+		if( level >= 0 ) size += 2 + level;
+	} else if( SP_XmlNode::eELEMENT == node->getType() ) {
+		size += getElementSize( encoding, node, level );
+	} else if( SP_XmlNode::eDOCDECL == node->getType() ) {
+		SP_XmlDocDeclNode * docDecl = static_cast<SP_XmlDocDeclNode*>((SP_XmlNode*)node);
+
+		size += 15 + 2 + ( level >= 0 ? 3 : 2 );
+		size += '\0' != * ( docDecl->getVersion() ) ? strlen( docDecl->getVersion() ) : 3;
+		if( '\0' != * ( docDecl->getEncoding() ) ) {
+			size += 10 + strlen( docDecl->getEncoding() ) + 2;
+		}
+		if( -1 != docDecl->getStandalone() ) {
+			size += 0 == docDecl->getStandalone() ? 16 : 17;
+		}
+	} else if( SP_XmlNode::eDOCTYPE == node->getType() ) {
+		SP_XmlDocTypeNode * docType = static_cast<SP_XmlDocTypeNode*>((SP_XmlNode*)node);
+
+		size += 10 + lengthOf( docType->getName() ) + ( level >= 0 ? 2 : 1 );
+		if( '\0' != * ( docType->getPublicID() ) ) size += 10 + strlen( docType->getPublicID() );
+		if( '\0' != * ( docType->getSystemID() ) ) size += 10 + strlen( docType->getSystemID() );
+		if( '\0' != * ( docType->getDTD() ) ) size += 3 + strlen( docType->getDTD() );
+	} else if( SP_XmlNode::ePI == node->getType() ) {
+		SP_XmlPINode * piNode = static_cast<SP_XmlPINode*>((SP_XmlNode*)node);
+
+		size += 4 + lengthOf( piNode->getTarget() ) + lengthOf( piNode->getData() );
+		if( level >= 0 ) {
+			size += level + 2;
+		} else {
+			if( '\0' != *( piNode->getTarget() ) ) size++;
+		}
 	}
+
+	return size;
 }
 
+int SP_XmlDomBuffer :: getElementSize( const char * encoding,
+		const SP_XmlNode * node, int level )
+{
+	SP_XmlElementNode * element = static_cast<SP_XmlElementNode*>((SP_XmlNode*)node);
+
+	int nameLen = lengthOf( element->getName() );
+
+	int size = ( level > 0 ? level : 0 ) + 1 + nameLen;
+
+	const char * name = NULL, * value = NULL;
+	for( int i = 0; i < element->getAttrCount(); i++ ) {
+		name = element->getAttr( i, &value );
+		if( NULL != name && NULL != value ) {
+			size += strlen( name ) + 4;
+			size += SP_XmlStringCodec::getEncodedSize( encoding, value );
+		}
+	}
+
+	const SP_XmlNodeList * children = element->getChildren();
+
+	if( children->getLength() > 0 ) {
+		int isCData = ( SP_XmlNode::eCDATA == children->get( 0 )->getType() );
+
+		size += ( ! isCData && level >= 0 ) ? 2 : 1;
+
+		for( int j = 0; j < children->getLength(); j++ ) {
+			size += getDumpSize( encoding, children->get( j ), level >= 0 ? level + 1 : -1 );
+		}
+
+		if( ! isCData && level > 0 ) size += level;
+		size += 2 + nameLen + ( level >= 0 ? 2 : 1 );
+	} else {
+		size += level >= 0 ? 3 : 2;
+	}
+
+	return size;
+}
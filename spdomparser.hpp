@@ -12,7 +12,9 @@ class SP_XmlElementNode;
 class SP_XmlDocDeclNode;
 class SP_XmlDocTypeNode;
 class SP_XmlPullParser;
+class SP_XmlPullEvent;
 class SP_XmlStringBuffer;
+class SP_XmlOutputSink;
 
 /// parse string to xml node tree
 class SP_XmlDomParser {
@@ -24,6 +26,15 @@ public:
 	/// @return how much byte has been consumed
 	int append( const char * source, int len );
 
+	/// parse a whole document in memory, a truncated one is an error
+	/// @return 0 : OK, -1 : error, see getError
+	int parse( const char * source, int len );
+
+	/// parse a whole file, a regular file is mapped instead of copied,
+	/// see SP_XmlPullParser::parseFile
+	/// @return 0 : OK, -1 : error, see getError
+	int parseFile( const char * path );
+
 	/// @return NOT NULL : the detail error message
 	/// @return NULL : no error
 	const char * getError();
@@ -31,6 +42,18 @@ public:
 	/// get the parse result
 	const SP_XmlDocument * getDocument() const;
 
+	/// take over the parse result, the caller should delete it,
+	/// the parser starts an empty document
+	SP_XmlDocument * takeDocument();
+
+	/// add an event pulled by another parser to the tree, it takes over
+	/// the event, the events must come in document order
+	void addEvent( SP_XmlPullEvent * event );
+
+	/// forget the current document, and be ready for the next one, the
+	/// pull parser and its buffers are reused, see SP_XmlPullParser::reset
+	void reset();
+
 	void setIgnoreWhitespace( int ignoreWhitespace );
 
 	int getIgnoreWhitespace();
@@ -60,6 +83,21 @@ public:
 
 public:
 
+	/// write to a sink, nothing is accumulated in memory beyond the sink's chunk,
+	/// level : 0 - indent, -1 - no indent, call sink->flush() when done
+	static void dumpDocDecl( const char * encoding,
+			const SP_XmlDocDeclNode * docDecl,
+			SP_XmlOutputSink * sink, int level );
+	static void dumpDocType( const char * encoding,
+			const SP_XmlDocTypeNode * docType,
+			SP_XmlOutputSink * sink, int level );
+	static void dump( const char * encoding,
+			const SP_XmlNode * node,
+			SP_XmlOutputSink * sink, int level );
+	static void dumpElement( const char * encoding,
+			const SP_XmlNode * node,
+			SP_XmlOutputSink * sink, int level );
+
 	static void dumpDocDecl( const char * encoding,
 			const SP_XmlDocDeclNode * docDecl,
 			SP_XmlStringBuffer * buffer, int level );
@@ -73,10 +111,18 @@ public:
 			const SP_XmlNode * node,
 			SP_XmlStringBuffer * buffer, int level );
 
+	/// @return the exact length of dump( encoding, node, ..., level ),
+	/// for a Content-Length before streaming, or a SP_XmlStringSink::reserve
+	static int getDumpSize( const char * encoding,
+			const SP_XmlNode * node, int level );
+
 private:
 	SP_XmlDomBuffer( SP_XmlDomBuffer & );
 	SP_XmlDomBuffer & operator=( SP_XmlDomBuffer & );
 
+	static int getElementSize( const char * encoding,
+			const SP_XmlNode * node, int level );
+
 	SP_XmlStringBuffer * mBuffer;
 };
 
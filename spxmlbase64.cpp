@@ -0,0 +1,531 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spxmlbase64.hpp"
+#include "spxmlsink.hpp"
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define SP_XML_BASE64_X86
+#include <immintrin.h>
+#endif
+
+enum { eInvalid = -1, eSpace = -2, ePad = -3 };
+
+// the output is collected on the stack, and appended to the sink in chunks
+enum { OUT_SIZE = 4096 };
+
+static const signed char DECODE_TABLE[ 256 ] = {
+	 -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -2,  -2,  -1,  -1,  -2,  -1,  -1,
+	 -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+	 -2,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  62,  -1,  -1,  -1,  63,
+	 52,  53,  54,  55,  56,  57,  58,  59,  60,  61,  -1,  -1,  -1,  -3,  -1,  -1,
+	 -1,   0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,
+	 15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25,  -1,  -1,  -1,  -1,  -1,
+	 -1,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+	 41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  -1,  -1,  -1,  -1,  -1,
+	 -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+	 -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+	 -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+	 -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+	 -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+	 -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+	 -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,
+	 -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1,  -1
+};
+
+static const char ENCODE_TABLE[] =
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/// decode whole blocks while they have no whitespace or padding
+/// @return the chars consumed, a multiple of 4, 3/4 of it is written to out
+typedef int ( * DecodeBlocks_t )( const unsigned char * in, int len, unsigned char * out );
+
+/// encode whole blocks, out must have room for 8 bytes more than the result
+/// @return the bytes consumed, a multiple of 3, 4/3 of it is written to out
+typedef int ( * EncodeBlocks_t )( const unsigned char * in, int len, char * out );
+
+typedef struct tagSP_XmlBase64Impl {
+	const char * mName;
+	DecodeBlocks_t mDecode;
+	EncodeBlocks_t mEncode;
+} SP_XmlBase64Impl_t;
+
+#ifdef SP_XML_BASE64_X86
+
+/* The vector kernels follow Mula and Lemire, "Faster Base64 Encoding and
+ * Decoding Using AVX2 Instructions". A char is classified by its two
+ * nibbles, which also select the offset to its 6-bit value. */
+
+__attribute__(( target( "ssse3" ) ))
+static inline int decodeBlock16( __m128i str, __m128i * result )
+{
+	const __m128i lutLo = _mm_setr_epi8( 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A );
+	const __m128i lutHi = _mm_setr_epi8( 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+			0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+	const __m128i lutRoll = _mm_setr_epi8( 0, 16, 19, 4, -65, -65, -71, -71,
+			0, 0, 0, 0, 0, 0, 0, 0 );
+	const __m128i nibble = _mm_set1_epi8( 0x0F );
+
+	__m128i hiNibbles = _mm_and_si128( _mm_srli_epi32( str, 4 ), nibble );
+	__m128i loNibbles = _mm_and_si128( str, nibble );
+
+	// a valid char has no bit in common in its two entries, >= 0x80 included
+	__m128i check = _mm_and_si128( _mm_shuffle_epi8( lutLo, loNibbles ),
+			_mm_shuffle_epi8( lutHi, hiNibbles ) );
+	if( 0xFFFF != _mm_movemask_epi8( _mm_cmpeq_epi8( check, _mm_setzero_si128() ) ) ) return -1;
+
+	__m128i isSlash = _mm_cmpeq_epi8( str, _mm_set1_epi8( 0x2F ) );
+	__m128i roll = _mm_shuffle_epi8( lutRoll, _mm_add_epi8( isSlash, hiNibbles ) );
+	__m128i values = _mm_add_epi8( str, roll );
+
+	// pack 4 x 6 bits into 3 bytes, in each 32 bits
+	__m128i merged = _mm_maddubs_epi16( values, _mm_set1_epi32( 0x01400140 ) );
+	merged = _mm_madd_epi16( merged, _mm_set1_epi32( 0x00011000 ) );
+
+	*result = _mm_shuffle_epi8( merged, _mm_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8,
+			14, 13, 12, -1, -1, -1, -1 ) );
+
+	return 0;
+}
+
+__attribute__(( target( "ssse3" ) ))
+static int decodeBlocksSsse3( const unsigned char * in, int len, unsigned char * out )
+{
+	int done = 0;
+
+	for( ; len - done >= 16; done += 16, out += 12 ) {
+		__m128i result;
+		if( 0 != decodeBlock16( _mm_loadu_si128( (const __m128i*)( in + done ) ), &result ) ) break;
+		_mm_storeu_si128( (__m128i*)out, result );
+	}
+
+	return done;
+}
+
+__attribute__(( target( "avx2" ) ))
+static int decodeBlocksAvx2( const unsigned char * in, int len, unsigned char * out )
+{
+	const __m256i lutLo = _mm256_setr_epi8( 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+			0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A );
+	const __m256i lutHi = _mm256_setr_epi8( 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+			0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+			0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+			0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 );
+	const __m256i lutRoll = _mm256_setr_epi8( 0, 16, 19, 4, -65, -65, -71, -71,
+			0, 0, 0, 0, 0, 0, 0, 0,
+			0, 16, 19, 4, -65, -65, -71, -71,
+			0, 0, 0, 0, 0, 0, 0, 0 );
+	const __m256i nibble = _mm256_set1_epi8( 0x0F );
+	const __m256i pack = _mm256_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+
+	int done = 0;
+
+	for( ; len - done >= 32; done += 32, out += 24 ) {
+		__m256i str = _mm256_loadu_si256( (const __m256i*)( in + done ) );
+
+		__m256i hiNibbles = _mm256_and_si256( _mm256_srli_epi32( str, 4 ), nibble );
+		__m256i loNibbles = _mm256_and_si256( str, nibble );
+
+		__m256i check = _mm256_and_si256( _mm256_shuffle_epi8( lutLo, loNibbles ),
+				_mm256_shuffle_epi8( lutHi, hiNibbles ) );
+		if( -1 != _mm256_movemask_epi8( _mm256_cmpeq_epi8( check, _mm256_setzero_si256() ) ) ) break;
+
+		__m256i isSlash = _mm256_cmpeq_epi8( str, _mm256_set1_epi8( 0x2F ) );
+		__m256i roll = _mm256_shuffle_epi8( lutRoll, _mm256_add_epi8( isSlash, hiNibbles ) );
+		__m256i values = _mm256_add_epi8( str, roll );
+
+		__m256i merged = _mm256_maddubs_epi16( values, _mm256_set1_epi32( 0x01400140 ) );
+		merged = _mm256_madd_epi16( merged, _mm256_set1_epi32( 0x00011000 ) );
+		merged = _mm256_shuffle_epi8( merged, pack );
+
+		// 12 bytes in each lane, move them together
+		merged = _mm256_permutevar8x32_epi32( merged, _mm256_setr_epi32( 0, 1, 2, 4, 5, 6, 7, 7 ) );
+		_mm256_storeu_si256( (__m256i*)out, merged );
+	}
+
+	return done + decodeBlocksSsse3( in + done, len - done, out );
+}
+
+__attribute__(( target( "ssse3" ) ))
+static inline __m128i encodeBlock12( __m128i in )
+{
+	// the 3 bytes of each group are spread to 32 bits, 6 bits in each byte
+	in = _mm_shuffle_epi8( in, _mm_set_epi8( 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1 ) );
+
+	__m128i t0 = _mm_and_si128( in, _mm_set1_epi32( 0x0fc0fc00 ) );
+	__m128i t1 = _mm_mulhi_epu16( t0, _mm_set1_epi32( 0x04000040 ) );
+	__m128i t2 = _mm_and_si128( in, _mm_set1_epi32( 0x003f03f0 ) );
+	__m128i t3 = _mm_mullo_epi16( t2, _mm_set1_epi32( 0x01000010 ) );
+	__m128i indices = _mm_or_si128( t1, t3 );
+
+	// the offset of each range of the alphabet
+	const __m128i shift = _mm_setr_epi8( 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63,
+			'A', 0, 0 );
+
+	__m128i range = _mm_subs_epu8( indices, _mm_set1_epi8( 51 ) );
+	__m128i isUpper = _mm_cmpgt_epi8( _mm_set1_epi8( 26 ), indices );
+	range = _mm_or_si128( range, _mm_and_si128( isUpper, _mm_set1_epi8( 13 ) ) );
+
+	return _mm_add_epi8( indices, _mm_shuffle_epi8( shift, range ) );
+}
+
+__attribute__(( target( "ssse3" ) ))
+static int encodeBlocksSsse3( const unsigned char * in, int len, char * out )
+{
+	int done = 0;
+
+	// 16 bytes are read for the 12 used
+	for( ; len - done >= 16; done += 12, out += 16 ) {
+		__m128i block = encodeBlock12( _mm_loadu_si128( (const __m128i*)( in + done ) ) );
+		_mm_storeu_si128( (__m128i*)out, block );
+	}
+
+	return done;
+}
+
+__attribute__(( target( "avx2" ) ))
+static int encodeBlocksAvx2( const unsigned char * in, int len, char * out )
+{
+	const __m256i spread = _mm256_setr_epi8( 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+			1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10 );
+	const __m256i shift = _mm256_setr_epi8( 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63,
+			'A', 0, 0,
+			'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63,
+			'A', 0, 0 );
+
+	int done = 0;
+
+	// 12 bytes for each lane, 28 bytes are read for the 24 used
+	for( ; len - done >= 28; done += 24, out += 32 ) {
+		__m256i in2 = _mm256_inserti128_si256( _mm256_castsi128_si256(
+				_mm_loadu_si128( (const __m128i*)( in + done ) ) ),
+				_mm_loadu_si128( (const __m128i*)( in + done + 12 ) ), 1 );
+
+		in2 = _mm256_shuffle_epi8( in2, spread );
+
+		__m256i t0 = _mm256_and_si256( in2, _mm256_set1_epi32( 0x0fc0fc00 ) );
+		__m256i t1 = _mm256_mulhi_epu16( t0, _mm256_set1_epi32( 0x04000040 ) );
+		__m256i t2 = _mm256_and_si256( in2, _mm256_set1_epi32( 0x003f03f0 ) );
+		__m256i t3 = _mm256_mullo_epi16( t2, _mm256_set1_epi32( 0x01000010 ) );
+		__m256i indices = _mm256_or_si256( t1, t3 );
+
+		__m256i range = _mm256_subs_epu8( indices, _mm256_set1_epi8( 51 ) );
+		__m256i isUpper = _mm256_cmpgt_epi8( _mm256_set1_epi8( 26 ), indices );
+		range = _mm256_or_si256( range, _mm256_and_si256( isUpper, _mm256_set1_epi8( 13 ) ) );
+
+		_mm256_storeu_si256( (__m256i*)out,
+				_mm256_add_epi8( indices, _mm256_shuffle_epi8( shift, range ) ) );
+	}
+
+	return done + encodeBlocksSsse3( in + done, len - done, out );
+}
+
+#endif
+
+static const SP_XmlBase64Impl_t IMPLS[] = {
+#ifdef SP_XML_BASE64_X86
+	{ "avx2", decodeBlocksAvx2, encodeBlocksAvx2 },
+	{ "ssse3", decodeBlocksSsse3, encodeBlocksSsse3 },
+#endif
+	{ "scalar", NULL, NULL }
+};
+
+static const SP_XmlBase64Impl_t * gForcedImpl = NULL;
+
+static const SP_XmlBase64Impl_t * detectImpl()
+{
+	const SP_XmlBase64Impl_t * impl = IMPLS;
+
+#ifdef SP_XML_BASE64_X86
+	__builtin_cpu_init();
+	if( ! __builtin_cpu_supports( "avx2" ) ) impl++;
+	if( ! __builtin_cpu_supports( "ssse3" ) ) impl++;
+#endif
+
+	return impl;
+}
+
+static const SP_XmlBase64Impl_t * getImplementation()
+{
+	if( NULL != gForcedImpl ) return gForcedImpl;
+
+	static const SP_XmlBase64Impl_t * impl = detectImpl();
+
+	return impl;
+}
+
+//=========================================================
+
+SP_XmlBase64Decoder :: SP_XmlBase64Decoder( SP_XmlOutputSink * sink )
+{
+	mSink = sink;
+	reset();
+}
+
+SP_XmlBase64Decoder :: ~SP_XmlBase64Decoder()
+{
+}
+
+void SP_XmlBase64Decoder :: reset()
+{
+	mGroup = 0;
+	mGroupLen = 0;
+	mPadding = 0;
+	mIsEnd = 0;
+	mError = NULL;
+}
+
+int SP_XmlBase64Decoder :: setError( const char * error )
+{
+	if( NULL == mError ) mError = error;
+
+	return -1;
+}
+
+const char * SP_XmlBase64Decoder :: getError() const
+{
+	return mError;
+}
+
+int SP_XmlBase64Decoder :: append( const char * text, int len )
+{
+	if( NULL != mError ) return -1;
+
+	const SP_XmlBase64Impl_t * impl = getImplementation();
+
+	const unsigned char * in = (const unsigned char*)text;
+	const unsigned char * end = in + len;
+
+	// room for the last vector store
+	unsigned char out[ OUT_SIZE + 32 ];
+	int outLen = 0;
+
+	for( ; in < end; ) {
+		if( outLen > OUT_SIZE - 64 ) {
+			mSink->append( (char*)out, outLen );
+			outLen = 0;
+		}
+
+		// whole groups go to the vector code, until whitespace or padding
+		if( 0 == mGroupLen && 0 == mPadding && NULL != impl->mDecode ) {
+			int room = ( OUT_SIZE - outLen ) / 3 * 4;
+			int done = impl->mDecode( in, end - in < room ? end - in : room, out + outLen );
+			in += done;
+			outLen += done / 4 * 3;
+			if( in >= end ) break;
+		}
+
+		int value = DECODE_TABLE[ *in++ ];
+
+		if( value >= 0 ) {
+			if( mPadding > 0 ) return setError( "base64 data after padding" );
+
+			mGroup = ( mGroup << 6 ) | value;
+			if( 4 == ++mGroupLen ) {
+				out[ outLen++ ] = (unsigned char)( mGroup >> 16 );
+				out[ outLen++ ] = (unsigned char)( mGroup >> 8 );
+				out[ outLen++ ] = (unsigned char)mGroup;
+				mGroup = 0;
+				mGroupLen = 0;
+			}
+		} else if( ePad == value ) {
+			if( mIsEnd || mGroupLen < 2 ) return setError( "misplaced base64 padding" );
+
+			if( 4 == mGroupLen + ++mPadding ) {
+				if( 2 == mGroupLen ) {
+					out[ outLen++ ] = (unsigned char)( mGroup >> 4 );
+				} else {
+					out[ outLen++ ] = (unsigned char)( mGroup >> 10 );
+					out[ outLen++ ] = (unsigned char)( mGroup >> 2 );
+				}
+				mGroup = 0;
+				mGroupLen = 0;
+				mIsEnd = 1;
+			}
+		} else if( eSpace != value ) {
+			return setError( "invalid base64 char" );
+		}
+	}
+
+	if( outLen > 0 ) mSink->append( (char*)out, outLen );
+
+	return 0;
+}
+
+int SP_XmlBase64Decoder :: finish()
+{
+	if( NULL != mError ) return -1;
+
+	if( mPadding > 0 && ! mIsEnd ) return setError( "incomplete base64 padding" );
+	if( 1 == mGroupLen ) return setError( "truncated base64 group" );
+
+	// the padding is optional
+	char out[ 2 ];
+	if( 2 == mGroupLen ) {
+		out[ 0 ] = (char)( mGroup >> 4 );
+		mSink->append( out, 1 );
+	} else if( 3 == mGroupLen ) {
+		out[ 0 ] = (char)( mGroup >> 10 );
+		out[ 1 ] = (char)( mGroup >> 2 );
+		mSink->append( out, 2 );
+	}
+
+	reset();
+
+	return 0 == mSink->getError() ? 0 : -1;
+}
+
+//=========================================================
+
+SP_XmlBase64Encoder :: SP_XmlBase64Encoder( SP_XmlOutputSink * sink )
+{
+	mSink = sink;
+	reset();
+}
+
+SP_XmlBase64Encoder :: ~SP_XmlBase64Encoder()
+{
+}
+
+void SP_XmlBase64Encoder :: reset()
+{
+	mTailLen = 0;
+}
+
+static inline void encodeGroup( const unsigned char * in, char * out )
+{
+	out[ 0 ] = ENCODE_TABLE[ in[ 0 ] >> 2 ];
+	out[ 1 ] = ENCODE_TABLE[ ( ( in[ 0 ] & 0x03 ) << 4 ) | ( in[ 1 ] >> 4 ) ];
+	out[ 2 ] = ENCODE_TABLE[ ( ( in[ 1 ] & 0x0F ) << 2 ) | ( in[ 2 ] >> 6 ) ];
+	out[ 3 ] = ENCODE_TABLE[ in[ 2 ] & 0x3F ];
+}
+
+int SP_XmlBase64Encoder :: append( const void * data, int len )
+{
+	const SP_XmlBase64Impl_t * impl = getImplementation();
+
+	const unsigned char * in = (const unsigned char*)data;
+	const unsigned char * end = in + len;
+
+	char out[ OUT_SIZE + 32 ];
+	int outLen = 0;
+
+	// complete the group left by the last append
+	if( mTailLen > 0 ) {
+		for( ; mTailLen < 3 && in < end; ) mTail[ mTailLen++ ] = *in++;
+		if( mTailLen < 3 ) return 0;
+
+		encodeGroup( mTail, out );
+		outLen = 4;
+		mTailLen = 0;
+	}
+
+	for( ; end - in >= 3; ) {
+		if( outLen > OUT_SIZE - 64 ) {
+			mSink->append( out, outLen );
+			outLen = 0;
+		}
+
+		if( NULL != impl->mEncode ) {
+			int room = ( OUT_SIZE - outLen ) / 4 * 3;
+			int done = impl->mEncode( in, end - in < room ? end - in : room, out + outLen );
+			in += done;
+			outLen += done / 3 * 4;
+			if( end - in < 3 ) break;
+		}
+
+		encodeGroup( in, out + outLen );
+		in += 3;
+		outLen += 4;
+	}
+
+	for( ; in < end; ) mTail[ mTailLen++ ] = *in++;
+
+	return outLen > 0 ? mSink->append( out, outLen ) : 0;
+}
+
+int SP_XmlBase64Encoder :: finish()
+{
+	if( mTailLen > 0 ) {
+		char out[ 4 ] = { '=', '=', '=', '=' };
+
+		out[ 0 ] = ENCODE_TABLE[ mTail[ 0 ] >> 2 ];
+		if( 1 == mTailLen ) {
+			out[ 1 ] = ENCODE_TABLE[ ( mTail[ 0 ] & 0x03 ) << 4 ];
+		} else {
+			out[ 1 ] = ENCODE_TABLE[ ( ( mTail[ 0 ] & 0x03 ) << 4 ) | ( mTail[ 1 ] >> 4 ) ];
+			out[ 2 ] = ENCODE_TABLE[ ( mTail[ 1 ] & 0x0F ) << 2 ];
+		}
+
+		mSink->append( out, 4 );
+		mTailLen = 0;
+	}
+
+	return 0 == mSink->getError() ? 0 : -1;
+}
+
+//=========================================================
+
+int SP_XmlBase64 :: decode( const char * text, int len, SP_XmlOutputSink * sink )
+{
+	SP_XmlBase64Decoder decoder( sink );
+
+	if( 0 != decoder.append( text, len ) ) return -1;
+
+	return decoder.finish();
+}
+
+int SP_XmlBase64 :: encode( const void * data, int len, SP_XmlOutputSink * sink )
+{
+	SP_XmlBase64Encoder encoder( sink );
+
+	if( 0 != encoder.append( data, len ) ) return -1;
+
+	return encoder.finish();
+}
+
+int SP_XmlBase64 :: getEncodedSize( int len )
+{
+	return ( len + 2 ) / 3 * 4;
+}
+
+int SP_XmlBase64 :: getDecodedSize( int len )
+{
+	return ( len + 3 ) / 4 * 3;
+}
+
+const char * SP_XmlBase64 :: getImpl()
+{
+	return getImplementation()->mName;
+}
+
+int SP_XmlBase64 :: setImpl( const char * name )
+{
+	const SP_XmlBase64Impl_t * best = detectImpl();
+
+	for( const SP_XmlBase64Impl_t * impl = IMPLS; ; impl++ ) {
+		// the list is from the best, the ones before the detected are not supported
+		if( 0 == strcmp( impl->mName, name ) ) {
+			if( impl < best ) return -1;
+			gForcedImpl = impl;
+			return 0;
+		}
+		if( NULL == impl->mDecode ) break;
+	}
+
+	return -1;
+}
+
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmlbase64_hpp__
+#define __spxmlbase64_hpp__
+
+class SP_XmlOutputSink;
+
+/**
+ *  Decode base64 text which comes in pieces of any size, straight to a sink.
+ *  Whitespace is skipped, the padding is optional.
+ *
+ *	@verbatim
+ *	SP_XmlFdSink sink( fd );
+ *	SP_XmlBase64Decoder decoder( &sink );
+ *	decoder.append( text, len );	// as many times as needed
+ *	if( 0 != decoder.finish() ) printf( "%s\n", decoder.getError() );
+ *	sink.flush();
+ *	@endverbatim
+ */
+class SP_XmlBase64Decoder {
+public:
+	SP_XmlBase64Decoder( SP_XmlOutputSink * sink );
+	~SP_XmlBase64Decoder();
+
+	/// @return 0 : OK, -1 : invalid text, see getError
+	int append( const char * text, int len );
+
+	/// decode the last group, the sink is not flushed
+	int finish();
+
+	/// for the next text, to the same sink
+	void reset();
+
+	const char * getError() const;
+
+private:
+	SP_XmlBase64Decoder( SP_XmlBase64Decoder & );
+	SP_XmlBase64Decoder & operator=( SP_XmlBase64Decoder & );
+
+	int setError( const char * error );
+
+	SP_XmlOutputSink * mSink;
+
+	// the bits of the partial group
+	unsigned int mGroup;
+	int mGroupLen;
+	int mPadding;
+	int mIsEnd;
+
+	const char * mError;
+};
+
+/// encode bytes which come in pieces of any size, without line breaks
+class SP_XmlBase64Encoder {
+public:
+	SP_XmlBase64Encoder( SP_XmlOutputSink * sink );
+	~SP_XmlBase64Encoder();
+
+	int append( const void * data, int len );
+
+	/// write the last group with padding, the sink is not flushed
+	int finish();
+
+	void reset();
+
+private:
+	SP_XmlBase64Encoder( SP_XmlBase64Encoder & );
+	SP_XmlBase64Encoder & operator=( SP_XmlBase64Encoder & );
+
+	SP_XmlOutputSink * mSink;
+
+	unsigned char mTail[ 4 ];
+	int mTailLen;
+};
+
+/// the whole input at once, and the SIMD selection
+class SP_XmlBase64 {
+public:
+	/// @return 0 : OK, -1 : invalid text
+	static int decode( const char * text, int len, SP_XmlOutputSink * sink );
+
+	static int encode( const void * data, int len, SP_XmlOutputSink * sink );
+
+	static int getEncodedSize( int len );
+
+	/// the upper bound of the decoded size
+	static int getDecodedSize( int len );
+
+	/// "avx2", "ssse3" or "scalar", picked by the cpu at the first use
+	static const char * getImpl();
+
+	/// force an implementation, for benchmarks, call it before any use
+	/// @return -1 : the cpu does not support it
+	static int setImpl( const char * name );
+
+private:
+	SP_XmlBase64();
+};
+
+#endif
+
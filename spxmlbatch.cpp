@@ -0,0 +1,373 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spxmlbatch.hpp"
+#include "spdomparser.hpp"
+#include "spxmlnode.hpp"
+
+// one thread, the calling thread is the first one,
+// [ mNext, mEnd ) is the range of documents left to it
+struct tagSP_XmlBatchWorker {
+	SP_XmlBatchParser * mOwner;
+	SP_XmlDomParser * mDomParser;
+
+	pthread_mutex_t mMutex;
+	int mNext;
+	int mEnd;
+};
+
+//=========================================================
+
+SP_XmlBatchParser :: SP_XmlBatchParser( int threadCount )
+{
+	if( threadCount <= 0 ) threadCount = (int)sysconf( _SC_NPROCESSORS_ONLN );
+	if( threadCount <= 0 ) threadCount = 1;
+
+	pthread_mutex_init( &mMutex, NULL );
+	pthread_cond_init( &mWork, NULL );
+	pthread_cond_init( &mDone, NULL );
+	pthread_mutex_init( &mDeliverMutex, NULL );
+
+	mBatchId = mBusyCount = mIsShutdown = 0;
+
+	mCount = 0;
+	mSources = NULL;
+	mLens = NULL;
+
+	mDocuments = NULL;
+	mErrors = NULL;
+	mErrorCount = mStealCount = 0;
+
+	mCallback = NULL;
+	mCallbackArg = NULL;
+	mOrder = eInputOrder;
+
+	mIsParsed = NULL;
+	mDelivered = mIsDelivering = mIsStopped = 0;
+
+	mWorkers = (SP_XmlBatchWorker_t*)calloc( threadCount, sizeof( SP_XmlBatchWorker_t ) );
+	for( int i = 0; i < threadCount; i++ ) {
+		mWorkers[i].mOwner = this;
+		mWorkers[i].mDomParser = new SP_XmlDomParser();
+		pthread_mutex_init( &( mWorkers[i].mMutex ), NULL );
+	}
+
+	// the threads besides the calling one, with fewer of them if some fail
+	mThreads = (pthread_t*)malloc( threadCount * sizeof( pthread_t ) );
+	mThreadCount = 1;
+	for( int i = 1; i < threadCount; i++ ) {
+		if( 0 != pthread_create( mThreads + i - 1, NULL, workerMain, mWorkers + i ) ) break;
+		mThreadCount++;
+	}
+	for( int i = mThreadCount; i < threadCount; i++ ) {
+		delete mWorkers[i].mDomParser;
+		pthread_mutex_destroy( &( mWorkers[i].mMutex ) );
+	}
+}
+
+SP_XmlBatchParser :: ~SP_XmlBatchParser()
+{
+	pthread_mutex_lock( &mMutex );
+	mIsShutdown = 1;
+	pthread_cond_broadcast( &mWork );
+	pthread_mutex_unlock( &mMutex );
+
+	for( int i = 0; i < mThreadCount - 1; i++ ) pthread_join( mThreads[i], NULL );
+	free( mThreads );
+
+	for( int i = 0; i < mThreadCount; i++ ) {
+		delete mWorkers[i].mDomParser;
+		pthread_mutex_destroy( &( mWorkers[i].mMutex ) );
+	}
+	free( mWorkers );
+
+	clear();
+
+	pthread_mutex_destroy( &mMutex );
+	pthread_cond_destroy( &mWork );
+	pthread_cond_destroy( &mDone );
+	pthread_mutex_destroy( &mDeliverMutex );
+}
+
+void SP_XmlBatchParser :: clear()
+{
+	for( int i = 0; i < mCount; i++ ) {
+		if( NULL != mDocuments[i] ) delete mDocuments[i];
+		if( NULL != mErrors[i] ) free( mErrors[i] );
+	}
+
+	if( NULL != mDocuments ) free( mDocuments );
+	if( NULL != mErrors ) free( mErrors );
+	if( NULL != mIsParsed ) free( mIsParsed );
+	mDocuments = NULL;
+	mErrors = NULL;
+	mIsParsed = NULL;
+
+	mCount = 0;
+	mSources = NULL;
+	mLens = NULL;
+}
+
+void SP_XmlBatchParser :: setIgnoreWhitespace( int ignoreWhitespace )
+{
+	for( int i = 0; i < mThreadCount; i++ ) {
+		mWorkers[i].mDomParser->setIgnoreWhitespace( ignoreWhitespace );
+	}
+}
+
+void SP_XmlBatchParser :: setDocumentCallback( DocumentCallback_t callback, void * arg, int order )
+{
+	mCallback = callback;
+	mCallbackArg = arg;
+	mOrder = order;
+}
+
+int SP_XmlBatchParser :: parse( int count, const char ** sources, const int * lens )
+{
+	clear();
+
+	mCount = count > 0 ? count : 0;
+	mSources = sources;
+	mLens = lens;
+
+	mDocuments = (SP_XmlDocument**)calloc( mCount + 1, sizeof( SP_XmlDocument * ) );
+	mErrors = (char**)calloc( mCount + 1, sizeof( char * ) );
+	if( NULL != mCallback && eInputOrder == mOrder ) mIsParsed = (char*)calloc( mCount + 1, 1 );
+
+	mErrorCount = mStealCount = 0;
+	mDelivered = mIsDelivering = mIsStopped = 0;
+
+	// contiguous ranges, the neighbour documents are parsed by the same thread
+	for( int i = 0; i < mThreadCount; i++ ) {
+		SP_XmlBatchWorker_t * worker = mWorkers + i;
+		pthread_mutex_lock( &( worker->mMutex ) );
+		worker->mNext = (int)( (long long)mCount * i / mThreadCount );
+		worker->mEnd = (int)( (long long)mCount * ( i + 1 ) / mThreadCount );
+		pthread_mutex_unlock( &( worker->mMutex ) );
+	}
+
+	pthread_mutex_lock( &mMutex );
+	mBatchId++;
+	mBusyCount = mThreadCount - 1;
+	pthread_cond_broadcast( &mWork );
+	pthread_mutex_unlock( &mMutex );
+
+	runWorker( mWorkers );
+
+	pthread_mutex_lock( &mMutex );
+	for( ; mBusyCount > 0; ) pthread_cond_wait( &mDone, &mMutex );
+	pthread_mutex_unlock( &mMutex );
+
+	// the ones not delivered after the callback stopped the batch
+	if( NULL != mCallback ) {
+		for( int i = 0; i < mCount; i++ ) {
+			if( NULL != mDocuments[i] ) delete mDocuments[i];
+			mDocuments[i] = NULL;
+		}
+	}
+
+	return 0 == mErrorCount && 0 == mIsStopped ? 0 : -1;
+}
+
+void * SP_XmlBatchParser :: workerMain( void * arg )
+{
+	SP_XmlBatchWorker_t * worker = (SP_XmlBatchWorker_t*)arg;
+	SP_XmlBatchParser * owner = worker->mOwner;
+
+	int batchId = 0;
+
+	pthread_mutex_lock( &( owner->mMutex ) );
+
+	for( ; ; ) {
+		for( ; batchId == owner->mBatchId && ! owner->mIsShutdown; ) {
+			pthread_cond_wait( &( owner->mWork ), &( owner->mMutex ) );
+		}
+		if( owner->mIsShutdown ) break;
+
+		batchId = owner->mBatchId;
+
+		pthread_mutex_unlock( &( owner->mMutex ) );
+		owner->runWorker( worker );
+		pthread_mutex_lock( &( owner->mMutex ) );
+
+		if( 0 == --owner->mBusyCount ) pthread_cond_signal( &( owner->mDone ) );
+	}
+
+	pthread_mutex_unlock( &( owner->mMutex ) );
+
+	return NULL;
+}
+
+void SP_XmlBatchParser :: runWorker( SP_XmlBatchWorker_t * worker )
+{
+	for( int index = claim( worker ); index >= 0; index = claim( worker ) ) {
+		parseOne( worker, index );
+	}
+}
+
+int SP_XmlBatchParser :: claim( SP_XmlBatchWorker_t * worker )
+{
+	if( 0 != __sync_fetch_and_add( &mIsStopped, 0 ) ) return -1;
+
+	int index = -1;
+
+	pthread_mutex_lock( &( worker->mMutex ) );
+	if( worker->mNext < worker->mEnd ) index = worker->mNext++;
+	pthread_mutex_unlock( &( worker->mMutex ) );
+
+	if( index >= 0 ) return index;
+
+	// steal the second half of the largest range, its owner keeps the first
+	for( ; ; ) {
+		SP_XmlBatchWorker_t * victim = NULL;
+		int largest = 0;
+
+		for( int i = 0; i < mThreadCount; i++ ) {
+			SP_XmlBatchWorker_t * other = mWorkers + i;
+			if( other == worker ) continue;
+
+			pthread_mutex_lock( &( other->mMutex ) );
+			int left = other->mEnd - other->mNext;
+			pthread_mutex_unlock( &( other->mMutex ) );
+
+			if( left > largest ) {
+				largest = left;
+				victim = other;
+			}
+		}
+
+		if( NULL == victim ) return -1;
+
+		int begin = 0, end = 0;
+
+		pthread_mutex_lock( &( victim->mMutex ) );
+		int left = victim->mEnd - victim->mNext;
+		if( left > 0 ) {
+			end = victim->mEnd;
+			begin = end - ( left + 1 ) / 2;
+			victim->mEnd = begin;
+		}
+		pthread_mutex_unlock( &( victim->mMutex ) );
+
+		// taken by its owner or another thief meanwhile, look again
+		if( left <= 0 ) continue;
+
+		pthread_mutex_lock( &( worker->mMutex ) );
+		worker->mNext = begin + 1;
+		worker->mEnd = end;
+		pthread_mutex_unlock( &( worker->mMutex ) );
+
+		__sync_fetch_and_add( &mStealCount, 1 );
+
+		return begin;
+	}
+}
+
+void SP_XmlBatchParser :: parseOne( SP_XmlBatchWorker_t * worker, int index )
+{
+	SP_XmlDomParser * parser = worker->mDomParser;
+
+	if( 0 == parser->parse( mSources[ index ], mLens[ index ] ) ) {
+		mDocuments[ index ] = parser->takeDocument();
+	} else {
+		mErrors[ index ] = strdup( parser->getError() );
+		__sync_fetch_and_add( &mErrorCount, 1 );
+	}
+
+	parser->reset();
+
+	if( NULL != mCallback ) deliver( index );
+}
+
+void SP_XmlBatchParser :: deliver( int index )
+{
+	pthread_mutex_lock( &mDeliverMutex );
+
+	if( eCompletionOrder == mOrder ) {
+		if( 0 == __sync_fetch_and_add( &mIsStopped, 0 ) ) {
+			SP_XmlDocument * document = mDocuments[ index ];
+			mDocuments[ index ] = NULL;
+			if( 0 != mCallback( mCallbackArg, index, document, mErrors[ index ] ) ) {
+				__sync_lock_test_and_set( &mIsStopped, 1 );
+			}
+		}
+
+		pthread_mutex_unlock( &mDeliverMutex );
+		return;
+	}
+
+	mIsParsed[ index ] = 1;
+
+	// one thread delivers all the documents which are ready in a row,
+	// the others only mark theirs, it sees them before it stops
+	if( ! mIsDelivering ) {
+		mIsDelivering = 1;
+
+		for( ; mDelivered < mCount && mIsParsed[ mDelivered ]
+				&& 0 == __sync_fetch_and_add( &mIsStopped, 0 ); ) {
+			int next = mDelivered++;
+			SP_XmlDocument * document = mDocuments[ next ];
+			mDocuments[ next ] = NULL;
+
+			pthread_mutex_unlock( &mDeliverMutex );
+			int ret = mCallback( mCallbackArg, next, document, mErrors[ next ] );
+			pthread_mutex_lock( &mDeliverMutex );
+
+			if( 0 != ret ) __sync_lock_test_and_set( &mIsStopped, 1 );
+		}
+
+		mIsDelivering = 0;
+	}
+
+	pthread_mutex_unlock( &mDeliverMutex );
+}
+
+int SP_XmlBatchParser :: getCount() const
+{
+	return mCount;
+}
+
+const SP_XmlDocument * SP_XmlBatchParser :: getDocument( int index ) const
+{
+	return index >= 0 && index < mCount ? mDocuments[ index ] : NULL;
+}
+
+SP_XmlDocument * SP_XmlBatchParser :: takeDocument( int index )
+{
+	SP_XmlDocument * document = NULL;
+
+	if( index >= 0 && index < mCount ) {
+		document = mDocuments[ index ];
+		mDocuments[ index ] = NULL;
+	}
+
+	return document;
+}
+
+const char * SP_XmlBatchParser :: getError( int index ) const
+{
+	return index >= 0 && index < mCount ? mErrors[ index ] : NULL;
+}
+
+int SP_XmlBatchParser :: getErrorCount() const
+{
+	return mErrorCount;
+}
+
+int SP_XmlBatchParser :: getThreadCount() const
+{
+	return mThreadCount;
+}
+
+int SP_XmlBatchParser :: getStealCount() const
+{
+	return mStealCount;
+}
+
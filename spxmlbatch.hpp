@@ -0,0 +1,132 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmlbatch_hpp__
+#define __spxmlbatch_hpp__
+
+#include <pthread.h>
+
+class SP_XmlDocument;
+
+typedef struct tagSP_XmlBatchWorker SP_XmlBatchWorker_t;
+
+/**
+ *  Parse many small independent documents, such as queued messages, on a
+ *  fixed pool of threads.
+ *
+ *  The documents of a batch are split in one range for each thread. A
+ *  thread which runs out of work steals the second half of the largest
+ *  range left, so a few big documents do not hold up the batch. Each
+ *  thread keeps its own SP_XmlDomParser, and reuses it, with its readers
+ *  and buffers, for all the documents it parses, batch after batch.
+ *
+ *	@verbatim
+ *	SP_XmlBatchParser batch;
+ *	if( 0 != batch.parse( count, messages, lens ) ) {
+ *		for( int i = 0; i < count; i++ ) {
+ *			if( NULL != batch.getError( i ) ) printf( "%d: %s\n", i, batch.getError( i ) );
+ *		}
+ *	}
+ *	SP_XmlDocument * doc = batch.takeDocument( 0 );
+ *	@endverbatim
+ */
+class SP_XmlBatchParser {
+public:
+	enum { eInputOrder, eCompletionOrder };
+
+	/// called by one thread at a time, it takes over document,
+	/// document is NULL when error is not NULL
+	/// @return 0 : OK, -1 : stop the batch
+	typedef int ( * DocumentCallback_t )( void * arg, int index,
+			SP_XmlDocument * document, const char * error );
+
+	/// threadCount : <= 0 means the number of cpus, the calling thread is one of them
+	SP_XmlBatchParser( int threadCount = 0 );
+	~SP_XmlBatchParser();
+
+	/// default ignoreWhitespace is true, set it between batches
+	void setIgnoreWhitespace( int ignoreWhitespace );
+
+	/// hand the documents over to callback, in input order or as soon as
+	/// they are parsed, instead of keeping them for getDocument
+	void setDocumentCallback( DocumentCallback_t callback, void * arg,
+			int order = eInputOrder );
+
+	/// parse count whole documents, the sources must stay valid until parse returns
+	/// @return 0 : all are parsed, -1 : some have errors, or the callback stops
+	int parse( int count, const char ** sources, const int * lens );
+
+	/// the results of the last batch, without a callback
+	int getCount() const;
+	const SP_XmlDocument * getDocument( int index ) const;
+
+	/// take over document index, the caller should delete it
+	SP_XmlDocument * takeDocument( int index );
+
+	/// @return NOT NULL : the detail error message of document index
+	/// @return NULL : no error
+	const char * getError( int index ) const;
+
+	int getErrorCount() const;
+
+	int getThreadCount() const;
+
+	/// how many ranges were stolen in the last batch
+	int getStealCount() const;
+
+private:
+	SP_XmlBatchParser( SP_XmlBatchParser & );
+	SP_XmlBatchParser & operator=( SP_XmlBatchParser & );
+
+	/// free the results of the last batch
+	void clear();
+
+	static void * workerMain( void * arg );
+
+	void runWorker( SP_XmlBatchWorker_t * worker );
+
+	/// @return the next document of worker, -1 : none left
+	int claim( SP_XmlBatchWorker_t * worker );
+
+	void parseOne( SP_XmlBatchWorker_t * worker, int index );
+
+	void deliver( int index );
+
+	int mThreadCount;
+	SP_XmlBatchWorker_t * mWorkers;
+	pthread_t * mThreads;
+
+	pthread_mutex_t mMutex;
+	pthread_cond_t mWork;
+	pthread_cond_t mDone;
+
+	// a new batch for each increment, the threads still in it
+	int mBatchId;
+	int mBusyCount;
+	int mIsShutdown;
+
+	int mCount;
+	const char ** mSources;
+	const int * mLens;
+
+	SP_XmlDocument ** mDocuments;
+	char ** mErrors;
+	int mErrorCount;
+	int mStealCount;
+
+	DocumentCallback_t mCallback;
+	void * mCallbackArg;
+	int mOrder;
+
+	// the delivery in input order : the parsed ones, the next to deliver
+	pthread_mutex_t mDeliverMutex;
+	char * mIsParsed;
+	int mDelivered;
+	int mIsDelivering;
+	int mIsStopped;
+};
+
+#endif
+
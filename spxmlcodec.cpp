@@ -9,6 +9,7 @@
 
 #include "spxmlcodec.hpp"
 #include "spxmlutils.hpp"
+#include "spxmlsink.hpp"
 
 const char * SP_XmlStringCodec :: DEFAULT_ENCODING = "utf-8";
 
@@ -71,46 +72,161 @@ int SP_XmlStringCodec :: decode( const char * encoding, const char * encodeValue
 int SP_XmlStringCodec :: encode( const char * encoding, const char * decodeValue,
 		SP_XmlStringBuffer * outBuffer )
 {
-	int isUtf8 = ( 0 == strcasecmp( encoding, "utf-8" ) );
+	SP_XmlStringSink outSink( outBuffer );
+
+	return encode( encoding, decodeValue, &outSink );
+}
+
+int SP_XmlStringCodec :: encode( const char * encoding, const char * decodeValue,
+		SP_XmlOutputSink * outSink )
+{
+	return encode( encoding, decodeValue, -1, outSink );
+}
+
+// strcasecmp( encoding, "utf-8" ) without the locale
+static int isUtf8Encoding( const char * encoding )
+{
+	const char * utf8 = "utf-8";
+
+	for( ; '\0' != *utf8; utf8++, encoding++ ) {
+		if( *encoding != *utf8 && ! ( *utf8 >= 'a' && *encoding == *utf8 - 'a' + 'A' ) ) {
+			return 0;
+		}
+	}
+
+	return '\0' == *encoding;
+}
+
+// bytes which are written as is
+static inline int isPlainChar( unsigned char c, int isUtf8 )
+{
+	if( '\0' == c || '<' == c || '>' == c || '&' == c || '"' == c ) return 0;
+
+	return isUtf8 ? c < 0x80 : c >= 32;
+}
+
+static inline const char * getEscape( unsigned char c )
+{
+	switch( c ) {
+		case '<': return "&lt;";
+		case '>': return "&gt;";
+		case '&': return "&amp;";
+		case '"': return "&quot;";
+	}
+
+	return NULL;
+}
+
+// the bytes of the utf-8 sequence led by c, the same split as utf82uni
+static inline int getUtf8Length( unsigned char c )
+{
+	return c < 0xE0 ? 2 : ( c < 0xF0 ? 3 : 4 );
+}
+
+// format "&#ch;", the same as snprintf( temp, size, "&#%d;", ch )
+static int formatEntity( int ch, char * temp )
+{
+	char digits[ 16 ];
+	int count = 0;
+
+	unsigned int value = (unsigned int)ch;
+	do {
+		digits[ count++ ] = '0' + value % 10;
+		value /= 10;
+	} while( value > 0 );
+
+	int len = 0;
+	temp[ len++ ] = '&';
+	temp[ len++ ] = '#';
+	for( ; count > 0; ) temp[ len++ ] = digits[ --count ];
+	temp[ len++ ] = ';';
+	temp[ len ] = '\0';
+
+	return len;
+}
+
+int SP_XmlStringCodec :: encode( const char * encoding, const char * decodeValue,
+		int len, SP_XmlOutputSink * outSink )
+{
+	int isUtf8 = isUtf8Encoding( encoding );
 
 	const unsigned char * pos = (unsigned char *)decodeValue;
-	for( ; '\0' != *pos; pos++ ) {
-		int index = -1;
-		for( int i = 0; i < (int)( sizeof( XML_CHARS ) / sizeof( XML_CHARS[0] ) ); i++ ) {
-			if( XML_CHARS[i] == *pos ) {
-				index = i;
-				break;
+	const unsigned char * end = len >= 0 ? pos + len : NULL;
+
+	char temp[ 32 ] = { 0 };
+
+	for( ; ; ) {
+		const unsigned char * run = pos;
+		for( ; ( NULL == end || pos < end ) && isPlainChar( *pos, isUtf8 ); ) pos++;
+		if( pos > run ) outSink->append( (char*)run, pos - run );
+
+		if( ( NULL != end && pos >= end ) || '\0' == *pos ) break;
+
+		const char * esc = getEscape( *pos );
+
+		if( NULL != esc ) {
+			outSink->append( esc );
+			pos++;
+		} else if( isUtf8 ) {
+			int ch = 0, count = 0;
+
+			// a sequence cut by the end of the slice goes out as raw bytes
+			if( NULL == end || end - pos >= getUtf8Length( *pos ) ) {
+				count = SP_XmlUtf8Codec::utf82uni( pos, &ch );
+			}
+
+			if( count > 0 ) {
+				outSink->append( temp, formatEntity( ch, temp ) );
+				pos += count;
+			} else {
+				outSink->append( (char)*pos++ );
 			}
-		}
-		if( index >= 0 && '\'' != *pos ) {
-			outBuffer->append( ESC_CHARS[ index ] );
 		} else {
-			if( isUtf8 ) {
-				int ch = 0;
-				int len = SP_XmlUtf8Codec::utf82uni( (unsigned char*)pos, &ch );
+			outSink->append( temp, formatEntity( *pos++, temp ) );
+		}
+	}
+
+	return 0;
+}
 
-				if( len > 0 ) {
-					pos += len - 1;
+int SP_XmlStringCodec :: getEncodedSize( const char * encoding, const char * decodeValue )
+{
+	int isUtf8 = isUtf8Encoding( encoding );
 
-					char temp[ 32 ] = { 0 };
-					snprintf( temp, sizeof( temp ), "&#%d;", ch );
-					outBuffer->append( temp );
-				} else {
-					outBuffer->append( *pos );
-				}
+	int size = 0;
+
+	char temp[ 32 ] = { 0 };
+
+	const unsigned char * pos = (unsigned char *)decodeValue;
+	for( ; ; ) {
+		const unsigned char * run = pos;
+		for( ; isPlainChar( *pos, isUtf8 ); ) pos++;
+		size += pos - run;
+
+		if( '\0' == *pos ) break;
+
+		const char * esc = getEscape( *pos );
+
+		if( NULL != esc ) {
+			size += strlen( esc );
+			pos++;
+		} else if( isUtf8 ) {
+			int ch = 0;
+			int count = SP_XmlUtf8Codec::utf82uni( pos, &ch );
+
+			if( count > 0 ) {
+				size += formatEntity( ch, temp );
+				pos += count;
 			} else {
-				if( *pos < 32 ) {
-					char temp[ 32 ] = { 0 };
-					snprintf( temp, sizeof( temp ), "&#%d;", *pos );
-					outBuffer->append( temp );
-				} else {
-					outBuffer->append( *pos );
-				}
+				size++;
+				pos++;
 			}
-		}	
+		} else {
+			size += formatEntity( *pos++, temp );
+		}
 	}
 
-	return 0;
+	return size;
 }
 
 int SP_XmlStringCodec :: isNameChar( const char * encoding, char c )
@@ -7,6 +7,7 @@
 #define __spxmlcodec_hpp__
 
 class SP_XmlStringBuffer;
+class SP_XmlOutputSink;
 
 class SP_XmlStringCodec {
 public:
@@ -17,6 +18,13 @@ public:
 			const char * encodeValue, SP_XmlStringBuffer * outBuffer );
 	static int encode( const char * encoding,
 			const char * decodeValue, SP_XmlStringBuffer * outBuffer );
+	static int encode( const char * encoding,
+			const char * decodeValue, SP_XmlOutputSink * outSink );
+	/// @param len : encode at most len bytes, < 0 means until '\0'
+	static int encode( const char * encoding,
+			const char * decodeValue, int len, SP_XmlOutputSink * outSink );
+	/// @return the length of the encode output
+	static int getEncodedSize( const char * encoding, const char * decodeValue );
 	static int isNameChar( const char * encoding, char c );
 
 private:
@@ -0,0 +1,873 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#include "spxmldiff.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlparser.hpp"
+#include "spxmlevent.hpp"
+#include "spxmlutils.hpp"
+
+SP_XmlDiffEdit :: SP_XmlDiffEdit( int type, const char * path,
+		const char * left, const char * right )
+{
+	mType = type;
+	mPath = strdup( path );
+	mLeft = NULL != left ? strdup( left ) : NULL;
+	mRight = NULL != right ? strdup( right ) : NULL;
+}
+
+SP_XmlDiffEdit :: ~SP_XmlDiffEdit()
+{
+	free( mPath );
+	if( NULL != mLeft ) free( mLeft );
+	if( NULL != mRight ) free( mRight );
+}
+
+int SP_XmlDiffEdit :: getType() const
+{
+	return mType;
+}
+
+const char * SP_XmlDiffEdit :: getPath() const
+{
+	return mPath;
+}
+
+const char * SP_XmlDiffEdit :: getLeft() const
+{
+	return mLeft;
+}
+
+const char * SP_XmlDiffEdit :: getRight() const
+{
+	return mRight;
+}
+
+//=========================================================
+
+typedef struct tagSP_XmlDiffAttr {
+	const char * mName;
+	const char * mValue;
+} SP_XmlDiffAttr_t;
+
+static int cmpDiffAttr( const void * item1, const void * item2 )
+{
+	return strcmp( ((const SP_XmlDiffAttr_t*)item1)->mName,
+			((const SP_XmlDiffAttr_t*)item2)->mName );
+}
+
+/// one side of the comparison, the canonical items of a tree or a stream :
+/// start-tag with sorted attributes, end-tag, merged text, PI
+class SP_XmlDiffSource {
+public:
+	enum { eStart, eEnd, eText, ePI, eEndDoc, eError };
+
+	SP_XmlDiffSource( int foldWhitespace );
+	virtual ~SP_XmlDiffSource();
+
+	/// @return the type of the current item
+	int peek();
+
+	/// move to the next item
+	void next();
+
+	/// element name or PI target
+	const char * getName() const;
+
+	/// text or PI data
+	const char * getText() const;
+
+	int getAttrCount() const;
+	const SP_XmlDiffAttr_t * getAttrs() const;
+
+	virtual const char * getError() = 0;
+
+protected:
+	/// read the next item
+	virtual int read() = 0;
+
+	template< class T >
+	void setAttrs( const T * owner );
+
+	void resetText();
+	void appendText( const char * text );
+	int hasText() const;
+
+	const char * mName;
+	const char * mText;
+
+private:
+	int mType;
+	int mHasItem;
+
+	SP_XmlDiffAttr_t * mAttrs;
+	int mAttrCount, mAttrMax;
+
+	int mFoldWhitespace;
+	int mPendingSpace;
+	SP_XmlStringBuffer * mTextBuffer;
+};
+
+SP_XmlDiffSource :: SP_XmlDiffSource( int foldWhitespace )
+{
+	mType = eEndDoc;
+	mHasItem = 0;
+
+	mName = mText = NULL;
+
+	mAttrs = NULL;
+	mAttrCount = mAttrMax = 0;
+
+	mFoldWhitespace = foldWhitespace;
+	mPendingSpace = 0;
+	mTextBuffer = new SP_XmlStringBuffer();
+}
+
+SP_XmlDiffSource :: ~SP_XmlDiffSource()
+{
+	if( NULL != mAttrs ) free( mAttrs );
+	delete mTextBuffer;
+}
+
+int SP_XmlDiffSource :: peek()
+{
+	if( ! mHasItem ) {
+		mName = mText = NULL;
+		mAttrCount = 0;
+
+		mType = read();
+		if( eText == mType ) mText = mTextBuffer->getBuffer();
+
+		mHasItem = 1;
+	}
+
+	return mType;
+}
+
+void SP_XmlDiffSource :: next()
+{
+	// stay at the end
+	if( eEndDoc != mType && eError != mType ) mHasItem = 0;
+}
+
+const char * SP_XmlDiffSource :: getName() const
+{
+	return mName;
+}
+
+const char * SP_XmlDiffSource :: getText() const
+{
+	return mText;
+}
+
+int SP_XmlDiffSource :: getAttrCount() const
+{
+	return mAttrCount;
+}
+
+const SP_XmlDiffAttr_t * SP_XmlDiffSource :: getAttrs() const
+{
+	return mAttrs;
+}
+
+template< class T >
+void SP_XmlDiffSource :: setAttrs( const T * owner )
+{
+	mAttrCount = 0;
+
+	int count = owner->getAttrCount();
+	if( count > mAttrMax ) {
+		mAttrMax = count;
+		mAttrs = (SP_XmlDiffAttr_t*)realloc( mAttrs, mAttrMax * sizeof( SP_XmlDiffAttr_t ) );
+	}
+
+	for( int i = 0; i < count; i++ ) {
+		const char * value = NULL;
+		const char * name = owner->getAttr( i, &value );
+		if( NULL != name && NULL != value ) {
+			mAttrs[ mAttrCount ].mName = name;
+			mAttrs[ mAttrCount ].mValue = value;
+			mAttrCount++;
+		}
+	}
+
+	if( mAttrCount > 1 ) qsort( mAttrs, mAttrCount, sizeof( SP_XmlDiffAttr_t ), cmpDiffAttr );
+}
+
+void SP_XmlDiffSource :: resetText()
+{
+	mTextBuffer->clean();
+	mPendingSpace = 0;
+}
+
+void SP_XmlDiffSource :: appendText( const char * text )
+{
+	if( ! mFoldWhitespace ) {
+		mTextBuffer->append( text );
+		return;
+	}
+
+	for( const char * pos = text; '\0' != *pos; pos++ ) {
+		if( isspace( (unsigned char)*pos ) ) {
+			mPendingSpace = mTextBuffer->getSize() > 0;
+		} else {
+			if( mPendingSpace ) mTextBuffer->append( ' ' );
+			mTextBuffer->append( *pos );
+			mPendingSpace = 0;
+		}
+	}
+}
+
+int SP_XmlDiffSource :: hasText() const
+{
+	return mTextBuffer->getSize() > 0;
+}
+
+//=========================================================
+
+typedef struct tagSP_XmlDiffFrame {
+	const SP_XmlNodeList * mList;
+	const SP_XmlNode * mSingle;
+	const char * mName;
+	int mIndex;
+} SP_XmlDiffFrame_t;
+
+class SP_XmlDiffDomSource : public SP_XmlDiffSource {
+public:
+	SP_XmlDiffDomSource( const SP_XmlNode * node, int foldWhitespace );
+	virtual ~SP_XmlDiffDomSource();
+
+	virtual const char * getError();
+
+protected:
+	virtual int read();
+
+private:
+	void push( const SP_XmlNodeList * list, const SP_XmlNode * single, const char * name );
+
+	SP_XmlDiffFrame_t * mFrames;
+	int mFrameCount, mFrameMax;
+};
+
+SP_XmlDiffDomSource :: SP_XmlDiffDomSource( const SP_XmlNode * node, int foldWhitespace )
+	: SP_XmlDiffSource( foldWhitespace )
+{
+	mFrames = NULL;
+	mFrameCount = mFrameMax = 0;
+
+	if( NULL != node ) push( NULL, node, NULL );
+}
+
+SP_XmlDiffDomSource :: ~SP_XmlDiffDomSource()
+{
+	if( NULL != mFrames ) free( mFrames );
+}
+
+const char * SP_XmlDiffDomSource :: getError()
+{
+	return NULL;
+}
+
+void SP_XmlDiffDomSource :: push( const SP_XmlNodeList * list,
+		const SP_XmlNode * single, const char * name )
+{
+	if( mFrameCount >= mFrameMax ) {
+		mFrameMax = mFrameMax > 0 ? mFrameMax * 2 : 16;
+		mFrames = (SP_XmlDiffFrame_t*)realloc( mFrames, mFrameMax * sizeof( SP_XmlDiffFrame_t ) );
+	}
+
+	SP_XmlDiffFrame_t * frame = mFrames + mFrameCount++;
+	frame->mList = list;
+	frame->mSingle = single;
+	frame->mName = name;
+	frame->mIndex = 0;
+}
+
+int SP_XmlDiffDomSource :: read()
+{
+	int inText = 0;
+	resetText();
+
+	for( ; mFrameCount > 0; ) {
+		SP_XmlDiffFrame_t * frame = mFrames + mFrameCount - 1;
+
+		const SP_XmlNode * node = NULL;
+		if( NULL != frame->mList ) {
+			if( frame->mIndex < frame->mList->getLength() ) node = frame->mList->get( frame->mIndex );
+		} else {
+			if( 0 == frame->mIndex ) node = frame->mSingle;
+		}
+
+		if( NULL == node ) {
+			if( inText && hasText() ) return eText;
+			inText = 0;
+
+			mFrameCount--;
+			if( NULL != frame->mName ) {
+				mName = frame->mName;
+				return eEnd;
+			}
+			continue;
+		}
+
+		int type = node->getType();
+
+		if( SP_XmlNode::eCDATA == type ) {
+			appendText( ((SP_XmlCDataNode*)node)->getText() );
+			inText = 1;
+			frame->mIndex++;
+			continue;
+		}
+
+		if( SP_XmlNode::eCOMMENT == type || SP_XmlNode::eDOCDECL == type
+				|| SP_XmlNode::eDOCTYPE == type ) {
+			frame->mIndex++;
+			continue;
+		}
+
+		if( inText && hasText() ) return eText;
+		inText = 0;
+
+		frame->mIndex++;
+
+		if( SP_XmlNode::eELEMENT == type ) {
+			const SP_XmlElementNode * element = (SP_XmlElementNode*)node;
+			mName = element->getName();
+			setAttrs( element );
+			push( element->getChildren(), NULL, element->getName() );
+			return eStart;
+		}
+
+		if( SP_XmlNode::ePI == type ) {
+			const SP_XmlPINode * pi = (SP_XmlPINode*)node;
+			mName = pi->getTarget();
+			mText = pi->getData();
+			return ePI;
+		}
+
+		if( SP_XmlNode::eXMLDOC == type ) {
+			push( ((SP_XmlDocument*)node)->getChildren(), NULL, NULL );
+		}
+	}
+
+	return inText && hasText() ? eText : eEndDoc;
+}
+
+//=========================================================
+
+class SP_XmlDiffPullSource : public SP_XmlDiffSource {
+public:
+	SP_XmlDiffPullSource( SP_XmlDiff::Read_t reader, void * arg, int foldWhitespace );
+	virtual ~SP_XmlDiffPullSource();
+
+	virtual const char * getError();
+
+protected:
+	virtual int read();
+
+private:
+	SP_XmlPullEvent * pull();
+
+	SP_XmlDiff::Read_t mReader;
+	void * mArg;
+
+	SP_XmlPullParser * mParser;
+	SP_XmlPullEvent * mHeld;
+	SP_XmlPullEvent * mPending;
+
+	int mDepth;
+	int mIsEof;
+	const char * mError;
+};
+
+SP_XmlDiffPullSource :: SP_XmlDiffPullSource( SP_XmlDiff::Read_t reader,
+		void * arg, int foldWhitespace )
+	: SP_XmlDiffSource( foldWhitespace )
+{
+	mReader = reader;
+	mArg = arg;
+
+	mParser = new SP_XmlPullParser();
+	mParser->setIgnoreWhitespace( foldWhitespace );
+
+	mHeld = mPending = NULL;
+
+	mDepth = 0;
+	mIsEof = 0;
+	mError = NULL;
+}
+
+SP_XmlDiffPullSource :: ~SP_XmlDiffPullSource()
+{
+	if( NULL != mHeld ) delete mHeld;
+	if( NULL != mPending ) delete mPending;
+
+	delete mParser;
+}
+
+const char * SP_XmlDiffPullSource :: getError()
+{
+	return NULL != mParser->getError() ? mParser->getError() : mError;
+}
+
+SP_XmlPullEvent * SP_XmlDiffPullSource :: pull()
+{
+	if( NULL != mPending ) {
+		SP_XmlPullEvent * event = mPending;
+		mPending = NULL;
+		return event;
+	}
+
+	for( ; ; ) {
+		SP_XmlPullEvent * event = mParser->getNext();
+		if( NULL != event ) return event;
+
+		if( mIsEof || NULL != mParser->getError() ) return NULL;
+
+		char buffer[ 4096 ];
+		int len = mReader( mArg, buffer, sizeof( buffer ) );
+		if( len > 0 ) {
+			mParser->append( buffer, len );
+		} else {
+			mIsEof = 1;
+			if( len < 0 ) mError = "read error";
+		}
+	}
+}
+
+int SP_XmlDiffPullSource :: read()
+{
+	if( NULL != mHeld ) delete mHeld;
+	mHeld = NULL;
+
+	int inText = 0;
+	resetText();
+
+	for( SP_XmlPullEvent * event = pull(); NULL != event; event = pull() ) {
+		int type = event->getEventType();
+
+		if( SP_XmlPullEvent::eCData == type ) {
+			// same as the dom, text outside of the root element is dropped
+			if( mDepth > 0 ) {
+				appendText( ((SP_XmlCDataEvent*)event)->getText() );
+				inText = 1;
+			}
+			delete event;
+			continue;
+		}
+
+		if( SP_XmlPullEvent::eStartTag != type && SP_XmlPullEvent::eEndTag != type
+				&& SP_XmlPullEvent::ePI != type ) {
+			delete event;
+			continue;
+		}
+
+		if( inText && hasText() ) {
+			mPending = event;
+			return eText;
+		}
+		inText = 0;
+
+		mHeld = event;
+
+		if( SP_XmlPullEvent::eStartTag == type ) {
+			const SP_XmlStartTagEvent * startTag = (SP_XmlStartTagEvent*)event;
+			mName = startTag->getName();
+			setAttrs( startTag );
+			mDepth++;
+			return eStart;
+		}
+
+		if( SP_XmlPullEvent::eEndTag == type ) {
+			mName = ((SP_XmlEndTagEvent*)event)->getText();
+			mDepth--;
+			return eEnd;
+		}
+
+		const SP_XmlPIEvent * pi = (SP_XmlPIEvent*)event;
+		mName = pi->getTarget();
+		mText = pi->getData();
+		return ePI;
+	}
+
+	if( inText && hasText() ) return eText;
+
+	if( NULL != getError() ) return eError;
+
+	if( mDepth > 0 ) {
+		mError = "unexpected end of input";
+		return eError;
+	}
+
+	return eEndDoc;
+}
+
+//=========================================================
+
+typedef struct tagSP_XmlDiffLevel {
+	int mPathLen;
+	SP_XmlHashMap * mCounts[ 2 ];
+} SP_XmlDiffLevel_t;
+
+typedef struct tagSP_XmlDiffMemory {
+	const char * mSource;
+	int mLen;
+	int mPos;
+} SP_XmlDiffMemory_t;
+
+static int readMemory( void * arg, char * buffer, int len )
+{
+	SP_XmlDiffMemory_t * memory = (SP_XmlDiffMemory_t*)arg;
+
+	int left = memory->mLen - memory->mPos;
+	len = left < len ? left : len;
+
+	memcpy( buffer, memory->mSource + memory->mPos, len );
+	memory->mPos += len;
+
+	return len;
+}
+
+// an element is <name>, a PI is <?target data?>
+static void describe( SP_XmlDiffSource * source, SP_XmlStringBuffer * buffer )
+{
+	int type = source->peek();
+
+	if( SP_XmlDiffSource::eStart == type ) {
+		buffer->append( '<' );
+		buffer->append( source->getName() );
+		buffer->append( '>' );
+	} else if( SP_XmlDiffSource::eText == type ) {
+		buffer->append( source->getText() );
+	} else if( SP_XmlDiffSource::ePI == type ) {
+		buffer->append( "<?" );
+		buffer->append( source->getName() );
+		if( '\0' != *( source->getText() ) ) {
+			buffer->append( ' ' );
+			buffer->append( source->getText() );
+		}
+		buffer->append( "?>" );
+	}
+}
+
+SP_XmlDiff :: SP_XmlDiff()
+{
+	mFoldWhitespace = 0;
+	mMaxEdits = 1;
+
+	mEdits = new SP_XmlArrayList();
+	mError = NULL;
+
+	mLevels = NULL;
+	mDepth = mMaxDepth = 0;
+
+	mPath = NULL;
+	mPathLen = mPathMax = 0;
+}
+
+SP_XmlDiff :: ~SP_XmlDiff()
+{
+	reset();
+	delete mEdits;
+
+	for( int i = 0; i < mMaxDepth; i++ ) {
+		if( NULL != mLevels[ i ].mCounts[ 0 ] ) delete mLevels[ i ].mCounts[ 0 ];
+		if( NULL != mLevels[ i ].mCounts[ 1 ] ) delete mLevels[ i ].mCounts[ 1 ];
+	}
+	if( NULL != mLevels ) free( mLevels );
+
+	if( NULL != mPath ) free( mPath );
+}
+
+void SP_XmlDiff :: setFoldWhitespace( int foldWhitespace )
+{
+	mFoldWhitespace = foldWhitespace;
+}
+
+void SP_XmlDiff :: setMaxEdits( int maxEdits )
+{
+	mMaxEdits = maxEdits > 0 ? maxEdits : 1;
+}
+
+int SP_XmlDiff :: getEditCount() const
+{
+	return mEdits->getCount();
+}
+
+const SP_XmlDiffEdit * SP_XmlDiff :: getEdit( int index ) const
+{
+	return (const SP_XmlDiffEdit*)mEdits->getItem( index );
+}
+
+const char * SP_XmlDiff :: getError() const
+{
+	return mError;
+}
+
+void SP_XmlDiff :: reset()
+{
+	for( ; mEdits->getCount() > 0; ) {
+		delete (SP_XmlDiffEdit*)mEdits->takeItem( SP_XmlArrayList::LAST_INDEX );
+	}
+
+	if( NULL != mError ) free( mError );
+	mError = NULL;
+
+	mDepth = 0;
+	mPathLen = 0;
+}
+
+int SP_XmlDiff :: compare( const SP_XmlNode * left, const SP_XmlNode * right )
+{
+	SP_XmlDiffDomSource leftSource( left, mFoldWhitespace );
+	SP_XmlDiffDomSource rightSource( right, mFoldWhitespace );
+
+	return run( &leftSource, &rightSource );
+}
+
+int SP_XmlDiff :: compare( const char * left, int leftLen, const char * right, int rightLen )
+{
+	SP_XmlDiffMemory_t leftMemory = { left, leftLen, 0 };
+	SP_XmlDiffMemory_t rightMemory = { right, rightLen, 0 };
+
+	return compare( readMemory, &leftMemory, readMemory, &rightMemory );
+}
+
+int SP_XmlDiff :: compare( Read_t leftRead, void * leftArg, Read_t rightRead, void * rightArg )
+{
+	SP_XmlDiffPullSource leftSource( leftRead, leftArg, mFoldWhitespace );
+	SP_XmlDiffPullSource rightSource( rightRead, rightArg, mFoldWhitespace );
+
+	return run( &leftSource, &rightSource );
+}
+
+void SP_XmlDiff :: enter( const char * step )
+{
+	if( mDepth >= mMaxDepth ) {
+		int maxDepth = mMaxDepth > 0 ? mMaxDepth * 2 : 16;
+		mLevels = (SP_XmlDiffLevel_t*)realloc( mLevels, maxDepth * sizeof( SP_XmlDiffLevel_t ) );
+		memset( mLevels + mMaxDepth, 0, ( maxDepth - mMaxDepth ) * sizeof( SP_XmlDiffLevel_t ) );
+		mMaxDepth = maxDepth;
+	}
+
+	SP_XmlDiffLevel_t * level = mLevels + mDepth++;
+	level->mPathLen = mPathLen;
+
+	for( int i = 0; i < 2; i++ ) {
+		if( NULL == level->mCounts[ i ] ) {
+			level->mCounts[ i ] = new SP_XmlHashMap();
+		} else {
+			level->mCounts[ i ]->clean();
+		}
+	}
+
+	int len = strlen( step );
+	if( mPathLen + len + 1 > mPathMax ) {
+		mPathMax = ( mPathLen + len + 1 ) * 2;
+		mPath = (char*)realloc( mPath, mPathMax );
+	}
+	memcpy( mPath + mPathLen, step, len + 1 );
+	mPathLen += len;
+}
+
+void SP_XmlDiff :: leave()
+{
+	if( mDepth <= 0 ) return;
+
+	mPathLen = mLevels[ --mDepth ].mPathLen;
+	mPath[ mPathLen ] = '\0';
+}
+
+void SP_XmlDiff :: getStep( SP_XmlDiffSource * source, int side, int isCount,
+		char * step, int size )
+{
+	int type = source->peek();
+
+	if( SP_XmlDiffSource::eStart == type ) {
+		SP_XmlHashMap * counts = mLevels[ mDepth - 1 ].mCounts[ side ];
+
+		long count = (long)counts->get( source->getName() ) + 1;
+		if( isCount ) counts->put( source->getName(), (void*)count );
+
+		snprintf( step, size, "/%s[%ld]", source->getName(), count );
+	} else if( SP_XmlDiffSource::eText == type ) {
+		snprintf( step, size, "/text()" );
+	} else if( SP_XmlDiffSource::ePI == type ) {
+		snprintf( step, size, "/processing-instruction(%s)", source->getName() );
+	} else {
+		*step = '\0';
+	}
+}
+
+void SP_XmlDiff :: skip( SP_XmlDiffSource * source, int side )
+{
+	char step[ 512 ] = { 0 };
+	getStep( source, side, 1, step, sizeof( step ) );
+
+	int depth = 0;
+
+	do {
+		int type = source->peek();
+		if( SP_XmlDiffSource::eStart == type ) depth++;
+		if( SP_XmlDiffSource::eEnd == type ) depth--;
+		if( SP_XmlDiffSource::eEndDoc == type || SP_XmlDiffSource::eError == type ) break;
+
+		source->next();
+	} while( depth > 0 );
+}
+
+int SP_XmlDiff :: addEdit( int type, const char * step, const char * left, const char * right )
+{
+	SP_XmlStringBuffer path;
+	if( mPathLen > 0 ) path.append( mPath, mPathLen );
+	path.append( step );
+
+	mEdits->append( new SP_XmlDiffEdit( type, path.getBuffer(), left, right ) );
+
+	return mEdits->getCount() >= mMaxEdits;
+}
+
+int SP_XmlDiff :: compareAttrs( SP_XmlDiffSource * left, SP_XmlDiffSource * right )
+{
+	const SP_XmlDiffAttr_t * leftAttrs = left->getAttrs(), * rightAttrs = right->getAttrs();
+	int leftCount = left->getAttrCount(), rightCount = right->getAttrCount();
+
+	char step[ 512 ] = { 0 };
+
+	for( int i = 0, j = 0; i < leftCount || j < rightCount; ) {
+		int ret = 0;
+		if( i >= leftCount ) {
+			ret = 1;
+		} else if( j >= rightCount ) {
+			ret = -1;
+		} else {
+			ret = strcmp( leftAttrs[ i ].mName, rightAttrs[ j ].mName );
+		}
+
+		if( ret < 0 ) {
+			snprintf( step, sizeof( step ), "/@%s", leftAttrs[ i ].mName );
+			if( addEdit( SP_XmlDiffEdit::eRemoveAttr, step, leftAttrs[ i ].mValue, NULL ) ) return 1;
+			i++;
+		} else if( ret > 0 ) {
+			snprintf( step, sizeof( step ), "/@%s", rightAttrs[ j ].mName );
+			if( addEdit( SP_XmlDiffEdit::eAddAttr, step, NULL, rightAttrs[ j ].mValue ) ) return 1;
+			j++;
+		} else {
+			if( 0 != strcmp( leftAttrs[ i ].mValue, rightAttrs[ j ].mValue ) ) {
+				snprintf( step, sizeof( step ), "/@%s", leftAttrs[ i ].mName );
+				if( addEdit( SP_XmlDiffEdit::eChangeAttr, step,
+						leftAttrs[ i ].mValue, rightAttrs[ j ].mValue ) ) return 1;
+			}
+			i++;
+			j++;
+		}
+	}
+
+	return 0;
+}
+
+int SP_XmlDiff :: run( SP_XmlDiffSource * left, SP_XmlDiffSource * right )
+{
+	reset();
+	enter( "" );
+
+	char step[ 512 ] = { 0 };
+
+	for( ; ; ) {
+		int leftType = left->peek(), rightType = right->peek();
+
+		if( SP_XmlDiffSource::eError == leftType || SP_XmlDiffSource::eError == rightType ) {
+			int isLeft = SP_XmlDiffSource::eError == leftType;
+			SP_XmlStringBuffer error;
+			error.append( isLeft ? "left: " : "right: " );
+			error.append( isLeft ? left->getError() : right->getError() );
+			mError = strdup( error.getBuffer() );
+			return -1;
+		}
+
+		int isLeftEnd = SP_XmlDiffSource::eEnd == leftType || SP_XmlDiffSource::eEndDoc == leftType;
+		int isRightEnd = SP_XmlDiffSource::eEnd == rightType || SP_XmlDiffSource::eEndDoc == rightType;
+
+		if( isLeftEnd && isRightEnd ) {
+			if( SP_XmlDiffSource::eEndDoc == leftType ) break;
+
+			leave();
+			left->next();
+			right->next();
+			continue;
+		}
+
+		if( isLeftEnd || isRightEnd ) {
+			// one side has more children
+			SP_XmlDiffSource * source = isLeftEnd ? right : left;
+			int side = isLeftEnd ? eRight : eLeft;
+
+			SP_XmlStringBuffer value;
+			describe( source, &value );
+			getStep( source, side, 0, step, sizeof( step ) );
+
+			int isStop = isLeftEnd
+					? addEdit( SP_XmlDiffEdit::eInsert, step, NULL, value.getBuffer() )
+					: addEdit( SP_XmlDiffEdit::eDelete, step, value.getBuffer(), NULL );
+			if( isStop ) return 1;
+
+			skip( source, side );
+			continue;
+		}
+
+		if( leftType == rightType && SP_XmlDiffSource::eStart == leftType
+				&& 0 == strcmp( left->getName(), right->getName() ) ) {
+			getStep( right, eRight, 1, step, sizeof( step ) );
+			getStep( left, eLeft, 1, step, sizeof( step ) );
+			enter( step );
+
+			if( compareAttrs( left, right ) ) return 1;
+
+			left->next();
+			right->next();
+			continue;
+		}
+
+		if( leftType == rightType && SP_XmlDiffSource::eText == leftType ) {
+			if( 0 != strcmp( left->getText(), right->getText() ) ) {
+				getStep( left, eLeft, 0, step, sizeof( step ) );
+				if( addEdit( SP_XmlDiffEdit::eChangeText, step,
+						left->getText(), right->getText() ) ) return 1;
+			}
+
+			left->next();
+			right->next();
+			continue;
+		}
+
+		if( leftType == rightType && SP_XmlDiffSource::ePI == leftType
+				&& 0 == strcmp( left->getName(), right->getName() )
+				&& 0 == strcmp( left->getText(), right->getText() ) ) {
+			left->next();
+			right->next();
+			continue;
+		}
+
+		// different kinds of node, different element names, or different PIs
+		SP_XmlStringBuffer leftValue, rightValue;
+		describe( left, &leftValue );
+		describe( right, &rightValue );
+		getStep( left, eLeft, 0, step, sizeof( step ) );
+
+		if( addEdit( SP_XmlDiffEdit::eReplace, step,
+				leftValue.getBuffer(), rightValue.getBuffer() ) ) return 1;
+
+		skip( left, eLeft );
+		skip( right, eRight );
+	}
+
+	return mEdits->getCount() > 0 ? 1 : 0;
+}
+
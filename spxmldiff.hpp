@@ -0,0 +1,134 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmldiff_hpp__
+#define __spxmldiff_hpp__
+
+class SP_XmlNode;
+class SP_XmlArrayList;
+class SP_XmlDiffSource;
+
+typedef struct tagSP_XmlDiffLevel SP_XmlDiffLevel_t;
+
+class SP_XmlDiffEdit {
+public:
+	enum { eInsert, eDelete, eReplace, eChangeText,
+			eAddAttr, eRemoveAttr, eChangeAttr };
+
+	SP_XmlDiffEdit( int type, const char * path, const char * left, const char * right );
+	~SP_XmlDiffEdit();
+
+	int getType() const;
+
+	/// the step of an element is name[n], n counts the siblings of the same
+	/// name from 1, on the right side for eInsert, on the left side otherwise,
+	/// ex: /config[1]/server[2]/@port, /config[1]/server[2]/text()
+	const char * getPath() const;
+
+	/// NULL for eInsert and eAddAttr, an element is shown as <name>
+	const char * getLeft() const;
+
+	/// NULL for eDelete and eRemoveAttr
+	const char * getRight() const;
+
+private:
+	SP_XmlDiffEdit( SP_XmlDiffEdit & );
+	SP_XmlDiffEdit & operator=( SP_XmlDiffEdit & );
+
+	int mType;
+	char * mPath;
+	char * mLeft;
+	char * mRight;
+};
+
+/**
+ *  Compare two documents by their canonical form ( SP_CanonXmlBuffer ),
+ *  the order of attributes, comments, the xml declaration and the doctype
+ *  do not count. Two parsed trees, or two sources which are pulled in
+ *  lockstep, so the comparison stops reading at the first difference and
+ *  never holds a whole document.
+ *
+ *  The children are matched by position, an element inserted in the middle
+ *  shows as the replacements of the following siblings.
+ *
+ *	@verbatim
+ *	SP_XmlDiff diff;
+ *	diff.setFoldWhitespace( 1 );
+ *	if( 1 == diff.compare( oldXml, oldLen, newXml, newLen ) ) {
+ *		const SP_XmlDiffEdit * edit = diff.getEdit( 0 );
+ *		printf( "%s changed\n", edit->getPath() );
+ *	}
+ *	@endverbatim
+ */
+class SP_XmlDiff {
+public:
+	/// @return > 0 : bytes read, 0 : end of input, -1 : error
+	typedef int ( * Read_t )( void * arg, char * buffer, int len );
+
+	SP_XmlDiff();
+	~SP_XmlDiff();
+
+	/// trim the text, collapse the whitespace runs to one space, and drop
+	/// the whitespace only text, default is 0, compare the text exactly
+	void setFoldWhitespace( int foldWhitespace );
+
+	/// stop after maxEdits edits, default is 1, stop at the first difference
+	void setMaxEdits( int maxEdits );
+
+	/// @return 0 : equal, 1 : different, -1 : error
+	int compare( const SP_XmlNode * left, const SP_XmlNode * right );
+
+	/// @return 0 : equal, 1 : different, -1 : parse error
+	int compare( const char * left, int leftLen, const char * right, int rightLen );
+
+	/// pull each side from a reader as far as the comparison goes
+	/// @return 0 : equal, 1 : different, -1 : read or parse error
+	int compare( Read_t leftRead, void * leftArg, Read_t rightRead, void * rightArg );
+
+	/// the edits found by the last compare, up to the error if it fails
+	int getEditCount() const;
+	const SP_XmlDiffEdit * getEdit( int index ) const;
+
+	/// @return NOT NULL : the error of the last compare
+	const char * getError() const;
+
+private:
+	SP_XmlDiff( SP_XmlDiff & );
+	SP_XmlDiff & operator=( SP_XmlDiff & );
+
+	enum { eLeft = 0, eRight = 1 };
+
+	int run( SP_XmlDiffSource * left, SP_XmlDiffSource * right );
+	void reset();
+
+	/// @return 1 : enough edits, stop
+	int addEdit( int type, const char * step, const char * left, const char * right );
+	int compareAttrs( SP_XmlDiffSource * left, SP_XmlDiffSource * right );
+
+	/// the step of the current child of the side, count it when isCount
+	void getStep( SP_XmlDiffSource * source, int side, int isCount,
+			char * step, int size );
+
+	/// skip the current node of the side, with its subtree
+	void skip( SP_XmlDiffSource * source, int side );
+
+	void enter( const char * step );
+	void leave();
+
+	int mFoldWhitespace;
+	int mMaxEdits;
+
+	SP_XmlArrayList * mEdits;
+	char * mError;
+
+	SP_XmlDiffLevel_t * mLevels;
+	int mDepth, mMaxDepth;
+
+	char * mPath;
+	int mPathLen, mPathMax;
+};
+
+#endif
+
@@ -12,17 +12,34 @@
 SP_XmlPullEvent :: SP_XmlPullEvent( int eventType )
 	: mEventType( eventType )
 {
+	mSourceOffset = mSourceLength = -1;
 }
 
 SP_XmlPullEvent :: ~SP_XmlPullEvent()
 {
 }
 
-int SP_XmlPullEvent :: getEventType()
+int SP_XmlPullEvent :: getEventType() const
 {
 	return mEventType;
 }
 
+void SP_XmlPullEvent :: setSourceRange( SP_XmlInt64_t offset, SP_XmlInt64_t length )
+{
+	mSourceOffset = offset;
+	mSourceLength = length;
+}
+
+SP_XmlInt64_t SP_XmlPullEvent :: getSourceOffset() const
+{
+	return mSourceOffset;
+}
+
+SP_XmlInt64_t SP_XmlPullEvent :: getSourceLength() const
+{
+	return mSourceLength;
+}
+
 //=========================================================
 
 SP_XmlPullEventQueue :: SP_XmlPullEventQueue()
@@ -50,6 +67,11 @@ SP_XmlPullEvent * SP_XmlPullEventQueue :: dequeue()
 	return event;
 }
 
+int SP_XmlPullEventQueue :: isEmpty()
+{
+	return NULL == mQueue->top();
+}
+
 //=========================================================
 
 SP_XmlStartDocEvent :: SP_XmlStartDocEvent()
@@ -147,7 +169,7 @@ void SP_XmlPIEvent :: setTarget( const char * target )
 	snprintf( mTarget, sizeof( mTarget ), "%s", target );
 }
 
-const char * SP_XmlPIEvent :: getTarget()
+const char * SP_XmlPIEvent :: getTarget() const
 {
 	return mTarget;
 }
@@ -162,7 +184,7 @@ void SP_XmlPIEvent :: setData( const char * data, int len )
 	}
 }
 
-const char * SP_XmlPIEvent :: getData()
+const char * SP_XmlPIEvent :: getData() const
 {
 	return mData;
 }
@@ -6,6 +6,8 @@
 #ifndef __spxmlevent_hpp__
 #define __spxmlevent_hpp__
 
+#include "spxmlnumber.hpp"
+
 class SP_XmlArrayList;
 class SP_XmlQueue;
 
@@ -17,7 +19,15 @@ public:
 	SP_XmlPullEvent( int eventType );
 	virtual ~SP_XmlPullEvent();
 
-	int getEventType();
+	int getEventType() const;
+
+	/// the byte range of the event in the input of the parser, the start-tag
+	/// of <a/> covers "<a/", its end-tag covers "<a/>",
+	/// -1 : not known, the event was not read from input, 64 bits for
+	/// a long-lived stream
+	void setSourceRange( SP_XmlInt64_t offset, SP_XmlInt64_t length );
+	SP_XmlInt64_t getSourceOffset() const;
+	SP_XmlInt64_t getSourceLength() const;
 
 private:
 	/// Private copy constructor and copy assignment ensure classes derived from
@@ -27,6 +37,9 @@ private:
 
 protected:
 	const int mEventType;
+
+	SP_XmlInt64_t mSourceOffset;
+	SP_XmlInt64_t mSourceLength;
 };
 
 class SP_XmlPullEventQueue {
@@ -37,6 +50,8 @@ public:
 	void enqueue( SP_XmlPullEvent * event );
 	SP_XmlPullEvent * dequeue();
 
+	int isEmpty();
+
 private:
 	SP_XmlPullEventQueue( SP_XmlPullEventQueue & );
 	SP_XmlPullEventQueue & operator=( SP_XmlPullEventQueue & );
@@ -83,10 +98,10 @@ public:
 	~SP_XmlPIEvent();
 
 	void setTarget( const char * target );
-	const char * getTarget();
+	const char * getTarget() const;
 
 	void setData( const char * data, int len );
-	const char * getData();
+	const char * getData() const;
 
 private:
 	char mTarget[ 128 ];
@@ -0,0 +1,247 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <zlib.h>
+
+#include "spxmlgzip.hpp"
+
+// windowBits of deflateInit2 / inflateInit2, 16 selects the gzip wrapper
+static const int GZIP_WINDOW_BITS = 15 + 16;
+
+SP_XmlGzipSource :: SP_XmlGzipSource( SP_XmlInputSource * source, int isOwnSource, int chunkSize )
+{
+	mSource = source;
+	mIsOwnSource = isOwnSource;
+
+	mState = eDetect;
+
+	mInput = NULL;
+	mInputLen = 0;
+	mIsInputEnd = 0;
+	mIsMemberEnd = 0;
+
+	mStream = NULL;
+
+	mChunk = NULL;
+	mChunkSize = chunkSize > 0 ? chunkSize : DEFAULT_CHUNK_SIZE;
+}
+
+SP_XmlGzipSource :: ~SP_XmlGzipSource()
+{
+	if( NULL != mStream ) {
+		inflateEnd( mStream );
+		free( mStream );
+	}
+	mStream = NULL;
+
+	if( NULL != mChunk ) free( mChunk );
+	mChunk = NULL;
+
+	if( mIsOwnSource && NULL != mSource ) delete mSource;
+	mSource = NULL;
+}
+
+int SP_XmlGzipSource :: isCompressed() const
+{
+	if( eDetect == mState ) return -1;
+
+	return ePlain == mState ? 0 : 1;
+}
+
+int SP_XmlGzipSource :: setError( int error )
+{
+	if( 0 == mError ) mError = error;
+
+	return -1;
+}
+
+int SP_XmlGzipSource :: detect()
+{
+	mInputLen = mSource->read( &mInput );
+	if( mInputLen < 0 ) {
+		mInputLen = 0;
+		return setError( mSource->getError() ? mSource->getError() : EIO );
+	}
+
+	// 0x1f is not a legal xml char, so a single 0x1f is the start of gzip too
+	const unsigned char * magic = (const unsigned char *)mInput;
+	if( mInputLen <= 0 || 0x1f != magic[0] || ( mInputLen > 1 && 0x8b != magic[1] ) ) {
+		mState = ePlain;
+		return 0;
+	}
+
+	mStream = (z_stream*)calloc( 1, sizeof( z_stream ) );
+	if( Z_OK != inflateInit2( mStream, GZIP_WINDOW_BITS ) ) {
+		free( mStream );
+		mStream = NULL;
+		return setError( ENOMEM );
+	}
+
+	mChunk = (char*)malloc( mChunkSize );
+
+	mStream->next_in = (Bytef*)mInput;
+	mStream->avail_in = mInputLen;
+
+	mState = eInflate;
+
+	return 0;
+}
+
+int SP_XmlGzipSource :: read( const char ** data )
+{
+	if( 0 != mError ) return -1;
+
+	if( eDetect == mState && 0 != detect() ) return -1;
+
+	if( ePlain == mState ) {
+		if( mInputLen > 0 ) {
+			int len = mInputLen;
+			*data = mInput;
+			mInputLen = 0;
+			return len;
+		}
+
+		int len = mSource->read( data );
+		if( len < 0 ) setError( mSource->getError() ? mSource->getError() : EIO );
+		return len;
+	}
+
+	for( ; eInflate == mState; ) {
+		if( 0 == mStream->avail_in && ! mIsInputEnd ) {
+			mInputLen = mSource->read( &mInput );
+			if( mInputLen < 0 ) return setError( mSource->getError() ? mSource->getError() : EIO );
+			if( 0 == mInputLen ) mIsInputEnd = 1;
+
+			mStream->next_in = (Bytef*)mInput;
+			mStream->avail_in = mInputLen;
+		}
+
+		if( 0 == mStream->avail_in && mIsInputEnd ) {
+			// the end of input must be the end of a member
+			if( ! mIsMemberEnd ) return setError( EIO );
+			mState = eEnd;
+			break;
+		}
+
+		mIsMemberEnd = 0;
+
+		mStream->next_out = (Bytef*)mChunk;
+		mStream->avail_out = mChunkSize;
+
+		int ret = inflate( mStream, Z_NO_FLUSH );
+
+		if( Z_STREAM_END == ret ) {
+			// maybe another member follows
+			mIsMemberEnd = 1;
+			inflateReset( mStream );
+		} else if( Z_OK != ret && Z_BUF_ERROR != ret ) {
+			return setError( EIO );
+		}
+
+		int len = mChunkSize - mStream->avail_out;
+		if( len > 0 ) {
+			*data = mChunk;
+			return len;
+		}
+	}
+
+	return 0;
+}
+
+//=========================================================
+
+SP_XmlGzipSink :: SP_XmlGzipSink( SP_XmlOutputSink * sink, int level, int chunkSize )
+	: SP_XmlChunkSink( chunkSize )
+{
+	mSink = sink;
+	mIsClosed = 0;
+
+	mStream = (z_stream*)calloc( 1, sizeof( z_stream ) );
+	if( Z_OK != deflateInit2( mStream, level, Z_DEFLATED, GZIP_WINDOW_BITS,
+			8, Z_DEFAULT_STRATEGY ) ) {
+		free( mStream );
+		mStream = NULL;
+		mError = ENOMEM;
+	}
+}
+
+SP_XmlGzipSink :: ~SP_XmlGzipSink()
+{
+	close();
+}
+
+int SP_XmlGzipSink :: deflateTo( const char * data, int len, int flush )
+{
+	mStream->next_in = (Bytef*)data;
+	mStream->avail_in = len;
+
+	for( ; ; ) {
+		mStream->next_out = (Bytef*)mOutput;
+		mStream->avail_out = sizeof( mOutput );
+
+		int ret = deflate( mStream, flush );
+		if( Z_STREAM_ERROR == ret ) {
+			mError = EIO;
+			return -1;
+		}
+
+		int outLen = sizeof( mOutput ) - mStream->avail_out;
+		if( outLen > 0 && 0 != mSink->append( mOutput, outLen ) ) {
+			mError = mSink->getError() ? mSink->getError() : EIO;
+			return -1;
+		}
+
+		// the output buffer was not filled, so deflate has nothing more for now
+		if( 0 != mStream->avail_out ) break;
+	}
+
+	return 0;
+}
+
+int SP_XmlGzipSink :: write( const char * data, int len )
+{
+	if( mIsClosed || NULL == mStream ) return -1;
+
+	return deflateTo( data, len, Z_NO_FLUSH );
+}
+
+int SP_XmlGzipSink :: overflow( int need )
+{
+	if( 0 != SP_XmlChunkSink::overflow( need ) ) return -1;
+
+	// an explicit flush
+	if( 0 == need && ! mIsClosed && NULL != mStream ) {
+		if( 0 != deflateTo( NULL, 0, Z_SYNC_FLUSH ) ) return -1;
+		return mSink->flush();
+	}
+
+	return 0;
+}
+
+int SP_XmlGzipSink :: close()
+{
+	if( mIsClosed ) return 0 == mError ? 0 : -1;
+
+	int ret = SP_XmlChunkSink::overflow( 0 );
+
+	mIsClosed = 1;
+
+	if( NULL != mStream ) {
+		if( 0 == ret ) ret = deflateTo( NULL, 0, Z_FINISH );
+
+		deflateEnd( mStream );
+		free( mStream );
+		mStream = NULL;
+	}
+
+	if( 0 != mSink->flush() ) ret = -1;
+
+	return 0 == ret && 0 == mError ? 0 : -1;
+}
+
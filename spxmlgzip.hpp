@@ -0,0 +1,98 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmlgzip_hpp__
+#define __spxmlgzip_hpp__
+
+#include "spxmlsource.hpp"
+#include "spxmlsink.hpp"
+
+struct z_stream_s;
+
+/**
+ *  Inflate the pieces of another source a chunk at a time. The input is
+ *  checked for the gzip magic, plain input is passed through untouched,
+ *  so every file can go through it. Concatenated gzip members are read
+ *  as one stream. A corrupt or truncated input is an EIO error.
+ */
+class SP_XmlGzipSource : public SP_XmlInputSource {
+public:
+	enum { DEFAULT_CHUNK_SIZE = 65536 };
+
+	/// isOwnSource : delete the source in the destructor
+	SP_XmlGzipSource( SP_XmlInputSource * source, int isOwnSource = 0,
+			int chunkSize = DEFAULT_CHUNK_SIZE );
+	virtual ~SP_XmlGzipSource();
+
+	virtual int read( const char ** data );
+
+	/// @return 1 : gzip, 0 : plain, -1 : nothing read yet
+	int isCompressed() const;
+
+private:
+	int detect();
+
+	int setError( int error );
+
+	SP_XmlInputSource * mSource;
+	int mIsOwnSource;
+
+	enum { eDetect, ePlain, eInflate, eEnd };
+	int mState;
+
+	// the piece of the source not handed over yet
+	const char * mInput;
+	int mInputLen;
+	int mIsInputEnd;
+	int mIsMemberEnd;
+
+	struct z_stream_s * mStream;
+
+	char * mChunk;
+	int mChunkSize;
+};
+
+/**
+ *  Deflate everything appended to gzip, a chunk at a time, into another
+ *  sink. flush hands over all the data appended so far, with a zlib sync
+ *  flush, close writes the gzip trailer, the destructor closes.
+ *
+ *	@verbatim
+ *	SP_XmlFdSink fdSink( fd );
+ *	SP_XmlGzipSink sink( &fdSink );
+ *	SP_XmlDomBuffer::dump( NULL, doc, &sink, 0 );
+ *	sink.close();
+ *	@endverbatim
+ */
+class SP_XmlGzipSink : public SP_XmlChunkSink {
+public:
+	/// level : 0 - 9, -1 means the zlib default
+	SP_XmlGzipSink( SP_XmlOutputSink * sink, int level = -1,
+			int chunkSize = DEFAULT_CHUNK_SIZE );
+	virtual ~SP_XmlGzipSink();
+
+	/// finish the gzip stream and flush the sink, nothing can be appended after it
+	/// @return 0 : OK, -1 : error
+	int close();
+
+protected:
+	virtual int write( const char * data, int len );
+
+	virtual int overflow( int need );
+
+private:
+	/// deflate the input and append the output to the sink
+	int deflateTo( const char * data, int len, int flush );
+
+	SP_XmlOutputSink * mSink;
+
+	struct z_stream_s * mStream;
+	int mIsClosed;
+
+	char mOutput[ 16384 ];
+};
+
+#endif
+
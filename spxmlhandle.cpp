@@ -37,21 +37,7 @@ SP_XmlHandle SP_XmlHandle :: getChild( const char * name, int index ) const
 	if( NULL != mNode ) {
 		if( SP_XmlNode::eELEMENT == mNode->getType() ) {
 			SP_XmlElementNode * element = (SP_XmlElementNode*)mNode;
-			const SP_XmlNodeList * children = element->getChildren();
-
-			int tmpIndex = index;
-			for( int i = 0; i < children->getLength(); i++ ) {
-				if( SP_XmlNode::eELEMENT == children->get(i)->getType() ) {
-					SP_XmlElementNode * iter = (SP_XmlElementNode*)children->get(i);
-					if( 0 == strcmp( name, iter->getName() ) ) {
-						if( 0 == tmpIndex ) {
-							ret = iter;
-							break;
-						}
-						tmpIndex--;
-					}
-				}
-			}
+			ret = element->getChildren()->findElement( name, index );
 		}
 	}
 
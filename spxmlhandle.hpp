@@ -19,6 +19,9 @@ class SP_XmlCommentNode;
  *  A SP_XmlHandle is a class that wraps a node pointer with null checks; this is
  *  an incredibly useful thing. Note that SP_XmlHandle is not part of the SPXml
  *  DOM structure. It is a separate utility class.
+ *
+ *  A SP_XmlHandle never changes the node it wraps, the lookups are safe
+ *  on a document shared by many threads, see spxmlnode.hpp.
  *
 
 	Take an example:
@@ -0,0 +1,397 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "spxmlhash.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlutils.hpp"
+#include "spcanonxml.hpp"
+
+static const unsigned int SHA256_K[ 64 ] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline unsigned int rotr32( unsigned int x, int n )
+{
+	return ( x >> n ) | ( x << ( 32 - n ) );
+}
+
+SP_XmlSha256Sink :: SP_XmlSha256Sink( int chunkSize )
+	: SP_XmlChunkSink( chunkSize )
+{
+	reset();
+}
+
+SP_XmlSha256Sink :: ~SP_XmlSha256Sink()
+{
+}
+
+void SP_XmlSha256Sink :: reset()
+{
+	static const unsigned int init[ 8 ] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	memcpy( mState, init, sizeof( mState ) );
+	mBlockLen = 0;
+	mTotal = 0;
+
+	mCursor = mBegin;
+	mError = 0;
+}
+
+void SP_XmlSha256Sink :: transform( const unsigned char * block )
+{
+	unsigned int w[ 64 ];
+
+	for( int i = 0; i < 16; i++ ) {
+		w[ i ] = ( (unsigned int)block[ i * 4 ] << 24 ) | ( (unsigned int)block[ i * 4 + 1 ] << 16 )
+				| ( (unsigned int)block[ i * 4 + 2 ] << 8 ) | (unsigned int)block[ i * 4 + 3 ];
+	}
+
+	for( int i = 16; i < 64; i++ ) {
+		unsigned int s0 = rotr32( w[ i - 15 ], 7 ) ^ rotr32( w[ i - 15 ], 18 ) ^ ( w[ i - 15 ] >> 3 );
+		unsigned int s1 = rotr32( w[ i - 2 ], 17 ) ^ rotr32( w[ i - 2 ], 19 ) ^ ( w[ i - 2 ] >> 10 );
+		w[ i ] = w[ i - 16 ] + s0 + w[ i - 7 ] + s1;
+	}
+
+	unsigned int a = mState[ 0 ], b = mState[ 1 ], c = mState[ 2 ], d = mState[ 3 ];
+	unsigned int e = mState[ 4 ], f = mState[ 5 ], g = mState[ 6 ], h = mState[ 7 ];
+
+	for( int i = 0; i < 64; i++ ) {
+		unsigned int s1 = rotr32( e, 6 ) ^ rotr32( e, 11 ) ^ rotr32( e, 25 );
+		unsigned int ch = ( e & f ) ^ ( ~e & g );
+		unsigned int t1 = h + s1 + ch + SHA256_K[ i ] + w[ i ];
+		unsigned int s0 = rotr32( a, 2 ) ^ rotr32( a, 13 ) ^ rotr32( a, 22 );
+		unsigned int maj = ( a & b ) ^ ( a & c ) ^ ( b & c );
+		unsigned int t2 = s0 + maj;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	mState[ 0 ] += a;
+	mState[ 1 ] += b;
+	mState[ 2 ] += c;
+	mState[ 3 ] += d;
+	mState[ 4 ] += e;
+	mState[ 5 ] += f;
+	mState[ 6 ] += g;
+	mState[ 7 ] += h;
+}
+
+int SP_XmlSha256Sink :: write( const char * data, int len )
+{
+	const unsigned char * pos = (const unsigned char *)data;
+
+	mTotal += len;
+
+	if( mBlockLen > 0 ) {
+		int fill = 64 - mBlockLen < len ? 64 - mBlockLen : len;
+		memcpy( mBlock + mBlockLen, pos, fill );
+		mBlockLen += fill;
+		pos += fill;
+		len -= fill;
+
+		if( mBlockLen < 64 ) return 0;
+
+		transform( mBlock );
+		mBlockLen = 0;
+	}
+
+	for( ; len >= 64; pos += 64, len -= 64 ) transform( pos );
+
+	if( len > 0 ) {
+		memcpy( mBlock, pos, len );
+		mBlockLen = len;
+	}
+
+	return 0;
+}
+
+void SP_XmlSha256Sink :: getDigest( unsigned char digest[ DIGEST_SIZE ] )
+{
+	flush();
+
+	// pad a copy, so more data can be appended
+	unsigned int state[ 8 ];
+	memcpy( state, mState, sizeof( state ) );
+
+	unsigned char block[ 64 ];
+	memcpy( block, mBlock, mBlockLen );
+	int blockLen = mBlockLen;
+
+	block[ blockLen++ ] = 0x80;
+	if( blockLen > 56 ) {
+		memset( block + blockLen, 0, 64 - blockLen );
+		transform( block );
+		blockLen = 0;
+	}
+	memset( block + blockLen, 0, 56 - blockLen );
+
+	SP_XmlUint64_t bits = mTotal * 8;
+	for( int i = 0; i < 8; i++ ) {
+		block[ 63 - i ] = (unsigned char)( bits >> ( i * 8 ) );
+	}
+	transform( block );
+
+	for( int i = 0; i < 8; i++ ) {
+		digest[ i * 4 ] = (unsigned char)( mState[ i ] >> 24 );
+		digest[ i * 4 + 1 ] = (unsigned char)( mState[ i ] >> 16 );
+		digest[ i * 4 + 2 ] = (unsigned char)( mState[ i ] >> 8 );
+		digest[ i * 4 + 3 ] = (unsigned char)( mState[ i ] );
+	}
+
+	memcpy( mState, state, sizeof( state ) );
+}
+
+void SP_XmlSha256Sink :: getHexDigest( char hex[ DIGEST_SIZE * 2 + 1 ] )
+{
+	static const char HEX[] = "0123456789abcdef";
+
+	unsigned char digest[ DIGEST_SIZE ];
+	getDigest( digest );
+
+	for( int i = 0; i < DIGEST_SIZE; i++ ) {
+		hex[ i * 2 ] = HEX[ digest[ i ] >> 4 ];
+		hex[ i * 2 + 1 ] = HEX[ digest[ i ] & 0x0f ];
+	}
+	hex[ DIGEST_SIZE * 2 ] = '\0';
+}
+
+//=========================================================
+
+// the rounds of xxhash64, with a single accumulator
+
+static const SP_XmlUint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const SP_XmlUint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const SP_XmlUint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const SP_XmlUint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const SP_XmlUint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline SP_XmlUint64_t rotl64( SP_XmlUint64_t x, int n )
+{
+	return ( x << n ) | ( x >> ( 64 - n ) );
+}
+
+// little endian on every platform, compilers turn it into a single load
+static inline SP_XmlUint64_t readLE64( const unsigned char * pos )
+{
+	return (SP_XmlUint64_t)pos[ 0 ] | ( (SP_XmlUint64_t)pos[ 1 ] << 8 )
+			| ( (SP_XmlUint64_t)pos[ 2 ] << 16 ) | ( (SP_XmlUint64_t)pos[ 3 ] << 24 )
+			| ( (SP_XmlUint64_t)pos[ 4 ] << 32 ) | ( (SP_XmlUint64_t)pos[ 5 ] << 40 )
+			| ( (SP_XmlUint64_t)pos[ 6 ] << 48 ) | ( (SP_XmlUint64_t)pos[ 7 ] << 56 );
+}
+
+static inline SP_XmlUint64_t round64( SP_XmlUint64_t acc, SP_XmlUint64_t word )
+{
+	word *= PRIME64_2;
+	word = rotl64( word, 31 );
+	word *= PRIME64_1;
+
+	acc ^= word;
+	return rotl64( acc, 27 ) * PRIME64_1 + PRIME64_4;
+}
+
+SP_XmlHash64Sink :: SP_XmlHash64Sink( SP_XmlUint64_t seed, int chunkSize )
+	: SP_XmlChunkSink( chunkSize )
+{
+	mSeed = seed;
+	reset();
+}
+
+SP_XmlHash64Sink :: ~SP_XmlHash64Sink()
+{
+}
+
+void SP_XmlHash64Sink :: reset()
+{
+	mAcc = mSeed + PRIME64_5;
+	mTailLen = 0;
+	mTotal = 0;
+
+	mCursor = mBegin;
+	mError = 0;
+}
+
+int SP_XmlHash64Sink :: write( const char * data, int len )
+{
+	const unsigned char * pos = (const unsigned char *)data;
+
+	mTotal += len;
+
+	if( mTailLen > 0 ) {
+		int fill = 8 - mTailLen < len ? 8 - mTailLen : len;
+		memcpy( mTail + mTailLen, pos, fill );
+		mTailLen += fill;
+		pos += fill;
+		len -= fill;
+
+		if( mTailLen < 8 ) return 0;
+
+		mAcc = round64( mAcc, readLE64( mTail ) );
+		mTailLen = 0;
+	}
+
+	SP_XmlUint64_t acc = mAcc;
+	for( ; len >= 8; pos += 8, len -= 8 ) acc = round64( acc, readLE64( pos ) );
+	mAcc = acc;
+
+	if( len > 0 ) {
+		memcpy( mTail, pos, len );
+		mTailLen = len;
+	}
+
+	return 0;
+}
+
+SP_XmlUint64_t SP_XmlHash64Sink :: getHash()
+{
+	flush();
+
+	SP_XmlUint64_t hash = mAcc + mTotal;
+
+	for( int i = 0; i < mTailLen; i++ ) {
+		hash ^= mTail[ i ] * PRIME64_5;
+		hash = rotl64( hash, 11 ) * PRIME64_1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= PRIME64_3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+//=========================================================
+
+void SP_XmlFingerprint :: sha256( const SP_XmlNode * node,
+		unsigned char digest[ SP_XmlSha256Sink::DIGEST_SIZE ] )
+{
+	SP_XmlSha256Sink sink;
+	SP_CanonXmlBuffer::dump( node, &sink );
+	sink.getDigest( digest );
+}
+
+SP_XmlUint64_t SP_XmlFingerprint :: hash64( const SP_XmlNode * node )
+{
+	SP_XmlHash64Sink sink;
+	SP_CanonXmlBuffer::dump( node, &sink );
+	return sink.getHash();
+}
+
+//=========================================================
+
+typedef struct tagSP_XmlFingerprintEntry {
+	int mHasSha256;
+	unsigned char mSha256[ SP_XmlSha256Sink::DIGEST_SIZE ];
+	int mHasHash64;
+	SP_XmlUint64_t mHash64;
+} SP_XmlFingerprintEntry_t;
+
+SP_XmlFingerprintCache :: SP_XmlFingerprintCache()
+{
+	mMap = new SP_XmlHashMap();
+}
+
+SP_XmlFingerprintCache :: ~SP_XmlFingerprintCache()
+{
+	clear();
+
+	delete mMap;
+	mMap = NULL;
+}
+
+void SP_XmlFingerprintCache :: makeKey( const SP_XmlNode * node, char * key, int size )
+{
+	snprintf( key, size, "%p", (const void*)node );
+}
+
+SP_XmlFingerprintEntry_t * SP_XmlFingerprintCache :: getEntry( const SP_XmlNode * node )
+{
+	char key[ 32 ] = { 0 };
+	makeKey( node, key, sizeof( key ) );
+
+	SP_XmlFingerprintEntry_t * entry = (SP_XmlFingerprintEntry_t*)mMap->get( key );
+	if( NULL == entry ) {
+		entry = (SP_XmlFingerprintEntry_t*)calloc( 1, sizeof( SP_XmlFingerprintEntry_t ) );
+		mMap->put( key, entry );
+	}
+
+	return entry;
+}
+
+void SP_XmlFingerprintCache :: sha256( const SP_XmlNode * node,
+		unsigned char digest[ SP_XmlSha256Sink::DIGEST_SIZE ] )
+{
+	SP_XmlFingerprintEntry_t * entry = getEntry( node );
+
+	if( ! entry->mHasSha256 ) {
+		SP_XmlFingerprint::sha256( node, entry->mSha256 );
+		entry->mHasSha256 = 1;
+	}
+
+	memcpy( digest, entry->mSha256, sizeof( entry->mSha256 ) );
+}
+
+SP_XmlUint64_t SP_XmlFingerprintCache :: hash64( const SP_XmlNode * node )
+{
+	SP_XmlFingerprintEntry_t * entry = getEntry( node );
+
+	if( ! entry->mHasHash64 ) {
+		entry->mHash64 = SP_XmlFingerprint::hash64( node );
+		entry->mHasHash64 = 1;
+	}
+
+	return entry->mHash64;
+}
+
+void SP_XmlFingerprintCache :: invalidate( const SP_XmlNode * node )
+{
+	for( ; NULL != node; node = node->getParent() ) {
+		char key[ 32 ] = { 0 };
+		makeKey( node, key, sizeof( key ) );
+
+		void * entry = mMap->remove( key );
+		if( NULL != entry ) free( entry );
+	}
+}
+
+void SP_XmlFingerprintCache :: clear()
+{
+	void * entry = NULL;
+	for( int i = 0; i < mMap->getCount(); i++ ) {
+		mMap->getItem( i, &entry );
+		if( NULL != entry ) free( entry );
+	}
+
+	delete mMap;
+	mMap = new SP_XmlHashMap();
+}
+
+int SP_XmlFingerprintCache :: getCount() const
+{
+	return mMap->getCount();
+}
+
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmlhash_hpp__
+#define __spxmlhash_hpp__
+
+#include "spxmlsink.hpp"
+
+#ifdef WIN32
+typedef unsigned __int64 SP_XmlUint64_t;
+#else
+typedef unsigned long long SP_XmlUint64_t;
+#endif
+
+class SP_XmlNode;
+class SP_XmlHashMap;
+
+typedef struct tagSP_XmlFingerprintEntry SP_XmlFingerprintEntry_t;
+
+/// a sink which computes the SHA-256 of all the data appended to it
+class SP_XmlSha256Sink : public SP_XmlChunkSink {
+public:
+	enum { DIGEST_SIZE = 32 };
+
+	SP_XmlSha256Sink( int chunkSize = DEFAULT_CHUNK_SIZE );
+	virtual ~SP_XmlSha256Sink();
+
+	/// flush, then get the digest of all the data appended so far,
+	/// more data can still be appended after it
+	void getDigest( unsigned char digest[ DIGEST_SIZE ] );
+
+	/// same as getDigest, as 64 lowercase hex chars plus '\0'
+	void getHexDigest( char hex[ DIGEST_SIZE * 2 + 1 ] );
+
+	/// start over, drop the data appended so far
+	void reset();
+
+protected:
+	virtual int write( const char * data, int len );
+
+private:
+	void transform( const unsigned char * block );
+
+	unsigned int mState[ 8 ];
+	unsigned char mBlock[ 64 ];
+	int mBlockLen;
+	SP_XmlUint64_t mTotal;
+};
+
+/// a sink which computes a fast 64-bit hash of all the data appended to it,
+/// it is not a cryptographic hash. The value is the same on every platform,
+/// whatever the chunks the data is handed over in.
+class SP_XmlHash64Sink : public SP_XmlChunkSink {
+public:
+	SP_XmlHash64Sink( SP_XmlUint64_t seed = 0, int chunkSize = DEFAULT_CHUNK_SIZE );
+	virtual ~SP_XmlHash64Sink();
+
+	/// flush, then get the hash of all the data appended so far,
+	/// more data can still be appended after it
+	SP_XmlUint64_t getHash();
+
+	/// start over, drop the data appended so far
+	void reset();
+
+protected:
+	virtual int write( const char * data, int len );
+
+private:
+	SP_XmlUint64_t mSeed;
+	SP_XmlUint64_t mAcc;
+	unsigned char mTail[ 8 ];
+	int mTailLen;
+	SP_XmlUint64_t mTotal;
+};
+
+/**
+ *  Fingerprint of the canonical form ( SP_CanonXmlBuffer ) of a node,
+ *  the canonical form is hashed while it is written, it is never kept.
+ *
+ *  For a document which is not parsed into a tree, hash the output of
+ *  SP_CanonXmlStream:
+ *
+ *	@verbatim
+ *	SP_XmlSha256Sink sink;
+ *	SP_CanonXmlStream canon( &sink );
+ *	for( ... ) canon.append( buffer, len );
+ *	sink.getDigest( digest );
+ *	@endverbatim
+ */
+class SP_XmlFingerprint {
+public:
+	static void sha256( const SP_XmlNode * node,
+			unsigned char digest[ SP_XmlSha256Sink::DIGEST_SIZE ] );
+
+	static SP_XmlUint64_t hash64( const SP_XmlNode * node );
+
+private:
+	SP_XmlFingerprint();
+};
+
+/// remember the fingerprints of the nodes queried, for the callers who ask
+/// for the same subtrees again and again. The cache does not see the changes
+/// of the tree, call invalidate with the changed node, or clear.
+class SP_XmlFingerprintCache {
+public:
+	SP_XmlFingerprintCache();
+	~SP_XmlFingerprintCache();
+
+	void sha256( const SP_XmlNode * node,
+			unsigned char digest[ SP_XmlSha256Sink::DIGEST_SIZE ] );
+
+	SP_XmlUint64_t hash64( const SP_XmlNode * node );
+
+	/// forget node and all its ancestors
+	void invalidate( const SP_XmlNode * node );
+
+	/// forget all
+	void clear();
+
+	int getCount() const;
+
+private:
+	SP_XmlFingerprintCache( SP_XmlFingerprintCache & );
+	SP_XmlFingerprintCache & operator=( SP_XmlFingerprintCache & );
+
+	SP_XmlFingerprintEntry_t * getEntry( const SP_XmlNode * node );
+
+	static void makeKey( const SP_XmlNode * node, char * key, int size );
+
+	SP_XmlHashMap * mMap;
+};
+
+#endif
+
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef WIN32
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#include "spxmliovec.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlsink.hpp"
+#include "spxmlutils.hpp"
+#include "spxmlcodec.hpp"
+#include "spdomparser.hpp"
+
+typedef struct tagSP_XmlIovecPiece {
+	int mIsSource;
+	int mOffset;
+	int mLen;
+} SP_XmlIovecPiece_t;
+
+SP_XmlIovecBuffer :: SP_XmlIovecBuffer( const char * source, int len,
+		const SP_XmlNode * node, const char * encoding )
+{
+	mSource = source;
+	mSourceLen = len;
+	mEncoding = strdup( NULL != encoding ? encoding : SP_XmlStringCodec::DEFAULT_ENCODING );
+
+	mGenerated = new SP_XmlStringBuffer();
+	mSink = new SP_XmlStringSink( mGenerated );
+	mGeneratedStart = 0;
+
+	mPieces = NULL;
+	mPieceCount = mPieceMax = 0;
+
+	mSize = mSourceSize = 0;
+
+	if( NULL != node ) build( node );
+	endGenerated();
+
+	delete mSink;
+	mSink = NULL;
+
+	// the generated buffer is complete, so the pointers are stable now
+	mIovec = (struct iovec*)malloc( ( mPieceCount > 0 ? mPieceCount : 1 ) * sizeof( struct iovec ) );
+	for( int i = 0; i < mPieceCount; i++ ) {
+		SP_XmlIovecPiece_t * piece = mPieces + i;
+		const char * base = piece->mIsSource ? mSource : mGenerated->getBuffer();
+		mIovec[ i ].iov_base = (void*)( base + piece->mOffset );
+		mIovec[ i ].iov_len = piece->mLen;
+
+		mSize += piece->mLen;
+		if( piece->mIsSource ) mSourceSize += piece->mLen;
+	}
+}
+
+SP_XmlIovecBuffer :: ~SP_XmlIovecBuffer()
+{
+	free( mEncoding );
+	delete mGenerated;
+	if( NULL != mPieces ) free( mPieces );
+	free( mIovec );
+}
+
+const struct iovec * SP_XmlIovecBuffer :: getIovec() const
+{
+	return mIovec;
+}
+
+int SP_XmlIovecBuffer :: getCount() const
+{
+	return mPieceCount;
+}
+
+int SP_XmlIovecBuffer :: getSize() const
+{
+	return mSize;
+}
+
+int SP_XmlIovecBuffer :: getSourceSize() const
+{
+	return mSourceSize;
+}
+
+void SP_XmlIovecBuffer :: addPiece( int isSource, int offset, int len )
+{
+	if( len <= 0 ) return;
+
+	if( mPieceCount > 0 ) {
+		SP_XmlIovecPiece_t * last = mPieces + mPieceCount - 1;
+		if( last->mIsSource == isSource && last->mOffset + last->mLen == offset ) {
+			last->mLen += len;
+			return;
+		}
+	}
+
+	if( mPieceCount >= mPieceMax ) {
+		mPieceMax = mPieceMax > 0 ? mPieceMax * 2 : 16;
+		mPieces = (SP_XmlIovecPiece_t*)realloc( mPieces, mPieceMax * sizeof( SP_XmlIovecPiece_t ) );
+	}
+
+	mPieces[ mPieceCount ].mIsSource = isSource;
+	mPieces[ mPieceCount ].mOffset = offset;
+	mPieces[ mPieceCount ].mLen = len;
+	mPieceCount++;
+}
+
+void SP_XmlIovecBuffer :: endGenerated()
+{
+	mSink->flush();
+
+	addPiece( 0, mGeneratedStart, mGenerated->getSize() - mGeneratedStart );
+	mGeneratedStart = mGenerated->getSize();
+}
+
+void SP_XmlIovecBuffer :: addSource( int offset, int len )
+{
+	endGenerated();
+	addPiece( 1, offset, len );
+}
+
+void SP_XmlIovecBuffer :: build( const SP_XmlNode * node )
+{
+	if( node->isClean() && node->getSourceOffset() + node->getSourceLength() <= mSourceLen ) {
+		addSource( (int)node->getSourceOffset(), (int)node->getSourceLength() );
+		return;
+	}
+
+	if( SP_XmlNode::eXMLDOC == node->getType() ) {
+		SP_XmlDocument * document = static_cast<SP_XmlDocument*>((SP_XmlNode*)node);
+
+		if( NULL != document->getDocDecl() ) build( document->getDocDecl() );
+		if( NULL != document->getDocType() ) build( document->getDocType() );
+
+		const SP_XmlNodeList * children = document->getChildren();
+		for( int j = 0; j < children->getLength(); j++ ) {
+			build( children->get( j ) );
+		}
+	} else if( SP_XmlNode::eELEMENT == node->getType() ) {
+		buildElement( node );
+	} else {
+		SP_XmlDomBuffer::dump( mEncoding, node, mSink, -1 );
+	}
+}
+
+void SP_XmlIovecBuffer :: buildElement( const SP_XmlNode * node )
+{
+	SP_XmlElementNode * element = static_cast<SP_XmlElementNode*>((SP_XmlNode*)node);
+
+	mSink->append( '<' );
+	mSink->append( element->getName() );
+
+	const char * name = NULL, * value = NULL;
+	for( int i = 0; i < element->getAttrCount(); i++ ) {
+		name = element->getAttr( i, &value );
+		if( NULL != name && NULL != value ) {
+			mSink->append( ' ' );
+			mSink->append( name );
+			mSink->append( "=\"" );
+			SP_XmlStringCodec::encode( mEncoding, value, mSink );
+			mSink->append( '"' );
+		}
+	}
+
+	const SP_XmlNodeList * children = element->getChildren();
+
+	if( children->getLength() > 0 ) {
+		mSink->append( '>' );
+
+		for( int j = 0; j < children->getLength(); j++ ) {
+			build( children->get( j ) );
+		}
+
+		mSink->append( "</" );
+		mSink->append( element->getName() );
+		mSink->append( '>' );
+	} else {
+		mSink->append( "/>" );
+	}
+}
+
+int SP_XmlIovecBuffer :: writeTo( int fd ) const
+{
+	enum { BATCH = 64 };
+
+	int index = 0, skip = 0;
+
+	for( ; index < mPieceCount; ) {
+		struct iovec vec[ BATCH ];
+		int count = 0;
+		for( ; count < BATCH && index + count < mPieceCount; count++ ) {
+			vec[ count ] = mIovec[ index + count ];
+		}
+		vec[ 0 ].iov_base = (char*)vec[ 0 ].iov_base + skip;
+		vec[ 0 ].iov_len -= skip;
+
+		int ret = writev( fd, vec, count );
+		if( ret < 0 ) {
+			if( EINTR == errno ) continue;
+			return -1;
+		}
+
+		for( ; ret > 0; ) {
+			int left = mIovec[ index ].iov_len - skip;
+			if( ret >= left ) {
+				ret -= left;
+				index++;
+				skip = 0;
+			} else {
+				skip += ret;
+				ret = 0;
+			}
+		}
+	}
+
+	return 0;
+}
+
+int SP_XmlIovecBuffer :: writeTo( SP_XmlOutputSink * sink ) const
+{
+	for( int i = 0; i < mPieceCount; i++ ) {
+		if( 0 != sink->append( (char*)mIovec[ i ].iov_base, mIovec[ i ].iov_len ) ) return -1;
+	}
+
+	return sink->flush();
+}
+
+#endif
+
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmliovec_hpp__
+#define __spxmliovec_hpp__
+
+#ifndef WIN32
+
+struct iovec;
+
+class SP_XmlNode;
+class SP_XmlStringBuffer;
+class SP_XmlStringSink;
+class SP_XmlOutputSink;
+
+typedef struct tagSP_XmlIovecPiece SP_XmlIovecPiece_t;
+
+/**
+ *  Serialize a tree, which was parsed from an in-memory source, to a
+ *  struct iovec list for writev. A clean subtree ( SP_XmlNode::isClean )
+ *  points back into the source bytes, only the changed parts are generated.
+ *
+ *	@verbatim
+ *	SP_XmlDomParser parser;
+ *	parser.append( source, len );
+ *	... change one element ...
+ *	SP_XmlIovecBuffer out( source, len, parser.getDocument() );
+ *	out.writeTo( fd );
+ *	@endverbatim
+ *
+ *  The source must be the whole input given to the parser, in the same
+ *  order, and must stay unchanged while the iovec list is used. A node moved
+ *  from another document keeps the source range of that document, so move
+ *  nodes between documents with care.
+ *
+ *  The generated parts are not indented.
+ */
+class SP_XmlIovecBuffer {
+public:
+	SP_XmlIovecBuffer( const char * source, int len, const SP_XmlNode * node,
+			const char * encoding = 0 );
+	~SP_XmlIovecBuffer();
+
+	const struct iovec * getIovec() const;
+	int getCount() const;
+
+	/// @return the total bytes
+	int getSize() const;
+
+	/// @return the bytes which point into the source
+	int getSourceSize() const;
+
+	/// writev all the bytes, retry on partial writes
+	/// @return 0 : OK, -1 : error
+	int writeTo( int fd ) const;
+
+	/// @return 0 : OK, -1 : error
+	int writeTo( SP_XmlOutputSink * sink ) const;
+
+private:
+	SP_XmlIovecBuffer( SP_XmlIovecBuffer & );
+	SP_XmlIovecBuffer & operator=( SP_XmlIovecBuffer & );
+
+	void build( const SP_XmlNode * node );
+	void buildElement( const SP_XmlNode * node );
+
+	void addPiece( int isSource, int offset, int len );
+	void addSource( int offset, int len );
+	void endGenerated();
+
+	const char * mSource;
+	int mSourceLen;
+	char * mEncoding;
+
+	SP_XmlStringBuffer * mGenerated;
+	SP_XmlStringSink * mSink;
+	int mGeneratedStart;
+
+	SP_XmlIovecPiece_t * mPieces;
+	int mPieceCount, mPieceMax;
+
+	struct iovec * mIovec;
+	int mSize;
+	int mSourceSize;
+};
+
+#endif
+
+#endif
+
@@ -16,6 +16,9 @@ SP_XmlNode :: SP_XmlNode( int type )
 	: mType( type )
 {
 	mParent = NULL;
+
+	mSourceOffset = mSourceLength = -1;
+	mIsDirty = 0;
 }
 
 SP_XmlNode :: ~SP_XmlNode()
@@ -38,15 +41,50 @@ int SP_XmlNode :: getType() const
 	return mType;
 }
 
+void SP_XmlNode :: setSourceRange( SP_XmlInt64_t offset, SP_XmlInt64_t length )
+{
+	mSourceOffset = offset;
+	mSourceLength = length;
+	mIsDirty = 0;
+}
+
+SP_XmlInt64_t SP_XmlNode :: getSourceOffset() const
+{
+	return mSourceOffset;
+}
+
+SP_XmlInt64_t SP_XmlNode :: getSourceLength() const
+{
+	return mSourceLength;
+}
+
+int SP_XmlNode :: isClean() const
+{
+	return mSourceOffset >= 0 && mSourceLength >= 0 && 0 == mIsDirty;
+}
+
+void SP_XmlNode :: setDirty()
+{
+	// the ancestors of a dirty node are dirty already
+	for( SP_XmlNode * node = this; NULL != node && 0 == node->mIsDirty; ) {
+		node->mIsDirty = 1;
+		node = node->mParent;
+	}
+}
+
 //=========================================================
 
-SP_XmlNodeList :: SP_XmlNodeList()
+SP_XmlNodeList :: SP_XmlNodeList( SP_XmlNode * owner )
 {
 	mList = new SP_XmlArrayList();
+	mOwner = owner;
+	mIndex = NULL;
 }
 
 SP_XmlNodeList :: ~SP_XmlNodeList()
 {
+	resetIndex();
+
 	for( int i = 0; i < mList->getCount(); i++ ) {
 		SP_XmlNode * node = (SP_XmlNode*)mList->getItem( i );
 		delete node;
@@ -64,7 +102,10 @@ int SP_XmlNodeList :: getLength() const
 
 void SP_XmlNodeList :: append( SP_XmlNode * node )
 {
+	resetIndex();
 	mList->append( node );
+
+	if( NULL != mOwner ) mOwner->setDirty();
 }
 
 SP_XmlNode * SP_XmlNodeList :: get( int index ) const
@@ -74,7 +115,87 @@ SP_XmlNode * SP_XmlNodeList :: get( int index ) const
 
 SP_XmlNode * SP_XmlNodeList :: take( int index ) const
 {
-	return (SP_XmlNode*)mList->takeItem( index );
+	resetIndex();
+
+	SP_XmlNode * node = (SP_XmlNode*)mList->takeItem( index );
+	if( NULL != node && NULL != mOwner ) mOwner->setDirty();
+
+	return node;
+}
+
+SP_XmlElementNode * SP_XmlNodeList :: findElement( const char * name, int index ) const
+{
+	if( NULL == name || index < 0 ) return NULL;
+
+	if( mList->getCount() < INDEX_THRESHOLD ) {
+		for( int i = 0; i < mList->getCount(); i++ ) {
+			SP_XmlNode * node = (SP_XmlNode*)mList->getItem( i );
+			if( SP_XmlNode::eELEMENT == node->getType() ) {
+				SP_XmlElementNode * iter = (SP_XmlElementNode*)node;
+				if( 0 == strcmp( name, iter->getName() ) ) {
+					if( 0 == index ) return iter;
+					index--;
+				}
+			}
+		}
+
+		return NULL;
+	}
+
+	SP_XmlHashMap * nameIndex = (SP_XmlHashMap*)SP_XmlAtomic::loadPtr( &mIndex );
+	if( NULL == nameIndex ) {
+		// concurrent readers may build it at the same time, only one is published
+		nameIndex = buildIndex();
+		if( ! SP_XmlAtomic::casPtr( &mIndex, NULL, nameIndex ) ) {
+			freeIndex( nameIndex );
+			nameIndex = (SP_XmlHashMap*)SP_XmlAtomic::loadPtr( &mIndex );
+		}
+	}
+
+	SP_XmlArrayList * list = (SP_XmlArrayList*)nameIndex->get( name );
+
+	return NULL != list ? (SP_XmlElementNode*)list->getItem( index ) : NULL;
+}
+
+SP_XmlHashMap * SP_XmlNodeList :: buildIndex() const
+{
+	SP_XmlHashMap * index = new SP_XmlHashMap();
+
+	for( int i = 0; i < mList->getCount(); i++ ) {
+		SP_XmlNode * node = (SP_XmlNode*)mList->getItem( i );
+		if( SP_XmlNode::eELEMENT != node->getType() ) continue;
+
+		const char * name = ((SP_XmlElementNode*)node)->getName();
+		if( NULL == name ) continue;
+
+		SP_XmlArrayList * list = (SP_XmlArrayList*)index->get( name );
+		if( NULL == list ) {
+			list = new SP_XmlArrayList();
+			index->put( name, list );
+		}
+		list->append( node );
+	}
+
+	return index;
+}
+
+void SP_XmlNodeList :: freeIndex( SP_XmlHashMap * index )
+{
+	for( int i = 0; i < index->getCount(); i++ ) {
+		void * list = NULL;
+		index->getItem( i, &list );
+		delete (SP_XmlArrayList*)list;
+	}
+
+	delete index;
+}
+
+void SP_XmlNodeList :: resetIndex() const
+{
+	if( NULL == mIndex ) return;
+
+	freeIndex( (SP_XmlHashMap*)mIndex );
+	mIndex = NULL;
 }
 
 //=========================================================
@@ -84,7 +205,7 @@ SP_XmlDocument :: SP_XmlDocument()
 {
 	mDocDecl = NULL;
 	mDocType = NULL;
-	mChildren = new SP_XmlNodeList();
+	mChildren = new SP_XmlNodeList( this );
 }
 
 SP_XmlDocument :: ~SP_XmlDocument()
@@ -101,6 +222,8 @@ SP_XmlDocument :: ~SP_XmlDocument()
 
 void SP_XmlDocument :: setDocDecl( SP_XmlDocDeclNode * docDecl )
 {
+	setDirty();
+
 	if( NULL != mDocDecl ) delete mDocDecl;
 	docDecl->setParent( this );
 	mDocDecl = docDecl;
@@ -113,6 +236,8 @@ SP_XmlDocDeclNode * SP_XmlDocument :: getDocDecl() const
 
 void SP_XmlDocument :: setDocType( SP_XmlDocTypeNode * docType )
 {
+	setDirty();
+
 	if( NULL != mDocType ) delete mDocType;
 	docType->setParent( this );
 	mDocType = docType;
@@ -177,6 +302,8 @@ SP_XmlPINode :: SP_XmlPINode( SP_XmlPIEvent * event )
 	: SP_XmlNode( ePI )
 {
 	mEvent = event;
+
+	setSourceRange( event->getSourceOffset(), event->getSourceLength() );
 }
 
 SP_XmlPINode :: ~SP_XmlPINode()
@@ -187,20 +314,24 @@ SP_XmlPINode :: ~SP_XmlPINode()
 
 void SP_XmlPINode :: setTarget( const char * target )
 {
+	setDirty();
+
 	mEvent->setTarget( target );
 }
 
-const char * SP_XmlPINode :: getTarget()
+const char * SP_XmlPINode :: getTarget() const
 {
 	return mEvent->getTarget();
 }
 
 void SP_XmlPINode :: setData( const char * data )
 {
+	setDirty();
+
 	mEvent->setData( data, strlen( data ) );
 }
 
-const char * SP_XmlPINode :: getData()
+const char * SP_XmlPINode :: getData() const
 {
 	return mEvent->getData();
 }
@@ -217,6 +348,8 @@ SP_XmlDocDeclNode :: SP_XmlDocDeclNode( SP_XmlDocDeclEvent * event )
 	: SP_XmlNode( eDOCDECL )
 {
 	mEvent = event;
+
+	setSourceRange( event->getSourceOffset(), event->getSourceLength() );
 }
 
 SP_XmlDocDeclNode :: ~SP_XmlDocDeclNode()
@@ -227,6 +360,8 @@ SP_XmlDocDeclNode :: ~SP_XmlDocDeclNode()
 
 void SP_XmlDocDeclNode :: setVersion( const char * version )
 {
+	setDirty();
+
 	mEvent->setVersion( version );
 }
 
@@ -237,6 +372,8 @@ const char * SP_XmlDocDeclNode :: getVersion() const
 
 void SP_XmlDocDeclNode :: setEncoding( const char * encoding )
 {
+	setDirty();
+
 	mEvent->setEncoding( encoding );
 }
 
@@ -247,6 +384,8 @@ const char * SP_XmlDocDeclNode :: getEncoding() const
 
 void SP_XmlDocDeclNode :: setStandalone( int standalone )
 {
+	setDirty();
+
 	mEvent->setStandalone( standalone );
 }
 
@@ -267,6 +406,8 @@ SP_XmlDocTypeNode :: SP_XmlDocTypeNode( SP_XmlDocTypeEvent * event )
 	: SP_XmlNode( eDOCTYPE )
 {
 	mEvent = event;
+
+	setSourceRange( event->getSourceOffset(), event->getSourceLength() );
 }
 
 SP_XmlDocTypeNode :: ~SP_XmlDocTypeNode()
@@ -277,6 +418,8 @@ SP_XmlDocTypeNode :: ~SP_XmlDocTypeNode()
 
 void SP_XmlDocTypeNode :: setName( const char * name )
 {
+	setDirty();
+
 	mEvent->setName( name );
 }
 
@@ -287,6 +430,8 @@ const char * SP_XmlDocTypeNode :: getName() const
 
 void SP_XmlDocTypeNode :: setSystemID( const char * systemID )
 {
+	setDirty();
+
 	mEvent->setSystemID( systemID );
 }
 
@@ -297,6 +442,8 @@ const char * SP_XmlDocTypeNode :: getSystemID() const
 
 void SP_XmlDocTypeNode :: setPublicID( const char * publicID )
 {
+	setDirty();
+
 	mEvent->setPublicID( publicID );
 }
 
@@ -307,6 +454,8 @@ const char * SP_XmlDocTypeNode :: getPublicID() const
 
 void SP_XmlDocTypeNode :: setDTD( const char * dtd )
 {
+	setDirty();
+
 	mEvent->setDTD( dtd );
 }
 
@@ -321,14 +470,18 @@ SP_XmlElementNode :: SP_XmlElementNode()
 	: SP_XmlNode( eELEMENT )
 {
 	mEvent = new SP_XmlStartTagEvent();
-	mChildren = new SP_XmlNodeList();
+	mChildren = new SP_XmlNodeList( this );
 }
 
 SP_XmlElementNode :: SP_XmlElementNode( SP_XmlStartTagEvent * event )
 	: SP_XmlNode( eELEMENT )
 {
 	mEvent = event;
-	mChildren = new SP_XmlNodeList();
+
+	mChildren = new SP_XmlNodeList( this );
+
+	// the length is known at the end-tag
+	setSourceRange( event->getSourceOffset(), -1 );
 }
 
 SP_XmlElementNode :: ~SP_XmlElementNode()
@@ -342,7 +495,19 @@ SP_XmlElementNode :: ~SP_XmlElementNode()
 
 void SP_XmlElementNode :: setName( const char * name )
 {
+	setDirty();
+
 	mEvent->setName( name );
+
+	// the parent's name index is keyed by our old name
+	const SP_XmlNode * parent = getParent();
+	if( NULL != parent ) {
+		if( eELEMENT == parent->getType() ) {
+			((SP_XmlElementNode*)parent)->mChildren->resetIndex();
+		} else if( eXMLDOC == parent->getType() ) {
+			((SP_XmlDocument*)parent)->getChildren()->resetIndex();
+		}
+	}
 }
 
 const char * SP_XmlElementNode :: getName() const
@@ -363,6 +528,8 @@ const SP_XmlNodeList * SP_XmlElementNode :: getChildren() const
 
 void SP_XmlElementNode :: addAttr( const char * name, const char * value )
 {
+	setDirty();
+
 	mEvent->addAttr( name, value );
 }
 
@@ -381,8 +548,25 @@ const char * SP_XmlElementNode :: getAttr( int index, const char ** value ) cons
 	return mEvent->getAttr( index, value );
 }
 
+int SP_XmlElementNode :: getAttrInt64( const char * name, SP_XmlInt64_t * value ) const
+{
+	return SP_XmlNumber::parseInt64( mEvent->getAttrValue( name ), value );
+}
+
+int SP_XmlElementNode :: getAttrDouble( const char * name, double * value ) const
+{
+	return SP_XmlNumber::parseDouble( mEvent->getAttrValue( name ), value );
+}
+
+int SP_XmlElementNode :: getAttrBool( const char * name, int * value ) const
+{
+	return SP_XmlNumber::parseBool( mEvent->getAttrValue( name ), value );
+}
+
 void SP_XmlElementNode :: removeAttr( const char * name )
 {
+	setDirty();
+
 	mEvent->removeAttr( name );
 }
 
@@ -398,6 +582,8 @@ SP_XmlCDataNode :: SP_XmlCDataNode( SP_XmlCDataEvent * event )
 	: SP_XmlNode( eCDATA )
 {
 	mEvent = event;
+
+	setSourceRange( event->getSourceOffset(), event->getSourceLength() );
 }
 
 SP_XmlCDataNode :: ~SP_XmlCDataNode()
@@ -408,6 +594,8 @@ SP_XmlCDataNode :: ~SP_XmlCDataNode()
 
 void SP_XmlCDataNode :: setText( const char * content )
 {
+	setDirty();
+
 	mEvent->setText( content, strlen( content ) );
 }
 
@@ -416,6 +604,21 @@ const char * SP_XmlCDataNode :: getText() const
 	return mEvent->getText();
 }
 
+int SP_XmlCDataNode :: getTextInt64( SP_XmlInt64_t * value ) const
+{
+	return SP_XmlNumber::parseInt64( mEvent->getText(), value );
+}
+
+int SP_XmlCDataNode :: getTextDouble( double * value ) const
+{
+	return SP_XmlNumber::parseDouble( mEvent->getText(), value );
+}
+
+int SP_XmlCDataNode :: getTextBool( int * value ) const
+{
+	return SP_XmlNumber::parseBool( mEvent->getText(), value );
+}
+
 //=========================================================
 
 SP_XmlCommentNode :: SP_XmlCommentNode()
@@ -428,6 +631,8 @@ SP_XmlCommentNode :: SP_XmlCommentNode( SP_XmlCommentEvent * event )
 	: SP_XmlNode( eCOMMENT )
 {
 	mEvent = event;
+
+	setSourceRange( event->getSourceOffset(), event->getSourceLength() );
 }
 
 SP_XmlCommentNode :: ~SP_XmlCommentNode()
@@ -438,6 +643,8 @@ SP_XmlCommentNode :: ~SP_XmlCommentNode()
 
 void SP_XmlCommentNode :: setText( const char * comment )
 {
+	setDirty();
+
 	mEvent->setText( comment, strlen( comment ) );
 }
 
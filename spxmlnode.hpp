@@ -6,7 +6,24 @@
 #ifndef __spxmlnode_hpp__
 #define __spxmlnode_hpp__
 
+#include "spxmlnumber.hpp"
+
 class SP_XmlArrayList;
+class SP_XmlHashMap;
+
+/**
+ *  Thread safety
+ *
+ *  A finished document, which will not be changed by append, setXXX, addXXX,
+ *  removeXXX or take any more, can be read by many threads at the same time
+ *  without locking. The const methods of the nodes, SP_XmlHandle, SP_XmlPath,
+ *  SP_DomIterator ( one per thread ), SP_XmlDomBuffer and SP_CanonXmlBuffer
+ *  only read the tree. The only lazily built cache is the child name index of
+ *  SP_XmlNodeList, it is published atomically, so concurrent first lookups
+ *  are safe.
+ *
+ *  Changing a document while other threads are reading it needs a lock.
+ */
 
 class SP_XmlNode {
 public:
@@ -19,6 +36,20 @@ public:
 	const SP_XmlNode * getParent() const;
 	int getType() const;
 
+	/// the byte range of the node in the parsed input, an element covers
+	/// its start-tag to its end-tag, -1 : the node was not parsed
+	void setSourceRange( SP_XmlInt64_t offset, SP_XmlInt64_t length );
+	SP_XmlInt64_t getSourceOffset() const;
+	SP_XmlInt64_t getSourceLength() const;
+
+	/// @return 1 : the node and its descendants have not been changed since
+	/// they were parsed, the source range can be written out as is
+	int isClean() const;
+
+	/// mark the node and its ancestors changed, called by the setXXX,
+	/// addXXX, removeXXX methods and by SP_XmlNodeList append/take
+	void setDirty();
+
 protected:
 	SP_XmlNode( SP_XmlNode & );
 	SP_XmlNode & operator=( SP_XmlNode & );
@@ -26,11 +57,21 @@ protected:
 private:
 	SP_XmlNode * mParent;
 	const int mType;
+
+	SP_XmlInt64_t mSourceOffset;
+	SP_XmlInt64_t mSourceLength;
+	int mIsDirty;
 };
 
+class SP_XmlElementNode;
+
 class SP_XmlNodeList {
 public:
-	SP_XmlNodeList();
+	/// lists shorter than this are scanned linearly, no name index is built
+	enum { INDEX_THRESHOLD = 8 };
+
+	/// @param owner : the node the list belongs to, made dirty by append and take
+	SP_XmlNodeList( SP_XmlNode * owner = 0 );
 	~SP_XmlNodeList();
 
 	int getLength() const;
@@ -38,11 +79,26 @@ public:
 	SP_XmlNode * get( int index ) const;
 	SP_XmlNode * take( int index ) const;
 
+	/// find the index'th element named name, the name index is built on first lookup
+	/// @return NULL : not found
+	SP_XmlElementNode * findElement( const char * name, int index = 0 ) const;
+
+	/// drop the name index, it will be rebuilt by the next findElement
+	void resetIndex() const;
+
 private:
 	SP_XmlNodeList( SP_XmlNodeList & );
 	SP_XmlNodeList & operator=( SP_XmlNodeList & );
 
+	SP_XmlHashMap * buildIndex() const;
+	static void freeIndex( SP_XmlHashMap * index );
+
 	SP_XmlArrayList * mList;
+	SP_XmlNode * mOwner;
+
+	/// element name -> SP_XmlArrayList of elements, in document order,
+	/// readers publish it with SP_XmlAtomic, see the thread-safety note above
+	mutable void * volatile mIndex;
 };
 
 class SP_XmlPIEvent;
@@ -52,7 +108,6 @@ class SP_XmlStartTagEvent;
 class SP_XmlCDataEvent;
 class SP_XmlCommentEvent;
 
-class SP_XmlElementNode;
 class SP_XmlDocDeclNode;
 class SP_XmlDocTypeNode;
 
@@ -82,10 +137,10 @@ public:
 	virtual ~SP_XmlPINode();
 
 	void setTarget( const char * target );
-	const char * getTarget();
+	const char * getTarget() const;
 
 	void setData( const char * data );
-	const char * getData();
+	const char * getData() const;
 
 private:
 	SP_XmlPIEvent * mEvent;
@@ -143,6 +198,12 @@ public:
 	int getAttrCount() const;
 	const char * getAttr( int index, const char ** value ) const;
 
+	/// parse the attribute by SP_XmlNumber, value is kept on eNotFound and eFormatError
+	/// @return SP_XmlNumber::eOK, eNotFound, eFormatError, eOverflow
+	int getAttrInt64( const char * name, SP_XmlInt64_t * value ) const;
+	int getAttrDouble( const char * name, double * value ) const;
+	int getAttrBool( const char * name, int * value ) const;
+
 	void removeAttr( const char * name );
 
 protected:
@@ -159,6 +220,11 @@ public:
 	void setText( const char * content );
 	const char * getText() const;
 
+	/// parse the text by SP_XmlNumber, see SP_XmlElementNode::getAttrInt64
+	int getTextInt64( SP_XmlInt64_t * value ) const;
+	int getTextDouble( double * value ) const;
+	int getTextBool( int * value ) const;
+
 protected:
 	SP_XmlCDataEvent * mEvent;
 };
@@ -0,0 +1,243 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <errno.h>
+#include <locale.h>
+
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+
+#include "spxmlnumber.hpp"
+
+// the powers of ten which are exact in a double
+static const double POW10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const unsigned long long MAX_EXACT_INT = 1ULL << 53;
+
+static inline int isSpace( char c )
+{
+	return ' ' == c || '\t' == c || '\r' == c || '\n' == c;
+}
+
+static inline int isDigit( char c )
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline const char * skipSpace( const char * pos )
+{
+	for( ; isSpace( *pos ); ) pos++;
+
+	return pos;
+}
+
+// the slow path, strtod without the decimal comma of the current locale
+static double strtodC( const char * text, char ** end )
+{
+#ifdef WIN32
+	static _locale_t cLocale = _create_locale( LC_NUMERIC, "C" );
+	return _strtod_l( text, end, cLocale );
+#else
+	static locale_t cLocale = newlocale( LC_NUMERIC_MASK, "C", (locale_t)0 );
+	return strtod_l( text, end, cLocale );
+#endif
+}
+
+int SP_XmlNumber :: parseInt64( const char * text, SP_XmlInt64_t * value )
+{
+	if( NULL == text ) return eNotFound;
+
+	const char * pos = skipSpace( text );
+
+	int isNegative = '-' == *pos;
+	if( '-' == *pos || '+' == *pos ) pos++;
+
+	if( ! isDigit( *pos ) ) return eFormatError;
+
+	// the magnitude, -2^63 has one more than the maximum
+	unsigned long long limit = isNegative ? ( 1ULL << 63 ) : ( 1ULL << 63 ) - 1;
+	unsigned long long magnitude = 0;
+	int isOverflow = 0;
+
+	for( ; isDigit( *pos ); pos++ ) {
+		unsigned int digit = *pos - '0';
+		if( magnitude > ( limit - digit ) / 10 ) {
+			isOverflow = 1;
+		} else {
+			magnitude = magnitude * 10 + digit;
+		}
+	}
+
+	if( '\0' != *skipSpace( pos ) ) return eFormatError;
+
+	if( isOverflow ) magnitude = limit;
+
+	if( isNegative ) {
+		*value = 0 == magnitude ? 0 : -(SP_XmlInt64_t)( magnitude - 1 ) - 1;
+	} else {
+		*value = (SP_XmlInt64_t)magnitude;
+	}
+
+	return isOverflow ? eOverflow : eOK;
+}
+
+int SP_XmlNumber :: parseDouble( const char * text, double * value )
+{
+	if( NULL == text ) return eNotFound;
+
+	const char * start = skipSpace( text );
+	const char * pos = start;
+
+	int isNegative = '-' == *pos;
+	if( '-' == *pos || '+' == *pos ) pos++;
+
+	if( 0 == strncmp( pos, "INF", 3 ) || 0 == strncmp( pos, "NaN", 3 ) ) {
+		if( '\0' != *skipSpace( pos + 3 ) ) return eFormatError;
+
+		double special = 'I' == *pos ? HUGE_VAL : NAN;
+		*value = isNegative ? -special : special;
+		return eOK;
+	}
+
+	// up to 19 significant digits, the rest only moves the exponent
+	unsigned long long mantissa = 0;
+	int digits = 0, exponent = 0, hasDigit = 0, isTruncated = 0;
+
+	for( ; isDigit( *pos ); pos++ ) {
+		hasDigit = 1;
+		if( 0 == mantissa && '0' == *pos ) continue;
+
+		if( digits < 19 ) {
+			mantissa = mantissa * 10 + ( *pos - '0' );
+			digits++;
+		} else {
+			exponent++;
+			if( '0' != *pos ) isTruncated = 1;
+		}
+	}
+
+	if( '.' == *pos ) {
+		for( pos++; isDigit( *pos ); pos++ ) {
+			hasDigit = 1;
+			if( 0 == mantissa && '0' == *pos ) {
+				exponent--;
+			} else if( digits < 19 ) {
+				mantissa = mantissa * 10 + ( *pos - '0' );
+				digits++;
+				exponent--;
+			} else if( '0' != *pos ) {
+				isTruncated = 1;
+			}
+		}
+	}
+
+	if( ! hasDigit ) return eFormatError;
+
+	if( 'e' == *pos || 'E' == *pos ) {
+		pos++;
+
+		int isNegativeExp = '-' == *pos;
+		if( '-' == *pos || '+' == *pos ) pos++;
+
+		if( ! isDigit( *pos ) ) return eFormatError;
+
+		int exp = 0;
+		for( ; isDigit( *pos ); pos++ ) {
+			if( exp < 100000 ) exp = exp * 10 + ( *pos - '0' );
+		}
+
+		exponent += isNegativeExp ? -exp : exp;
+	}
+
+	if( '\0' != *skipSpace( pos ) ) return eFormatError;
+
+	double result = 0;
+	int isExact = 0;
+
+	if( 0 == mantissa ) {
+		isExact = 1;
+	} else if( ! isTruncated && mantissa <= MAX_EXACT_INT ) {
+#if defined( FLT_EVAL_METHOD ) && 0 == FLT_EVAL_METHOD
+		// both operands are exact, so one rounding gives the right result
+		if( exponent >= 0 && exponent <= 22 ) {
+			result = (double)mantissa * POW10[ exponent ];
+			isExact = 1;
+		} else if( exponent < 0 && exponent >= -22 ) {
+			result = (double)mantissa / POW10[ -exponent ];
+			isExact = 1;
+		} else if( exponent > 22 && exponent <= 22 + 15 ) {
+			// move some zeros into the mantissa while it stays exact
+			unsigned long long shifted = mantissa;
+			int i = 22;
+			for( ; i < exponent && shifted <= MAX_EXACT_INT / 10; i++ ) shifted *= 10;
+			if( i == exponent ) {
+				result = (double)shifted * POW10[ 22 ];
+				isExact = 1;
+			}
+		}
+#endif
+	}
+
+	if( isExact ) {
+		*value = isNegative ? -result : result;
+		return eOK;
+	}
+
+	*value = strtodC( start, NULL );
+
+	return isinf( *value ) ? eOverflow : eOK;
+}
+
+int SP_XmlNumber :: parseBool( const char * text, int * value )
+{
+	if( NULL == text ) return eNotFound;
+
+	const char * pos = skipSpace( text );
+
+	int result = 0, len = 0;
+
+	if( 0 == strncmp( pos, "true", 4 ) ) {
+		result = 1;
+		len = 4;
+	} else if( 0 == strncmp( pos, "false", 5 ) ) {
+		len = 5;
+	} else if( '1' == *pos || '0' == *pos ) {
+		result = '1' == *pos;
+		len = 1;
+	} else {
+		return eFormatError;
+	}
+
+	if( '\0' != *skipSpace( pos + len ) ) return eFormatError;
+
+	*value = result;
+
+	return eOK;
+}
+
+const char * SP_XmlNumber :: getErrorText( int code )
+{
+	switch( code ) {
+		case eOK:
+			return "ok";
+		case eNotFound:
+			return "not found";
+		case eFormatError:
+			return "format error";
+		case eOverflow:
+			return "overflow";
+	}
+
+	return "unknown error";
+}
+
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmlnumber_hpp__
+#define __spxmlnumber_hpp__
+
+#ifdef WIN32
+typedef __int64 SP_XmlInt64_t;
+#else
+typedef long long SP_XmlInt64_t;
+#endif
+
+/**
+ *  Parse the text of attributes and text nodes, the xml schema way: the
+ *  decimal point is always '.', whatever the locale is, and the whitespace
+ *  around the value is skipped. Nothing is allocated.
+ *
+ *  A double with up to 19 significant digits and a small exponent is
+ *  computed exactly with one multiply or divide, the others go to strtod
+ *  in the C locale, so the result is always the correctly rounded one.
+ */
+class SP_XmlNumber {
+public:
+	enum { eOK = 0, eNotFound = -1, eFormatError = -2, eOverflow = -3 };
+
+	/// [+-]digits
+	static int parseInt64( const char * text, SP_XmlInt64_t * value );
+
+	/// [+-]digits[.digits][(e|E)[+-]digits], INF, -INF, NaN
+	static int parseDouble( const char * text, double * value );
+
+	/// true, false, 1, 0
+	static int parseBool( const char * text, int * value );
+
+	/// @return the name of an error code
+	static const char * getErrorText( int code );
+
+private:
+	SP_XmlNumber();
+};
+
+#endif
+
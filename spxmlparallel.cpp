@@ -0,0 +1,667 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "spxmlparallel.hpp"
+#include "spxmlparser.hpp"
+#include "spdomparser.hpp"
+#include "spxmlevent.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlutils.hpp"
+
+struct tagSP_XmlParallelChunk {
+	long long mBegin;
+	long long mEnd;
+	int mIsFirst;
+	int mIsLast;
+
+	enum { ePending, eDone, eMerged };
+	int mState;
+
+	// the result, a document or the events, valid means the chunk was
+	// cut at the right places
+	int mIsValid;
+	char * mError;
+	SP_XmlDocument * mDocument;
+	SP_XmlPullEventQueue * mEvents;
+
+	// the real end-tag of the root, in the last chunk
+	SP_XmlInt64_t mRootEndOffset;
+	SP_XmlInt64_t mRootEndLength;
+
+	char mEncoding[ 32 ];
+
+	// the state of parsing, see parseChunk
+	int mDepth;
+	int mPrefixLen;
+	int mSuffixOffset;
+	int mIsRootEnded;
+	int mIsSuffixEnded;
+};
+
+static int isNameChar( char c )
+{
+	return NULL == strchr( " \t\r\n/>=\"'", c ) && '\0' != c;
+}
+
+// skip the markup at pos which has no element in it, comments, CDATA, PIs
+// @return the end of the markup, pos : no such markup, end : not terminated
+static const char * skipMarkup( const char * pos, const char * end )
+{
+	static const struct { const char * mOpen, * mClose; } MARKUPS[] = {
+		{ "<!--", "-->" }, { "<![CDATA[", "]]>" }, { "<?", "?>" }
+	};
+
+	for( int i = 0; i < (int)( sizeof( MARKUPS ) / sizeof( MARKUPS[0] ) ); i++ ) {
+		int openLen = strlen( MARKUPS[i].mOpen ), closeLen = strlen( MARKUPS[i].mClose );
+		if( end - pos >= openLen && 0 == memcmp( pos, MARKUPS[i].mOpen, openLen ) ) {
+			const char * close = (const char*)memmem( pos + openLen, end - pos - openLen,
+					MARKUPS[i].mClose, closeLen );
+			return NULL == close ? end : close + closeLen;
+		}
+	}
+
+	return pos;
+}
+
+//=========================================================
+
+SP_XmlParallelParser :: SP_XmlParallelParser( int threadCount, int chunkSize )
+{
+	if( threadCount <= 0 ) threadCount = (int)sysconf( _SC_NPROCESSORS_ONLN );
+	mThreadCount = threadCount > 0 ? threadCount : 1;
+	mChunkSize = chunkSize > 0 ? chunkSize : DEFAULT_CHUNK_SIZE;
+	mIgnoreWhitespace = 1;
+
+	mCallback = NULL;
+	mCallbackArg = NULL;
+
+	mSource = NULL;
+	mSourceLen = 0;
+
+	mRootName = mRecordName = NULL;
+	mRecordNameLen = 0;
+	mRecordsStart = 0;
+
+	mChunks = NULL;
+	mChunkCount = mMergeCount = 0;
+
+	mNextChunk = mStitchChunk = 0;
+	mIsStopped = 0;
+
+	pthread_mutex_init( &mMutex, NULL );
+	pthread_cond_init( &mChanged, NULL );
+
+	mDocument = NULL;
+	mError = NULL;
+	memset( mEncoding, 0, sizeof( mEncoding ) );
+}
+
+SP_XmlParallelParser :: ~SP_XmlParallelParser()
+{
+	reset();
+
+	pthread_mutex_destroy( &mMutex );
+	pthread_cond_destroy( &mChanged );
+}
+
+void SP_XmlParallelParser :: reset()
+{
+	for( int i = 0; i < mChunkCount; i++ ) freeChunk( &( mChunks[i] ) );
+	if( NULL != mChunks ) free( mChunks );
+	mChunks = NULL;
+	mChunkCount = mMergeCount = 0;
+
+	if( NULL != mRootName ) free( mRootName );
+	if( NULL != mRecordName ) free( mRecordName );
+	mRootName = mRecordName = NULL;
+	mRecordNameLen = 0;
+
+	if( NULL != mDocument ) delete mDocument;
+	mDocument = NULL;
+
+	if( NULL != mError ) free( mError );
+	mError = NULL;
+
+	memset( mEncoding, 0, sizeof( mEncoding ) );
+}
+
+void SP_XmlParallelParser :: setIgnoreWhitespace( int ignoreWhitespace )
+{
+	mIgnoreWhitespace = ignoreWhitespace;
+}
+
+void SP_XmlParallelParser :: setEventCallback( EventCallback_t callback, void * arg )
+{
+	mCallback = callback;
+	mCallbackArg = arg;
+}
+
+const char * SP_XmlParallelParser :: getError()
+{
+	return mError;
+}
+
+const SP_XmlDocument * SP_XmlParallelParser :: getDocument() const
+{
+	return mDocument;
+}
+
+SP_XmlDocument * SP_XmlParallelParser :: takeDocument()
+{
+	SP_XmlDocument * ret = mDocument;
+	mDocument = NULL;
+
+	return ret;
+}
+
+const char * SP_XmlParallelParser :: getEncoding()
+{
+	return mEncoding;
+}
+
+void SP_XmlParallelParser :: getStats( int * chunkCount, int * mergeCount )
+{
+	if( NULL != chunkCount ) *chunkCount = mChunkCount;
+	if( NULL != mergeCount ) *mergeCount = mMergeCount;
+}
+
+void SP_XmlParallelParser :: setError( const char * error )
+{
+	if( NULL != mError ) free( mError );
+	mError = strdup( error );
+}
+
+int SP_XmlParallelParser :: parseFile( const char * path )
+{
+	reset();
+
+	int fd = open( path, O_RDONLY );
+	if( fd < 0 ) {
+		char error[ 256 ] = { 0 };
+		snprintf( error, sizeof( error ), "cannot open %s, %s", path, strerror( errno ) );
+		setError( error );
+		return -1;
+	}
+
+	int ret = -1;
+
+	struct stat aStat;
+	void * map = MAP_FAILED;
+	if( 0 == fstat( fd, &aStat ) && S_ISREG( aStat.st_mode ) && aStat.st_size > 0 ) {
+		map = mmap( NULL, aStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	}
+
+	if( MAP_FAILED != map ) {
+		madvise( map, aStat.st_size, MADV_WILLNEED );
+		ret = parse( (char*)map, aStat.st_size );
+		munmap( map, aStat.st_size );
+	} else {
+		SP_XmlStringBuffer buffer;
+
+		char chunk[ 65536 ];
+		for( int len = 0; ( len = read( fd, chunk, sizeof( chunk ) ) ) != 0; ) {
+			if( len < 0 && EINTR == errno ) continue;
+			if( len < 0 ) break;
+			buffer.append( chunk, len );
+		}
+
+		ret = parse( buffer.getBuffer(), buffer.getSize() );
+	}
+
+	close( fd );
+
+	return ret;
+}
+
+int SP_XmlParallelParser :: parse( const char * source, long long len )
+{
+	reset();
+
+	mSource = source;
+	mSourceLen = len;
+
+	split();
+
+	mNextChunk = mStitchChunk = 0;
+	mIsStopped = 0;
+
+	int workerCount = mThreadCount - 1 < mChunkCount - 1 ? mThreadCount - 1 : mChunkCount - 1;
+	pthread_t * workers = (pthread_t*)calloc( workerCount > 0 ? workerCount : 1, sizeof( pthread_t ) );
+	int started = 0;
+	for( ; started < workerCount; started++ ) {
+		if( 0 != pthread_create( &( workers[ started ] ), NULL, workerMain, this ) ) break;
+	}
+
+	for( int i = 0; i < mChunkCount; ) {
+		SP_XmlParallelChunk_t * chunk = &( mChunks[i] );
+
+		// parse it here if no worker has claimed it yet
+		int isClaimed = 0;
+
+		pthread_mutex_lock( &mMutex );
+		mStitchChunk = i;
+		pthread_cond_broadcast( &mChanged );
+		if( mNextChunk == i ) {
+			mNextChunk++;
+			isClaimed = 1;
+		} else {
+			for( ; SP_XmlParallelChunk_t::eDone != chunk->mState; ) {
+				pthread_cond_wait( &mChanged, &mMutex );
+			}
+		}
+		pthread_mutex_unlock( &mMutex );
+
+		if( isClaimed ) parseChunk( chunk );
+
+		for( ; ! chunk->mIsValid && ! chunk->mIsLast; ) mergeChunk( i );
+
+		if( ! chunk->mIsValid ) {
+			char error[ 512 ] = { 0 };
+			snprintf( error, sizeof( error ), "%s, in the chunk from byte %lld",
+					NULL != chunk->mError ? chunk->mError : "unknown error", chunk->mBegin );
+			setError( error );
+		}
+
+		if( 0 != stitchChunk( chunk ) ) {
+			if( NULL == mError ) setError( "stopped by the event callback" );
+			break;
+		}
+
+		if( ! chunk->mIsValid ) break;
+
+		for( i++; i < mChunkCount && SP_XmlParallelChunk_t::eMerged == mChunks[i].mState; ) i++;
+	}
+
+	pthread_mutex_lock( &mMutex );
+	mIsStopped = 1;
+	pthread_cond_broadcast( &mChanged );
+	pthread_mutex_unlock( &mMutex );
+
+	for( int i = 0; i < started; i++ ) pthread_join( workers[i], NULL );
+	free( workers );
+
+	for( int i = 0; i < mChunkCount; i++ ) freeChunk( &( mChunks[i] ) );
+
+	mSource = NULL;
+	mSourceLen = 0;
+
+	return NULL == mError ? 0 : -1;
+}
+
+int SP_XmlParallelParser :: split()
+{
+	const char * begin = mSource, * end = mSource + mSourceLen;
+	const char * pos = begin;
+
+	// the prolog, up to the start-tag of the root
+	for( ; ; ) {
+		for( ; pos < end && '<' != *pos; ) pos++;
+		if( pos >= end ) break;
+
+		const char * next = skipMarkup( pos, end );
+		if( next != pos ) {
+			pos = next;
+		} else if( end - pos > 2 && '!' == pos[1] ) {
+			// the doctype, with its internal subset
+			int bracket = 0;
+			for( pos++; pos < end && ( bracket > 0 || '>' != *pos ); pos++ ) {
+				if( '[' == *pos ) bracket++;
+				if( ']' == *pos ) bracket--;
+			}
+		} else {
+			break;
+		}
+	}
+
+	const char * name = pos + 1;
+	for( pos = name; pos < end && isNameChar( *pos ); ) pos++;
+
+	if( pos < end && pos > name ) {
+		mRootName = strndup( name, pos - name );
+
+		// the rest of the start-tag, a '>' may be in a quoted value
+		for( char quote = 0; pos < end && ( 0 != quote || '>' != *pos ); pos++ ) {
+			if( 0 != quote && quote == *pos ) {
+				quote = 0;
+			} else if( 0 == quote && ( '"' == *pos || '\'' == *pos ) ) {
+				quote = *pos;
+			}
+		}
+
+		if( pos < end && '/' != pos[-1] ) {
+			mRecordsStart = ++pos - begin;
+
+			// the first child element names the records
+			for( ; pos < end; ) {
+				for( ; pos < end && '<' != *pos; ) pos++;
+				if( pos >= end ) break;
+
+				const char * next = skipMarkup( pos, end );
+				if( next != pos ) {
+					pos = next;
+					continue;
+				}
+
+				if( end - pos > 1 && isNameChar( pos[1] ) ) {
+					for( name = ++pos; pos < end && isNameChar( *pos ); ) pos++;
+					mRecordName = strndup( name, pos - name );
+					mRecordNameLen = pos - name;
+				}
+				break;
+			}
+		}
+	}
+
+	// the boundaries, one chunk for a document without records
+	int maxCount = 1 + mSourceLen / mChunkSize + 1;
+	mChunks = (SP_XmlParallelChunk_t*)calloc( maxCount, sizeof( SP_XmlParallelChunk_t ) );
+
+	long long boundary = 0;
+	for( mChunkCount = 0; boundary < mSourceLen && mChunkCount < maxCount; ) {
+		SP_XmlParallelChunk_t * chunk = &( mChunks[ mChunkCount ] );
+		chunk->mBegin = boundary;
+		chunk->mIsFirst = 0 == mChunkCount;
+
+		long long target = ( 0 == mChunkCount ? mRecordsStart : boundary ) + mChunkSize;
+		boundary = ( NULL != mRecordName && target < mSourceLen ) ? findBoundary( target ) : mSourceLen;
+		if( mChunkCount + 1 >= maxCount ) boundary = mSourceLen;
+
+		chunk->mEnd = boundary;
+		chunk->mIsLast = boundary >= mSourceLen;
+		mChunkCount++;
+	}
+
+	if( 0 == mChunkCount ) {
+		mChunks[0].mIsFirst = mChunks[0].mIsLast = 1;
+		mChunkCount = 1;
+	}
+
+	return 0;
+}
+
+long long SP_XmlParallelParser :: findBoundary( long long from )
+{
+	const char * end = mSource + mSourceLen;
+
+	for( const char * pos = mSource + from; pos < end; ) {
+		pos = (const char*)memchr( pos, '<', end - pos );
+		if( NULL == pos ) break;
+
+		const char * next = skipMarkup( pos, end );
+		if( next != pos ) {
+			pos = next;
+			continue;
+		}
+
+		if( end - pos > mRecordNameLen + 1 && 0 == memcmp( pos + 1, mRecordName, mRecordNameLen )
+				&& ! isNameChar( pos[ mRecordNameLen + 1 ] ) ) {
+			return pos - mSource;
+		}
+
+		pos++;
+	}
+
+	return mSourceLen;
+}
+
+void * SP_XmlParallelParser :: workerMain( void * arg )
+{
+	((SP_XmlParallelParser*)arg)->runWorker();
+
+	return NULL;
+}
+
+void SP_XmlParallelParser :: runWorker()
+{
+	// with a callback, only a few chunks are kept ahead of it
+	int window = NULL != mCallback ? 2 * mThreadCount : mChunkCount;
+
+	pthread_mutex_lock( &mMutex );
+
+	for( ; ; ) {
+		for( ; ! mIsStopped && mNextChunk < mChunkCount && mNextChunk >= mStitchChunk + window; ) {
+			pthread_cond_wait( &mChanged, &mMutex );
+		}
+
+		if( mIsStopped || mNextChunk >= mChunkCount ) break;
+
+		SP_XmlParallelChunk_t * chunk = &( mChunks[ mNextChunk++ ] );
+
+		pthread_mutex_unlock( &mMutex );
+		parseChunk( chunk );
+		pthread_mutex_lock( &mMutex );
+
+		pthread_cond_broadcast( &mChanged );
+	}
+
+	pthread_mutex_unlock( &mMutex );
+}
+
+void SP_XmlParallelParser :: mergeChunk( int index )
+{
+	SP_XmlParallelChunk_t * chunk = &( mChunks[ index ] );
+
+	int next = index + 1;
+	for( ; SP_XmlParallelChunk_t::eMerged == mChunks[ next ].mState; ) next++;
+
+	// wait for the next chunk, or take it away from the workers
+	pthread_mutex_lock( &mMutex );
+	if( mNextChunk == next ) {
+		mNextChunk++;
+	} else {
+		for( ; SP_XmlParallelChunk_t::eDone != mChunks[ next ].mState; ) {
+			pthread_cond_wait( &mChanged, &mMutex );
+		}
+	}
+	mChunks[ next ].mState = SP_XmlParallelChunk_t::eMerged;
+	pthread_mutex_unlock( &mMutex );
+
+	freeChunk( &( mChunks[ next ] ) );
+	freeChunk( chunk );
+
+	chunk->mEnd = mChunks[ next ].mEnd;
+	chunk->mIsLast = mChunks[ next ].mIsLast;
+	mMergeCount++;
+
+	parseChunk( chunk );
+}
+
+void SP_XmlParallelParser :: freeChunk( SP_XmlParallelChunk_t * chunk )
+{
+	if( NULL != chunk->mError ) free( chunk->mError );
+	chunk->mError = NULL;
+
+	if( NULL != chunk->mDocument ) delete chunk->mDocument;
+	chunk->mDocument = NULL;
+
+	if( NULL != chunk->mEvents ) delete chunk->mEvents;
+	chunk->mEvents = NULL;
+}
+
+// build the document of a chunk with builder, or keep the events,
+// and drop the copies of the root tag around it
+static void handleEvent( SP_XmlParallelChunk_t * chunk, SP_XmlPullEvent * event,
+		SP_XmlDomParser * builder )
+{
+	int type = event->getEventType();
+
+	// the offset in the chunk input, which starts with the prefix
+	SP_XmlInt64_t offset = event->getSourceOffset();
+	if( offset >= 0 ) {
+		event->setSourceRange( offset - chunk->mPrefixLen + chunk->mBegin, event->getSourceLength() );
+	}
+
+	int isCopy = 0;
+
+	if( SP_XmlPullEvent::eStartTag == type ) {
+		chunk->mDepth++;
+		if( 1 == chunk->mDepth && ! chunk->mIsFirst ) isCopy = 1;
+	} else if( SP_XmlPullEvent::eEndTag == type ) {
+		chunk->mDepth--;
+		if( 0 == chunk->mDepth ) {
+			if( ! chunk->mIsLast && offset == chunk->mSuffixOffset ) {
+				isCopy = 1;
+				chunk->mIsSuffixEnded = 1;
+			} else {
+				chunk->mIsRootEnded = 1;
+				chunk->mRootEndOffset = event->getSourceOffset();
+				chunk->mRootEndLength = event->getSourceLength();
+			}
+		}
+	} else if( SP_XmlPullEvent::eStartDocument == type ) {
+		isCopy = ! chunk->mIsFirst;
+	} else if( SP_XmlPullEvent::eEndDocument == type ) {
+		isCopy = ! chunk->mIsLast;
+	}
+
+	if( NULL != builder ) {
+		// the copy of the root holds the records until they are stitched
+		builder->addEvent( event );
+	} else if( isCopy ) {
+		delete event;
+	} else {
+		chunk->mEvents->enqueue( event );
+	}
+}
+
+static void feedChunk( SP_XmlPullParser * parser, SP_XmlParallelChunk_t * chunk,
+		const char * data, long long len, SP_XmlDomParser * builder )
+{
+	for( long long pos = 0; pos < len && NULL == parser->getError(); ) {
+		int slice = len - pos > 65536 ? 65536 : (int)( len - pos );
+		parser->append( data + pos, slice );
+		pos += slice;
+
+		for( SP_XmlPullEvent * event = parser->getNext(); NULL != event; event = parser->getNext() ) {
+			handleEvent( chunk, event, builder );
+		}
+	}
+}
+
+void SP_XmlParallelParser :: parseChunk( SP_XmlParallelChunk_t * chunk )
+{
+	// the tree is built the same way as SP_XmlDomParser does
+	SP_XmlDomParser * builder = NULL;
+
+	if( NULL == mCallback ) {
+		builder = new SP_XmlDomParser();
+	} else {
+		chunk->mEvents = new SP_XmlPullEventQueue();
+	}
+
+	chunk->mDepth = 0;
+	chunk->mIsRootEnded = chunk->mIsSuffixEnded = 0;
+	chunk->mRootEndOffset = chunk->mRootEndLength = -1;
+
+	// a chunk in the middle is parsed inside <root> ... </root>
+	char prefix[ 256 ] = { 0 }, suffix[ 256 ] = { 0 };
+	if( ! chunk->mIsFirst && NULL != mRootName ) {
+		snprintf( prefix, sizeof( prefix ), "<%s>", mRootName );
+	}
+	if( ! chunk->mIsLast && NULL != mRootName ) {
+		snprintf( suffix, sizeof( suffix ), "</%s>", mRootName );
+	}
+
+	chunk->mPrefixLen = strlen( prefix );
+	chunk->mSuffixOffset = chunk->mPrefixLen + (int)( chunk->mEnd - chunk->mBegin );
+
+	SP_XmlPullParser parser;
+	parser.setIgnoreWhitespace( mIgnoreWhitespace );
+
+	feedChunk( &parser, chunk, prefix, chunk->mPrefixLen, builder );
+	feedChunk( &parser, chunk, mSource + chunk->mBegin, chunk->mEnd - chunk->mBegin, builder );
+	feedChunk( &parser, chunk, suffix, strlen( suffix ), builder );
+
+	if( NULL != builder ) {
+		chunk->mDocument = builder->takeDocument();
+		delete builder;
+	}
+
+	if( NULL != parser.getError() ) {
+		chunk->mError = strdup( parser.getError() );
+	} else if( chunk->mIsLast ? ! chunk->mIsRootEnded : ! chunk->mIsSuffixEnded ) {
+		chunk->mError = strdup( "unexpected end of input" );
+	}
+
+	chunk->mIsValid = NULL == chunk->mError;
+
+	if( chunk->mIsFirst ) {
+		snprintf( chunk->mEncoding, sizeof( chunk->mEncoding ), "%s", parser.getEncoding() );
+	}
+
+	// the state is read by the stitching thread under the lock
+	pthread_mutex_lock( &mMutex );
+	chunk->mState = SP_XmlParallelChunk_t::eDone;
+	pthread_mutex_unlock( &mMutex );
+}
+
+int SP_XmlParallelParser :: stitchChunk( SP_XmlParallelChunk_t * chunk )
+{
+	if( chunk->mIsFirst ) memcpy( mEncoding, chunk->mEncoding, sizeof( mEncoding ) );
+
+	if( NULL != chunk->mEvents ) {
+		for( SP_XmlPullEvent * event = chunk->mEvents->dequeue(); NULL != event;
+				event = chunk->mEvents->dequeue() ) {
+			if( 0 != mCallback( mCallbackArg, event ) ) {
+				pthread_mutex_lock( &mMutex );
+				mIsStopped = 1;
+				pthread_cond_broadcast( &mChanged );
+				pthread_mutex_unlock( &mMutex );
+				return -1;
+			}
+		}
+		return 0;
+	}
+
+	if( chunk->mIsFirst ) {
+		mDocument = chunk->mDocument;
+		chunk->mDocument = NULL;
+
+		// the end-tag in this chunk is the copy, the last chunk gives the range
+		SP_XmlElementNode * root = mDocument->getRootElement();
+		if( ! chunk->mIsRootEnded && NULL != root ) root->setDirty();
+
+		return 0;
+	}
+
+	SP_XmlElementNode * root = NULL == mDocument ? NULL : mDocument->getRootElement();
+	SP_XmlDocument * document = chunk->mDocument;
+	SP_XmlElementNode * copy = document->getRootElement();
+
+	if( NULL == root || NULL == copy ) return 0;
+
+	// the records, in their order
+	SP_XmlNodeList * records = (SP_XmlNodeList*)copy->getChildren();
+	int count = records->getLength();
+	SP_XmlNode ** nodes = (SP_XmlNode**)malloc( ( count > 0 ? count : 1 ) * sizeof( SP_XmlNode * ) );
+	for( int i = count - 1; i >= 0; i-- ) nodes[i] = records->take( i );
+	for( int i = 0; i < count; i++ ) root->addChild( nodes[i] );
+	free( nodes );
+
+	// the comments and PIs after the root
+	SP_XmlNodeList * children = document->getChildren();
+	int index = 0;
+	for( ; index < children->getLength() && copy != children->get( index ); ) index++;
+	for( index++; index < children->getLength(); ) {
+		mDocument->getChildren()->append( children->take( index ) );
+	}
+
+	if( chunk->mIsRootEnded && root->getSourceOffset() >= 0 && chunk->mRootEndOffset >= 0 ) {
+		root->setSourceRange( root->getSourceOffset(),
+				chunk->mRootEndOffset + chunk->mRootEndLength - root->getSourceOffset() );
+	}
+
+	return 0;
+}
+
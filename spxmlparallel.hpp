@@ -0,0 +1,136 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmlparallel_hpp__
+#define __spxmlparallel_hpp__
+
+#include <pthread.h>
+
+class SP_XmlDocument;
+class SP_XmlPullEvent;
+
+typedef struct tagSP_XmlParallelChunk SP_XmlParallelChunk_t;
+
+/**
+ *  Parse one large record oriented document, <records><record>...</record>
+ *  ...</records>, on many threads.
+ *
+ *  The input is cut into chunks of about chunkSize at a guessed boundary,
+ *  a '<' followed by the name of the first child of the root, skipping the
+ *  comments, CDATA sections and PIs met on the way. Each chunk is parsed
+ *  on its own, inside a copy of the root tag, by a pool of threads. The
+ *  results are stitched in document order. A chunk which does not end
+ *  exactly at its closing copy of the root tag was cut at a wrong place,
+ *  it is merged with the next chunk and parsed again, so the result is the
+ *  same as the one of SP_XmlDomParser, whatever the document is.
+ *
+ *  Source offsets are 64-bit, each chunk's are rebased to those of the
+ *  whole input, past 2 GB too.
+ */
+class SP_XmlParallelParser {
+public:
+	enum { DEFAULT_CHUNK_SIZE = 4 * 1024 * 1024 };
+
+	/// @return 0 : OK, -1 : stop parsing
+	typedef int ( * EventCallback_t )( void * arg, SP_XmlPullEvent * event );
+
+	/// threadCount : <= 0 means the number of cpus, the calling thread is one of them
+	SP_XmlParallelParser( int threadCount = 0, int chunkSize = DEFAULT_CHUNK_SIZE );
+	~SP_XmlParallelParser();
+
+	/// default ignoreWhitespace is true
+	void setIgnoreWhitespace( int ignoreWhitespace );
+
+	/// hand the events over to callback in document order, which takes over
+	/// them, instead of building a document. Only a few chunks are kept
+	/// ahead of the callback, so the memory is bounded.
+	void setEventCallback( EventCallback_t callback, void * arg );
+
+	/// parse a whole document, source must stay valid until parse returns
+	/// @return 0 : OK, -1 : error or stopped by the callback, see getError
+	int parse( const char * source, long long len );
+
+	/// map the file and parse it, a pipe or device is read into memory first
+	/// @return 0 : OK, -1 : error, see getError
+	int parseFile( const char * path );
+
+	/// @return NOT NULL : the detail error message
+	/// @return NULL : no error
+	const char * getError();
+
+	/// the parse result, NULL with an event callback
+	const SP_XmlDocument * getDocument() const;
+
+	/// take over the parse result, the caller should delete it
+	SP_XmlDocument * takeDocument();
+
+	const char * getEncoding();
+
+	/// the chunks of the last parse, and how many guessed boundaries were wrong
+	void getStats( int * chunkCount, int * mergeCount );
+
+private:
+	SP_XmlParallelParser( SP_XmlParallelParser & );
+	SP_XmlParallelParser & operator=( SP_XmlParallelParser & );
+
+	void reset();
+
+	void setError( const char * error );
+
+	/// find the root and the record names, and the guessed boundaries
+	int split();
+
+	long long findBoundary( long long from );
+
+	static void * workerMain( void * arg );
+
+	/// claim and parse chunks until all are claimed
+	void runWorker();
+
+	void parseChunk( SP_XmlParallelChunk_t * chunk );
+
+	/// merge the following chunks into chunk index until it is valid
+	void mergeChunk( int index );
+
+	/// move the result of a chunk to the document or the callback
+	int stitchChunk( SP_XmlParallelChunk_t * chunk );
+
+	void freeChunk( SP_XmlParallelChunk_t * chunk );
+
+	int mThreadCount;
+	int mChunkSize;
+	int mIgnoreWhitespace;
+
+	EventCallback_t mCallback;
+	void * mCallbackArg;
+
+	const char * mSource;
+	long long mSourceLen;
+
+	// the root element, <name ...>, and the element name which starts a record
+	char * mRootName;
+	char * mRecordName;
+	int mRecordNameLen;
+	long long mRecordsStart;
+
+	SP_XmlParallelChunk_t * mChunks;
+	int mChunkCount;
+	int mMergeCount;
+
+	// the next chunk to claim, and the chunk being stitched
+	int mNextChunk;
+	int mStitchChunk;
+	int mIsStopped;
+
+	pthread_mutex_t mMutex;
+	pthread_cond_t mChanged;
+
+	SP_XmlDocument * mDocument;
+	char * mError;
+	char mEncoding[ 32 ];
+};
+
+#endif
+
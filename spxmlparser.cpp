@@ -5,7 +5,9 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdio.h>
 #include <assert.h>
+#include <ctype.h>
 #include <typeinfo>
 
 #include "spxmlparser.hpp"
@@ -13,6 +15,8 @@
 #include "spxmlutils.hpp"
 #include "spxmlevent.hpp"
 #include "spxmlcodec.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlsource.hpp"
 
 SP_XmlPullParser :: SP_XmlPullParser()
 {
@@ -25,15 +29,27 @@ SP_XmlPullParser :: SP_XmlPullParser()
 	mTagNameStack = new SP_XmlArrayList();
 	mLevel = 0;
 
+	mSubtreeRoot = mSubtreeCurrent = NULL;
+
 	mIgnoreWhitespace = 1;
 
+	mIsMultiDocument = 0;
+	mIsBetweenDocuments = 0;
+
 	mError = NULL;
 
 	memset( mErrorSegment, 0, sizeof( mErrorSegment ) );
 	mErrorIndex = 0;
 	mRowIndex = mColIndex = 0;
 
+	mOffset = mTokenStart = mTextStart = 0;
+
 	memset( mEncoding, 0, sizeof( mEncoding ) );
+
+	mSource = NULL;
+	mIsOwnSource = 0;
+	mSourceData = NULL;
+	mSourceLen = 0;
 }
 
 SP_XmlPullParser :: ~SP_XmlPullParser()
@@ -49,9 +65,56 @@ SP_XmlPullParser :: ~SP_XmlPullParser()
 
 	delete mReaderPool;
 
+	if( NULL != mSubtreeRoot ) delete mSubtreeRoot;
+
+	closeSource();
+
 	if( NULL != mError ) free( mError );	
 }
 
+void SP_XmlPullParser :: reset()
+{
+	// keep the readers and the queue, only their content goes
+	mReaderPool->save( mReader );
+	mReader = getReader( SP_XmlReader::eLBracket );
+
+	for( SP_XmlPullEvent * event = mEventQueue->dequeue(); NULL != event;
+			event = mEventQueue->dequeue() ) {
+		delete event;
+	}
+
+	// a stream starts its first document with the first markup
+	if( mIsMultiDocument ) {
+		mIsBetweenDocuments = 1;
+	} else {
+		mIsBetweenDocuments = 0;
+		mEventQueue->enqueue( new SP_XmlStartDocEvent() );
+	}
+
+	mRootTagState = eRootNone;
+	for( int i = 0; i < mTagNameStack->getCount(); i++ ) {
+		free( (char*)mTagNameStack->getItem( i ) );
+	}
+	mTagNameStack->clean();
+	mLevel = 0;
+
+	if( NULL != mSubtreeRoot ) delete mSubtreeRoot;
+	mSubtreeRoot = mSubtreeCurrent = NULL;
+
+	if( NULL != mError ) free( mError );
+	mError = NULL;
+
+	memset( mErrorSegment, 0, sizeof( mErrorSegment ) );
+	mErrorIndex = 0;
+	mRowIndex = mColIndex = 0;
+
+	mOffset = mTokenStart = mTextStart = 0;
+
+	memset( mEncoding, 0, sizeof( mEncoding ) );
+
+	closeSource();
+}
+
 const char * SP_XmlPullParser :: getEncoding()
 {
 	if( '\0' == mEncoding[0] ) {
@@ -75,6 +138,7 @@ int SP_XmlPullParser :: append( const char * source, int len )
 
 		mErrorSegment[ mErrorIndex++ % sizeof( mErrorSegment ) ] = c;
 		mReader->read( this, c );
+		mOffset++;
 		if( '\n' == c ) {
 			mRowIndex++;
 			mColIndex = 0;
@@ -86,8 +150,76 @@ int SP_XmlPullParser :: append( const char * source, int len )
 	return consumed;
 }
 
+int SP_XmlPullParser :: parseFile( const char * path )
+{
+	SP_XmlFileSource * source = new SP_XmlFileSource( path );
+
+	if( 0 != source->getError() ) {
+		char error[ 256 ] = { 0 };
+		snprintf( error, sizeof( error ), "cannot open %s, %s", path, strerror( source->getError() ) );
+		delete source;
+
+		if( NULL != mError ) free( mError );
+		mError = strdup( error );
+
+		return -1;
+	}
+
+	setSource( source );
+	mIsOwnSource = 1;
+
+	return 0;
+}
+
+void SP_XmlPullParser :: setSource( SP_XmlInputSource * source )
+{
+	closeSource();
+
+	mSource = source;
+}
+
+void SP_XmlPullParser :: closeSource()
+{
+	if( mIsOwnSource && NULL != mSource ) delete mSource;
+
+	mSource = NULL;
+	mIsOwnSource = 0;
+	mSourceData = NULL;
+	mSourceLen = 0;
+}
+
+void SP_XmlPullParser :: readSource()
+{
+	// a small slice at a time, so the queue holds a few events, not a whole window
+	for( ; NULL != mSource && NULL == mError && mEventQueue->isEmpty(); ) {
+		if( mSourceLen <= 0 ) {
+			mSourceLen = mSource->read( &mSourceData );
+
+			if( mSourceLen < 0 ) {
+				char error[ 256 ] = { 0 };
+				snprintf( error, sizeof( error ), "read error, %s", strerror( mSource->getError() ) );
+				setError( error );
+			} else if( 0 == mSourceLen && ( mIsMultiDocument
+					? ! mIsBetweenDocuments : eRootEnd != mRootTagState ) ) {
+				setError( "unexpected end of input" );
+			}
+
+			if( mSourceLen <= 0 ) closeSource();
+
+			continue;
+		}
+
+		int len = mSourceLen > 4096 ? 4096 : mSourceLen;
+		append( mSourceData, len );
+		mSourceData += len;
+		mSourceLen -= len;
+	}
+}
+
 SP_XmlPullEvent * SP_XmlPullParser :: getNext()
 {
+	if( NULL != mSource ) readSource();
+
 	SP_XmlPullEvent * event = mEventQueue->dequeue();
 
 	if( NULL != event ) {
@@ -98,6 +230,65 @@ SP_XmlPullEvent * SP_XmlPullParser :: getNext()
 	return event;
 }
 
+SP_XmlElementNode * SP_XmlPullParser :: readSubtree( SP_XmlStartTagEvent * startTag )
+{
+	if( NULL != startTag ) {
+		// not a start-tag, the caller keeps it
+		if( SP_XmlPullEvent::eStartTag != startTag->getEventType() ) return NULL;
+
+		if( NULL != mSubtreeRoot ) delete mSubtreeRoot;
+		mSubtreeRoot = mSubtreeCurrent = new SP_XmlElementNode( startTag );
+	}
+
+	if( NULL == mSubtreeRoot ) return NULL;
+
+	for( SP_XmlPullEvent * event = getNext(); NULL != event; event = getNext() ) {
+		switch( event->getEventType() ) {
+			case SP_XmlPullEvent::eStartTag:
+				{
+					SP_XmlElementNode * element =
+							new SP_XmlElementNode( (SP_XmlStartTagEvent*)event );
+					mSubtreeCurrent->addChild( element );
+					mSubtreeCurrent = element;
+					break;
+				}
+			case SP_XmlPullEvent::eEndTag:
+				{
+					if( mSubtreeCurrent->getSourceOffset() >= 0 && event->getSourceOffset() >= 0 ) {
+						mSubtreeCurrent->setSourceRange( mSubtreeCurrent->getSourceOffset(),
+								event->getSourceOffset() + event->getSourceLength()
+								- mSubtreeCurrent->getSourceOffset() );
+					}
+
+					delete event;
+
+					if( mSubtreeCurrent == mSubtreeRoot ) {
+						SP_XmlElementNode * ret = mSubtreeRoot;
+						mSubtreeRoot = mSubtreeCurrent = NULL;
+						return ret;
+					}
+
+					mSubtreeCurrent = (SP_XmlElementNode*)mSubtreeCurrent->getParent();
+					break;
+				}
+			case SP_XmlPullEvent::eCData:
+				mSubtreeCurrent->addChild( new SP_XmlCDataNode( (SP_XmlCDataEvent*)event ) );
+				break;
+			case SP_XmlPullEvent::eComment:
+				mSubtreeCurrent->addChild( new SP_XmlCommentNode( (SP_XmlCommentEvent*)event ) );
+				break;
+			case SP_XmlPullEvent::ePI:
+				mSubtreeCurrent->addChild( new SP_XmlPINode( (SP_XmlPIEvent*)event ) );
+				break;
+			default:
+				delete event;
+				break;
+		}
+	}
+
+	return NULL;
+}
+
 int SP_XmlPullParser :: getLevel()
 {
 	return mLevel;
@@ -113,6 +304,31 @@ int SP_XmlPullParser :: getIgnoreWhitespace()
 	return mIgnoreWhitespace;
 }
 
+void SP_XmlPullParser :: setMultiDocument( int multiDocument )
+{
+	mIsMultiDocument = multiDocument ? 1 : 0;
+
+	// no input yet, only the StartDocument of the first document is queued
+	if( 0 == mOffset && NULL == mError ) {
+		for( SP_XmlPullEvent * event = mEventQueue->dequeue(); NULL != event;
+				event = mEventQueue->dequeue() ) {
+			delete event;
+		}
+
+		if( mIsMultiDocument ) {
+			mIsBetweenDocuments = 1;
+		} else {
+			mIsBetweenDocuments = 0;
+			mEventQueue->enqueue( new SP_XmlStartDocEvent() );
+		}
+	}
+}
+
+int SP_XmlPullParser :: getMultiDocument()
+{
+	return mIsMultiDocument;
+}
+
 const char * SP_XmlPullParser :: getError()
 {
 	return mError;
@@ -121,6 +337,18 @@ const char * SP_XmlPullParser :: getError()
 void SP_XmlPullParser :: changeReader( SP_XmlReader * reader )
 {
 	SP_XmlPullEvent * event = mReader->getEvent( this );
+
+	if( NULL != event ) {
+		if( mTokenStart == mOffset ) {
+			// text, ended by the '<' of the next token
+			event->setSourceRange( mTextStart, mOffset - mTextStart );
+		} else {
+			event->setSourceRange( mTokenStart, mOffset + 1 - mTokenStart );
+		}
+	}
+
+	if( mTokenStart != mOffset ) mTextStart = mOffset + 1;
+
 	if( NULL != event ) {
 		if( SP_XmlPullEvent::eStartTag == event->getEventType() ) {
 			if( eRootNone == mRootTagState ) mRootTagState = eRootStart;
@@ -150,6 +378,8 @@ void SP_XmlPullParser :: changeReader( SP_XmlReader * reader )
 			}
 		}
 
+		if( NULL != event && mIsBetweenDocuments ) event = startDocument( event );
+
 		if( NULL != event ) {
 			if( SP_XmlPullEvent::eDocDecl == event->getEventType() ) {
 				snprintf( mEncoding, sizeof( mEncoding ), "%s",
@@ -158,7 +388,17 @@ void SP_XmlPullParser :: changeReader( SP_XmlReader * reader )
 			mEventQueue->enqueue( event );
 			if( mTagNameStack->getCount() <= 0 && eRootStart == mRootTagState ) {
 				mRootTagState = eRootEnd;
-				mEventQueue->enqueue( new SP_XmlEndDocEvent() );
+
+				SP_XmlPullEvent * endDoc = new SP_XmlEndDocEvent();
+				mEventQueue->enqueue( endDoc );
+
+				if( mIsMultiDocument ) {
+					endDoc->setSourceRange( event->getSourceOffset() + event->getSourceLength(), 0 );
+
+					// the next document starts with its first markup, see startDocument
+					mRootTagState = eRootNone;
+					mIsBetweenDocuments = 1;
+				}
 			}
 		}
 	}
@@ -169,6 +409,35 @@ void SP_XmlPullParser :: changeReader( SP_XmlReader * reader )
 	mReader = reader;
 }
 
+SP_XmlPullEvent * SP_XmlPullParser :: startDocument( SP_XmlPullEvent * event )
+{
+	if( SP_XmlPullEvent::eCData == event->getEventType() ) {
+		const char * pos = ((SP_XmlCDataEvent*)event)->getText();
+		for( ; '\0' != *pos && isspace( (unsigned char)*pos ); ) pos++;
+
+		if( '\0' != *pos ) setError( "text outside the root element" );
+
+		delete event;
+		return NULL;
+	}
+
+	mIsBetweenDocuments = 0;
+
+	SP_XmlPullEvent * startDoc = new SP_XmlStartDocEvent();
+	startDoc->setSourceRange( event->getSourceOffset(), 0 );
+	mEventQueue->enqueue( startDoc );
+
+	// the encoding of the last document does not carry over
+	memset( mEncoding, 0, sizeof( mEncoding ) );
+
+	return event;
+}
+
+void SP_XmlPullParser :: markToken()
+{
+	mTokenStart = mOffset;
+}
+
 SP_XmlReader * SP_XmlPullParser :: getReader( int type )
 {
 	return mReaderPool->borrow( type );
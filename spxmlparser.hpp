@@ -6,11 +6,16 @@
 #ifndef __xmlparser_hpp__
 #define __xmlparser_hpp__
 
+#include "spxmlnumber.hpp"
+
 class SP_XmlPullEvent;
 class SP_XmlPullEventQueue;
 class SP_XmlReader;
 class SP_XmlReaderPool;
 class SP_XmlArrayList;
+class SP_XmlStartTagEvent;
+class SP_XmlElementNode;
+class SP_XmlInputSource;
 
 class SP_XmlPullParser {
 public:
@@ -21,10 +26,30 @@ public:
 	/// @return how much byte has been consumed
 	int append( const char * source, int len );
 
+	/// read the input from a file, a piece at a time as getNext needs it,
+	/// a regular file is mapped instead of copied, see SP_XmlFileSource,
+	/// for a gzip file setSource a SP_XmlGzipSource instead
+	/// @return 0 : OK, -1 : cannot open the file, see getError
+	int parseFile( const char * path );
+
+	/// read the input from source as getNext needs it, the source must
+	/// outlive the parser, or the end of input
+	void setSource( SP_XmlInputSource * source );
+
 	/// @return NOT NULL : the pull event
-	/// @return NULL : error or need more input
+	/// @return NULL : error or need more input, with a source : error or end of input
 	SP_XmlPullEvent * getNext();	
 
+	/// read the events up to the end-tag matching startTag, and build them to
+	/// an element tree, startTag must be the start-tag event just returned by
+	/// getNext, the parser takes over it. Typical usage is a record oriented
+	/// document, <records><record>...</record>...</records>, materialize one
+	/// record at a time and keep pulling the rest.
+	/// @return NOT NULL : the element, the caller should delete it
+	/// @return NULL : error or need more input, call readSubtree( NULL ) after append,
+	///   or startTag is not a start-tag, the caller keeps it
+	SP_XmlElementNode * readSubtree( SP_XmlStartTagEvent * startTag );
+
 	/// @return NOT NULL : the detail error message
 	/// @return NULL : no error
 	const char * getError();
@@ -38,6 +63,23 @@ public:
 
 	const char * getEncoding();
 
+	/// a stream of documents one after another, such as a log of records or
+	/// messages off a socket, instead of a single document. Each document is
+	/// StartDocument ... EndDocument, the parser goes on with the next one in
+	/// place. The StartDocument offset is the first byte of the document's
+	/// first markup, the EndDocument offset is the byte after its root end-tag,
+	/// whitespace between documents is dropped, other text is an error. The end
+	/// of input is only an error inside a document. getEncoding is the one of
+	/// the latest document read, see the DocDecl event for each document.
+	/// Set it before any input.
+	void setMultiDocument( int multiDocument );
+
+	int getMultiDocument();
+
+	/// forget the current document, and be ready for the next one,
+	/// the readers and buffers are kept, ignoreWhitespace and multiDocument are kept
+	void reset();
+
 protected:
 	void changeReader( SP_XmlReader * reader );
 
@@ -45,6 +87,19 @@ protected:
 
 	void setError( const char * error );
 
+	/// feed the source until an event is ready
+	void readSource();
+
+	void closeSource();
+
+	/// a markup token starts at the current byte
+	void markToken();
+
+	/// in multi-document mode, the first event after a document ends
+	/// starts the next one
+	/// @return NULL : the event is dropped
+	SP_XmlPullEvent * startDocument( SP_XmlPullEvent * event );
+
 	friend class SP_XmlReader;
 
 private:
@@ -53,6 +108,9 @@ private:
 	SP_XmlReaderPool * mReaderPool;
 	SP_XmlArrayList * mTagNameStack;
 
+	SP_XmlElementNode * mSubtreeRoot;
+	SP_XmlElementNode * mSubtreeCurrent;
+
 	enum { eRootNone, eRootStart, eRootEnd };
 	int mRootTagState;
 
@@ -60,13 +118,28 @@ private:
 
 	int mIgnoreWhitespace;
 
+	int mIsMultiDocument;
+	// no document is open, the next markup starts one
+	int mIsBetweenDocuments;
+
 	char * mError;
 
 	char mErrorSegment[ 32 ];
 	int mErrorIndex;
 	int mColIndex, mRowIndex;
 
+	// byte offsets in the whole input : the current byte,
+	// the '<' of the current markup token, the first byte after the last markup
+	SP_XmlInt64_t mOffset;
+	SP_XmlInt64_t mTokenStart;
+	SP_XmlInt64_t mTextStart;
+
 	char mEncoding[ 32 ];
+
+	SP_XmlInputSource * mSource;
+	int mIsOwnSource;
+	const char * mSourceData;
+	int mSourceLen;
 };
 
 #endif
@@ -0,0 +1,785 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "spxmlpath.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlutils.hpp"
+#include "spxmlparser.hpp"
+#include "spxmlevent.hpp"
+
+enum { eAxisChild, eAxisDescendant };
+enum { eTestName, eTestAny, eTestText, eTestSelf, eTestParent };
+enum { ePredPosition, ePredLast, ePredAttrExists, ePredAttrEquals };
+
+typedef struct tagSP_XmlPathPred {
+	int mType;
+	int mPosition;
+	char * mName;
+	char * mValue;
+} SP_XmlPathPred_t;
+
+struct tagSP_XmlPathStep {
+	int mAxis;
+	int mTest;
+	char * mName;
+
+	int mPredCount;
+	SP_XmlPathPred_t * mPreds;
+};
+
+static const SP_XmlNodeList * getChildList( const SP_XmlNode * node )
+{
+	if( SP_XmlNode::eELEMENT == node->getType() ) {
+		return ((SP_XmlElementNode*)node)->getChildren();
+	} else if( SP_XmlNode::eXMLDOC == node->getType() ) {
+		return ((SP_XmlDocument*)node)->getChildren();
+	}
+
+	return NULL;
+}
+
+static void freeStep( SP_XmlPathStep_t * step )
+{
+	for( int i = 0; i < step->mPredCount; i++ ) {
+		if( NULL != step->mPreds[i].mName ) free( step->mPreds[i].mName );
+		if( NULL != step->mPreds[i].mValue ) free( step->mPreds[i].mValue );
+	}
+
+	if( NULL != step->mPreds ) free( step->mPreds );
+	if( NULL != step->mName ) free( step->mName );
+
+	free( step );
+}
+
+static const char * skipSpace( const char * pos )
+{
+	for( ; isspace( (unsigned char)*pos ); ) pos++;
+	return pos;
+}
+
+static const char * readName( const char * pos, char ** name )
+{
+	const char * end = pos;
+	for( ; '\0' != *end && NULL == strchr( "/[]=@'\"", *end ) && ! isspace( (unsigned char)*end ); ) end++;
+
+	*name = NULL;
+	if( end > pos ) {
+		*name = (char*)malloc( end - pos + 1 );
+		memcpy( *name, pos, end - pos );
+		(*name)[ end - pos ] = '\0';
+	}
+
+	return end;
+}
+
+//=========================================================
+
+SP_XmlPath :: SP_XmlPath( const char * expr )
+{
+	mExpr = strdup( NULL == expr ? "" : expr );
+	mError = NULL;
+	mIsAbsolute = 0;
+	mSteps = new SP_XmlArrayList();
+
+	compile( mExpr );
+}
+
+SP_XmlPath :: ~SP_XmlPath()
+{
+	for( int i = 0; i < mSteps->getCount(); i++ ) {
+		freeStep( (SP_XmlPathStep_t*)mSteps->getItem( i ) );
+	}
+	delete mSteps;
+	mSteps = NULL;
+
+	free( mExpr );
+	mExpr = NULL;
+
+	if( NULL != mError ) free( mError );
+	mError = NULL;
+}
+
+const char * SP_XmlPath :: getError() const
+{
+	return mError;
+}
+
+const char * SP_XmlPath :: getExpr() const
+{
+	return mExpr;
+}
+
+int SP_XmlPath :: isAbsolute() const
+{
+	return mIsAbsolute;
+}
+
+int SP_XmlPath :: getStepCount() const
+{
+	return mSteps->getCount();
+}
+
+void SP_XmlPath :: setError( const char * error, const char * pos )
+{
+	if( NULL != mError ) return;
+
+	char msg[ 256 ];
+	snprintf( msg, sizeof( msg ), "%s ( occured at col(%d) of \"%s\" )",
+			error, (int)( pos - mExpr ) + 1, mExpr );
+
+	mError = strdup( msg );
+}
+
+void SP_XmlPath :: compile( const char * expr )
+{
+	const char * pos = skipSpace( expr );
+
+	int axis = eAxisChild;
+
+	if( '/' == *pos ) {
+		mIsAbsolute = 1;
+		if( '/' == pos[1] ) {
+			axis = eAxisDescendant;
+			pos += 2;
+		} else {
+			pos++;
+		}
+
+		// "/" alone selects the document
+		if( eAxisChild == axis && '\0' == *skipSpace( pos ) ) return;
+	}
+
+	for( ; NULL == mError; ) {
+		SP_XmlPathStep_t * step = (SP_XmlPathStep_t*)calloc( 1, sizeof( SP_XmlPathStep_t ) );
+		step->mAxis = axis;
+
+		pos = compileStep( skipSpace( pos ), step );
+
+		if( NULL != mError ) {
+			freeStep( step );
+			break;
+		}
+
+		mSteps->append( step );
+
+		pos = skipSpace( pos );
+
+		if( '\0' == *pos ) break;
+
+		if( '/' == *pos ) {
+			if( '/' == pos[1] ) {
+				axis = eAxisDescendant;
+				pos += 2;
+			} else {
+				axis = eAxisChild;
+				pos++;
+			}
+		} else {
+			setError( "unexpected char", pos );
+		}
+	}
+}
+
+const char * SP_XmlPath :: compileStep( const char * pos, SP_XmlPathStep_t * step )
+{
+	if( 0 == strncmp( pos, "text()", 6 ) ) {
+		step->mTest = eTestText;
+		pos += 6;
+	} else if( '*' == *pos ) {
+		step->mTest = eTestAny;
+		pos++;
+	} else if( 0 == strncmp( pos, "..", 2 ) ) {
+		step->mTest = eTestParent;
+		pos += 2;
+	} else if( '.' == *pos ) {
+		step->mTest = eTestSelf;
+		pos++;
+	} else {
+		step->mTest = eTestName;
+		pos = readName( pos, &( step->mName ) );
+		if( NULL == step->mName ) {
+			setError( "miss step name", pos );
+			return pos;
+		}
+	}
+
+	if( eAxisDescendant == step->mAxis
+			&& ( eTestSelf == step->mTest || eTestParent == step->mTest ) ) {
+		setError( "'.' or '..' cannot follow '//'", pos );
+		return pos;
+	}
+
+	for( pos = skipSpace( pos ); '[' == *pos && NULL == mError; pos = skipSpace( pos ) ) {
+		pos = compilePredicate( skipSpace( pos + 1 ), step );
+	}
+
+	return pos;
+}
+
+const char * SP_XmlPath :: compilePredicate( const char * pos, SP_XmlPathStep_t * step )
+{
+	step->mPreds = (SP_XmlPathPred_t*)realloc( step->mPreds,
+			sizeof( SP_XmlPathPred_t ) * ( step->mPredCount + 1 ) );
+	SP_XmlPathPred_t * pred = &( step->mPreds[ step->mPredCount++ ] );
+	memset( pred, 0, sizeof( SP_XmlPathPred_t ) );
+
+	if( isdigit( (unsigned char)*pos ) ) {
+		char * end = NULL;
+		pred->mType = ePredPosition;
+		pred->mPosition = strtol( pos, &end, 10 );
+		pos = end;
+		if( pred->mPosition <= 0 ) {
+			setError( "position must be greater than 0", pos );
+			return pos;
+		}
+	} else if( 0 == strncmp( pos, "last()", 6 ) ) {
+		pred->mType = ePredLast;
+		pos += 6;
+	} else if( '@' == *pos ) {
+		pred->mType = ePredAttrExists;
+		pos = skipSpace( readName( pos + 1, &( pred->mName ) ) );
+		if( NULL == pred->mName ) {
+			setError( "miss attribute name", pos );
+			return pos;
+		}
+
+		if( '=' == *pos ) {
+			pos = skipSpace( pos + 1 );
+
+			char quot = *pos;
+			if( '\'' != quot && '"' != quot ) {
+				setError( "attribute value must be quoted", pos );
+				return pos;
+			}
+
+			const char * end = strchr( pos + 1, quot );
+			if( NULL == end ) {
+				setError( "unterminated attribute value", pos );
+				return pos;
+			}
+
+			pred->mType = ePredAttrEquals;
+			pred->mValue = (char*)malloc( end - pos );
+			memcpy( pred->mValue, pos + 1, end - pos - 1 );
+			pred->mValue[ end - pos - 1 ] = '\0';
+			pos = end + 1;
+		}
+	} else {
+		setError( "unsupported predicate", pos );
+		return pos;
+	}
+
+	pos = skipSpace( pos );
+	if( ']' != *pos ) {
+		setError( "miss ']'", pos );
+		return pos;
+	}
+
+	return pos + 1;
+}
+
+//=========================================================
+
+int SP_XmlPath :: matchTest( const SP_XmlPathStep_t * step, const SP_XmlNode * node )
+{
+	switch( step->mTest ) {
+		case eTestName:
+			return SP_XmlNode::eELEMENT == node->getType()
+					&& 0 == strcmp( step->mName, ((SP_XmlElementNode*)node)->getName() );
+		case eTestAny:
+			return SP_XmlNode::eELEMENT == node->getType();
+		case eTestText:
+			return SP_XmlNode::eCDATA == node->getType();
+		default:
+			return 1;
+	}
+}
+
+void SP_XmlPath :: filter( const SP_XmlPathStep_t * step,
+		const SP_XmlArrayList * candidates, SP_XmlArrayList * result )
+{
+	SP_XmlArrayList temp1, temp2;
+
+	const SP_XmlArrayList * curr = candidates;
+	SP_XmlArrayList * next = &temp1;
+
+	for( int i = 0; i < step->mPredCount; i++ ) {
+		const SP_XmlPathPred_t * pred = &( step->mPreds[i] );
+
+		next->clean();
+
+		for( int j = 0; j < curr->getCount(); j++ ) {
+			const SP_XmlNode * node = (SP_XmlNode*)curr->getItem( j );
+
+			int isMatch = 0;
+
+			if( ePredPosition == pred->mType ) {
+				isMatch = ( j + 1 == pred->mPosition );
+			} else if( ePredLast == pred->mType ) {
+				isMatch = ( j == curr->getCount() - 1 );
+			} else if( SP_XmlNode::eELEMENT == node->getType() ) {
+				const char * value = ((SP_XmlElementNode*)node)->getAttrValue( pred->mName );
+				if( ePredAttrExists == pred->mType ) {
+					isMatch = ( NULL != value );
+				} else {
+					isMatch = ( NULL != value && 0 == strcmp( value, pred->mValue ) );
+				}
+			}
+
+			if( isMatch ) next->append( (void*)node );
+		}
+
+		curr = next;
+		next = ( next == &temp1 ) ? &temp2 : &temp1;
+	}
+
+	for( int i = 0; i < curr->getCount(); i++ ) {
+		result->append( (void*)curr->getItem( i ) );
+	}
+}
+
+void SP_XmlPath :: selectChildren( const SP_XmlPathStep_t * step,
+		const SP_XmlNode * parent, SP_XmlArrayList * result )
+{
+	const SP_XmlNodeList * children = getChildList( parent );
+	if( NULL == children ) return;
+
+	SP_XmlArrayList candidates;
+
+	if( eTestName == step->mTest ) {
+		// use the name index, avoid to scan all the children
+		if( step->mPredCount > 0 && ePredPosition == step->mPreds[0].mType ) {
+			const SP_XmlNode * node = children->findElement( step->mName,
+					step->mPreds[0].mPosition - 1 );
+			if( NULL == node ) return;
+
+			if( 1 == step->mPredCount ) {
+				result->append( (void*)node );
+			} else {
+				// the remaining predicates see a one node list
+				SP_XmlPathStep_t rest = *step;
+				rest.mPreds = step->mPreds + 1;
+				rest.mPredCount = step->mPredCount - 1;
+
+				candidates.append( (void*)node );
+				filter( &rest, &candidates, result );
+			}
+
+			return;
+		}
+
+		for( int i = 0; ; i++ ) {
+			const SP_XmlNode * node = children->findElement( step->mName, i );
+			if( NULL == node ) break;
+			candidates.append( (void*)node );
+		}
+	} else {
+		for( int i = 0; i < children->getLength(); i++ ) {
+			const SP_XmlNode * node = children->get( i );
+			if( matchTest( step, node ) ) candidates.append( (void*)node );
+		}
+	}
+
+	filter( step, &candidates, result );
+}
+
+void SP_XmlPath :: selectDescendants( const SP_XmlPathStep_t * step,
+		const SP_XmlNode * parent, SP_XmlArrayList * result )
+{
+	const SP_XmlNodeList * children = getChildList( parent );
+	if( NULL == children ) return;
+
+	SP_XmlArrayList matched;
+	selectChildren( step, parent, &matched );
+
+	// merge the matched children with the deeper matches in document order
+	int index = 0;
+	for( int i = 0; i < children->getLength(); i++ ) {
+		const SP_XmlNode * node = children->get( i );
+
+		if( index < matched.getCount() && node == matched.getItem( index ) ) {
+			result->append( (void*)node );
+			index++;
+		}
+
+		if( SP_XmlNode::eELEMENT == node->getType() ) {
+			selectDescendants( step, node, result );
+		}
+	}
+}
+
+typedef struct tagSP_XmlPathSeen {
+	const void * mItem;
+	int mIndex;
+} SP_XmlPathSeen_t;
+
+static int cmpPathSeen( const void * a, const void * b )
+{
+	const SP_XmlPathSeen_t * x = (SP_XmlPathSeen_t*)a;
+	const SP_XmlPathSeen_t * y = (SP_XmlPathSeen_t*)b;
+
+	if( x->mItem != y->mItem ) return x->mItem < y->mItem ? -1 : 1;
+
+	return x->mIndex - y->mIndex;
+}
+
+// append the items to result in their order, a repeated one only the first time
+static void appendUnique( const SP_XmlArrayList * items, SP_XmlArrayList * result )
+{
+	int count = items->getCount();
+	if( count <= 0 ) return;
+
+	SP_XmlPathSeen_t * seen = (SP_XmlPathSeen_t*)malloc( sizeof( SP_XmlPathSeen_t ) * count );
+	char * isFirst = (char*)malloc( count );
+
+	for( int i = 0; i < count; i++ ) {
+		seen[i].mItem = items->getItem( i );
+		seen[i].mIndex = i;
+	}
+
+	qsort( seen, count, sizeof( SP_XmlPathSeen_t ), cmpPathSeen );
+
+	for( int i = 0; i < count; i++ ) {
+		isFirst[ seen[i].mIndex ] = 0 == i || seen[i].mItem != seen[ i - 1 ].mItem;
+	}
+
+	for( int i = 0; i < count; i++ ) {
+		if( isFirst[i] ) result->append( (void*)items->getItem( i ) );
+	}
+
+	free( isFirst );
+	free( seen );
+}
+
+void SP_XmlPath :: evalStep( const SP_XmlPathStep_t * step,
+		const SP_XmlArrayList * context, SP_XmlArrayList * result ) const
+{
+	// nested context nodes or siblings with the same parent may produce duplicates
+	int isUnique = context->getCount() > 1
+			&& ( eAxisDescendant == step->mAxis || eTestParent == step->mTest );
+
+	SP_XmlArrayList temp;
+	SP_XmlArrayList * output = isUnique ? &temp : result;
+
+	for( int i = 0; i < context->getCount(); i++ ) {
+		const SP_XmlNode * node = (SP_XmlNode*)context->getItem( i );
+
+		if( eTestSelf == step->mTest ) {
+			SP_XmlArrayList candidates;
+			candidates.append( (void*)node );
+			filter( step, &candidates, output );
+		} else if( eTestParent == step->mTest ) {
+			if( NULL != node->getParent() ) {
+				SP_XmlArrayList candidates;
+				candidates.append( (void*)node->getParent() );
+				filter( step, &candidates, output );
+			}
+		} else if( eAxisChild == step->mAxis ) {
+			selectChildren( step, node, output );
+		} else {
+			selectDescendants( step, node, output );
+		}
+	}
+
+	if( isUnique ) appendUnique( &temp, result );
+}
+
+int SP_XmlPath :: select( const SP_XmlNode * context, SP_XmlArrayList * result ) const
+{
+	if( NULL != mError || NULL == context ) return 0;
+
+	SP_XmlArrayList * curr = new SP_XmlArrayList();
+	SP_XmlArrayList * next = new SP_XmlArrayList();
+
+	int first = 0;
+
+	if( mIsAbsolute ) {
+		for( ; NULL != context->getParent(); ) context = context->getParent();
+
+		if( SP_XmlNode::eXMLDOC != context->getType() && mSteps->getCount() > 0 ) {
+			// a detached tree, the top node is the only child of a virtual document
+			const SP_XmlPathStep_t * step = (SP_XmlPathStep_t*)mSteps->getItem( 0 );
+
+			if( matchTest( step, context ) ) {
+				SP_XmlArrayList candidates;
+				candidates.append( (void*)context );
+				filter( step, &candidates, curr );
+			}
+			if( eAxisDescendant == step->mAxis ) selectDescendants( step, context, curr );
+
+			first = 1;
+		} else {
+			curr->append( (void*)context );
+		}
+	} else {
+		curr->append( (void*)context );
+	}
+
+	for( int i = first; i < mSteps->getCount() && curr->getCount() > 0; i++ ) {
+		evalStep( (SP_XmlPathStep_t*)mSteps->getItem( i ), curr, next );
+
+		SP_XmlArrayList * swap = curr;
+		curr = next;
+		next = swap;
+		next->clean();
+	}
+
+	int ret = curr->getCount();
+	for( int i = 0; i < curr->getCount(); i++ ) {
+		result->append( (void*)curr->getItem( i ) );
+	}
+
+	delete curr;
+	delete next;
+
+	return ret;
+}
+
+const SP_XmlNode * SP_XmlPath :: selectFirst( const SP_XmlNode * context ) const
+{
+	SP_XmlArrayList result;
+	select( context, &result );
+
+	return (SP_XmlNode*)result.getItem( 0 );
+}
+
+//=========================================================
+
+SP_XmlPathHandler :: ~SP_XmlPathHandler()
+{
+}
+
+//=========================================================
+
+typedef struct tagSP_XmlPathFrame {
+	/// per path, bit k is set if the first k steps match the element chain
+	unsigned int * mStates;
+	int mIsMatched;
+	SP_XmlStartTagEvent * mEvent;
+	SP_XmlStringBuffer * mText;
+} SP_XmlPathFrame_t;
+
+SP_XmlPathMatcher :: SP_XmlPathMatcher( SP_XmlPathHandler * handler )
+{
+	mHandler = handler;
+	mParser = new SP_XmlPullParser();
+	mPaths = new SP_XmlArrayList();
+	mFrames = new SP_XmlArrayList();
+	mDepth = 0;
+	mError = NULL;
+}
+
+SP_XmlPathMatcher :: ~SP_XmlPathMatcher()
+{
+	for( int i = 0; i < mFrames->getCount(); i++ ) {
+		SP_XmlPathFrame_t * frame = (SP_XmlPathFrame_t*)mFrames->getItem( i );
+		if( NULL != frame->mEvent ) delete frame->mEvent;
+		delete frame->mText;
+		free( frame->mStates );
+		free( frame );
+	}
+	delete mFrames;
+
+	for( int i = 0; i < mPaths->getCount(); i++ ) {
+		delete (SP_XmlPath*)mPaths->getItem( i );
+	}
+	delete mPaths;
+
+	delete mParser;
+
+	if( NULL != mError ) free( mError );
+}
+
+SP_XmlPullParser * SP_XmlPathMatcher :: getParser()
+{
+	return mParser;
+}
+
+const char * SP_XmlPathMatcher :: getError()
+{
+	return NULL != mError ? mError : mParser->getError();
+}
+
+int SP_XmlPathMatcher :: addPath( const char * expr )
+{
+	if( mFrames->getCount() > 0 ) return -1;
+
+	SP_XmlPath * path = new SP_XmlPath( expr );
+
+	const char * error = path->getError();
+
+	int count = path->getStepCount();
+	if( NULL == error && 0 == count ) error = "empty path";
+	if( NULL == error && count > MAX_STEPS ) error = "too many steps";
+
+	for( int i = 0; i < count && NULL == error; i++ ) {
+		const SP_XmlPathStep_t * step = (SP_XmlPathStep_t*)path->mSteps->getItem( i );
+
+		if( eTestText == step->mTest ) {
+			if( i != count - 1 || 0 == i || step->mPredCount > 0 ) {
+				error = "text() is only streamable as the last step";
+			}
+		} else if( eTestName != step->mTest && eTestAny != step->mTest ) {
+			error = "'.' and '..' are not streamable";
+		}
+
+		for( int j = 0; j < step->mPredCount && NULL == error; j++ ) {
+			if( ePredPosition == step->mPreds[j].mType
+					|| ePredLast == step->mPreds[j].mType ) {
+				error = "positional predicate is not streamable";
+			}
+		}
+	}
+
+	if( NULL != error ) {
+		char msg[ 512 ];
+		snprintf( msg, sizeof( msg ), "%s : %s", expr, error );
+		if( NULL != mError ) free( mError );
+		mError = strdup( msg );
+
+		delete path;
+		return -1;
+	}
+
+	// the text is always delivered, a trailing text() selects the parent
+	const SP_XmlPathStep_t * last = (SP_XmlPathStep_t*)path->mSteps->getItem(
+			SP_XmlArrayList::LAST_INDEX );
+	if( eTestText == last->mTest ) {
+		freeStep( (SP_XmlPathStep_t*)path->mSteps->takeItem( SP_XmlArrayList::LAST_INDEX ) );
+	}
+
+	mPaths->append( path );
+
+	return mPaths->getCount() - 1;
+}
+
+int SP_XmlPathMatcher :: matchStep( const SP_XmlPathStep_t * step,
+		const SP_XmlStartTagEvent * event )
+{
+	if( eTestName == step->mTest && 0 != strcmp( step->mName, event->getName() ) ) {
+		return 0;
+	}
+
+	for( int i = 0; i < step->mPredCount; i++ ) {
+		const SP_XmlPathPred_t * pred = &( step->mPreds[i] );
+		const char * value = event->getAttrValue( pred->mName );
+
+		if( NULL == value ) return 0;
+		if( ePredAttrEquals == pred->mType && 0 != strcmp( value, pred->mValue ) ) return 0;
+	}
+
+	return 1;
+}
+
+void SP_XmlPathMatcher :: startTag( SP_XmlStartTagEvent * event )
+{
+	int count = mPaths->getCount();
+
+	// frames are kept for reuse, the memory is bounded by the max depth
+	if( mDepth + 1 >= mFrames->getCount() ) {
+		for( ; mFrames->getCount() <= mDepth + 1; ) {
+			SP_XmlPathFrame_t * frame = (SP_XmlPathFrame_t*)calloc( 1, sizeof( SP_XmlPathFrame_t ) );
+			frame->mStates = (unsigned int*)calloc( count > 0 ? count : 1, sizeof( unsigned int ) );
+			frame->mText = new SP_XmlStringBuffer();
+
+			// the document level, no step has been matched
+			if( 0 == mFrames->getCount() ) {
+				for( int i = 0; i < count; i++ ) frame->mStates[i] = 1;
+			}
+
+			mFrames->append( frame );
+		}
+	}
+
+	const SP_XmlPathFrame_t * parent = (SP_XmlPathFrame_t*)mFrames->getItem( mDepth );
+	SP_XmlPathFrame_t * frame = (SP_XmlPathFrame_t*)mFrames->getItem( mDepth + 1 );
+
+	frame->mIsMatched = 0;
+
+	for( int i = 0; i < count; i++ ) {
+		const SP_XmlPath * path = (SP_XmlPath*)mPaths->getItem( i );
+		int steps = path->mSteps->getCount();
+
+		unsigned int states = 0;
+		for( int k = 0; k < steps; k++ ) {
+			if( 0 == ( parent->mStates[i] & ( 1U << k ) ) ) continue;
+
+			const SP_XmlPathStep_t * step = (SP_XmlPathStep_t*)path->mSteps->getItem( k );
+
+			// a descendant step may still match deeper elements
+			if( eAxisDescendant == step->mAxis ) states |= 1U << k;
+
+			if( matchStep( step, event ) ) states |= 1U << ( k + 1 );
+		}
+
+		frame->mStates[i] = states;
+		if( states & ( 1U << steps ) ) frame->mIsMatched = 1;
+	}
+
+	mDepth++;
+
+	if( frame->mIsMatched ) {
+		frame->mEvent = event;
+		frame->mText->clean();
+	} else {
+		delete event;
+	}
+}
+
+void SP_XmlPathMatcher :: endTag()
+{
+	if( mDepth <= 0 ) return;
+
+	SP_XmlPathFrame_t * frame = (SP_XmlPathFrame_t*)mFrames->getItem( mDepth );
+
+	if( frame->mIsMatched ) {
+		for( int i = 0; i < mPaths->getCount(); i++ ) {
+			const SP_XmlPath * path = (SP_XmlPath*)mPaths->getItem( i );
+			if( frame->mStates[i] & ( 1U << path->mSteps->getCount() ) ) {
+				mHandler->onMatch( i, frame->mEvent, frame->mText->getBuffer() );
+			}
+		}
+
+		delete frame->mEvent;
+		frame->mEvent = NULL;
+		frame->mIsMatched = 0;
+	}
+
+	mDepth--;
+}
+
+int SP_XmlPathMatcher :: append( const char * source, int len )
+{
+	if( mPaths->getCount() <= 0 ) return 0;
+
+	int ret = mParser->append( source, len );
+
+	for( SP_XmlPullEvent * event = mParser->getNext();
+			NULL != event; event = mParser->getNext() ) {
+		if( SP_XmlPullEvent::eStartTag == event->getEventType() ) {
+			startTag( (SP_XmlStartTagEvent*)event );
+			continue;
+		}
+
+		if( SP_XmlPullEvent::eEndTag == event->getEventType() ) {
+			endTag();
+		} else if( SP_XmlPullEvent::eCData == event->getEventType() ) {
+			SP_XmlPathFrame_t * frame = (SP_XmlPathFrame_t*)mFrames->getItem( mDepth );
+			if( mDepth > 0 && frame->mIsMatched ) {
+				frame->mText->append( ((SP_XmlCDataEvent*)event)->getText() );
+			}
+		}
+
+		delete event;
+	}
+
+	return ret;
+}
+
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmlpath_hpp__
+#define __spxmlpath_hpp__
+
+class SP_XmlNode;
+class SP_XmlNodeList;
+class SP_XmlArrayList;
+class SP_XmlPullParser;
+class SP_XmlStartTagEvent;
+
+typedef struct tagSP_XmlPathStep SP_XmlPathStep_t;
+
+/**
+ *  A compiled XPath subset, compile once and select many times.
+ *
+ *  Supported syntax:
+ *
+ *	@verbatim
+ *	path      : [ '/' | '//' ] step ( ( '/' | '//' ) step )*
+ *	step      : ( name | '*' | 'text()' | '.' | '..' ) predicate*
+ *	predicate : '[' number ']' | '[last()]' | '[@name]' | '[@name=' literal ']'
+ *	@endverbatim
+ *
+ *  Child steps by name use the child name index of SP_XmlNodeList, so
+ *  "/methodCall/params/param[2]" never walks the whole tree. Only '//'
+ *  steps visit the subtree.
+ *
+ *  select is const, one compiled SP_XmlPath can be shared by many threads.
+ */
+
+class SP_XmlPath {
+public:
+	SP_XmlPath( const char * expr );
+	~SP_XmlPath();
+
+	/// @return NOT NULL : the detail error message
+	/// @return NULL : no error
+	const char * getError() const;
+
+	const char * getExpr() const;
+
+	/// append the matched nodes ( const SP_XmlNode * ) to result
+	/// @return how many nodes have been matched
+	int select( const SP_XmlNode * context, SP_XmlArrayList * result ) const;
+
+	/// @return NULL : not found
+	const SP_XmlNode * selectFirst( const SP_XmlNode * context ) const;
+
+	int isAbsolute() const;
+	int getStepCount() const;
+
+private:
+	SP_XmlPath( SP_XmlPath & );
+	SP_XmlPath & operator=( SP_XmlPath & );
+
+	void compile( const char * expr );
+	const char * compileStep( const char * pos, SP_XmlPathStep_t * step );
+	const char * compilePredicate( const char * pos, SP_XmlPathStep_t * step );
+	void setError( const char * error, const char * pos );
+
+	void evalStep( const SP_XmlPathStep_t * step, const SP_XmlArrayList * context,
+			SP_XmlArrayList * result ) const;
+
+	static void filter( const SP_XmlPathStep_t * step,
+			const SP_XmlArrayList * candidates, SP_XmlArrayList * result );
+	static void selectChildren( const SP_XmlPathStep_t * step,
+			const SP_XmlNode * parent, SP_XmlArrayList * result );
+	static void selectDescendants( const SP_XmlPathStep_t * step,
+			const SP_XmlNode * parent, SP_XmlArrayList * result );
+	static int matchTest( const SP_XmlPathStep_t * step, const SP_XmlNode * node );
+
+	char * mExpr;
+	char * mError;
+
+	int mIsAbsolute;
+	SP_XmlArrayList * mSteps;
+
+	friend class SP_XmlPathMatcher;
+};
+
+/// callback of SP_XmlPathMatcher
+class SP_XmlPathHandler {
+public:
+	virtual ~SP_XmlPathHandler();
+
+	/// called when the end-tag of a matched element has been read
+	/// @param id : the return value of SP_XmlPathMatcher::addPath
+	/// @param element : the start-tag of the matched element, with its attributes
+	/// @param text : the text directly inside the matched element
+	virtual void onMatch( int id, const SP_XmlStartTagEvent * element,
+			const char * text ) = 0;
+};
+
+/**
+ *  One pass streaming matcher, runs compiled paths over the pull events
+ *  without building a DOM. Memory is bounded by the depth of the document.
+ *
+ *  Only the streamable subset of SP_XmlPath is accepted : child and descendant
+ *  steps with name tests, '*', attribute predicates, and a trailing text().
+ *  Relative paths are matched from the document.
+ */
+class SP_XmlPathMatcher {
+public:
+	enum { MAX_STEPS = 31 };
+
+	SP_XmlPathMatcher( SP_XmlPathHandler * handler );
+	~SP_XmlPathMatcher();
+
+	/// add paths before the first append
+	/// @return >= 0 : the path id, -1 : the path is invalid or not streamable
+	int addPath( const char * expr );
+
+	/// append more input xml source
+	/// @return how much byte has been consumed
+	int append( const char * source, int len );
+
+	/// @return NOT NULL : the detail error message
+	/// @return NULL : no error
+	const char * getError();
+
+	SP_XmlPullParser * getParser();
+
+private:
+	SP_XmlPathMatcher( SP_XmlPathMatcher & );
+	SP_XmlPathMatcher & operator=( SP_XmlPathMatcher & );
+
+	void startTag( SP_XmlStartTagEvent * event );
+	void endTag();
+	static int matchStep( const SP_XmlPathStep_t * step, const SP_XmlStartTagEvent * event );
+
+	SP_XmlPathHandler * mHandler;
+	SP_XmlPullParser * mParser;
+
+	SP_XmlArrayList * mPaths;
+	SP_XmlArrayList * mFrames;
+	int mDepth;
+
+	char * mError;
+};
+
+#endif
+
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "spxmlpipeline.hpp"
+#include "spxmlparser.hpp"
+#include "spxmlevent.hpp"
+#include "spxmlsource.hpp"
+#include "spdomparser.hpp"
+#include "spxmlnode.hpp"
+
+// checks of the other side's index before sleeping, a sleep costs two
+// context switches, a check a few nanoseconds
+static const int SPIN_COUNT = 256;
+
+//=========================================================
+
+SP_XmlEventRing :: SP_XmlEventRing( int capacity )
+{
+	unsigned int size = 2;
+	for( ; (int)size < capacity && size < ( 1U << 30 ); ) size <<= 1;
+
+	mSlots = (SP_XmlPullEvent**)calloc( size, sizeof( SP_XmlPullEvent * ) );
+	mMask = size - 1;
+	mBatch = size / 4 > 0 ? size / 4 : 1;
+
+	mHead = mTail = 0;
+	mIsClosed = mIsAborted = 0;
+
+	pthread_mutex_init( &mMutex, NULL );
+	pthread_cond_init( &mChanged, NULL );
+	mSleepers = 0;
+
+	mProducerWaits = mConsumerWaits = 0;
+}
+
+SP_XmlEventRing :: ~SP_XmlEventRing()
+{
+	for( unsigned int i = mHead; i != mTail; i++ ) delete mSlots[ i & mMask ];
+	free( mSlots );
+
+	pthread_mutex_destroy( &mMutex );
+	pthread_cond_destroy( &mChanged );
+}
+
+void SP_XmlEventRing :: wait( unsigned int * index, unsigned int stop, int * waits )
+{
+	for( int i = 0; i < SPIN_COUNT; i++ ) {
+		if( stop != __atomic_load_n( index, __ATOMIC_ACQUIRE )
+				|| __atomic_load_n( &mIsClosed, __ATOMIC_ACQUIRE )
+				|| __atomic_load_n( &mIsAborted, __ATOMIC_ACQUIRE ) ) return;
+	}
+
+	pthread_mutex_lock( &mMutex );
+
+	( *waits )++;
+
+	// announce the sleep before the last check, see wake
+	__atomic_add_fetch( &mSleepers, 1, __ATOMIC_SEQ_CST );
+
+	for( ; stop == __atomic_load_n( index, __ATOMIC_SEQ_CST )
+			&& ! __atomic_load_n( &mIsClosed, __ATOMIC_SEQ_CST )
+			&& ! __atomic_load_n( &mIsAborted, __ATOMIC_SEQ_CST ); ) {
+		pthread_cond_wait( &mChanged, &mMutex );
+	}
+
+	__atomic_sub_fetch( &mSleepers, 1, __ATOMIC_SEQ_CST );
+
+	pthread_mutex_unlock( &mMutex );
+}
+
+void SP_XmlEventRing :: wake( int isEnough )
+{
+	// the index is stored before the check, so either the sleeper sees
+	// the new index, or this sees the sleeper
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+
+	if( isEnough && __atomic_load_n( &mSleepers, __ATOMIC_SEQ_CST ) > 0 ) {
+		pthread_mutex_lock( &mMutex );
+		pthread_cond_broadcast( &mChanged );
+		pthread_mutex_unlock( &mMutex );
+	}
+}
+
+int SP_XmlEventRing :: push( SP_XmlPullEvent * event )
+{
+	unsigned int tail = mTail;
+
+	// full when the consumer is a whole ring behind
+	if( tail - __atomic_load_n( &mHead, __ATOMIC_ACQUIRE ) > mMask ) {
+		wait( &mHead, tail - mMask - 1, &mProducerWaits );
+	}
+
+	if( __atomic_load_n( &mIsAborted, __ATOMIC_ACQUIRE ) ) return -1;
+
+	mSlots[ tail & mMask ] = event;
+	__atomic_store_n( &mTail, tail + 1, __ATOMIC_RELEASE );
+
+	// the only sleeper here is a consumer on an empty ring, it is woken
+	// for this event at once, the producer may block on its source next
+	wake( 1 );
+
+	return 0;
+}
+
+void SP_XmlEventRing :: close()
+{
+	__atomic_store_n( &mIsClosed, 1, __ATOMIC_RELEASE );
+
+	wake( 1 );
+}
+
+SP_XmlPullEvent * SP_XmlEventRing :: pop()
+{
+	unsigned int head = mHead;
+
+	if( head == __atomic_load_n( &mTail, __ATOMIC_ACQUIRE ) ) {
+		wait( &mTail, head, &mConsumerWaits );
+
+		// closed, the events pushed before close are seen here
+		if( head == __atomic_load_n( &mTail, __ATOMIC_ACQUIRE ) ) return NULL;
+	}
+
+	if( __atomic_load_n( &mIsAborted, __ATOMIC_ACQUIRE ) ) return NULL;
+
+	SP_XmlPullEvent * event = mSlots[ head & mMask ];
+	__atomic_store_n( &mHead, head + 1, __ATOMIC_RELEASE );
+
+	// a producer on a full ring is woken for a batch of free slots, not
+	// for each one, a wake is a context switch on a busy machine
+	wake( mMask + 1 - ( __atomic_load_n( &mTail, __ATOMIC_ACQUIRE ) - head - 1 ) >= mBatch );
+
+	return event;
+}
+
+void SP_XmlEventRing :: abort()
+{
+	__atomic_store_n( &mIsAborted, 1, __ATOMIC_RELEASE );
+
+	wake( 1 );
+}
+
+void SP_XmlEventRing :: getStats( int * producerWaits, int * consumerWaits )
+{
+	pthread_mutex_lock( &mMutex );
+
+	if( NULL != producerWaits ) *producerWaits = mProducerWaits;
+	if( NULL != consumerWaits ) *consumerWaits = mConsumerWaits;
+
+	pthread_mutex_unlock( &mMutex );
+}
+
+//=========================================================
+
+SP_XmlPipelineParser :: SP_XmlPipelineParser( int ringCapacity )
+{
+	mRingCapacity = ringCapacity;
+
+	mCallback = NULL;
+	mCallbackArg = NULL;
+
+	mParser = new SP_XmlPullParser();
+	mBuilder = new SP_XmlDomParser();
+	mRing = NULL;
+
+	mTokenizerWaits = mConsumerWaits = 0;
+
+	mError = NULL;
+}
+
+SP_XmlPipelineParser :: ~SP_XmlPipelineParser()
+{
+	delete mParser;
+	delete mBuilder;
+
+	if( NULL != mError ) free( mError );
+}
+
+void SP_XmlPipelineParser :: setIgnoreWhitespace( int ignoreWhitespace )
+{
+	mParser->setIgnoreWhitespace( ignoreWhitespace );
+}
+
+void SP_XmlPipelineParser :: setEventCallback( EventCallback_t callback, void * arg )
+{
+	mCallback = callback;
+	mCallbackArg = arg;
+}
+
+int SP_XmlPipelineParser :: parse( SP_XmlInputSource * source )
+{
+	mParser->reset();
+	mParser->setSource( source );
+
+	return run();
+}
+
+int SP_XmlPipelineParser :: parse( const char * source, int len )
+{
+	SP_XmlMemorySource memory( source, len );
+
+	return parse( &memory );
+}
+
+int SP_XmlPipelineParser :: parseFile( const char * path )
+{
+	mParser->reset();
+	if( 0 != mParser->parseFile( path ) ) return -1;
+
+	return run();
+}
+
+void * SP_XmlPipelineParser :: tokenizerMain( void * arg )
+{
+	((SP_XmlPipelineParser*)arg)->runTokenizer();
+
+	return NULL;
+}
+
+void SP_XmlPipelineParser :: runTokenizer()
+{
+	for( SP_XmlPullEvent * event = mParser->getNext(); NULL != event; event = mParser->getNext() ) {
+		if( 0 != mRing->push( event ) ) {
+			delete event;
+			break;
+		}
+	}
+
+	mRing->close();
+}
+
+int SP_XmlPipelineParser :: run()
+{
+	mBuilder->reset();
+
+	if( NULL != mError ) free( mError );
+	mError = NULL;
+
+	mRing = new SP_XmlEventRing( mRingCapacity );
+
+	pthread_t thread;
+	if( 0 != pthread_create( &thread, NULL, tokenizerMain, this ) ) {
+		mError = strdup( "cannot start the tokenizer thread" );
+	} else {
+		for( SP_XmlPullEvent * event = mRing->pop(); NULL != event; event = mRing->pop() ) {
+			if( NULL == mCallback ) {
+				mBuilder->addEvent( event );
+			} else if( 0 != mCallback( mCallbackArg, event ) ) {
+				mError = strdup( "stopped by the event callback" );
+				mRing->abort();
+				break;
+			}
+		}
+
+		pthread_join( thread, NULL );
+	}
+
+	mRing->getStats( &mTokenizerWaits, &mConsumerWaits );
+	delete mRing;
+	mRing = NULL;
+
+	mParser->setSource( NULL );
+
+	return NULL == getError() ? 0 : -1;
+}
+
+const char * SP_XmlPipelineParser :: getError()
+{
+	return NULL != mError ? mError : mParser->getError();
+}
+
+const SP_XmlDocument * SP_XmlPipelineParser :: getDocument() const
+{
+	return mBuilder->getDocument();
+}
+
+SP_XmlDocument * SP_XmlPipelineParser :: takeDocument()
+{
+	return mBuilder->takeDocument();
+}
+
+const char * SP_XmlPipelineParser :: getEncoding()
+{
+	return mParser->getEncoding();
+}
+
+void SP_XmlPipelineParser :: getStats( int * tokenizerWaits, int * consumerWaits )
+{
+	if( NULL != tokenizerWaits ) *tokenizerWaits = mTokenizerWaits;
+	if( NULL != consumerWaits ) *consumerWaits = mConsumerWaits;
+}
+
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmlpipeline_hpp__
+#define __spxmlpipeline_hpp__
+
+#include <pthread.h>
+
+class SP_XmlPullEvent;
+class SP_XmlPullParser;
+class SP_XmlDomParser;
+class SP_XmlDocument;
+class SP_XmlInputSource;
+
+/**
+ *  A bounded ring of events between exactly one producer thread and one
+ *  consumer thread. push and pop touch no lock while the ring is neither
+ *  full nor empty, each side only writes its own index. A side which finds
+ *  the ring full, or empty, spins a little, then sleeps. A consumer on an
+ *  empty ring is woken by the next event, a producer on a full ring when
+ *  the consumer has freed a quarter of it, so a fast producer is held
+ *  back by a slow consumer, and sleeps are rare.
+ */
+class SP_XmlEventRing {
+public:
+	enum { DEFAULT_CAPACITY = 4096 };
+
+	/// capacity is rounded up to a power of 2
+	SP_XmlEventRing( int capacity = DEFAULT_CAPACITY );
+
+	/// the events left in the ring are deleted
+	~SP_XmlEventRing();
+
+	/// producer, the ring takes over event, wait while the ring is full
+	/// @return 0 : OK, -1 : aborted by the consumer, event is not taken
+	int push( SP_XmlPullEvent * event );
+
+	/// producer, no more events
+	void close();
+
+	/// consumer, wait while the ring is empty
+	/// @return NOT NULL : the next event, NULL : closed and drained, or aborted
+	SP_XmlPullEvent * pop();
+
+	/// consumer, stop taking events, a waiting producer returns
+	void abort();
+
+	/// how many times each side had to sleep
+	void getStats( int * producerWaits, int * consumerWaits );
+
+private:
+	SP_XmlEventRing( SP_XmlEventRing & );
+	SP_XmlEventRing & operator=( SP_XmlEventRing & );
+
+	/// wait until the index of the other side is not stop, or the ring is closed
+	void wait( unsigned int * index, unsigned int stop, int * waits );
+
+	/// wake the other side if it sleeps, and isEnough, the ready events,
+	/// or free slots, are worth a wake
+	void wake( int isEnough );
+
+	SP_XmlPullEvent ** mSlots;
+	unsigned int mMask;
+	unsigned int mBatch;
+
+	// each on its own cache line, written by one side only
+	char mPad0[ 64 ];
+	unsigned int mHead;
+	char mPad1[ 64 ];
+	unsigned int mTail;
+	char mPad2[ 64 ];
+
+	int mIsClosed;
+	int mIsAborted;
+
+	pthread_mutex_t mMutex;
+	pthread_cond_t mChanged;
+	int mSleepers;
+
+	int mProducerWaits;
+	int mConsumerWaits;
+};
+
+/**
+ *  Parse one big stream on two threads, a tokenizer thread runs the pull
+ *  parser and pushes the events to a SP_XmlEventRing, the calling thread
+ *  builds the document, or runs the event callback, from the ring. The
+ *  two stages overlap, the ring bounds the events between them.
+ *
+ *  The document is the same as the one of SP_XmlDomParser.
+ */
+class SP_XmlPipelineParser {
+public:
+	/// @return 0 : OK, -1 : stop parsing
+	typedef int ( * EventCallback_t )( void * arg, SP_XmlPullEvent * event );
+
+	SP_XmlPipelineParser( int ringCapacity = SP_XmlEventRing::DEFAULT_CAPACITY );
+	~SP_XmlPipelineParser();
+
+	/// default ignoreWhitespace is true
+	void setIgnoreWhitespace( int ignoreWhitespace );
+
+	/// hand the events over to callback on the calling thread, which takes
+	/// over them, instead of building a document
+	void setEventCallback( EventCallback_t callback, void * arg );
+
+	/// parse the whole source, which is read by the tokenizer thread
+	/// @return 0 : OK, -1 : error or stopped by the callback, see getError
+	int parse( SP_XmlInputSource * source );
+
+	/// parse a whole document in memory
+	/// @return 0 : OK, -1 : error, see getError
+	int parse( const char * source, int len );
+
+	/// parse a whole file, see SP_XmlPullParser::parseFile
+	/// @return 0 : OK, -1 : error, see getError
+	int parseFile( const char * path );
+
+	/// @return NOT NULL : the detail error message
+	/// @return NULL : no error
+	const char * getError();
+
+	/// the parse result, empty with an event callback
+	const SP_XmlDocument * getDocument() const;
+
+	/// take over the parse result, the caller should delete it
+	SP_XmlDocument * takeDocument();
+
+	const char * getEncoding();
+
+	/// how many times the tokenizer waited for the consumer, and the reverse
+	void getStats( int * tokenizerWaits, int * consumerWaits );
+
+private:
+	SP_XmlPipelineParser( SP_XmlPipelineParser & );
+	SP_XmlPipelineParser & operator=( SP_XmlPipelineParser & );
+
+	/// run the stages, the pull parser has its input already
+	int run();
+
+	static void * tokenizerMain( void * arg );
+
+	void runTokenizer();
+
+	int mRingCapacity;
+
+	EventCallback_t mCallback;
+	void * mCallbackArg;
+
+	SP_XmlPullParser * mParser;
+	SP_XmlDomParser * mBuilder;
+	SP_XmlEventRing * mRing;
+
+	int mTokenizerWaits;
+	int mConsumerWaits;
+
+	char * mError;
+};
+
+#endif
+
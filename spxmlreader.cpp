@@ -43,6 +43,11 @@ void SP_XmlReader :: setError( SP_XmlPullParser * parser, const char * error )
 	parser->setError( error );
 }
 
+void SP_XmlReader :: markToken( SP_XmlPullParser * parser )
+{
+	parser->markToken();
+}
+
 void SP_XmlReader :: reset()
 {
 	mBuffer->clean();
@@ -459,6 +464,7 @@ void SP_XmlLeftBracketReader :: read( SP_XmlPullParser * parser, char c )
 			//skip
 		} else if( '<' == c ) {
 			mHasReadBracket = 1;
+			markToken( parser );
 		}
 	} else {
 		if( '?' == c ) {
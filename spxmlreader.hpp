@@ -50,6 +50,9 @@ protected:
 	/// help to call parser->setError
 	static void setError( SP_XmlPullParser * parser, const char * error );
 
+	/// help to call parser->markToken
+	static void markToken( SP_XmlPullParser * parser );
+
 private:
 	SP_XmlReader( SP_XmlReader & );
 	SP_XmlReader & operator=( SP_XmlReader & );
@@ -139,7 +139,10 @@ int SP_XmlRpcRespObject :: getErrorCode() const
 		}
 	}
 
-	return NULL != node ? atoi( node->getText() ) : 0;
+	SP_XmlInt64_t code = 0;
+	if( NULL != node ) node->getTextInt64( &code );
+
+	return (int)code;
 }
 
 const char * SP_XmlRpcRespObject :: getErrorMsg() const
@@ -0,0 +1,877 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "spxmlrpcserver.hpp"
+#include "spxmlrpcvalue.hpp"
+#include "spxmlrpc.hpp"
+#include "spxmlsink.hpp"
+#include "spxmlutils.hpp"
+#include "spxmlnumber.hpp"
+
+struct tagSP_XmlRpcMethod {
+	SP_XmlRpcServer::Method_t mMethod;
+	void * mArg;
+};
+
+// one sub-call of system.multicall
+struct tagSP_XmlRpcTask {
+	SP_XmlRpcServer * mServer;
+
+	const char * mName;
+	int mCount;
+	const SP_XmlRpcValue ** mParams;
+
+	// the bare value, or the fault string
+	SP_XmlStringBuffer * mOut;
+	int mFaultCode;
+
+	// the sub-calls of the same multicall which are not finished
+	int * mPending;
+	SP_XmlRpcTask_t * mNext;
+};
+
+struct tagSP_XmlRpcPool {
+	pthread_mutex_t mMutex;
+	pthread_cond_t mWork;
+	pthread_cond_t mDone;
+
+	SP_XmlRpcTask_t * mHead;
+	SP_XmlRpcTask_t * mTail;
+
+	pthread_t * mThreads;
+	int mCount;
+	int mIsStop;
+};
+
+// the pending request of one connection, the input is parsed in place
+struct tagSP_XmlRpcConn {
+	int mFd;
+	time_t mLastActive;
+
+	char * mInput;
+	int mInputLen, mInputMax;
+
+	// < 0 : reading the header
+	int mBodyLeft;
+	int mKeepAlive;
+	int mIsHttp10;
+	int mIsClosing;
+
+	// the epoll events waited for
+	int mEvents;
+
+	SP_XmlRpcDecoder * mDecoder;
+	SP_XmlStringBuffer * mBody;
+
+	SP_XmlStringBuffer * mOutput;
+	int mOutputPos;
+
+	SP_XmlRpcConn_t * mPrev;
+	SP_XmlRpcConn_t * mNext;
+};
+
+enum { MAX_HEADER_SIZE = 8192, READ_SIZE = 16384, SMALL_PARAMS = 16 };
+
+// no more request is read or answered while so much output is not sent
+enum { OUTPUT_HIGH_WATER = 1024 * 1024 };
+
+static int isOutputFull( const SP_XmlRpcConn_t * conn )
+{
+	return conn->mOutput->getSize() - conn->mOutputPos >= OUTPUT_HIGH_WATER;
+}
+
+const char * SP_XmlRpcServer :: MULTICALL = "system.multicall";
+
+//=========================================================
+
+SP_XmlRpcServer :: SP_XmlRpcServer( int workers )
+{
+	mMethods = new SP_XmlHashMap();
+
+	mPool = (SP_XmlRpcPool_t*)calloc( 1, sizeof( SP_XmlRpcPool_t ) );
+	pthread_mutex_init( &( mPool->mMutex ), NULL );
+	pthread_cond_init( &( mPool->mWork ), NULL );
+	pthread_cond_init( &( mPool->mDone ), NULL );
+
+	if( workers > 0 ) {
+		mPool->mThreads = (pthread_t*)malloc( workers * sizeof( pthread_t ) );
+		for( int i = 0; i < workers; i++ ) {
+			if( 0 != pthread_create( mPool->mThreads + mPool->mCount, NULL, worker, mPool ) ) break;
+			mPool->mCount++;
+		}
+	}
+
+	mListenFd = mEpollFd = -1;
+	mWakeFd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+	mPort = 0;
+	mUnixPath = NULL;
+
+	mConns = NULL;
+	mIdleTimeout = 60;
+	mMaxBodySize = 16 * 1024 * 1024;
+	mIsShutdown = 0;
+
+	mError = NULL;
+}
+
+SP_XmlRpcServer :: ~SP_XmlRpcServer()
+{
+	pthread_mutex_lock( &( mPool->mMutex ) );
+	mPool->mIsStop = 1;
+	pthread_cond_broadcast( &( mPool->mWork ) );
+	pthread_mutex_unlock( &( mPool->mMutex ) );
+
+	for( int i = 0; i < mPool->mCount; i++ ) pthread_join( mPool->mThreads[ i ], NULL );
+
+	pthread_mutex_destroy( &( mPool->mMutex ) );
+	pthread_cond_destroy( &( mPool->mWork ) );
+	pthread_cond_destroy( &( mPool->mDone ) );
+	if( NULL != mPool->mThreads ) free( mPool->mThreads );
+	free( mPool );
+
+	for( ; NULL != mConns; ) closeConn( mConns );
+
+	if( mListenFd >= 0 ) close( mListenFd );
+	if( mEpollFd >= 0 ) close( mEpollFd );
+	if( mWakeFd >= 0 ) close( mWakeFd );
+
+	if( NULL != mUnixPath ) {
+		unlink( mUnixPath );
+		free( mUnixPath );
+	}
+
+	for( int i = 0; i < mMethods->getCount(); i++ ) {
+		void * method = NULL;
+		mMethods->getItem( i, &method );
+		free( method );
+	}
+	delete mMethods;
+
+	if( NULL != mError ) free( mError );
+}
+
+void SP_XmlRpcServer :: setError( const char * what )
+{
+	char error[ 256 ] = { 0 };
+	snprintf( error, sizeof( error ), "%s: %s", what, strerror( errno ) );
+
+	if( NULL != mError ) free( mError );
+	mError = strdup( error );
+}
+
+const char * SP_XmlRpcServer :: getError() const
+{
+	return mError;
+}
+
+int SP_XmlRpcServer :: addMethod( const char * name, Method_t method, void * arg )
+{
+	if( NULL == name || NULL == method || 0 == strcmp( name, MULTICALL ) ) return -1;
+	if( NULL != mMethods->get( name ) ) return -1;
+
+	SP_XmlRpcMethod_t * entry = (SP_XmlRpcMethod_t*)malloc( sizeof( SP_XmlRpcMethod_t ) );
+	entry->mMethod = method;
+	entry->mArg = arg;
+
+	mMethods->put( name, entry );
+
+	return 0;
+}
+
+int SP_XmlRpcServer :: getMethodCount() const
+{
+	return mMethods->getCount();
+}
+
+void SP_XmlRpcServer :: setIdleTimeout( int seconds )
+{
+	mIdleTimeout = seconds;
+}
+
+void SP_XmlRpcServer :: setMaxBodySize( int size )
+{
+	mMaxBodySize = size;
+}
+
+//=========================================================
+
+int SP_XmlRpcServer :: call( const char * name, int count, const SP_XmlRpcValue ** params,
+		SP_XmlStringBuffer * out )
+{
+	const SP_XmlRpcMethod_t * method = (SP_XmlRpcMethod_t*)mMethods->get( name );
+
+	if( NULL == method ) {
+		out->append( "method not found: " );
+		out->append( name );
+		return SP_XmlRpcUtils::eMethodNoFound;
+	}
+
+	SP_XmlStringBuffer fault;
+	int code = 0;
+
+	{
+		SP_XmlRpcEncoder result( out );
+		code = method->mMethod( method->mArg, count, params, &result, &fault );
+		if( 0 == code ) {
+			result.end();
+			const char * error = result.getError();
+			if( NULL == error && 0 == out->getSize() ) error = "method returned no value";
+			if( NULL != error ) {
+				code = SP_XmlRpcUtils::eInternalError;
+				fault.append( error );
+			}
+		}
+	}
+
+	if( 0 == code ) return 0;
+
+	// the fault string replaces the value written so far
+	if( out->getSize() > 0 ) out->clean();
+	out->append( fault.getBuffer(), fault.getSize() );
+
+	return code;
+}
+
+int SP_XmlRpcServer :: dispatch( const SP_XmlRpcDecoder * call, SP_XmlOutputSink * sink )
+{
+	if( NULL != call->getError() || ! call->isDone() ) {
+		return SP_XmlRpcEncoder::writeFault( sink, SP_XmlRpcUtils::eParseError,
+				NULL != call->getError() ? call->getError() : "incomplete message" );
+	}
+
+	const char * name = call->getMethod();
+	int count = call->getParamCount();
+
+	if( '\0' == *name ) {
+		return SP_XmlRpcEncoder::writeFault( sink, SP_XmlRpcUtils::eInvalidRequest, "not a methodCall" );
+	}
+
+	if( 0 == strcmp( name, MULTICALL ) ) {
+		if( 1 != count || SP_XmlRpcValue::eArray != call->getParam( 0 )->getType() ) {
+			return SP_XmlRpcEncoder::writeFault( sink, SP_XmlRpcUtils::eInvalidParams,
+					"system.multicall takes an array" );
+		}
+		return multicall( call->getParam( 0 ), sink );
+	}
+
+	const SP_XmlRpcValue * small[ SMALL_PARAMS ];
+	const SP_XmlRpcValue ** params = count <= SMALL_PARAMS ? small
+			: (const SP_XmlRpcValue**)malloc( count * sizeof( void * ) );
+	for( int i = 0; i < count; i++ ) params[ i ] = call->getParam( i );
+
+	SP_XmlStringBuffer out;
+	int code = this->call( name, count, params, &out );
+
+	if( params != small ) free( params );
+
+	if( 0 != code ) return SP_XmlRpcEncoder::writeFault( sink, code, out.getBuffer() );
+
+	SP_XmlRpcEncoder encoder( sink );
+	encoder.startResponse();
+	encoder.addEncoded( out.getBuffer(), out.getSize() );
+
+	return encoder.end();
+}
+
+void SP_XmlRpcServer :: runTask( SP_XmlRpcTask_t * task )
+{
+	if( 0 == strcmp( task->mName, MULTICALL ) ) {
+		task->mOut->append( "recursive system.multicall forbidden" );
+		task->mFaultCode = SP_XmlRpcUtils::eInvalidRequest;
+	} else {
+		task->mFaultCode = task->mServer->call( task->mName,
+				task->mCount, task->mParams, task->mOut );
+	}
+}
+
+void * SP_XmlRpcServer :: worker( void * arg )
+{
+	SP_XmlRpcPool_t * pool = (SP_XmlRpcPool_t*)arg;
+
+	pthread_mutex_lock( &( pool->mMutex ) );
+
+	for( ; ; ) {
+		for( ; NULL == pool->mHead && ! pool->mIsStop; ) {
+			pthread_cond_wait( &( pool->mWork ), &( pool->mMutex ) );
+		}
+		if( NULL == pool->mHead ) break;
+
+		SP_XmlRpcTask_t * task = pool->mHead;
+		pool->mHead = task->mNext;
+		if( NULL == pool->mHead ) pool->mTail = NULL;
+
+		pthread_mutex_unlock( &( pool->mMutex ) );
+		runTask( task );
+		pthread_mutex_lock( &( pool->mMutex ) );
+
+		if( 0 == --*( task->mPending ) ) pthread_cond_broadcast( &( pool->mDone ) );
+	}
+
+	pthread_mutex_unlock( &( pool->mMutex ) );
+
+	return NULL;
+}
+
+int SP_XmlRpcServer :: multicall( const SP_XmlRpcValue * calls, SP_XmlOutputSink * sink )
+{
+	int count = calls->getCount();
+	int pending = 0;
+
+	SP_XmlRpcTask_t * tasks = (SP_XmlRpcTask_t*)calloc( count > 0 ? count : 1,
+			sizeof( SP_XmlRpcTask_t ) );
+
+	for( int i = 0; i < count; i++ ) {
+		SP_XmlRpcTask_t * task = tasks + i;
+		task->mServer = this;
+		task->mOut = new SP_XmlStringBuffer();
+		task->mPending = &pending;
+
+		const SP_XmlRpcValue * item = calls->getItem( i );
+		const SP_XmlRpcValue * name = item->getMember( "methodName" );
+		const SP_XmlRpcValue * params = item->getMember( "params" );
+
+		if( NULL == name || SP_XmlRpcValue::eString != name->getType()
+				|| ( NULL != params && SP_XmlRpcValue::eArray != params->getType() ) ) {
+			task->mOut->append( "need a struct of methodName and params" );
+			task->mFaultCode = SP_XmlRpcUtils::eInvalidParams;
+			continue;
+		}
+
+		task->mName = name->getString();
+		task->mCount = NULL != params ? params->getCount() : 0;
+		task->mParams = (const SP_XmlRpcValue**)malloc( ( task->mCount + 1 ) * sizeof( void * ) );
+		for( int j = 0; j < task->mCount; j++ ) task->mParams[ j ] = params->getItem( j );
+
+		pending++;
+	}
+
+	if( pending > 0 ) {
+		pthread_mutex_lock( &( mPool->mMutex ) );
+
+		for( int i = 0; i < count; i++ ) {
+			if( NULL == tasks[ i ].mName ) continue;
+			if( NULL == mPool->mTail ) {
+				mPool->mHead = mPool->mTail = tasks + i;
+			} else {
+				mPool->mTail->mNext = tasks + i;
+				mPool->mTail = tasks + i;
+			}
+		}
+		pthread_cond_broadcast( &( mPool->mWork ) );
+
+		// run the queued tasks here too, so no thread waits idle for the pool
+		for( ; pending > 0; ) {
+			if( NULL != mPool->mHead ) {
+				SP_XmlRpcTask_t * task = mPool->mHead;
+				mPool->mHead = task->mNext;
+				if( NULL == mPool->mHead ) mPool->mTail = NULL;
+
+				pthread_mutex_unlock( &( mPool->mMutex ) );
+				runTask( task );
+				pthread_mutex_lock( &( mPool->mMutex ) );
+
+				if( 0 == --*( task->mPending ) ) pthread_cond_broadcast( &( mPool->mDone ) );
+			} else {
+				pthread_cond_wait( &( mPool->mDone ), &( mPool->mMutex ) );
+			}
+		}
+
+		pthread_mutex_unlock( &( mPool->mMutex ) );
+	}
+
+	// a result is an array of one value, a fault is the fault struct
+	SP_XmlRpcEncoder encoder( sink );
+	encoder.startResponse();
+	encoder.startArray();
+	for( int i = 0; i < count; i++ ) {
+		SP_XmlRpcTask_t * task = tasks + i;
+		if( 0 != task->mFaultCode ) {
+			encoder.addFault( task->mFaultCode, task->mOut->getBuffer() );
+		} else {
+			encoder.startArray();
+			encoder.addEncoded( task->mOut->getBuffer(), task->mOut->getSize() );
+			encoder.endArray();
+		}
+
+		delete task->mOut;
+		if( NULL != task->mParams ) free( task->mParams );
+	}
+	encoder.endArray();
+
+	free( tasks );
+
+	return encoder.end();
+}
+
+//=========================================================
+
+static int setNonblock( int fd )
+{
+	int flags = fcntl( fd, F_GETFL );
+	return flags < 0 ? -1 : fcntl( fd, F_SETFL, flags | O_NONBLOCK );
+}
+
+int SP_XmlRpcServer :: listen( const char * address )
+{
+	if( mListenFd >= 0 ) {
+		errno = EISCONN;
+		setError( "listen" );
+		return -1;
+	}
+
+	int fd = -1;
+
+	if( 0 == strncmp( address, "unix:", 5 ) ) {
+		const char * path = address + 5;
+
+		struct sockaddr_un addr;
+		memset( &addr, 0, sizeof( addr ) );
+		addr.sun_family = AF_UNIX;
+		if( strlen( path ) >= sizeof( addr.sun_path ) ) {
+			errno = ENAMETOOLONG;
+			setError( path );
+			return -1;
+		}
+		strcpy( addr.sun_path, path );
+
+		// a socket left by a previous run
+		struct stat st;
+		if( 0 == stat( path, &st ) && S_ISSOCK( st.st_mode ) ) unlink( path );
+
+		fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+		if( fd < 0 || 0 != bind( fd, (struct sockaddr*)&addr, sizeof( addr ) ) ) {
+			setError( path );
+			if( fd >= 0 ) close( fd );
+			return -1;
+		}
+
+		mUnixPath = strdup( path );
+	} else {
+		char host[ 256 ] = { 0 };
+		const char * colon = strrchr( address, ':' );
+		if( NULL == colon || colon - address >= (int)sizeof( host ) ) {
+			errno = EINVAL;
+			setError( address );
+			return -1;
+		}
+		memcpy( host, address, colon - address );
+
+		struct addrinfo hints, * result = NULL;
+		memset( &hints, 0, sizeof( hints ) );
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+
+		if( 0 != getaddrinfo( '\0' == *host ? NULL : host, colon + 1, &hints, &result ) ) {
+			errno = EADDRNOTAVAIL;
+			setError( address );
+			return -1;
+		}
+
+		fd = socket( result->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+
+		int on = 1;
+		if( fd >= 0 ) setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof( on ) );
+
+		if( fd < 0 || 0 != bind( fd, result->ai_addr, result->ai_addrlen ) ) {
+			setError( address );
+			if( fd >= 0 ) close( fd );
+			freeaddrinfo( result );
+			return -1;
+		}
+		freeaddrinfo( result );
+
+		struct sockaddr_storage bound;
+		socklen_t len = sizeof( bound );
+		if( 0 == getsockname( fd, (struct sockaddr*)&bound, &len ) ) {
+			if( AF_INET == bound.ss_family ) {
+				mPort = ntohs( ( (struct sockaddr_in*)&bound )->sin_port );
+			} else if( AF_INET6 == bound.ss_family ) {
+				mPort = ntohs( ( (struct sockaddr_in6*)&bound )->sin6_port );
+			}
+		}
+	}
+
+	if( 0 != ::listen( fd, 128 ) || 0 != setNonblock( fd ) ) {
+		setError( "listen" );
+		close( fd );
+		return -1;
+	}
+
+	mListenFd = fd;
+
+	return 0;
+}
+
+int SP_XmlRpcServer :: getPort() const
+{
+	return mPort;
+}
+
+void SP_XmlRpcServer :: shutdown()
+{
+	__sync_lock_test_and_set( &mIsShutdown, 1 );
+
+	unsigned long long one = 1;
+	if( mWakeFd >= 0 && write( mWakeFd, &one, sizeof( one ) ) < 0 ) {
+		// the counter is full, a wakeup is pending anyway
+	}
+}
+
+int SP_XmlRpcServer :: run()
+{
+	if( mListenFd < 0 || mWakeFd < 0 ) {
+		errno = ENOTCONN;
+		setError( "run" );
+		return -1;
+	}
+
+	if( mEpollFd < 0 ) mEpollFd = epoll_create1( EPOLL_CLOEXEC );
+	if( mEpollFd < 0 ) {
+		setError( "epoll_create1" );
+		return -1;
+	}
+
+	struct epoll_event event;
+	memset( &event, 0, sizeof( event ) );
+
+	event.events = EPOLLIN;
+	event.data.ptr = &mListenFd;
+	epoll_ctl( mEpollFd, EPOLL_CTL_ADD, mListenFd, &event );
+
+	event.data.ptr = &mWakeFd;
+	epoll_ctl( mEpollFd, EPOLL_CTL_ADD, mWakeFd, &event );
+
+	struct epoll_event events[ 64 ];
+	time_t lastCheck = time( NULL );
+
+	for( ; 0 == __sync_fetch_and_add( &mIsShutdown, 0 ); ) {
+		int count = epoll_wait( mEpollFd, events, 64, 1000 );
+		if( count < 0 && EINTR != errno ) {
+			setError( "epoll_wait" );
+			break;
+		}
+
+		for( int i = 0; i < count; i++ ) {
+			void * ptr = events[ i ].data.ptr;
+
+			if( ptr == &mListenFd ) {
+				onAccept();
+			} else if( ptr == &mWakeFd ) {
+				unsigned long long value = 0;
+				if( read( mWakeFd, &value, sizeof( value ) ) < 0 ) value = 0;
+			} else {
+				SP_XmlRpcConn_t * conn = (SP_XmlRpcConn_t*)ptr;
+
+				int ret = 0;
+				if( events[ i ].events & ( EPOLLERR | EPOLLHUP ) ) ret = -1;
+				if( 0 == ret && ( events[ i ].events & EPOLLOUT ) ) ret = onWrite( conn );
+				if( 0 == ret && ( events[ i ].events & EPOLLIN ) ) ret = onRead( conn );
+				if( 0 != ret ) closeConn( conn );
+			}
+		}
+
+		time_t now = time( NULL );
+		if( now != lastCheck ) {
+			lastCheck = now;
+			closeIdle();
+		}
+	}
+
+	for( ; NULL != mConns; ) closeConn( mConns );
+
+	epoll_ctl( mEpollFd, EPOLL_CTL_DEL, mListenFd, NULL );
+	epoll_ctl( mEpollFd, EPOLL_CTL_DEL, mWakeFd, NULL );
+
+	return 0 != __sync_fetch_and_add( &mIsShutdown, 0 ) ? 0 : -1;
+}
+
+void SP_XmlRpcServer :: onAccept()
+{
+	for( ; ; ) {
+		int fd = accept4( mListenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC );
+		if( fd < 0 ) break;
+
+		if( NULL == mUnixPath ) {
+			int on = 1;
+			setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( on ) );
+		}
+
+		SP_XmlRpcConn_t * conn = (SP_XmlRpcConn_t*)calloc( 1, sizeof( SP_XmlRpcConn_t ) );
+		conn->mFd = fd;
+		conn->mLastActive = time( NULL );
+		conn->mBodyLeft = -1;
+		conn->mDecoder = new SP_XmlRpcDecoder();
+		conn->mBody = new SP_XmlStringBuffer();
+		conn->mOutput = new SP_XmlStringBuffer();
+		conn->mEvents = EPOLLIN;
+
+		conn->mNext = mConns;
+		if( NULL != mConns ) mConns->mPrev = conn;
+		mConns = conn;
+
+		struct epoll_event event;
+		memset( &event, 0, sizeof( event ) );
+		event.events = EPOLLIN;
+		event.data.ptr = conn;
+		epoll_ctl( mEpollFd, EPOLL_CTL_ADD, fd, &event );
+	}
+}
+
+void SP_XmlRpcServer :: closeConn( SP_XmlRpcConn_t * conn )
+{
+	if( NULL != conn->mPrev ) conn->mPrev->mNext = conn->mNext;
+	if( NULL != conn->mNext ) conn->mNext->mPrev = conn->mPrev;
+	if( mConns == conn ) mConns = conn->mNext;
+
+	if( mEpollFd >= 0 ) epoll_ctl( mEpollFd, EPOLL_CTL_DEL, conn->mFd, NULL );
+	close( conn->mFd );
+
+	if( NULL != conn->mInput ) free( conn->mInput );
+	delete conn->mDecoder;
+	delete conn->mBody;
+	delete conn->mOutput;
+
+	free( conn );
+}
+
+void SP_XmlRpcServer :: closeIdle()
+{
+	time_t deadline = time( NULL ) - mIdleTimeout;
+
+	for( SP_XmlRpcConn_t * conn = mConns; NULL != conn; ) {
+		SP_XmlRpcConn_t * next = conn->mNext;
+		if( conn->mLastActive < deadline ) closeConn( conn );
+		conn = next;
+	}
+}
+
+int SP_XmlRpcServer :: onRead( SP_XmlRpcConn_t * conn )
+{
+	conn->mLastActive = time( NULL );
+
+	for( ; ! conn->mIsClosing && ! isOutputFull( conn ); ) {
+		if( conn->mInputMax - conn->mInputLen < READ_SIZE ) {
+			conn->mInputMax = conn->mInputLen + READ_SIZE;
+			conn->mInput = (char*)realloc( conn->mInput, conn->mInputMax + 1 );
+		}
+
+		int len = recv( conn->mFd, conn->mInput + conn->mInputLen,
+				conn->mInputMax - conn->mInputLen, 0 );
+		if( 0 == len ) return -1;
+		if( len < 0 ) {
+			if( EINTR == errno ) continue;
+			if( EAGAIN == errno || EWOULDBLOCK == errno ) break;
+			return -1;
+		}
+
+		conn->mInputLen += len;
+		process( conn );
+	}
+
+	return onWrite( conn );
+}
+
+int SP_XmlRpcServer :: onWrite( SP_XmlRpcConn_t * conn )
+{
+	SP_XmlStringBuffer * output = conn->mOutput;
+
+	for( ; ; ) {
+		for( ; conn->mOutputPos < output->getSize(); ) {
+			int len = send( conn->mFd, output->getBuffer() + conn->mOutputPos,
+					output->getSize() - conn->mOutputPos, MSG_NOSIGNAL );
+			if( len < 0 ) {
+				if( EINTR == errno ) continue;
+				if( EAGAIN == errno || EWOULDBLOCK == errno ) break;
+				return -1;
+			}
+			conn->mOutputPos += len;
+
+			// a client slowly reading a big response is not idle
+			conn->mLastActive = time( NULL );
+		}
+
+		if( conn->mOutputPos >= output->getSize() ) {
+			if( output->getSize() > 0 ) output->clean();
+			conn->mOutputPos = 0;
+			if( conn->mIsClosing ) return -1;
+		}
+
+		// below the mark again, answer the pipelined requests kept in the input
+		if( conn->mIsClosing || isOutputFull( conn ) || 0 == conn->mInputLen ) break;
+
+		int size = output->getSize();
+		process( conn );
+		if( size == output->getSize() ) break;
+	}
+
+	int isPending = conn->mOutputPos < output->getSize();
+
+	// wait for EPOLLOUT only while there is something to write,
+	// and for EPOLLIN only while the output is below the mark
+	int events = ( isOutputFull( conn ) ? 0 : EPOLLIN ) | ( isPending ? EPOLLOUT : 0 );
+
+	if( events != conn->mEvents ) {
+		conn->mEvents = events;
+
+		struct epoll_event event;
+		memset( &event, 0, sizeof( event ) );
+		event.events = events;
+		event.data.ptr = conn;
+		epoll_ctl( mEpollFd, EPOLL_CTL_MOD, conn->mFd, &event );
+	}
+
+	return 0;
+}
+
+void SP_XmlRpcServer :: respond( SP_XmlRpcConn_t * conn, int status, const char * reason )
+{
+	char header[ 256 ] = { 0 };
+	snprintf( header, sizeof( header ), "HTTP/1.1 %d %s\r\n"
+			"Content-Length: 0\r\nConnection: close\r\n\r\n", status, reason );
+
+	conn->mOutput->append( header );
+	conn->mIsClosing = 1;
+}
+
+// the value of a header line, NULL if the line is not the header
+static const char * getHeader( const char * line, const char * name )
+{
+	int len = strlen( name );
+
+	if( 0 != strncasecmp( line, name, len ) || ':' != line[ len ] ) return NULL;
+
+	for( line += len + 1; ' ' == *line || '\t' == *line; ) line++;
+
+	return line;
+}
+
+int SP_XmlRpcServer :: process( SP_XmlRpcConn_t * conn )
+{
+	int pos = 0;
+
+	for( ; ! conn->mIsClosing && ! isOutputFull( conn ) && pos < conn->mInputLen; ) {
+		char * input = conn->mInput + pos;
+		int len = conn->mInputLen - pos;
+
+		if( conn->mBodyLeft < 0 ) {
+			input[ len ] = '\0';
+			char * end = strstr( input, "\r\n\r\n" );
+			if( NULL == end ) {
+				if( len > MAX_HEADER_SIZE ) respond( conn, 431, "Request Header Fields Too Large" );
+				break;
+			}
+			*end = '\0';
+			pos += end + 4 - input;
+
+			int isPost = 0 == strncmp( input, "POST ", 5 );
+			char * line = strstr( input, "\r\n" );
+			conn->mIsHttp10 = NULL != line && line - input >= 8
+					&& 0 == strncmp( line - 8, "HTTP/1.0", 8 );
+
+			SP_XmlInt64_t bodySize = -1;
+			int isBadLength = 0, isChunked = 0, isContinue = 0;
+			conn->mKeepAlive = ! conn->mIsHttp10;
+
+			for( ; NULL != line; ) {
+				line += 2;
+				char * next = strstr( line, "\r\n" );
+				if( NULL != next ) *next = '\0';
+
+				const char * value = NULL;
+				if( NULL != ( value = getHeader( line, "Content-Length" ) ) ) {
+					// digits only, no sign, no garbage, no overflow
+					isBadLength = ! isdigit( (unsigned char)*value )
+							|| SP_XmlNumber::eOK != SP_XmlNumber::parseInt64( value, &bodySize );
+				} else if( NULL != ( value = getHeader( line, "Connection" ) ) ) {
+					if( 0 == strncasecmp( value, "close", 5 ) ) conn->mKeepAlive = 0;
+					if( 0 == strncasecmp( value, "keep-alive", 10 ) ) conn->mKeepAlive = 1;
+				} else if( NULL != ( value = getHeader( line, "Transfer-Encoding" ) ) ) {
+					isChunked = 0 != strncasecmp( value, "identity", 8 );
+				} else if( NULL != ( value = getHeader( line, "Expect" ) ) ) {
+					isContinue = 0 == strncasecmp( value, "100-continue", 12 );
+				}
+
+				line = next;
+			}
+
+			if( ! isPost ) {
+				respond( conn, 405, "Method Not Allowed" );
+			} else if( isBadLength ) {
+				respond( conn, 400, "Bad Request" );
+			} else if( isChunked || bodySize < 0 ) {
+				respond( conn, 411, "Length Required" );
+			} else if( bodySize > (SP_XmlInt64_t)mMaxBodySize ) {
+				respond( conn, 413, "Payload Too Large" );
+			} else {
+				if( isContinue ) conn->mOutput->append( "HTTP/1.1 100 Continue\r\n\r\n" );
+				conn->mDecoder->reset();
+				conn->mBodyLeft = (int)bodySize;
+			}
+		} else {
+			int size = len < conn->mBodyLeft ? len : conn->mBodyLeft;
+			if( size > 0 ) conn->mDecoder->append( input, size );
+			pos += size;
+			conn->mBodyLeft -= size;
+		}
+
+		if( 0 == conn->mBodyLeft ) {
+			conn->mBodyLeft = -1;
+
+			SP_XmlStringBuffer * body = conn->mBody;
+			if( body->getSize() > 0 ) body->clean();
+
+			{
+				SP_XmlStringSink sink( body );
+				dispatch( conn->mDecoder, &sink );
+			}
+
+			// keep-alive is the default of HTTP/1.1 only
+			const char * connection = "";
+			if( ! conn->mKeepAlive ) {
+				connection = "Connection: close\r\n";
+			} else if( conn->mIsHttp10 ) {
+				connection = "Connection: keep-alive\r\n";
+			}
+
+			char header[ 256 ] = { 0 };
+			snprintf( header, sizeof( header ), "HTTP/1.1 200 OK\r\n"
+					"Content-Type: text/xml\r\nContent-Length: %d\r\n%s\r\n",
+					body->getSize(), connection );
+			conn->mOutput->append( header );
+			conn->mOutput->append( body->getBuffer(), body->getSize() );
+
+			if( ! conn->mKeepAlive ) conn->mIsClosing = 1;
+		}
+	}
+
+	if( pos > 0 ) {
+		conn->mInputLen -= pos;
+		memmove( conn->mInput, conn->mInput + pos, conn->mInputLen );
+	}
+
+	return 0;
+}
+
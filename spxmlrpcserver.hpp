@@ -0,0 +1,138 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmlrpcserver_hpp__
+#define __spxmlrpcserver_hpp__
+
+class SP_XmlHashMap;
+class SP_XmlOutputSink;
+class SP_XmlStringBuffer;
+class SP_XmlRpcValue;
+class SP_XmlRpcDecoder;
+class SP_XmlRpcEncoder;
+
+typedef struct tagSP_XmlRpcMethod SP_XmlRpcMethod_t;
+typedef struct tagSP_XmlRpcTask SP_XmlRpcTask_t;
+typedef struct tagSP_XmlRpcPool SP_XmlRpcPool_t;
+typedef struct tagSP_XmlRpcConn SP_XmlRpcConn_t;
+
+/**
+ *  Dispatch XML-RPC calls to registered methods, decoded by SP_XmlRpcDecoder
+ *  and answered by SP_XmlRpcEncoder.
+ *
+ *  The sub-calls of system.multicall run in parallel on a fixed pool of
+ *  worker threads, so a method can be called by several threads at once
+ *  and must be thread safe. Register all the methods before the first call.
+ *
+ *  run() serves HTTP/1.1 POST on one epoll thread, with keep-alive and
+ *  pipelining, each connection reuses its decoder and buffers.
+ *
+ *	@verbatim
+ *	static int add( void * arg, int count, const SP_XmlRpcValue ** params,
+ *			SP_XmlRpcEncoder * result, SP_XmlStringBuffer * fault )
+ *	{
+ *		if( 2 != count ) {
+ *			fault->append( "need 2 params" );
+ *			return SP_XmlRpcUtils::eInvalidParams;
+ *		}
+ *		return result->addInt( params[0]->getInt64() + params[1]->getInt64() );
+ *	}
+ *
+ *	SP_XmlRpcServer server( 4 );
+ *	server.addMethod( "math.add", add, NULL );
+ *	server.listen( "127.0.0.1:8080" );	// or "unix:/tmp/rpc.sock"
+ *	server.run();
+ *	@endverbatim
+ *
+ *  Linux only, it uses epoll, eventfd and accept4.
+ */
+class SP_XmlRpcServer {
+public:
+	/// write exactly one value to result and return 0, or return a fault
+	/// code and append the fault string to fault, the result is dropped
+	typedef int ( * Method_t )( void * arg, int count, const SP_XmlRpcValue ** params,
+			SP_XmlRpcEncoder * result, SP_XmlStringBuffer * fault );
+
+	/// @param workers : the threads for system.multicall, 0 : run them inline
+	SP_XmlRpcServer( int workers = 4 );
+	~SP_XmlRpcServer();
+
+	/// @return 0 : added, -1 : the name is taken
+	int addMethod( const char * name, Method_t method, void * arg );
+
+	int getMethodCount() const;
+
+	/// answer a decoded methodCall, a fault if it has an error
+	/// @return 0 : a response is written, -1 : sink error
+	int dispatch( const SP_XmlRpcDecoder * call, SP_XmlOutputSink * sink );
+
+	/// "host:port" or "unix:path", port 0 picks a free port
+	/// @return 0 : listening, -1 : see getError
+	int listen( const char * address );
+
+	/// the bound TCP port, 0 for a unix socket
+	int getPort() const;
+
+	/// serve until shutdown
+	/// @return 0 : shut down, -1 : see getError
+	int run();
+
+	/// stop run, safe from any thread and from a method
+	void shutdown();
+
+	/// keep-alive connections idle for so long are closed, default is 60
+	void setIdleTimeout( int seconds );
+
+	/// the request body limit, a bigger one is answered with 413, default is 16M
+	void setMaxBodySize( int size );
+
+	const char * getError() const;
+
+	static const char * MULTICALL;
+
+private:
+	SP_XmlRpcServer( SP_XmlRpcServer & );
+	SP_XmlRpcServer & operator=( SP_XmlRpcServer & );
+
+	void setError( const char * what );
+
+	/// call one method, write the bare value or the fault string to out
+	/// @return 0 : value, others : the fault code
+	int call( const char * name, int count, const SP_XmlRpcValue ** params,
+			SP_XmlStringBuffer * out );
+
+	int multicall( const SP_XmlRpcValue * calls, SP_XmlOutputSink * sink );
+
+	static void runTask( SP_XmlRpcTask_t * task );
+	static void * worker( void * arg );
+
+	void onAccept();
+	int onRead( SP_XmlRpcConn_t * conn );
+	int onWrite( SP_XmlRpcConn_t * conn );
+	int process( SP_XmlRpcConn_t * conn );
+	void respond( SP_XmlRpcConn_t * conn, int status, const char * reason );
+	void closeConn( SP_XmlRpcConn_t * conn );
+	void closeIdle();
+
+	SP_XmlHashMap * mMethods;
+
+	SP_XmlRpcPool_t * mPool;
+
+	int mListenFd;
+	int mEpollFd;
+	int mWakeFd;
+	int mPort;
+	char * mUnixPath;
+
+	SP_XmlRpcConn_t * mConns;
+	int mIdleTimeout;
+	int mMaxBodySize;
+	int mIsShutdown;
+
+	char * mError;
+};
+
+#endif
+
@@ -0,0 +1,1220 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <new>
+
+#include "spxmlrpcvalue.hpp"
+#include "spxmlparser.hpp"
+#include "spxmlevent.hpp"
+#include "spxmlutils.hpp"
+#include "spxmlsink.hpp"
+#include "spxmlcodec.hpp"
+#include "spxmlbase64.hpp"
+
+struct tagSP_XmlRpcArenaBlock {
+	SP_XmlRpcArenaBlock_t * mNext;
+	int mSize;
+	// the arena size when the block is added
+	int mBase;
+};
+
+SP_XmlRpcArena :: SP_XmlRpcArena( int blockSize )
+{
+	mBlockSize = blockSize > 256 ? blockSize : 256;
+	mHead = NULL;
+	mCursor = mEnd = NULL;
+	mSize = 0;
+}
+
+SP_XmlRpcArena :: ~SP_XmlRpcArena()
+{
+	for( SP_XmlRpcArenaBlock_t * block = mHead; NULL != block; ) {
+		SP_XmlRpcArenaBlock_t * next = block->mNext;
+		free( block );
+		block = next;
+	}
+}
+
+void * SP_XmlRpcArena :: alloc( int size )
+{
+	size = ( size + 7 ) & ~7;
+
+	if( mEnd - mCursor < size ) {
+		// the blocks grow with the arena, a big value gets a block of its own
+		int blockSize = mSize > mBlockSize ? mSize : mBlockSize;
+		if( blockSize > 1024 * 1024 ) blockSize = 1024 * 1024;
+		if( blockSize < size ) blockSize = size;
+
+		SP_XmlRpcArenaBlock_t * block = (SP_XmlRpcArenaBlock_t*)malloc(
+				sizeof( SP_XmlRpcArenaBlock_t ) + blockSize );
+		block->mSize = blockSize;
+		block->mBase = mSize;
+		block->mNext = mHead;
+		mHead = block;
+
+		mCursor = (char*)( block + 1 );
+		mEnd = mCursor + blockSize;
+	}
+
+	void * ret = mCursor;
+	mCursor += size;
+	mSize += size;
+
+	return ret;
+}
+
+char * SP_XmlRpcArena :: dup( const char * value, int len )
+{
+	char * ret = (char*)alloc( len + 1 );
+	memcpy( ret, value, len );
+	ret[ len ] = '\0';
+
+	return ret;
+}
+
+void SP_XmlRpcArena :: reset()
+{
+	if( NULL == mHead ) return;
+
+	// keep the last allocated block, it is the biggest
+	for( SP_XmlRpcArenaBlock_t * block = mHead->mNext; NULL != block; ) {
+		SP_XmlRpcArenaBlock_t * next = block->mNext;
+		free( block );
+		block = next;
+	}
+
+	mHead->mNext = NULL;
+	mHead->mBase = 0;
+	mCursor = (char*)( mHead + 1 );
+	mEnd = mCursor + mHead->mSize;
+	mSize = 0;
+}
+
+void SP_XmlRpcArena :: release( int size )
+{
+	if( NULL == mHead || size >= mSize ) return;
+
+	for( ; NULL != mHead->mNext && mHead->mBase > size; ) {
+		SP_XmlRpcArenaBlock_t * next = mHead->mNext;
+		free( mHead );
+		mHead = next;
+	}
+
+	if( size < mHead->mBase ) size = mHead->mBase;
+
+	mCursor = (char*)( mHead + 1 ) + ( size - mHead->mBase );
+	mEnd = (char*)( mHead + 1 ) + mHead->mSize;
+	mSize = size;
+}
+
+int SP_XmlRpcArena :: getSize() const
+{
+	return mSize;
+}
+
+//=========================================================
+
+struct tagSP_XmlRpcMember {
+	const char * mName;
+	const SP_XmlRpcValue * mValue;
+};
+
+SP_XmlRpcValue :: SP_XmlRpcValue()
+{
+	mType = eNil;
+	mCount = 0;
+	mInt = 0;
+	mHash = NULL;
+	mHashMask = 0;
+}
+
+int SP_XmlRpcValue :: getType() const
+{
+	return mType;
+}
+
+int SP_XmlRpcValue :: getInt() const
+{
+	return (int)getInt64();
+}
+
+SP_XmlInt64_t SP_XmlRpcValue :: getInt64() const
+{
+	if( eInt == mType || eBoolean == mType ) return mInt;
+	if( eDouble == mType ) return (SP_XmlInt64_t)mDouble;
+
+	return 0;
+}
+
+int SP_XmlRpcValue :: getBoolean() const
+{
+	return 0 != getInt64();
+}
+
+double SP_XmlRpcValue :: getDouble() const
+{
+	if( eDouble == mType ) return mDouble;
+	if( eInt == mType || eBoolean == mType ) return (double)mInt;
+
+	return 0;
+}
+
+const char * SP_XmlRpcValue :: getString() const
+{
+	if( eString == mType || eDateTime == mType || eBase64 == mType ) return mString;
+
+	return "";
+}
+
+int SP_XmlRpcValue :: getCount() const
+{
+	return mCount;
+}
+
+const SP_XmlRpcValue * SP_XmlRpcValue :: getItem( int index ) const
+{
+	if( eArray != mType || index < 0 || index >= mCount ) return NULL;
+
+	return mItems[ index ];
+}
+
+const char * SP_XmlRpcValue :: getMember( int index, const SP_XmlRpcValue ** value ) const
+{
+	if( eStruct != mType || index < 0 || index >= mCount ) return NULL;
+
+	if( NULL != value ) *value = mMembers[ index ].mValue;
+
+	return mMembers[ index ].mName;
+}
+
+const SP_XmlRpcValue * SP_XmlRpcValue :: getMember( const char * name ) const
+{
+	if( eStruct != mType || NULL == name ) return NULL;
+
+	if( NULL == mHash ) {
+		for( int i = 0; i < mCount; i++ ) {
+			if( 0 == strcmp( name, mMembers[ i ].mName ) ) return mMembers[ i ].mValue;
+		}
+		return NULL;
+	}
+
+	for( int pos = SP_XmlHashMap::hash( name ) & mHashMask; 0 != mHash[ pos ];
+			pos = ( pos + 1 ) & mHashMask ) {
+		const SP_XmlRpcMember_t * member = mMembers + mHash[ pos ] - 1;
+		if( 0 == strcmp( name, member->mName ) ) return member->mValue;
+	}
+
+	return NULL;
+}
+
+int SP_XmlRpcValue :: decodeBase64( SP_XmlOutputSink * sink ) const
+{
+	if( eBase64 != mType ) return -1;
+
+	return SP_XmlBase64::decode( mString, mCount, sink );
+}
+
+//=========================================================
+
+enum { eFrameMethodCall, eFrameMethodResponse, eFrameMethodName,
+		eFrameParams, eFrameParam, eFrameFault, eFrameValue, eFrameScalar,
+		eFrameArray, eFrameData, eFrameStruct, eFrameMember, eFrameName };
+
+struct tagSP_XmlRpcFrame {
+	int mKind;
+	int mType;
+	int mScratchStart;
+	// the arena size at the start, to free a streamed item
+	int mArenaMark;
+	// a streamed container, and the count of its items
+	int mIsStream;
+	int mItemCount;
+	const char * mName;
+	const SP_XmlRpcValue * mValue;
+};
+
+struct tagSP_XmlRpcScratch {
+	const char * mName;
+	const SP_XmlRpcValue * mValue;
+};
+
+// a struct bigger than this gets a hash table
+static const int HASHED_STRUCT_SIZE = 8;
+
+typedef struct tagSP_XmlRpcTag {
+	const char * mName;
+	int mKind;
+	int mType;
+} SP_XmlRpcTag_t;
+
+static const SP_XmlRpcTag_t RPC_TAGS[] = {
+	{ "value", eFrameValue, 0 },
+	{ "string", eFrameScalar, SP_XmlRpcValue::eString },
+	{ "int", eFrameScalar, SP_XmlRpcValue::eInt },
+	{ "i4", eFrameScalar, SP_XmlRpcValue::eInt },
+	{ "member", eFrameMember, 0 },
+	{ "name", eFrameName, 0 },
+	{ "struct", eFrameStruct, 0 },
+	{ "array", eFrameArray, 0 },
+	{ "data", eFrameData, 0 },
+	{ "boolean", eFrameScalar, SP_XmlRpcValue::eBoolean },
+	{ "double", eFrameScalar, SP_XmlRpcValue::eDouble },
+	{ "i8", eFrameScalar, SP_XmlRpcValue::eInt },
+	{ "dateTime.iso8601", eFrameScalar, SP_XmlRpcValue::eDateTime },
+	{ "base64", eFrameScalar, SP_XmlRpcValue::eBase64 },
+	{ "nil", eFrameScalar, SP_XmlRpcValue::eNil },
+	{ "param", eFrameParam, 0 },
+	{ "params", eFrameParams, 0 },
+	{ "methodName", eFrameMethodName, 0 },
+	{ "methodCall", eFrameMethodCall, 0 },
+	{ "methodResponse", eFrameMethodResponse, 0 },
+	{ "fault", eFrameFault, 0 },
+	{ NULL, 0, 0 }
+};
+
+// the kind of the parent which each kind of element must be in, -1 : root
+static int getParentKind( int kind, int parentKind )
+{
+	switch( kind ) {
+		case eFrameMethodCall:
+		case eFrameMethodResponse:
+			return -1;
+		case eFrameMethodName:
+			return eFrameMethodCall;
+		case eFrameParams:
+			return eFrameMethodCall == parentKind ? eFrameMethodCall : eFrameMethodResponse;
+		case eFrameParam:
+			return eFrameParams;
+		case eFrameFault:
+			return eFrameMethodResponse;
+		case eFrameValue:
+			if( eFrameParam == parentKind || eFrameData == parentKind
+					|| eFrameMember == parentKind || eFrameFault == parentKind ) {
+				return parentKind;
+			}
+			return eFrameParam;
+		case eFrameScalar:
+		case eFrameArray:
+		case eFrameStruct:
+			return eFrameValue;
+		case eFrameData:
+			return eFrameArray;
+		case eFrameMember:
+			return eFrameStruct;
+		case eFrameName:
+			return eFrameMember;
+	}
+
+	return -1;
+}
+
+SP_XmlRpcDecoder :: SP_XmlRpcDecoder()
+{
+	mArena = new SP_XmlRpcArena();
+	mParser = NULL;
+	mText = new SP_XmlStringBuffer();
+
+	mFrames = NULL;
+	mFrameCount = mFrameMax = 0;
+
+	mScratch = NULL;
+	mScratchCount = mScratchMax = 0;
+
+	mError = NULL;
+
+	mItemCallback = NULL;
+	mItemArg = NULL;
+
+	reset();
+}
+
+SP_XmlRpcDecoder :: ~SP_XmlRpcDecoder()
+{
+	delete mArena;
+	if( NULL != mParser ) delete mParser;
+	delete mText;
+
+	if( NULL != mFrames ) free( mFrames );
+	if( NULL != mScratch ) free( mScratch );
+
+	if( NULL != mError ) free( mError );
+}
+
+void SP_XmlRpcDecoder :: reset()
+{
+	mArena->reset();
+
+	if( NULL != mParser ) delete mParser;
+	mParser = new SP_XmlPullParser();
+	mParser->setIgnoreWhitespace( 0 );
+
+	mText->clean();
+
+	mFrameCount = 0;
+	mScratchCount = 0;
+
+	mMethod = NULL;
+	mParams = NULL;
+	mParamCount = 0;
+	mFault = NULL;
+
+	mStreamParam = 0;
+
+	mIsDone = 0;
+
+	if( NULL != mError ) free( mError );
+	mError = NULL;
+}
+
+void SP_XmlRpcDecoder :: setItemCallback( ItemCallback_t callback, void * arg )
+{
+	mItemCallback = callback;
+	mItemArg = arg;
+}
+
+int SP_XmlRpcDecoder :: append( const char * source, int len )
+{
+	if( mIsDone || NULL != mError ) return 0;
+
+	int ret = mParser->append( source, len );
+
+	for( SP_XmlPullEvent * event = mParser->getNext();
+			NULL != event; event = mParser->getNext() ) {
+		if( NULL == mError && ! mIsDone ) handle( event );
+		delete event;
+	}
+
+	if( NULL != mParser->getError() ) setError( mParser->getError() );
+
+	return ret;
+}
+
+int SP_XmlRpcDecoder :: isDone() const
+{
+	return mIsDone;
+}
+
+const char * SP_XmlRpcDecoder :: getError() const
+{
+	return mError;
+}
+
+void SP_XmlRpcDecoder :: setError( const char * error )
+{
+	if( NULL == mError ) mError = strdup( error );
+}
+
+const char * SP_XmlRpcDecoder :: getMethod() const
+{
+	return NULL != mMethod ? mMethod : "";
+}
+
+int SP_XmlRpcDecoder :: getParamCount() const
+{
+	return mParamCount;
+}
+
+const SP_XmlRpcValue * SP_XmlRpcDecoder :: getParam( int index ) const
+{
+	return index >= 0 && index < mParamCount ? mParams[ index ] : NULL;
+}
+
+int SP_XmlRpcDecoder :: isFault() const
+{
+	return NULL != mFault;
+}
+
+const SP_XmlRpcValue * SP_XmlRpcDecoder :: getFault() const
+{
+	return mFault;
+}
+
+int SP_XmlRpcDecoder :: getFaultCode() const
+{
+	const SP_XmlRpcValue * code = NULL != mFault ? mFault->getMember( "faultCode" ) : NULL;
+
+	return NULL != code ? code->getInt() : 0;
+}
+
+const char * SP_XmlRpcDecoder :: getFaultString() const
+{
+	const SP_XmlRpcValue * msg = NULL != mFault ? mFault->getMember( "faultString" ) : NULL;
+
+	return NULL != msg ? msg->getString() : NULL;
+}
+
+void SP_XmlRpcDecoder :: handle( SP_XmlPullEvent * event )
+{
+	switch( event->getEventType() ) {
+		case SP_XmlPullEvent::eStartTag:
+			startTag( ((SP_XmlStartTagEvent*)event)->getName() );
+			break;
+		case SP_XmlPullEvent::eEndTag:
+			endTag();
+			break;
+		case SP_XmlPullEvent::eCData:
+			if( mFrameCount > 0 ) {
+				SP_XmlRpcFrame_t * frame = mFrames + mFrameCount - 1;
+
+				// whitespace between the elements is dropped here
+				if( eFrameScalar == frame->mKind || eFrameName == frame->mKind
+						|| eFrameMethodName == frame->mKind
+						|| ( eFrameValue == frame->mKind && NULL == frame->mValue ) ) {
+					mText->append( ((SP_XmlCDataEvent*)event)->getText() );
+				}
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+void SP_XmlRpcDecoder :: pushFrame( int kind )
+{
+	if( mFrameCount >= mFrameMax ) {
+		mFrameMax = mFrameMax > 0 ? mFrameMax * 2 : 16;
+		mFrames = (SP_XmlRpcFrame_t*)realloc( mFrames, mFrameMax * sizeof( SP_XmlRpcFrame_t ) );
+	}
+
+	SP_XmlRpcFrame_t * frame = mFrames + mFrameCount++;
+	frame->mKind = kind;
+	frame->mType = 0;
+	frame->mScratchStart = mScratchCount;
+	frame->mArenaMark = mArena->getSize();
+	frame->mIsStream = 0;
+	frame->mItemCount = 0;
+	frame->mName = NULL;
+	frame->mValue = NULL;
+}
+
+void SP_XmlRpcDecoder :: pushScratch( const char * name, const SP_XmlRpcValue * value )
+{
+	if( mScratchCount >= mScratchMax ) {
+		mScratchMax = mScratchMax > 0 ? mScratchMax * 2 : 64;
+		mScratch = (SP_XmlRpcScratch_t*)realloc( mScratch, mScratchMax * sizeof( SP_XmlRpcScratch_t ) );
+	}
+
+	mScratch[ mScratchCount ].mName = name;
+	mScratch[ mScratchCount ].mValue = value;
+	mScratchCount++;
+}
+
+void SP_XmlRpcDecoder :: startTag( const char * name )
+{
+	const SP_XmlRpcTag_t * tag = RPC_TAGS;
+	for( ; NULL != tag->mName; tag++ ) {
+		if( 0 == strcmp( tag->mName, name ) ) break;
+	}
+
+	char error[ 256 ] = { 0 };
+
+	if( NULL == tag->mName ) {
+		snprintf( error, sizeof( error ), "invalid xml-rpc element <%.64s>", name );
+		setError( error );
+		return;
+	}
+
+	int parentKind = mFrameCount > 0 ? mFrames[ mFrameCount - 1 ].mKind : -1;
+
+	int isValid = getParentKind( tag->mKind, parentKind ) == parentKind;
+
+	// a value holds one typed child
+	if( isValid && eFrameValue == parentKind && NULL != mFrames[ mFrameCount - 1 ].mValue ) {
+		isValid = 0;
+	}
+
+	if( ! isValid ) {
+		snprintf( error, sizeof( error ), "unexpected xml-rpc element <%.64s>", name );
+		setError( error );
+		return;
+	}
+
+	pushFrame( tag->mKind );
+	mFrames[ mFrameCount - 1 ].mType = tag->mType;
+
+	// params / param / value / array or struct
+	if( NULL != mItemCallback && ( eFrameArray == tag->mKind || eFrameStruct == tag->mKind )
+			&& mFrameCount >= 4 && eFrameParam == mFrames[ mFrameCount - 3 ].mKind ) {
+		mFrames[ mFrameCount - 1 ].mIsStream = 1;
+		mStreamParam = mScratchCount - mFrames[ mFrameCount - 4 ].mScratchStart;
+	}
+
+	if( eFrameValue == tag->mKind || eFrameScalar == tag->mKind
+			|| eFrameName == tag->mKind || eFrameMethodName == tag->mKind ) {
+		mText->clean();
+	}
+}
+
+void SP_XmlRpcDecoder :: endTag()
+{
+	if( mFrameCount <= 0 ) return;
+
+	SP_XmlRpcFrame_t frame = mFrames[ --mFrameCount ];
+	SP_XmlRpcFrame_t * parent = mFrameCount > 0 ? mFrames + mFrameCount - 1 : NULL;
+
+	const SP_XmlRpcValue * value = NULL;
+
+	switch( frame.mKind ) {
+		case eFrameScalar:
+			value = newScalar( frame.mType, mText->getBuffer(), mText->getSize() );
+			if( NULL != value ) parent->mValue = value;
+			break;
+		case eFrameArray:
+			parent->mValue = newContainer( SP_XmlRpcValue::eArray, frame.mScratchStart );
+			break;
+		case eFrameStruct:
+			parent->mValue = newContainer( SP_XmlRpcValue::eStruct, frame.mScratchStart );
+			break;
+		case eFrameValue:
+			// a value without a type is a string
+			value = frame.mValue;
+			if( NULL == value ) {
+				value = newScalar( SP_XmlRpcValue::eString, mText->getBuffer(), mText->getSize() );
+			}
+
+			if( eFrameData == parent->mKind ) {
+				if( mFrames[ mFrameCount - 2 ].mIsStream ) {
+					streamItem( &frame, mFrames + mFrameCount - 2, NULL, value );
+				} else {
+					pushScratch( NULL, value );
+				}
+			} else {
+				parent->mValue = value;
+			}
+			break;
+		case eFrameName:
+			parent->mName = mArena->dup( mText->getBuffer(), mText->getSize() );
+			break;
+		case eFrameMember:
+			if( NULL == frame.mName || NULL == frame.mValue ) {
+				setError( "invalid xml-rpc member, need name and value" );
+			} else if( parent->mIsStream ) {
+				streamItem( &frame, parent, frame.mName, frame.mValue );
+			} else {
+				pushScratch( frame.mName, frame.mValue );
+			}
+			break;
+		case eFrameParam:
+			if( NULL == frame.mValue ) {
+				setError( "invalid xml-rpc param, need value" );
+			} else {
+				pushScratch( NULL, frame.mValue );
+			}
+			break;
+		case eFrameParams:
+			mParamCount = mScratchCount - frame.mScratchStart;
+			if( mParamCount > 0 ) {
+				mParams = (const SP_XmlRpcValue**)mArena->alloc(
+						mParamCount * sizeof( SP_XmlRpcValue * ) );
+				for( int i = 0; i < mParamCount; i++ ) {
+					mParams[ i ] = mScratch[ frame.mScratchStart + i ].mValue;
+				}
+			}
+			mScratchCount = frame.mScratchStart;
+			break;
+		case eFrameFault:
+			mFault = frame.mValue;
+			if( NULL == mFault ) setError( "invalid xml-rpc fault, need value" );
+			break;
+		case eFrameMethodName:
+			mMethod = mArena->dup( mText->getBuffer(), mText->getSize() );
+			break;
+		case eFrameMethodCall:
+			if( NULL == mMethod ) setError( "invalid xml-rpc methodCall, need methodName" );
+			mIsDone = 1;
+			break;
+		case eFrameMethodResponse:
+			if( NULL == mFault && mParamCount <= 0 ) {
+				setError( "invalid xml-rpc methodResponse, need params or fault" );
+			}
+			mIsDone = 1;
+			break;
+		default:
+			break;
+	}
+}
+
+void SP_XmlRpcDecoder :: streamItem( SP_XmlRpcFrame_t * item, SP_XmlRpcFrame_t * container,
+		const char * name, const SP_XmlRpcValue * value )
+{
+	if( NULL == value ) return;
+
+	if( 0 != mItemCallback( mItemArg, mStreamParam, container->mItemCount++, name, value ) ) {
+		setError( "stopped by the item callback" );
+	}
+
+	mArena->release( item->mArenaMark );
+}
+
+SP_XmlRpcValue * SP_XmlRpcDecoder :: newValue( int type )
+{
+	SP_XmlRpcValue * value = new ( mArena->alloc( sizeof( SP_XmlRpcValue ) ) ) SP_XmlRpcValue();
+	value->mType = type;
+
+	return value;
+}
+
+SP_XmlRpcValue * SP_XmlRpcDecoder :: newScalar( int type, const char * text, int len )
+{
+	SP_XmlRpcValue * value = newValue( type );
+
+	if( SP_XmlRpcValue::eString == type || SP_XmlRpcValue::eDateTime == type
+			|| SP_XmlRpcValue::eBase64 == type ) {
+		value->mString = mArena->dup( text, len );
+		value->mCount = len;
+		return value;
+	}
+
+	if( SP_XmlRpcValue::eNil == type ) return value;
+
+	// numbers may be padded with whitespace
+	const char * begin = text, * end = text + len;
+	for( ; begin < end && isspace( (unsigned char)*begin ); ) begin++;
+	for( ; end > begin && isspace( (unsigned char)*( end - 1 ) ); ) end--;
+
+	char temp[ 64 ] = { 0 };
+	if( end - begin >= (int)sizeof( temp ) || end == begin ) {
+		setError( "invalid xml-rpc number" );
+		return NULL;
+	}
+	memcpy( temp, begin, end - begin );
+
+	int ret = SP_XmlNumber::eOK;
+
+	if( SP_XmlRpcValue::eInt == type ) {
+		ret = SP_XmlNumber::parseInt64( temp, &( value->mInt ) );
+	} else if( SP_XmlRpcValue::eDouble == type ) {
+		ret = SP_XmlNumber::parseDouble( temp, &( value->mDouble ) );
+	} else if( SP_XmlRpcValue::eBoolean == type ) {
+		if( 0 == strcmp( temp, "1" ) || 0 == strcasecmp( temp, "true" ) ) {
+			value->mInt = 1;
+		} else if( 0 == strcmp( temp, "0" ) || 0 == strcasecmp( temp, "false" ) ) {
+			value->mInt = 0;
+		} else {
+			ret = SP_XmlNumber::eFormatError;
+		}
+	}
+
+	if( SP_XmlNumber::eOK != ret ) {
+		char error[ 128 ] = { 0 };
+		snprintf( error, sizeof( error ), SP_XmlNumber::eOverflow == ret
+				? "xml-rpc number out of range <%s>" : "invalid xml-rpc number <%s>", temp );
+		setError( error );
+		return NULL;
+	}
+
+	return value;
+}
+
+SP_XmlRpcValue * SP_XmlRpcDecoder :: newContainer( int type, int scratchStart )
+{
+	SP_XmlRpcValue * value = newValue( type );
+
+	int count = mScratchCount - scratchStart;
+	SP_XmlRpcScratch_t * scratch = mScratch + scratchStart;
+
+	value->mCount = count;
+
+	if( SP_XmlRpcValue::eArray == type ) {
+		value->mItems = (const SP_XmlRpcValue**)mArena->alloc( count * sizeof( SP_XmlRpcValue * ) );
+		for( int i = 0; i < count; i++ ) value->mItems[ i ] = scratch[ i ].mValue;
+	} else {
+		value->mMembers = (SP_XmlRpcMember_t*)mArena->alloc( count * sizeof( SP_XmlRpcMember_t ) );
+		for( int i = 0; i < count; i++ ) {
+			value->mMembers[ i ].mName = scratch[ i ].mName;
+			value->mMembers[ i ].mValue = scratch[ i ].mValue;
+		}
+
+		if( count > HASHED_STRUCT_SIZE ) {
+			int size = 16;
+			for( ; size < count * 2; ) size *= 2;
+
+			value->mHashMask = size - 1;
+			value->mHash = (int*)mArena->alloc( size * sizeof( int ) );
+			memset( value->mHash, 0, size * sizeof( int ) );
+
+			for( int i = 0; i < count; i++ ) {
+				int pos = SP_XmlHashMap::hash( scratch[ i ].mName ) & value->mHashMask;
+				for( ; 0 != value->mHash[ pos ]; ) pos = ( pos + 1 ) & value->mHashMask;
+				value->mHash[ pos ] = i + 1;
+			}
+		}
+	}
+
+	mScratchCount = scratchStart;
+
+	return value;
+}
+
+//=========================================================
+
+// the fixed parts of the messages, written without strlen
+
+#define RPC_FRAGMENT(str) str, (int)sizeof( str ) - 1
+
+enum { eEncodeParams, eEncodeArray, eEncodeStruct };
+enum { eEnvelopeNone, eEnvelopeCall, eEnvelopeResponse };
+
+static const char RESP_HEAD[] = "<?xml version=\"1.0\"?><methodResponse><params><param><value>";
+static const char RESP_TAIL[] = "</value></param></params></methodResponse>";
+
+static const char FAULT_HEAD[] = "<?xml version=\"1.0\"?><methodResponse><fault><value><struct>"
+		"<member><name>faultCode</name><value><int>";
+static const char FAULT_MIDDLE[] = "</int></value></member>"
+		"<member><name>faultString</name><value><string>";
+static const char FAULT_TAIL[] = "</string></value></member></struct></value></fault></methodResponse>";
+
+SP_XmlRpcEncoder :: SP_XmlRpcEncoder( SP_XmlOutputSink * sink )
+{
+	mStringSink = NULL;
+	init( sink );
+}
+
+SP_XmlRpcEncoder :: SP_XmlRpcEncoder( SP_XmlStringBuffer * buffer )
+{
+	mStringSink = new SP_XmlStringSink( buffer );
+	init( mStringSink );
+}
+
+void SP_XmlRpcEncoder :: init( SP_XmlOutputSink * sink )
+{
+	mSink = sink;
+
+	mFrames = NULL;
+	mDepth = mMaxDepth = 0;
+
+	mEnvelope = eEnvelopeNone;
+	mHasMember = 0;
+	mHasBareValue = 0;
+
+	mError = NULL;
+}
+
+SP_XmlRpcEncoder :: ~SP_XmlRpcEncoder()
+{
+	if( NULL != mStringSink ) delete mStringSink;
+	mStringSink = NULL;
+
+	if( NULL != mFrames ) free( mFrames );
+	if( NULL != mError ) free( mError );
+}
+
+int SP_XmlRpcEncoder :: setError( const char * error )
+{
+	if( NULL == mError ) mError = strdup( error );
+
+	return -1;
+}
+
+const char * SP_XmlRpcEncoder :: getError() const
+{
+	return mError;
+}
+
+int SP_XmlRpcEncoder :: flush()
+{
+	if( 0 != mSink->flush() ) return setError( "sink error" );
+
+	return NULL != mError ? -1 : 0;
+}
+
+void SP_XmlRpcEncoder :: pushFrame( int kind )
+{
+	if( mDepth >= mMaxDepth ) {
+		mMaxDepth = mMaxDepth > 0 ? mMaxDepth * 2 : 16;
+		mFrames = (int*)realloc( mFrames, mMaxDepth * sizeof( int ) );
+	}
+
+	mFrames[ mDepth++ ] = kind;
+}
+
+int SP_XmlRpcEncoder :: startCall( const char * method )
+{
+	if( NULL != mError ) return -1;
+
+	if( eEnvelopeNone != mEnvelope || mHasBareValue ) return setError( "startCall after a value" );
+
+	mEnvelope = eEnvelopeCall;
+	pushFrame( eEncodeParams );
+
+	mSink->append( RPC_FRAGMENT( "<?xml version=\"1.0\"?><methodCall><methodName>" ) );
+	if( NULL != method && '\0' != *method ) SP_XmlStringCodec::encode( "utf-8", method, mSink );
+	return mSink->append( RPC_FRAGMENT( "</methodName><params>" ) );
+}
+
+int SP_XmlRpcEncoder :: startResponse()
+{
+	if( NULL != mError ) return -1;
+
+	if( eEnvelopeNone != mEnvelope || mHasBareValue ) return setError( "startResponse after a value" );
+
+	mEnvelope = eEnvelopeResponse;
+	pushFrame( eEncodeParams );
+
+	return mSink->append( RPC_FRAGMENT( "<?xml version=\"1.0\"?><methodResponse><params>" ) );
+}
+
+int SP_XmlRpcEncoder :: end()
+{
+	if( NULL != mError ) return -1;
+
+	if( eEnvelopeNone != mEnvelope ) {
+		if( 1 != mDepth ) return setError( "end with an open array or struct" );
+
+		mDepth = 0;
+
+		if( eEnvelopeCall == mEnvelope ) {
+			mSink->append( RPC_FRAGMENT( "</params></methodCall>" ) );
+		} else {
+			mSink->append( RPC_FRAGMENT( "</params></methodResponse>" ) );
+		}
+		mEnvelope = eEnvelopeNone;
+	} else if( mDepth > 0 ) {
+		return setError( "end with an open array or struct" );
+	}
+
+	return flush();
+}
+
+int SP_XmlRpcEncoder :: beginValue()
+{
+	if( NULL != mError ) return -1;
+
+	if( 0 == mDepth ) {
+		if( mHasBareValue ) return setError( "more than one value outside of a call or response" );
+		mHasBareValue = 1;
+		return 0;
+	}
+
+	switch( mFrames[ mDepth - 1 ] ) {
+		case eEncodeParams:
+			return mSink->append( RPC_FRAGMENT( "<param><value>" ) );
+		case eEncodeArray:
+			return mSink->append( RPC_FRAGMENT( "<value>" ) );
+		default:
+			if( ! mHasMember ) return setError( "struct value without member name" );
+			mHasMember = 0;
+			return 0;
+	}
+}
+
+int SP_XmlRpcEncoder :: endValue()
+{
+	if( 0 == mDepth ) return 0;
+
+	switch( mFrames[ mDepth - 1 ] ) {
+		case eEncodeParams:
+			return mSink->append( RPC_FRAGMENT( "</value></param>" ) );
+		case eEncodeArray:
+			return mSink->append( RPC_FRAGMENT( "</value>" ) );
+		default:
+			return mSink->append( RPC_FRAGMENT( "</value></member>" ) );
+	}
+}
+
+int SP_XmlRpcEncoder :: writeScalar( const char * tag, int tagLen, const char * value, int len )
+{
+	if( 0 != beginValue() ) return -1;
+
+	mSink->append( '<' );
+	mSink->append( tag, tagLen );
+	mSink->append( '>' );
+	if( len > 0 ) mSink->append( value, len );
+	mSink->append( "</", 2 );
+	mSink->append( tag, tagLen );
+	mSink->append( '>' );
+
+	return endValue();
+}
+
+int SP_XmlRpcEncoder :: formatInt( SP_XmlInt64_t value, char * buffer )
+{
+	char temp[ 32 ];
+	int len = 0;
+
+	// the magnitude as unsigned, so the minimum value is right
+	unsigned long long magnitude = value < 0
+			? (unsigned long long)0 - (unsigned long long)value : (unsigned long long)value;
+
+	do {
+		temp[ len++ ] = (char)( '0' + magnitude % 10 );
+		magnitude /= 10;
+	} while( magnitude > 0 );
+
+	int pos = 0;
+	if( value < 0 ) buffer[ pos++ ] = '-';
+	for( ; len > 0; ) buffer[ pos++ ] = temp[ --len ];
+	buffer[ pos ] = '\0';
+
+	return pos;
+}
+
+int SP_XmlRpcEncoder :: formatDouble( double value, char * buffer )
+{
+	// the shortest of 15 or 17 digits which reads back the same value
+	int len = 0;
+	for( int precision = 15; precision <= 17; precision += 2 ) {
+		len = snprintf( buffer, 32, "%.*g", precision, value );
+
+		// a locale with decimal comma
+		char * comma = strchr( buffer, ',' );
+		if( NULL != comma ) *comma = '.';
+
+		double check = 0;
+		if( SP_XmlNumber::eOK == SP_XmlNumber::parseDouble( buffer, &check )
+				&& check == value ) {
+			break;
+		}
+	}
+
+	return len;
+}
+
+int SP_XmlRpcEncoder :: addInt( SP_XmlInt64_t value )
+{
+	char buffer[ 32 ];
+	int len = formatInt( value, buffer );
+
+	if( value >= -2147483647LL - 1 && value <= 2147483647LL ) {
+		return writeScalar( RPC_FRAGMENT( "int" ), buffer, len );
+	}
+
+	return writeScalar( RPC_FRAGMENT( "i8" ), buffer, len );
+}
+
+int SP_XmlRpcEncoder :: addBoolean( int value )
+{
+	return writeScalar( RPC_FRAGMENT( "boolean" ), value ? "1" : "0", 1 );
+}
+
+int SP_XmlRpcEncoder :: addDouble( double value )
+{
+	if( value != value || value - value != 0 ) return setError( "double is not finite" );
+
+	char buffer[ 32 ];
+	int len = formatDouble( value, buffer );
+
+	return writeScalar( RPC_FRAGMENT( "double" ), buffer, len );
+}
+
+int SP_XmlRpcEncoder :: addString( const char * value, int len )
+{
+	if( 0 != beginValue() ) return -1;
+
+	mSink->append( RPC_FRAGMENT( "<string>" ) );
+	if( NULL != value && 0 != len ) SP_XmlStringCodec::encode( "utf-8", value, len, mSink );
+	mSink->append( RPC_FRAGMENT( "</string>" ) );
+
+	return endValue();
+}
+
+int SP_XmlRpcEncoder :: addDateTime( const char * value )
+{
+	if( 0 != beginValue() ) return -1;
+
+	mSink->append( RPC_FRAGMENT( "<dateTime.iso8601>" ) );
+	if( NULL != value && '\0' != *value ) SP_XmlStringCodec::encode( "utf-8", value, mSink );
+	mSink->append( RPC_FRAGMENT( "</dateTime.iso8601>" ) );
+
+	return endValue();
+}
+
+int SP_XmlRpcEncoder :: addNil()
+{
+	if( 0 != beginValue() ) return -1;
+
+	mSink->append( RPC_FRAGMENT( "<nil/>" ) );
+
+	return endValue();
+}
+
+int SP_XmlRpcEncoder :: addBase64( const void * data, int len )
+{
+	if( 0 != beginValue() ) return -1;
+
+	mSink->append( RPC_FRAGMENT( "<base64>" ) );
+	if( NULL != data && len > 0 ) SP_XmlBase64::encode( data, len, mSink );
+	mSink->append( RPC_FRAGMENT( "</base64>" ) );
+
+	return endValue();
+}
+
+int SP_XmlRpcEncoder :: startArray()
+{
+	if( 0 != beginValue() ) return -1;
+
+	pushFrame( eEncodeArray );
+
+	return mSink->append( RPC_FRAGMENT( "<array><data>" ) );
+}
+
+int SP_XmlRpcEncoder :: endArray()
+{
+	if( NULL != mError ) return -1;
+
+	if( mDepth <= 0 || eEncodeArray != mFrames[ mDepth - 1 ] ) {
+		return setError( "endArray without startArray" );
+	}
+
+	mDepth--;
+	mSink->append( RPC_FRAGMENT( "</data></array>" ) );
+
+	return endValue();
+}
+
+int SP_XmlRpcEncoder :: startStruct()
+{
+	if( 0 != beginValue() ) return -1;
+
+	pushFrame( eEncodeStruct );
+	mHasMember = 0;
+
+	return mSink->append( RPC_FRAGMENT( "<struct>" ) );
+}
+
+int SP_XmlRpcEncoder :: member( const char * name )
+{
+	if( NULL != mError ) return -1;
+
+	if( mDepth <= 0 || eEncodeStruct != mFrames[ mDepth - 1 ] ) {
+		return setError( "member outside of a struct" );
+	}
+
+	if( mHasMember ) return setError( "member without value" );
+
+	mHasMember = 1;
+
+	mSink->append( RPC_FRAGMENT( "<member><name>" ) );
+	if( NULL != name && '\0' != *name ) SP_XmlStringCodec::encode( "utf-8", name, mSink );
+	return mSink->append( RPC_FRAGMENT( "</name><value>" ) );
+}
+
+int SP_XmlRpcEncoder :: endStruct()
+{
+	if( NULL != mError ) return -1;
+
+	if( mDepth <= 0 || eEncodeStruct != mFrames[ mDepth - 1 ] ) {
+		return setError( "endStruct without startStruct" );
+	}
+
+	if( mHasMember ) return setError( "member without value" );
+
+	mDepth--;
+	mSink->append( RPC_FRAGMENT( "</struct>" ) );
+
+	return endValue();
+}
+
+int SP_XmlRpcEncoder :: addValue( const SP_XmlRpcValue * value )
+{
+	if( NULL == value ) return setError( "null value" );
+
+	switch( value->getType() ) {
+		case SP_XmlRpcValue::eNil:
+			return addNil();
+		case SP_XmlRpcValue::eInt:
+			return addInt( value->getInt64() );
+		case SP_XmlRpcValue::eBoolean:
+			return addBoolean( value->getBoolean() );
+		case SP_XmlRpcValue::eDouble:
+			return addDouble( value->getDouble() );
+		case SP_XmlRpcValue::eString:
+			return addString( value->getString(), value->getCount() );
+		case SP_XmlRpcValue::eDateTime:
+			return addDateTime( value->getString() );
+		case SP_XmlRpcValue::eBase64:
+			// already encoded text, base64 has no char to escape
+			return writeScalar( RPC_FRAGMENT( "base64" ), value->getString(), value->getCount() );
+		case SP_XmlRpcValue::eArray:
+			startArray();
+			for( int i = 0; i < value->getCount(); i++ ) addValue( value->getItem( i ) );
+			return endArray();
+		case SP_XmlRpcValue::eStruct:
+			startStruct();
+			for( int i = 0; i < value->getCount(); i++ ) {
+				const SP_XmlRpcValue * item = NULL;
+				member( value->getMember( i, &item ) );
+				addValue( item );
+			}
+			return endStruct();
+	}
+
+	return setError( "unknown value type" );
+}
+
+int SP_XmlRpcEncoder :: addEncoded( const char * value, int len )
+{
+	if( 0 != beginValue() ) return -1;
+
+	if( NULL != value && len > 0 ) mSink->append( value, len );
+
+	return endValue();
+}
+
+int SP_XmlRpcEncoder :: addFault( int code, const char * msg )
+{
+	startStruct();
+	member( "faultCode" );
+	addInt( code );
+	member( "faultString" );
+	addString( msg );
+
+	return endStruct();
+}
+
+int SP_XmlRpcEncoder :: writeFault( SP_XmlOutputSink * sink, int code, const char * msg )
+{
+	char buffer[ 32 ];
+	int len = formatInt( code, buffer );
+
+	sink->append( RPC_FRAGMENT( FAULT_HEAD ) );
+	sink->append( buffer, len );
+	sink->append( RPC_FRAGMENT( FAULT_MIDDLE ) );
+	if( NULL != msg && '\0' != *msg ) SP_XmlStringCodec::encode( "utf-8", msg, sink );
+	sink->append( RPC_FRAGMENT( FAULT_TAIL ) );
+
+	return sink->flush();
+}
+
+int SP_XmlRpcEncoder :: writeIntResponse( SP_XmlOutputSink * sink, SP_XmlInt64_t value )
+{
+	SP_XmlRpcEncoder encoder( sink );
+	encoder.startResponse();
+	encoder.addInt( value );
+	return encoder.end();
+}
+
+int SP_XmlRpcEncoder :: writeBooleanResponse( SP_XmlOutputSink * sink, int value )
+{
+	sink->append( RPC_FRAGMENT( RESP_HEAD ) );
+	sink->append( value ? "<boolean>1</boolean>" : "<boolean>0</boolean>", 20 );
+	sink->append( RPC_FRAGMENT( RESP_TAIL ) );
+
+	return sink->flush();
+}
+
+int SP_XmlRpcEncoder :: writeDoubleResponse( SP_XmlOutputSink * sink, double value )
+{
+	SP_XmlRpcEncoder encoder( sink );
+	encoder.startResponse();
+	encoder.addDouble( value );
+	return encoder.end();
+}
+
+int SP_XmlRpcEncoder :: writeStringResponse( SP_XmlOutputSink * sink, const char * value )
+{
+	sink->append( RPC_FRAGMENT( RESP_HEAD ) );
+	sink->append( RPC_FRAGMENT( "<string>" ) );
+	if( NULL != value && '\0' != *value ) SP_XmlStringCodec::encode( "utf-8", value, sink );
+	sink->append( RPC_FRAGMENT( "</string>" ) );
+	sink->append( RPC_FRAGMENT( RESP_TAIL ) );
+
+	return sink->flush();
+}
+
@@ -0,0 +1,322 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmlrpcvalue_hpp__
+#define __spxmlrpcvalue_hpp__
+
+#include "spxmlnumber.hpp"
+
+class SP_XmlPullParser;
+class SP_XmlPullEvent;
+class SP_XmlStringBuffer;
+class SP_XmlOutputSink;
+class SP_XmlStringSink;
+
+typedef struct tagSP_XmlRpcArenaBlock SP_XmlRpcArenaBlock_t;
+typedef struct tagSP_XmlRpcMember SP_XmlRpcMember_t;
+typedef struct tagSP_XmlRpcFrame SP_XmlRpcFrame_t;
+typedef struct tagSP_XmlRpcScratch SP_XmlRpcScratch_t;
+
+/// bump allocator, everything allocated is freed together
+class SP_XmlRpcArena {
+public:
+	SP_XmlRpcArena( int blockSize = 4096 );
+	~SP_XmlRpcArena();
+
+	/// @return 8 bytes aligned memory, valid until reset or delete
+	void * alloc( int size );
+
+	/// copy len bytes and a '\0'
+	char * dup( const char * value, int len );
+
+	/// free all, keep the first block for reuse
+	void reset();
+
+	/// free what is allocated after getSize returned size
+	void release( int size );
+
+	/// @return the bytes allocated
+	int getSize() const;
+
+private:
+	SP_XmlRpcArena( SP_XmlRpcArena & );
+	SP_XmlRpcArena & operator=( SP_XmlRpcArena & );
+
+	SP_XmlRpcArenaBlock_t * mHead;
+	char * mCursor;
+	char * mEnd;
+	int mBlockSize;
+	int mSize;
+};
+
+/// a decoded XML-RPC value, it lives in the arena of its decoder
+class SP_XmlRpcValue {
+public:
+	enum { eNil, eInt, eBoolean, eDouble, eString,
+			eDateTime, eBase64, eArray, eStruct };
+
+	int getType() const;
+
+	/// <int>, <i4>, <i8>
+	int getInt() const;
+	SP_XmlInt64_t getInt64() const;
+
+	int getBoolean() const;
+	double getDouble() const;
+
+	/// the text of <string>, <dateTime.iso8601>, <base64>
+	const char * getString() const;
+
+	/// the length of the string, the count of the array or struct
+	int getCount() const;
+
+	/// array item
+	const SP_XmlRpcValue * getItem( int index ) const;
+
+	/// struct member by index, return the member name
+	const char * getMember( int index, const SP_XmlRpcValue ** value ) const;
+
+	/// struct member by name, hashed for big structs
+	/// @return NULL : no such member
+	const SP_XmlRpcValue * getMember( const char * name ) const;
+
+	/// decode the text of <base64> to sink, the sink is not flushed
+	/// @return 0 : OK, -1 : not base64 or invalid text
+	int decodeBase64( SP_XmlOutputSink * sink ) const;
+
+private:
+	SP_XmlRpcValue();
+	SP_XmlRpcValue( SP_XmlRpcValue & );
+	SP_XmlRpcValue & operator=( SP_XmlRpcValue & );
+
+	friend class SP_XmlRpcDecoder;
+
+	int mType;
+	int mCount;
+
+	union {
+		SP_XmlInt64_t mInt;
+		double mDouble;
+		const char * mString;
+		const SP_XmlRpcValue ** mItems;
+		SP_XmlRpcMember_t * mMembers;
+	};
+
+	// struct, an open addressing table of member index + 1, 0 : empty
+	int * mHash;
+	int mHashMask;
+};
+
+/**
+ *  Decode a methodCall or methodResponse to SP_XmlRpcValue directly from the
+ *  pull events, in one pass, no tree is built. The values are allocated in
+ *  an arena, which is freed by reset or delete.
+ *
+ *	@verbatim
+ *	SP_XmlRpcDecoder decoder;
+ *	decoder.append( buffer, len );
+ *	if( decoder.isDone() ) {
+ *		const SP_XmlRpcValue * user = decoder.getParam( 0 );
+ *		const SP_XmlRpcValue * id = user->getMember( "id" );
+ *		...
+ *	}
+ *	decoder.reset();	// for the next message
+ *	@endverbatim
+ */
+class SP_XmlRpcDecoder {
+public:
+	/// @param param : the index of the param which holds the container
+	/// @param index : the index of the item in the container
+	/// @param name : the member name, NULL for an array item
+	/// @param value : valid only in the call
+	/// @return 0 : go on, others : stop with an error
+	typedef int ( * ItemCallback_t )( void * arg, int param, int index,
+			const char * name, const SP_XmlRpcValue * value );
+
+	SP_XmlRpcDecoder();
+	~SP_XmlRpcDecoder();
+
+	/// hand each item of a param's array, or member of a param's struct, to
+	/// callback once it is decoded, and free it, so only one item is kept
+	/// at a time; that param then holds an empty array or struct.
+	/// It is kept by reset, NULL to turn it off
+	void setItemCallback( ItemCallback_t callback, void * arg );
+
+	/// append more input, it can be a part of the message
+	/// @return how much byte has been consumed
+	int append( const char * source, int len );
+
+	/// @return 1 : the whole message has been decoded
+	int isDone() const;
+
+	/// @return NOT NULL : the parse or the packet error
+	const char * getError() const;
+
+	/// clear the values and the error, for the next message
+	void reset();
+
+	/// methodCall
+	const char * getMethod() const;
+
+	/// the params of a methodCall, or the single param of a methodResponse
+	int getParamCount() const;
+	const SP_XmlRpcValue * getParam( int index ) const;
+
+	/// methodResponse
+	int isFault() const;
+	const SP_XmlRpcValue * getFault() const;
+	int getFaultCode() const;
+	const char * getFaultString() const;
+
+private:
+	SP_XmlRpcDecoder( SP_XmlRpcDecoder & );
+	SP_XmlRpcDecoder & operator=( SP_XmlRpcDecoder & );
+
+	void handle( SP_XmlPullEvent * event );
+	void startTag( const char * name );
+	void endTag();
+
+	void setError( const char * error );
+
+	SP_XmlRpcValue * newValue( int type );
+	SP_XmlRpcValue * newScalar( int type, const char * text, int len );
+	SP_XmlRpcValue * newContainer( int type, int scratchStart );
+
+	void pushScratch( const char * name, const SP_XmlRpcValue * value );
+	void pushFrame( int kind );
+
+	void streamItem( SP_XmlRpcFrame_t * item, SP_XmlRpcFrame_t * container,
+			const char * name, const SP_XmlRpcValue * value );
+
+	SP_XmlRpcArena * mArena;
+	SP_XmlPullParser * mParser;
+	SP_XmlStringBuffer * mText;
+
+	SP_XmlRpcFrame_t * mFrames;
+	int mFrameCount, mFrameMax;
+
+	SP_XmlRpcScratch_t * mScratch;
+	int mScratchCount, mScratchMax;
+
+	const char * mMethod;
+	const SP_XmlRpcValue ** mParams;
+	int mParamCount;
+	const SP_XmlRpcValue * mFault;
+
+	ItemCallback_t mItemCallback;
+	void * mItemArg;
+	int mStreamParam;
+
+	int mIsDone;
+	char * mError;
+};
+
+/**
+ *  Write XML-RPC messages straight to a sink, no node is allocated.
+ *
+ *	@verbatim
+ *	SP_XmlRpcEncoder encoder( &buffer );
+ *	encoder.startResponse();
+ *	encoder.startStruct();
+ *	encoder.member( "id" );
+ *	encoder.addInt( 41 );
+ *	encoder.member( "tags" );
+ *	encoder.startArray();
+ *	encoder.addString( "a" );
+ *	encoder.endArray();
+ *	encoder.endStruct();
+ *	encoder.end();
+ *	@endverbatim
+ *
+ *  Without startCall or startResponse, a single bare value is written.
+ *  The first error is kept, the calls after it do nothing.
+ */
+class SP_XmlRpcEncoder {
+public:
+	SP_XmlRpcEncoder( SP_XmlOutputSink * sink );
+	SP_XmlRpcEncoder( SP_XmlStringBuffer * buffer );
+	~SP_XmlRpcEncoder();
+
+	/// <methodCall>, every value at the top is a param
+	int startCall( const char * method );
+
+	/// <methodResponse>, write one value as the result
+	int startResponse();
+
+	/// close the call or response, and flush
+	int end();
+
+	int addInt( SP_XmlInt64_t value );
+	int addBoolean( int value );
+	int addDouble( double value );
+	int addString( const char * value, int len = -1 );
+	int addDateTime( const char * value );
+	int addNil();
+
+	/// encode the data straight to the sink as <base64>
+	int addBase64( const void * data, int len );
+
+	/// write a decoded value, with all its items and members
+	int addValue( const SP_XmlRpcValue * value );
+
+	/// write a value encoded before as a bare value, as it is
+	int addEncoded( const char * value, int len );
+
+	/// the fault struct as a value, such as a system.multicall item
+	int addFault( int code, const char * msg );
+
+	int startArray();
+	int endArray();
+
+	int startStruct();
+	/// the name of the next member, call it before each member value
+	int member( const char * name );
+	int endStruct();
+
+	int flush();
+
+	/// @return NOT NULL : the first error
+	const char * getError() const;
+
+	/// the whole response from fixed envelope fragments
+	static int writeFault( SP_XmlOutputSink * sink, int code, const char * msg );
+	static int writeIntResponse( SP_XmlOutputSink * sink, SP_XmlInt64_t value );
+	static int writeBooleanResponse( SP_XmlOutputSink * sink, int value );
+	static int writeDoubleResponse( SP_XmlOutputSink * sink, double value );
+	static int writeStringResponse( SP_XmlOutputSink * sink, const char * value );
+
+	/// @return the length, buffer has room for 32 bytes
+	static int formatInt( SP_XmlInt64_t value, char * buffer );
+	static int formatDouble( double value, char * buffer );
+
+private:
+	SP_XmlRpcEncoder( SP_XmlRpcEncoder & );
+	SP_XmlRpcEncoder & operator=( SP_XmlRpcEncoder & );
+
+	void init( SP_XmlOutputSink * sink );
+
+	int setError( const char * error );
+
+	int beginValue();
+	int endValue();
+	int writeScalar( const char * tag, int tagLen, const char * value, int len );
+
+	void pushFrame( int kind );
+
+	SP_XmlOutputSink * mSink;
+	SP_XmlStringSink * mStringSink;
+
+	int * mFrames;
+	int mDepth, mMaxDepth;
+
+	int mEnvelope;
+	int mHasMember;
+	int mHasBareValue;
+
+	char * mError;
+};
+
+#endif
+
@@ -0,0 +1,312 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include "spxmlsink.hpp"
+#include "spxmlutils.hpp"
+
+SP_XmlOutputSink :: SP_XmlOutputSink()
+{
+	mBegin = mCursor = mEnd = NULL;
+	mError = 0;
+}
+
+SP_XmlOutputSink :: ~SP_XmlOutputSink()
+{
+}
+
+int SP_XmlOutputSink :: appendSlow( const char * value, int size )
+{
+	for( ; size > 0; ) {
+		int space = mEnd - mCursor;
+		if( space <= 0 ) {
+			if( 0 != overflow( size ) || mCursor >= mEnd ) return -1;
+			continue;
+		}
+
+		int len = size < space ? size : space;
+		memcpy( mCursor, value, len );
+		mCursor += len;
+		value += len;
+		size -= len;
+	}
+
+	return 0;
+}
+
+int SP_XmlOutputSink :: flush()
+{
+	return overflow( 0 );
+}
+
+int SP_XmlOutputSink :: getError() const
+{
+	return mError;
+}
+
+//=========================================================
+
+SP_XmlStringSink :: SP_XmlStringSink( SP_XmlStringBuffer * buffer )
+{
+	mBuffer = buffer;
+
+	if( NULL != mBuffer->mBuffer ) {
+		mBegin = mCursor = mBuffer->mBuffer + mBuffer->mSize;
+		mEnd = mBuffer->mBuffer + mBuffer->mMaxSize;
+	}
+}
+
+SP_XmlStringSink :: ~SP_XmlStringSink()
+{
+	flush();
+}
+
+int SP_XmlStringSink :: reserve( int size )
+{
+	if( mEnd - mCursor >= size ) return 0;
+
+	return overflow( size );
+}
+
+int SP_XmlStringSink :: overflow( int need )
+{
+	if( NULL != mBuffer->mBuffer ) {
+		mBuffer->mSize = mCursor - mBuffer->mBuffer;
+		mBuffer->mBuffer[ mBuffer->mSize ] = '\0';
+	}
+
+	if( need > 0 ) mBuffer->ensureSpace( need );
+
+	if( NULL == mBuffer->mBuffer ) return 0;
+
+	mBegin = mCursor = mBuffer->mBuffer + mBuffer->mSize;
+	mEnd = mBuffer->mBuffer + mBuffer->mMaxSize;
+
+	return 0;
+}
+
+//=========================================================
+
+SP_XmlChunkSink :: SP_XmlChunkSink( int chunkSize )
+{
+	chunkSize = chunkSize > 0 ? chunkSize : DEFAULT_CHUNK_SIZE;
+
+	mChunk = (char*)malloc( chunkSize );
+	mBegin = mCursor = mChunk;
+	mEnd = mChunk + chunkSize;
+}
+
+SP_XmlChunkSink :: ~SP_XmlChunkSink()
+{
+	free( mChunk );
+	mChunk = NULL;
+}
+
+int SP_XmlChunkSink :: overflow( int need )
+{
+	int len = mCursor - mBegin;
+	mCursor = mBegin;
+
+	if( 0 != mError ) return -1;
+
+	if( len > 0 && 0 != write( mBegin, len ) ) {
+		if( 0 == mError ) mError = -1;
+		return -1;
+	}
+
+	return 0;
+}
+
+//=========================================================
+
+SP_XmlFdSink :: SP_XmlFdSink( int fd, int chunkSize )
+	: SP_XmlChunkSink( chunkSize )
+{
+	mFd = fd;
+}
+
+SP_XmlFdSink :: ~SP_XmlFdSink()
+{
+	flush();
+}
+
+int SP_XmlFdSink :: write( const char * data, int len )
+{
+#ifndef WIN32
+	for( ; len > 0; ) {
+		int ret = ::write( mFd, data, len );
+		if( ret < 0 ) {
+			if( EINTR == errno ) continue;
+			mError = errno;
+			return -1;
+		}
+		data += ret;
+		len -= ret;
+	}
+
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+//=========================================================
+
+SP_XmlFileSink :: SP_XmlFileSink( FILE * fp, int chunkSize )
+	: SP_XmlChunkSink( chunkSize )
+{
+	mFp = fp;
+}
+
+SP_XmlFileSink :: ~SP_XmlFileSink()
+{
+	flush();
+}
+
+int SP_XmlFileSink :: write( const char * data, int len )
+{
+	if( len != (int)fwrite( data, 1, len, mFp ) ) {
+		mError = errno ? errno : -1;
+		return -1;
+	}
+
+	return 0;
+}
+
+//=========================================================
+
+SP_XmlCallbackSink :: SP_XmlCallbackSink( Callback_t callback, void * arg, int chunkSize )
+	: SP_XmlChunkSink( chunkSize )
+{
+	mCallback = callback;
+	mArg = arg;
+}
+
+SP_XmlCallbackSink :: ~SP_XmlCallbackSink()
+{
+	flush();
+}
+
+int SP_XmlCallbackSink :: write( const char * data, int len )
+{
+	return mCallback( mArg, data, len );
+}
+
+//=========================================================
+
+#ifndef WIN32
+
+SP_XmlRingSink :: SP_XmlRingSink( int capacity, int chunkSize )
+	: SP_XmlChunkSink( chunkSize )
+{
+	mCapacity = capacity > 0 ? capacity : 65536;
+	mRing = (char*)malloc( mCapacity );
+	mHead = mSize = 0;
+	mIsClosed = mIsAborted = 0;
+
+	pthread_mutex_init( &mMutex, NULL );
+	pthread_cond_init( &mNotEmpty, NULL );
+	pthread_cond_init( &mNotFull, NULL );
+}
+
+SP_XmlRingSink :: ~SP_XmlRingSink()
+{
+	pthread_mutex_destroy( &mMutex );
+	pthread_cond_destroy( &mNotEmpty );
+	pthread_cond_destroy( &mNotFull );
+
+	free( mRing );
+	mRing = NULL;
+}
+
+void SP_XmlRingSink :: close()
+{
+	flush();
+
+	pthread_mutex_lock( &mMutex );
+	mIsClosed = 1;
+	pthread_cond_broadcast( &mNotEmpty );
+	pthread_mutex_unlock( &mMutex );
+}
+
+void SP_XmlRingSink :: abort()
+{
+	pthread_mutex_lock( &mMutex );
+	mIsAborted = 1;
+	pthread_cond_broadcast( &mNotFull );
+	pthread_mutex_unlock( &mMutex );
+}
+
+int SP_XmlRingSink :: write( const char * data, int len )
+{
+	int ret = 0;
+
+	pthread_mutex_lock( &mMutex );
+
+	for( ; len > 0; ) {
+		for( ; mSize >= mCapacity && ! mIsAborted; ) {
+			pthread_cond_wait( &mNotFull, &mMutex );
+		}
+
+		if( mIsAborted ) {
+			ret = -1;
+			break;
+		}
+
+		int tail = ( mHead + mSize ) % mCapacity;
+		int space = mCapacity - mSize;
+		if( space > mCapacity - tail ) space = mCapacity - tail;
+		if( space > len ) space = len;
+
+		memcpy( mRing + tail, data, space );
+		mSize += space;
+		data += space;
+		len -= space;
+
+		pthread_cond_signal( &mNotEmpty );
+	}
+
+	pthread_mutex_unlock( &mMutex );
+
+	return ret;
+}
+
+int SP_XmlRingSink :: read( char * buffer, int len )
+{
+	int ret = 0;
+
+	pthread_mutex_lock( &mMutex );
+
+	for( ; 0 == mSize && ! mIsClosed && ! mIsAborted; ) {
+		pthread_cond_wait( &mNotEmpty, &mMutex );
+	}
+
+	for( ; ret < len && mSize > 0; ) {
+		int count = mCapacity - mHead;
+		if( count > mSize ) count = mSize;
+		if( count > len - ret ) count = len - ret;
+
+		memcpy( buffer + ret, mRing + mHead, count );
+		mHead = ( mHead + count ) % mCapacity;
+		mSize -= count;
+		ret += count;
+	}
+
+	if( ret > 0 ) pthread_cond_signal( &mNotFull );
+
+	pthread_mutex_unlock( &mMutex );
+
+	return ret;
+}
+
+#endif
+
@@ -0,0 +1,200 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmlsink_hpp__
+#define __spxmlsink_hpp__
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <pthread.h>
+#endif
+
+class SP_XmlStringBuffer;
+
+/// destination of the serializers, the data is handed over in bounded chunks
+class SP_XmlOutputSink {
+public:
+	virtual ~SP_XmlOutputSink();
+
+	int append( char c );
+
+	/// @param size : <= 0 means strlen( value )
+	int append( const char * value, int size = 0 );
+
+	/// hand over all the appended data
+	/// @return 0 : OK, -1 : error
+	int flush();
+
+	/// @return 0 : no error
+	int getError() const;
+
+protected:
+	SP_XmlOutputSink();
+
+	/// consume [ mBegin, mCursor ), then make room for at least one byte,
+	/// and for need bytes if possible
+	/// @return 0 : OK, -1 : error
+	virtual int overflow( int need ) = 0;
+
+	int appendSlow( const char * value, int size );
+
+	/// the window to append into, [ mBegin, mCursor ) is pending
+	char * mBegin;
+	char * mCursor;
+	char * mEnd;
+
+	int mError;
+
+private:
+	SP_XmlOutputSink( SP_XmlOutputSink & );
+	SP_XmlOutputSink & operator=( SP_XmlOutputSink & );
+};
+
+// the common case, which fits in the window, is inlined
+
+inline int SP_XmlOutputSink :: append( char c )
+{
+	if( mCursor < mEnd ) {
+		*mCursor++ = c;
+		return 0;
+	}
+
+	return appendSlow( &c, 1 );
+}
+
+inline int SP_XmlOutputSink :: append( const char * value, int size )
+{
+	if( 0 == value ) return -1;
+
+	size = ( size <= 0 ? (int)strlen( value ) : size );
+	if( size <= 0 ) return -1;
+
+	if( mEnd - mCursor >= size ) {
+		memcpy( mCursor, value, size );
+		mCursor += size;
+		return 0;
+	}
+
+	return appendSlow( value, size );
+}
+
+/// write into a SP_XmlStringBuffer directly, flush before reading the buffer
+class SP_XmlStringSink : public SP_XmlOutputSink {
+public:
+	SP_XmlStringSink( SP_XmlStringBuffer * buffer );
+	virtual ~SP_XmlStringSink();
+
+	/// make room for size more bytes, so the next appends never reallocate
+	int reserve( int size );
+
+protected:
+	virtual int overflow( int need );
+
+private:
+	SP_XmlStringBuffer * mBuffer;
+};
+
+/// collect data in a fixed size chunk, hand over a chunk at a time by write
+class SP_XmlChunkSink : public SP_XmlOutputSink {
+public:
+	enum { DEFAULT_CHUNK_SIZE = 8192 };
+
+	virtual ~SP_XmlChunkSink();
+
+protected:
+	SP_XmlChunkSink( int chunkSize );
+
+	/// @return 0 : OK, -1 : error
+	virtual int write( const char * data, int len ) = 0;
+
+	virtual int overflow( int need );
+
+private:
+	char * mChunk;
+};
+
+class SP_XmlFdSink : public SP_XmlChunkSink {
+public:
+	SP_XmlFdSink( int fd, int chunkSize = DEFAULT_CHUNK_SIZE );
+	virtual ~SP_XmlFdSink();
+
+protected:
+	virtual int write( const char * data, int len );
+
+private:
+	int mFd;
+};
+
+class SP_XmlFileSink : public SP_XmlChunkSink {
+public:
+	SP_XmlFileSink( FILE * fp, int chunkSize = DEFAULT_CHUNK_SIZE );
+	virtual ~SP_XmlFileSink();
+
+protected:
+	virtual int write( const char * data, int len );
+
+private:
+	FILE * mFp;
+};
+
+class SP_XmlCallbackSink : public SP_XmlChunkSink {
+public:
+	/// @return 0 : OK, -1 : error, stop writing
+	typedef int ( * Callback_t )( void * arg, const char * data, int len );
+
+	SP_XmlCallbackSink( Callback_t callback, void * arg,
+			int chunkSize = DEFAULT_CHUNK_SIZE );
+	virtual ~SP_XmlCallbackSink();
+
+protected:
+	virtual int write( const char * data, int len );
+
+private:
+	Callback_t mCallback;
+	void * mArg;
+};
+
+#ifndef WIN32
+
+/// a fixed size ring between a producer thread, which serializes into it,
+/// and a consumer thread, which reads from it. The producer blocks when
+/// the ring is full, so the memory is bounded whatever the document size.
+class SP_XmlRingSink : public SP_XmlChunkSink {
+public:
+	SP_XmlRingSink( int capacity = 65536, int chunkSize = 4096 );
+	virtual ~SP_XmlRingSink();
+
+	/// producer side, flush and mark the end of data
+	void close();
+
+	/// consumer side, block until data is available
+	/// @return > 0 : bytes read, 0 : closed and drained
+	int read( char * buffer, int len );
+
+	/// consumer side, stop early, the blocked producer gets an error
+	void abort();
+
+protected:
+	virtual int write( const char * data, int len );
+
+private:
+	char * mRing;
+	int mCapacity;
+	int mHead;
+	int mSize;
+	int mIsClosed;
+	int mIsAborted;
+
+	pthread_mutex_t mMutex;
+	pthread_cond_t mNotEmpty;
+	pthread_cond_t mNotFull;
+};
+
+#endif
+
+#endif
+
@@ -0,0 +1,335 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <sys/mman.h>
+#else
+#include <io.h>
+#endif
+
+#include "spxmlsource.hpp"
+
+SP_XmlInputSource :: SP_XmlInputSource()
+{
+	mError = 0;
+}
+
+SP_XmlInputSource :: ~SP_XmlInputSource()
+{
+}
+
+int SP_XmlInputSource :: getError() const
+{
+	return mError;
+}
+
+//=========================================================
+
+SP_XmlMemorySource :: SP_XmlMemorySource( const char * buffer, int len )
+{
+	mBuffer = buffer;
+	mLen = len > 0 ? len : 0;
+}
+
+SP_XmlMemorySource :: ~SP_XmlMemorySource()
+{
+}
+
+int SP_XmlMemorySource :: read( const char ** data )
+{
+	int len = mLen;
+
+	*data = mBuffer;
+	mBuffer += len;
+	mLen = 0;
+
+	return len;
+}
+
+//=========================================================
+
+SP_XmlFileSource :: SP_XmlFileSource( const char * path, int chunkSize )
+{
+	int fd = open( path, O_RDONLY );
+	if( fd < 0 ) mError = errno;
+
+	init( fd, chunkSize );
+
+	mIsOwnFd = 1;
+}
+
+SP_XmlFileSource :: SP_XmlFileSource( int fd, int chunkSize )
+{
+	init( fd, chunkSize );
+}
+
+void SP_XmlFileSource :: init( int fd, int chunkSize )
+{
+	mFd = fd;
+	mIsOwnFd = 0;
+
+	mMap = NULL;
+	mMapSize = mMapPos = 0;
+
+	mChunk = NULL;
+	mChunkSize = chunkSize > 0 ? chunkSize : DEFAULT_CHUNK_SIZE;
+
+	if( mFd < 0 ) {
+		// keep the error of open
+		if( 0 == mError ) mError = EBADF;
+		return;
+	}
+
+#ifndef WIN32
+	struct stat aStat;
+	if( 0 == fstat( mFd, &aStat ) && S_ISREG( aStat.st_mode ) && aStat.st_size > 0 ) {
+		// a read-only private mapping, the pages come from the page cache
+		void * map = mmap( NULL, aStat.st_size, PROT_READ, MAP_PRIVATE, mFd, 0 );
+		if( MAP_FAILED != map ) {
+			mMap = (char*)map;
+			mMapSize = aStat.st_size;
+			mMapPos = 0;
+
+			madvise( mMap, mMapSize, MADV_SEQUENTIAL );
+
+			// read the rest of the file, not the beginning again
+			off_t offset = lseek( mFd, 0, SEEK_CUR );
+			if( offset > 0 ) mMapPos = offset < mMapSize ? offset : mMapSize;
+		}
+	}
+#endif
+}
+
+SP_XmlFileSource :: ~SP_XmlFileSource()
+{
+#ifndef WIN32
+	if( NULL != mMap ) munmap( mMap, mMapSize );
+#endif
+	mMap = NULL;
+
+	if( NULL != mChunk ) free( mChunk );
+	mChunk = NULL;
+
+	if( mIsOwnFd && mFd >= 0 ) close( mFd );
+	mFd = -1;
+}
+
+int SP_XmlFileSource :: isMapped() const
+{
+	return NULL != mMap;
+}
+
+int SP_XmlFileSource :: read( const char ** data )
+{
+	if( 0 != mError ) return -1;
+
+#ifndef WIN32
+	if( NULL != mMap ) {
+		// the previous window has been parsed, give back its pages
+		long long prev = ( mMapPos - 1 ) / WINDOW_SIZE * WINDOW_SIZE;
+		if( mMapPos > 0 ) madvise( mMap + prev, mMapPos - prev, MADV_DONTNEED );
+
+		if( mMapPos >= mMapSize ) return 0;
+
+		// windows are aligned, the first one may be shorter after a lseek
+		long long end = ( mMapPos / WINDOW_SIZE + 1 ) * WINDOW_SIZE;
+		if( end > mMapSize ) end = mMapSize;
+
+		*data = mMap + mMapPos;
+		int len = (int)( end - mMapPos );
+		mMapPos = end;
+
+		return len;
+	}
+#endif
+
+	if( mFd < 0 ) return -1;
+
+	if( NULL == mChunk ) mChunk = (char*)malloc( mChunkSize );
+
+	for( ; ; ) {
+		int ret = ::read( mFd, mChunk, mChunkSize );
+		if( ret < 0 ) {
+			if( EINTR == errno ) continue;
+			mError = errno;
+			return -1;
+		}
+
+		*data = mChunk;
+		return ret;
+	}
+}
+
+//=========================================================
+
+#ifndef WIN32
+
+SP_XmlReadAheadSource :: SP_XmlReadAheadSource( SP_XmlInputSource * source, int isOwnSource,
+		int bufferCount, int bufferSize )
+{
+	mSource = source;
+	mIsOwnSource = isOwnSource;
+
+	mBufferCount = bufferCount > 1 ? bufferCount : DEFAULT_BUFFER_COUNT;
+	mBufferSize = bufferSize > 0 ? bufferSize : DEFAULT_BUFFER_SIZE;
+
+	mBuffers = (char**)calloc( mBufferCount, sizeof( char * ) );
+	mLens = (int*)calloc( mBufferCount, sizeof( int ) );
+	for( int i = 0; i < mBufferCount; i++ ) mBuffers[i] = (char*)malloc( mBufferSize );
+
+	mHead = mCount = mIsHolding = 0;
+	mIsEnd = mIsAborted = mSourceError = 0;
+	mReaderWaits = mParserWaits = 0;
+
+	pthread_mutex_init( &mMutex, NULL );
+	pthread_cond_init( &mNotEmpty, NULL );
+	pthread_cond_init( &mNotFull, NULL );
+
+	int ret = pthread_create( &mThread, NULL, readerMain, this );
+	mIsStarted = 0 == ret;
+	if( 0 != ret ) mError = ret;
+}
+
+SP_XmlReadAheadSource :: ~SP_XmlReadAheadSource()
+{
+	if( mIsStarted ) {
+		pthread_mutex_lock( &mMutex );
+		mIsAborted = 1;
+		pthread_cond_broadcast( &mNotFull );
+		pthread_mutex_unlock( &mMutex );
+
+		pthread_join( mThread, NULL );
+	}
+
+	pthread_mutex_destroy( &mMutex );
+	pthread_cond_destroy( &mNotEmpty );
+	pthread_cond_destroy( &mNotFull );
+
+	for( int i = 0; i < mBufferCount; i++ ) free( mBuffers[i] );
+	free( mBuffers );
+	free( mLens );
+
+	if( mIsOwnSource && NULL != mSource ) delete mSource;
+	mSource = NULL;
+}
+
+void * SP_XmlReadAheadSource :: readerMain( void * arg )
+{
+	((SP_XmlReadAheadSource*)arg)->runReader();
+
+	return NULL;
+}
+
+void SP_XmlReadAheadSource :: runReader()
+{
+	const char * piece = NULL;
+	int pieceLen = 0, isEnd = 0;
+
+	for( ; ! isEnd; ) {
+		pthread_mutex_lock( &mMutex );
+
+		if( mCount >= mBufferCount && ! mIsAborted ) mReaderWaits++;
+		for( ; mCount >= mBufferCount && ! mIsAborted; ) {
+			pthread_cond_wait( &mNotFull, &mMutex );
+		}
+
+		int index = ( mHead + mCount ) % mBufferCount;
+		int isAborted = mIsAborted;
+
+		pthread_mutex_unlock( &mMutex );
+
+		if( isAborted ) break;
+
+		// the buffer is out of the ring, fill it without the lock
+		char * buffer = mBuffers[ index ];
+		int len = 0, error = 0;
+
+		for( ; len < mBufferSize; ) {
+			if( pieceLen <= 0 ) {
+				pieceLen = mSource->read( &piece );
+				if( pieceLen <= 0 ) {
+					if( pieceLen < 0 ) error = mSource->getError() ? mSource->getError() : -1;
+					pieceLen = 0;
+					isEnd = 1;
+					break;
+				}
+			}
+
+			int count = mBufferSize - len < pieceLen ? mBufferSize - len : pieceLen;
+			memcpy( buffer + len, piece, count );
+			len += count;
+			piece += count;
+			pieceLen -= count;
+		}
+
+		pthread_mutex_lock( &mMutex );
+
+		mLens[ index ] = len;
+		if( len > 0 ) mCount++;
+
+		if( isEnd ) {
+			mIsEnd = 1;
+			mSourceError = error;
+		}
+
+		pthread_cond_signal( &mNotEmpty );
+		pthread_mutex_unlock( &mMutex );
+	}
+}
+
+int SP_XmlReadAheadSource :: read( const char ** data )
+{
+	if( 0 != mError ) return -1;
+
+	int len = 0;
+
+	pthread_mutex_lock( &mMutex );
+
+	// give back the buffer of the last read
+	if( mIsHolding ) {
+		mHead = ( mHead + 1 ) % mBufferCount;
+		mCount--;
+		mIsHolding = 0;
+		pthread_cond_signal( &mNotFull );
+	}
+
+	if( 0 == mCount && ! mIsEnd ) mParserWaits++;
+	for( ; 0 == mCount && ! mIsEnd; ) {
+		pthread_cond_wait( &mNotEmpty, &mMutex );
+	}
+
+	if( mCount > 0 ) {
+		*data = mBuffers[ mHead ];
+		len = mLens[ mHead ];
+		mIsHolding = 1;
+	} else if( 0 != mSourceError ) {
+		mError = mSourceError;
+		len = -1;
+	}
+
+	pthread_mutex_unlock( &mMutex );
+
+	return len;
+}
+
+void SP_XmlReadAheadSource :: getStats( int * readerWaits, int * parserWaits )
+{
+	pthread_mutex_lock( &mMutex );
+
+	if( NULL != readerWaits ) *readerWaits = mReaderWaits;
+	if( NULL != parserWaits ) *parserWaits = mParserWaits;
+
+	pthread_mutex_unlock( &mMutex );
+}
+
+#endif
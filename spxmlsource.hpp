@@ -0,0 +1,160 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmlsource_hpp__
+#define __spxmlsource_hpp__
+
+#ifndef WIN32
+#include <pthread.h>
+#endif
+
+#include "spxmlnumber.hpp"
+
+/// origin of the parsers' input, the data is handed over in pieces,
+/// a piece stays valid until the next read
+class SP_XmlInputSource {
+public:
+	virtual ~SP_XmlInputSource();
+
+	/// @return > 0 : the size of the piece at *data, 0 : end of input, -1 : error
+	virtual int read( const char ** data ) = 0;
+
+	/// @return 0 : no error, else the errno of the failure
+	int getError() const;
+
+protected:
+	SP_XmlInputSource();
+
+	int mError;
+
+private:
+	SP_XmlInputSource( SP_XmlInputSource & );
+	SP_XmlInputSource & operator=( SP_XmlInputSource & );
+};
+
+/// a buffer already in memory, handed over at once, not copied
+class SP_XmlMemorySource : public SP_XmlInputSource {
+public:
+	/// the buffer must outlive the source
+	SP_XmlMemorySource( const char * buffer, int len );
+	virtual ~SP_XmlMemorySource();
+
+	virtual int read( const char ** data );
+
+private:
+	const char * mBuffer;
+	int mLen;
+};
+
+/**
+ *  A regular file is mapped and handed over a window at a time, the pages of
+ *  the windows already handed over are dropped, so the resident memory stays
+ *  about one window whatever the file size. Pipes, sockets and devices, or a
+ *  file which cannot be mapped, are read in chunks.
+ */
+class SP_XmlFileSource : public SP_XmlInputSource {
+public:
+	enum { DEFAULT_CHUNK_SIZE = 65536, WINDOW_SIZE = 4 * 1024 * 1024 };
+
+	/// check getError for a failure to open the file
+	SP_XmlFileSource( const char * path, int chunkSize = DEFAULT_CHUNK_SIZE );
+
+	/// the fd is not closed
+	SP_XmlFileSource( int fd, int chunkSize = DEFAULT_CHUNK_SIZE );
+
+	virtual ~SP_XmlFileSource();
+
+	virtual int read( const char ** data );
+
+	/// @return 1 : the file is mapped, 0 : read in chunks
+	int isMapped() const;
+
+private:
+	void init( int fd, int chunkSize );
+
+	int mFd;
+	int mIsOwnFd;
+
+	// the mapping, [ mMap, mMap + mMapSize ), mMapPos is the next window
+	char * mMap;
+	SP_XmlInt64_t mMapSize;
+	SP_XmlInt64_t mMapPos;
+
+	char * mChunk;
+	int mChunkSize;
+};
+
+#ifndef WIN32
+
+/**
+ *  Read another source ahead on a thread of its own, into a ring of fixed
+ *  size buffers, while the parser works on the buffer read before. The
+ *  reader blocks when all the buffers are full, so the memory is bounded
+ *  by bufferCount * bufferSize. Wrapping a SP_XmlGzipSource moves the
+ *  inflating to the reader thread too.
+ *
+ *	@verbatim
+ *	SP_XmlFileSource file( path );
+ *	SP_XmlGzipSource gzip( &file );
+ *	SP_XmlReadAheadSource source( &gzip );
+ *	parser.setSource( &source );
+ *	@endverbatim
+ */
+class SP_XmlReadAheadSource : public SP_XmlInputSource {
+public:
+	enum { DEFAULT_BUFFER_COUNT = 4, DEFAULT_BUFFER_SIZE = 262144 };
+
+	/// isOwnSource : delete the source in the destructor, after the thread stops
+	SP_XmlReadAheadSource( SP_XmlInputSource * source, int isOwnSource = 0,
+			int bufferCount = DEFAULT_BUFFER_COUNT, int bufferSize = DEFAULT_BUFFER_SIZE );
+
+	/// stop the reader thread, it may wait for a blocking read of the source
+	virtual ~SP_XmlReadAheadSource();
+
+	/// a piece is a whole buffer, it is given back at the next read
+	virtual int read( const char ** data );
+
+	/// how many times the reader waited for a free buffer, the input is
+	/// faster than the parser, and the parser waited for a full one, the
+	/// input is slower
+	void getStats( int * readerWaits, int * parserWaits );
+
+private:
+	static void * readerMain( void * arg );
+
+	void runReader();
+
+	SP_XmlInputSource * mSource;
+	int mIsOwnSource;
+
+	char ** mBuffers;
+	int * mLens;
+	int mBufferCount;
+	int mBufferSize;
+
+	// [ mHead, mHead + mCount ) are full, the parser holds mHead after a read
+	int mHead;
+	int mCount;
+	int mIsHolding;
+
+	int mIsEnd;
+	int mIsAborted;
+	int mSourceError;
+
+	int mReaderWaits;
+	int mParserWaits;
+
+	pthread_t mThread;
+	int mIsStarted;
+
+	pthread_mutex_t mMutex;
+	pthread_cond_t mNotEmpty;
+	pthread_cond_t mNotFull;
+};
+
+#endif
+
+#endif
+
@@ -12,6 +12,10 @@
 
 #include "spxmlutils.hpp"
 
+#ifdef WIN32
+#include <windows.h>
+#endif
+
 //=========================================================
 
 const int SP_XmlArrayList::LAST_INDEX = -1;
@@ -61,12 +65,12 @@ void * SP_XmlArrayList :: takeItem( int index )
 
 	mCount--;
 
-	if( ( index + 1 ) < mMaxCount ) {
+	// only the items after index move, the slots past mCount are NULL already
+	if( index < mCount ) {
 		memmove( mFirst + index, mFirst + index + 1,
-			( mMaxCount - index - 1 ) * sizeof( void * ) );
-	} else {
-		mFirst[ index ] = NULL;
+			( mCount - index ) * sizeof( void * ) );
 	}
+	mFirst[ mCount ] = NULL;
 
 	return ret;
 }
@@ -83,22 +87,249 @@ const void * SP_XmlArrayList :: getItem( int index ) const
 	return ret;
 }
 
-void SP_XmlArrayList :: sort( int ( * cmpFunc )( const void *, const void * ) )
+// stable merge sort of items[ 0, count ), temp has room for count / 2 items
+static void mergeSort( void ** items, void ** temp, int count,
+		int ( * cmpFunc )( const void *, const void * ) )
 {
-	for( int i = 0; i < mCount - 1; i++ ) {
-		int min = i;
-		for( int j = i + 1; j < mCount; j++ ) {
-			if( cmpFunc( mFirst[ min ], mFirst[ j ] ) > 0 ) {
-				min = j;
+	if( count <= 8 ) {
+		for( int i = 1; i < count; i++ ) {
+			void * item = items[ i ];
+			int j = i;
+			for( ; j > 0 && cmpFunc( items[ j - 1 ], item ) > 0; j-- ) {
+				items[ j ] = items[ j - 1 ];
 			}
+			items[ j ] = item;
 		}
+		return;
+	}
+
+	int half = count / 2;
+	mergeSort( items, temp, half, cmpFunc );
+	mergeSort( items + half, temp, count - half, cmpFunc );
+
+	if( cmpFunc( items[ half - 1 ], items[ half ] ) <= 0 ) return;
+
+	memcpy( temp, items, half * sizeof( void * ) );
+
+	int i = 0, j = half, k = 0;
+	for( ; i < half && j < count; ) {
+		items[ k++ ] = cmpFunc( temp[ i ], items[ j ] ) <= 0 ? temp[ i++ ] : items[ j++ ];
+	}
+	for( ; i < half; ) items[ k++ ] = temp[ i++ ];
+}
+
+void SP_XmlArrayList :: sort( int ( * cmpFunc )( const void *, const void * ) )
+{
+	if( mCount < 2 ) return;
+
+	void ** temp = (void**)malloc( ( mCount / 2 + 1 ) * sizeof( void * ) );
+	mergeSort( mFirst, temp, mCount, cmpFunc );
+	free( temp );
+}
+
+void SP_XmlArrayList :: clean()
+{
+	memset( mFirst, 0, mCount * sizeof( void * ) );
+	mCount = 0;
+}
+
+//=========================================================
+
+struct tagSP_XmlHashMapEntry {
+	char * mKey;
+	void * mValue;
+	unsigned int mHash;
+	int mNext;
+};
+
+SP_XmlHashMap :: SP_XmlHashMap( int initCount )
+{
+	mMaxCount = initCount <= 0 ? 8 : initCount;
+	mCount = 0;
+	mEntries = (SP_XmlHashMapEntry_t*)malloc( sizeof( SP_XmlHashMapEntry_t ) * mMaxCount );
+
+	mBuckets = NULL;
+	mBucketCount = 0;
+
+	int bucketCount = 8;
+	for( ; bucketCount < mMaxCount; ) bucketCount *= 2;
+	rehash( bucketCount );
+}
 
-		if( min != i ) {
-			void * temp = mFirst[ i ];
-			mFirst[ i ] = mFirst[ min ];
-			mFirst[ min ] = temp;
+SP_XmlHashMap :: ~SP_XmlHashMap()
+{
+	for( int i = 0; i < mCount; i++ ) free( mEntries[i].mKey );
+
+	free( mEntries );
+	mEntries = NULL;
+
+	free( mBuckets );
+	mBuckets = NULL;
+}
+
+unsigned int SP_XmlHashMap :: hash( const char * key )
+{
+	// FNV-1a
+	unsigned int ret = 2166136261U;
+
+	for( const unsigned char * pos = (unsigned char*)key; '\0' != *pos; pos++ ) {
+		ret ^= *pos;
+		ret *= 16777619U;
+	}
+
+	return ret;
+}
+
+int SP_XmlHashMap :: getCount() const
+{
+	return mCount;
+}
+
+void SP_XmlHashMap :: rehash( int bucketCount )
+{
+	free( mBuckets );
+
+	mBucketCount = bucketCount;
+	mBuckets = (int*)malloc( sizeof( int ) * mBucketCount );
+	assert( NULL != mBuckets );
+	memset( mBuckets, 0xff, sizeof( int ) * mBucketCount );
+
+	for( int i = 0; i < mCount; i++ ) {
+		int bucket = mEntries[i].mHash & ( mBucketCount - 1 );
+		mEntries[i].mNext = mBuckets[ bucket ];
+		mBuckets[ bucket ] = i;
+	}
+}
+
+int SP_XmlHashMap :: find( const char * key, unsigned int hashCode ) const
+{
+	int index = mBuckets[ hashCode & ( mBucketCount - 1 ) ];
+
+	for( ; index >= 0; index = mEntries[ index ].mNext ) {
+		if( hashCode == mEntries[ index ].mHash
+				&& 0 == strcmp( key, mEntries[ index ].mKey ) ) {
+			break;
 		}
 	}
+
+	return index;
+}
+
+void * SP_XmlHashMap :: put( const char * key, void * value )
+{
+	if( NULL == key ) return NULL;
+
+	unsigned int hashCode = hash( key );
+
+	int index = find( key, hashCode );
+	if( index >= 0 ) {
+		void * ret = mEntries[ index ].mValue;
+		mEntries[ index ].mValue = value;
+		return ret;
+	}
+
+	if( mCount >= mMaxCount ) {
+		mMaxCount = ( mMaxCount * 3 ) / 2 + 1;
+		mEntries = (SP_XmlHashMapEntry_t*)realloc( mEntries,
+				sizeof( SP_XmlHashMapEntry_t ) * mMaxCount );
+		assert( NULL != mEntries );
+	}
+
+	SP_XmlHashMapEntry_t * entry = &( mEntries[ mCount ] );
+	entry->mKey = strdup( key );
+	entry->mValue = value;
+	entry->mHash = hashCode;
+
+	int bucket = hashCode & ( mBucketCount - 1 );
+	entry->mNext = mBuckets[ bucket ];
+	mBuckets[ bucket ] = mCount;
+
+	mCount++;
+
+	if( mCount > mBucketCount ) rehash( mBucketCount * 2 );
+
+	return NULL;
+}
+
+void * SP_XmlHashMap :: get( const char * key ) const
+{
+	if( NULL == key ) return NULL;
+
+	int index = find( key, hash( key ) );
+
+	return index >= 0 ? mEntries[ index ].mValue : NULL;
+}
+
+void * SP_XmlHashMap :: remove( const char * key )
+{
+	if( NULL == key ) return NULL;
+
+	unsigned int hashCode = hash( key );
+
+	int index = find( key, hashCode );
+	if( index < 0 ) return NULL;
+
+	void * ret = mEntries[ index ].mValue;
+
+	// unlink index from its bucket chain
+	int * link = &( mBuckets[ hashCode & ( mBucketCount - 1 ) ] );
+	for( ; *link != index; ) link = &( mEntries[ *link ].mNext );
+	*link = mEntries[ index ].mNext;
+
+	free( mEntries[ index ].mKey );
+
+	// move the last entry into the hole
+	int last = mCount - 1;
+	if( index != last ) {
+		link = &( mBuckets[ mEntries[ last ].mHash & ( mBucketCount - 1 ) ] );
+		for( ; *link != last; ) link = &( mEntries[ *link ].mNext );
+		*link = index;
+
+		mEntries[ index ] = mEntries[ last ];
+	}
+
+	mCount--;
+
+	return ret;
+}
+
+void SP_XmlHashMap :: clean()
+{
+	for( int i = 0; i < mCount; i++ ) free( mEntries[i].mKey );
+	mCount = 0;
+
+	memset( mBuckets, 0xff, sizeof( int ) * mBucketCount );
+}
+
+const char * SP_XmlHashMap :: getItem( int index, void ** value ) const
+{
+	if( index < 0 || index >= mCount ) return NULL;
+
+	if( NULL != value ) *value = mEntries[ index ].mValue;
+
+	return mEntries[ index ].mKey;
+}
+
+//=========================================================
+
+void * SP_XmlAtomic :: loadPtr( void * volatile * ptr )
+{
+#ifdef WIN32
+	return InterlockedCompareExchangePointer( (PVOID volatile *)ptr, NULL, NULL );
+#else
+	return __atomic_load_n( ptr, __ATOMIC_ACQUIRE );
+#endif
+}
+
+int SP_XmlAtomic :: casPtr( void * volatile * ptr, void * oldValue, void * newValue )
+{
+#ifdef WIN32
+	return oldValue == InterlockedCompareExchangePointer(
+			(PVOID volatile *)ptr, newValue, oldValue );
+#else
+	return __atomic_compare_exchange_n( ptr, &oldValue, newValue, 0,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ? 1 : 0;
+#endif
 }
 
 //=========================================================
@@ -23,6 +23,9 @@ public:
 	void * takeItem( int index );
 	void sort( int ( * cmpFunc )( const void *, const void * ) );
 
+	/// remove all items, the items are not freed
+	void clean();
+
 private:
 	SP_XmlArrayList( SP_XmlArrayList & );
 	SP_XmlArrayList & operator=( SP_XmlArrayList & );
@@ -32,6 +35,58 @@ private:
 	void ** mFirst;
 };
 
+typedef struct tagSP_XmlHashMapEntry SP_XmlHashMapEntry_t;
+
+/// string keyed hash map, keys are copied, values are owned by the caller
+class SP_XmlHashMap {
+public:
+	SP_XmlHashMap( int initCount = 8 );
+	virtual ~SP_XmlHashMap();
+
+	int getCount() const;
+
+	/// @return the previous value of key, NULL if key is new
+	void * put( const char * key, void * value );
+	void * get( const char * key ) const;
+	void * remove( const char * key );
+
+	/// remove all entries, the values are not freed
+	void clean();
+
+	/// iterate all entries, return key of the index'th entry
+	const char * getItem( int index, void ** value ) const;
+
+	static unsigned int hash( const char * key );
+
+private:
+	SP_XmlHashMap( SP_XmlHashMap & );
+	SP_XmlHashMap & operator=( SP_XmlHashMap & );
+
+	int find( const char * key, unsigned int hashCode ) const;
+	void rehash( int bucketCount );
+
+	SP_XmlHashMapEntry_t * mEntries;
+	int mMaxCount;
+	int mCount;
+
+	int * mBuckets;
+	int mBucketCount;
+};
+
+/// atomic pointer access, used to publish lazily built caches of a shared document
+class SP_XmlAtomic {
+public:
+	/// load with acquire semantics
+	static void * loadPtr( void * volatile * ptr );
+
+	/// store newValue if *ptr is oldValue, with release semantics
+	/// @return 1 : stored, 0 : *ptr has been changed by another thread
+	static int casPtr( void * volatile * ptr, void * oldValue, void * newValue );
+
+private:
+	SP_XmlAtomic();
+};
+
 class SP_XmlQueue {
 public:
 	SP_XmlQueue();
@@ -71,6 +126,8 @@ private:
 	char * mBuffer;
 	int mMaxSize;
 	int mSize;	
+
+	friend class SP_XmlStringSink;
 };
 
 #ifdef WIN32
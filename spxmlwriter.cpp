@@ -0,0 +1,263 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "spxmlwriter.hpp"
+#include "spxmlsink.hpp"
+#include "spxmlcodec.hpp"
+#include "spxmlutils.hpp"
+#include "spxmlbase64.hpp"
+
+SP_XmlWriter :: SP_XmlWriter( SP_XmlOutputSink * sink, const char * encoding )
+{
+	mStringSink = NULL;
+	init( sink, encoding );
+}
+
+SP_XmlWriter :: SP_XmlWriter( SP_XmlStringBuffer * buffer, const char * encoding )
+{
+	mStringSink = new SP_XmlStringSink( buffer );
+	init( mStringSink, encoding );
+}
+
+void SP_XmlWriter :: init( SP_XmlOutputSink * sink, const char * encoding )
+{
+	mSink = sink;
+	mEncoding = strdup( NULL != encoding ? encoding : SP_XmlStringCodec::DEFAULT_ENCODING );
+
+	mNames = NULL;
+	mNamesSize = mNamesMax = 0;
+	mOffsets = NULL;
+	mDepth = mMaxDepth = 0;
+
+	mIsTagOpen = 0;
+	mHasRoot = 0;
+
+	mError = NULL;
+}
+
+SP_XmlWriter :: ~SP_XmlWriter()
+{
+	if( NULL != mStringSink ) delete mStringSink;
+	mStringSink = NULL;
+
+	free( mEncoding );
+	if( NULL != mNames ) free( mNames );
+	if( NULL != mOffsets ) free( mOffsets );
+	if( NULL != mError ) free( mError );
+}
+
+int SP_XmlWriter :: setError( const char * error )
+{
+	if( NULL == mError ) mError = strdup( error );
+
+	return -1;
+}
+
+const char * SP_XmlWriter :: getError() const
+{
+	return mError;
+}
+
+int SP_XmlWriter :: getDepth() const
+{
+	return mDepth;
+}
+
+int SP_XmlWriter :: checkName( const char * name )
+{
+	if( NULL == name || '\0' == *name ) return setError( "empty name" );
+
+	if( NULL != strpbrk( name, " \t\r\n<>&\"'=/" ) ) {
+		char error[ 256 ] = { 0 };
+		snprintf( error, sizeof( error ), "invalid name <%.64s>", name );
+		return setError( error );
+	}
+
+	return 0;
+}
+
+int SP_XmlWriter :: closeTag()
+{
+	if( mIsTagOpen ) {
+		mIsTagOpen = 0;
+		return mSink->append( '>' );
+	}
+
+	return 0;
+}
+
+int SP_XmlWriter :: startDocument()
+{
+	if( NULL != mError ) return -1;
+
+	if( mHasRoot || mDepth > 0 ) return setError( "startDocument after the root element" );
+
+	mSink->append( "<?xml version=\"1.0\" encoding=\"" );
+	mSink->append( mEncoding );
+	return mSink->append( "\"?>" );
+}
+
+int SP_XmlWriter :: endDocument()
+{
+	if( NULL != mError ) return -1;
+
+	for( ; mDepth > 0; ) {
+		if( 0 != endElement() ) return -1;
+	}
+
+	return flush();
+}
+
+int SP_XmlWriter :: startElement( const char * name )
+{
+	if( NULL != mError ) return -1;
+
+	if( 0 != checkName( name ) ) return -1;
+
+	if( 0 == mDepth ) {
+		if( mHasRoot ) return setError( "more than one root element" );
+		mHasRoot = 1;
+	}
+
+	closeTag();
+
+	int len = strlen( name ) + 1;
+
+	if( mNamesSize + len > mNamesMax ) {
+		mNamesMax = mNamesMax * 2 > mNamesSize + len ? mNamesMax * 2 : mNamesSize + len + 64;
+		mNames = (char*)realloc( mNames, mNamesMax );
+	}
+
+	if( mDepth >= mMaxDepth ) {
+		mMaxDepth = mMaxDepth > 0 ? mMaxDepth * 2 : 16;
+		mOffsets = (int*)realloc( mOffsets, mMaxDepth * sizeof( int ) );
+	}
+
+	memcpy( mNames + mNamesSize, name, len );
+	mOffsets[ mDepth++ ] = mNamesSize;
+	mNamesSize += len;
+
+	mIsTagOpen = 1;
+
+	mSink->append( '<' );
+	return mSink->append( name, len - 1 );
+}
+
+int SP_XmlWriter :: attribute( const char * name, const char * value )
+{
+	if( NULL != mError ) return -1;
+
+	if( ! mIsTagOpen ) return setError( "attribute outside of a start-tag" );
+
+	if( 0 != checkName( name ) ) return -1;
+
+	mSink->append( ' ' );
+	mSink->append( name );
+	mSink->append( "=\"" );
+	if( NULL != value ) SP_XmlStringCodec::encode( mEncoding, value, mSink );
+	return mSink->append( '"' );
+}
+
+int SP_XmlWriter :: text( const char * value, int len )
+{
+	if( NULL != mError ) return -1;
+
+	if( 0 == mDepth ) return setError( "text outside of the root element" );
+
+	closeTag();
+
+	if( NULL == value ) return 0;
+
+	return SP_XmlStringCodec::encode( mEncoding, value, len, mSink );
+}
+
+int SP_XmlWriter :: endElement()
+{
+	if( NULL != mError ) return -1;
+
+	if( mDepth <= 0 ) return setError( "endElement without startElement" );
+
+	mDepth--;
+	const char * name = mNames + mOffsets[ mDepth ];
+
+	int ret = 0;
+
+	if( mIsTagOpen ) {
+		mIsTagOpen = 0;
+		ret = mSink->append( "/>" );
+	} else {
+		mSink->append( "</" );
+		mSink->append( name );
+		ret = mSink->append( '>' );
+	}
+
+	mNamesSize = mOffsets[ mDepth ];
+
+	return ret;
+}
+
+int SP_XmlWriter :: comment( const char * value )
+{
+	if( NULL != mError ) return -1;
+
+	if( NULL != value && NULL != strstr( value, "--" ) ) {
+		return setError( "comment contains --" );
+	}
+
+	closeTag();
+
+	mSink->append( "<!--" );
+	if( NULL != value && '\0' != *value ) mSink->append( value );
+	return mSink->append( "-->" );
+}
+
+int SP_XmlWriter :: raw( const char * value, int len )
+{
+	if( NULL != mError ) return -1;
+
+	closeTag();
+
+	if( NULL == value ) return 0;
+
+	len = len > 0 ? len : strlen( value );
+
+	return len > 0 ? mSink->append( value, len ) : 0;
+}
+
+int SP_XmlWriter :: base64( const void * data, int len )
+{
+	if( NULL != mError ) return -1;
+
+	if( 0 == mDepth ) return setError( "text outside of the root element" );
+
+	closeTag();
+
+	if( NULL == data || len <= 0 ) return 0;
+
+	SP_XmlBase64Encoder encoder( mSink );
+	encoder.append( data, len );
+
+	return encoder.finish();
+}
+
+int SP_XmlWriter :: element( const char * name, const char * value )
+{
+	if( 0 != startElement( name ) ) return -1;
+	if( NULL != value && '\0' != *value && 0 != text( value ) ) return -1;
+
+	return endElement();
+}
+
+int SP_XmlWriter :: flush()
+{
+	if( 0 != mSink->flush() ) return setError( "sink error" );
+
+	return NULL != mError ? -1 : 0;
+}
+
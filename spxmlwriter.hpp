@@ -0,0 +1,96 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __spxmlwriter_hpp__
+#define __spxmlwriter_hpp__
+
+class SP_XmlOutputSink;
+class SP_XmlStringBuffer;
+class SP_XmlStringSink;
+
+/**
+ *  Generate xml without building a node tree.
+ *
+ *	@verbatim
+ *	SP_XmlWriter writer( &buffer );
+ *	writer.startElement( "value" );
+ *	writer.attribute( "type", "int" );
+ *	writer.text( "42" );
+ *	writer.endElement();
+ *	writer.flush();
+ *	@endverbatim
+ *
+ *  Text and attribute values are escaped as SP_XmlDomBuffer does. The names
+ *  of the open elements are kept in a stack, so endElement needs no name.
+ *  After the first error every call fails and does nothing.
+ */
+class SP_XmlWriter {
+public:
+	SP_XmlWriter( SP_XmlOutputSink * sink, const char * encoding = 0 );
+	SP_XmlWriter( SP_XmlStringBuffer * buffer, const char * encoding = 0 );
+	~SP_XmlWriter();
+
+	/// write <?xml version="1.0" encoding="..."?>, only before the first element
+	int startDocument();
+
+	/// close all the open elements and flush
+	int endDocument();
+
+	int startElement( const char * name );
+
+	/// only valid between startElement and the first content
+	int attribute( const char * name, const char * value );
+
+	/// @param len : < 0 means strlen( value )
+	int text( const char * value, int len = -1 );
+
+	int endElement();
+
+	int comment( const char * value );
+
+	/// write value without escaping
+	int raw( const char * value, int len = 0 );
+
+	/// write binary data as base64 text
+	int base64( const void * data, int len );
+
+	/// shortcut of startElement, text and endElement
+	int element( const char * name, const char * value );
+
+	int flush();
+
+	int getDepth() const;
+
+	/// @return NOT NULL : the detail error message
+	/// @return NULL : no error
+	const char * getError() const;
+
+private:
+	SP_XmlWriter( SP_XmlWriter & );
+	SP_XmlWriter & operator=( SP_XmlWriter & );
+
+	void init( SP_XmlOutputSink * sink, const char * encoding );
+	int closeTag();
+	int checkName( const char * name );
+	int setError( const char * error );
+
+	SP_XmlOutputSink * mSink;
+	SP_XmlStringSink * mStringSink;
+	char * mEncoding;
+
+	// names of the open elements, mNames[ mOffsets[ i ] ] is the name of level i
+	char * mNames;
+	int mNamesSize, mNamesMax;
+	int * mOffsets;
+	int mDepth, mMaxDepth;
+
+	int mIsTagOpen;
+	int mHasRoot;
+
+	char * mError;
+};
+
+#endif
+
@@ -0,0 +1,291 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "spxmlbase64.hpp"
+#include "spxmlsink.hpp"
+#include "spxmlutils.hpp"
+#include "spxmlwriter.hpp"
+#include "spxmlrpcvalue.hpp"
+
+static const char * IMPLS[] = { "scalar", "ssse3", "avx2" };
+
+static int testVectors()
+{
+	// RFC 4648
+	static const char * VECTORS[][ 2 ] = {
+		{ "", "" }, { "f", "Zg==" }, { "fo", "Zm8=" }, { "foo", "Zm9v" },
+		{ "foob", "Zm9vYg==" }, { "fooba", "Zm9vYmE=" }, { "foobar", "Zm9vYmFy" }
+	};
+
+	int errors = 0;
+
+	for( int i = 0; i < (int)( sizeof( VECTORS ) / sizeof( VECTORS[0] ) ); i++ ) {
+		SP_XmlStringBuffer encoded, decoded;
+		{
+			SP_XmlStringSink sink( &encoded );
+			SP_XmlBase64::encode( VECTORS[i][0], strlen( VECTORS[i][0] ), &sink );
+		}
+		{
+			SP_XmlStringSink sink( &decoded );
+			if( 0 != SP_XmlBase64::decode( VECTORS[i][1], strlen( VECTORS[i][1] ), &sink ) ) errors++;
+		}
+
+		if( 0 != strcmp( encoded.getBuffer(), VECTORS[i][1] ) ) errors++;
+		if( 0 != strcmp( decoded.getBuffer(), VECTORS[i][0] ) ) errors++;
+	}
+
+	return errors;
+}
+
+static void scalarEncode( const unsigned char * data, int len, SP_XmlStringBuffer * out )
+{
+	static const char TABLE[] =
+			"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	for( int i = 0; i < len; i += 3 ) {
+		unsigned int group = data[i] << 16;
+		if( i + 1 < len ) group |= data[i+1] << 8;
+		if( i + 2 < len ) group |= data[i+2];
+
+		out->append( TABLE[ group >> 18 ] );
+		out->append( TABLE[ ( group >> 12 ) & 0x3F ] );
+		out->append( i + 1 < len ? TABLE[ ( group >> 6 ) & 0x3F ] : '=' );
+		out->append( i + 2 < len ? TABLE[ group & 0x3F ] : '=' );
+	}
+}
+
+/* random data in random pieces, with line breaks, against a plain encoder */
+static int testRandom()
+{
+	int errors = 0;
+
+	unsigned char data[ 700 ];
+
+	for( int len = 0; len < 700; len++ ) {
+		for( int i = 0; i < len; i++ ) data[i] = rand() & 0xFF;
+
+		SP_XmlStringBuffer expect;
+		scalarEncode( data, len, &expect );
+
+		SP_XmlStringBuffer encoded;
+		{
+			SP_XmlStringSink sink( &encoded );
+			SP_XmlBase64Encoder encoder( &sink );
+			for( int pos = 0; pos < len; ) {
+				int piece = 1 + rand() % 64;
+				if( piece > len - pos ) piece = len - pos;
+				encoder.append( data + pos, piece );
+				pos += piece;
+			}
+			encoder.finish();
+		}
+
+		if( 0 != strcmp( expect.getBuffer(), encoded.getBuffer() ) ) errors++;
+
+		// break the lines at 76 chars, as mime does
+		SP_XmlStringBuffer text;
+		for( int pos = 0; pos < expect.getSize(); pos += 76 ) {
+			int line = expect.getSize() - pos < 76 ? expect.getSize() - pos : 76;
+			text.append( expect.getBuffer() + pos, line );
+			text.append( "\r\n" );
+		}
+
+		SP_XmlStringBuffer decoded;
+		{
+			SP_XmlStringSink sink( &decoded );
+			SP_XmlBase64Decoder decoder( &sink );
+			for( int pos = 0; pos < text.getSize(); ) {
+				int piece = 1 + rand() % 100;
+				if( piece > text.getSize() - pos ) piece = text.getSize() - pos;
+				if( 0 != decoder.append( text.getBuffer() + pos, piece ) ) errors++;
+				pos += piece;
+			}
+			if( 0 != decoder.finish() ) errors++;
+		}
+
+		if( decoded.getSize() != len || 0 != memcmp( decoded.getBuffer(), data, len ) ) errors++;
+	}
+
+	return errors;
+}
+
+/* every char outside of the alphabet is refused, at any position */
+static int testInvalid()
+{
+	int errors = 0;
+
+	unsigned char data[ 96 ];
+	for( int i = 0; i < (int)sizeof( data ); i++ ) data[i] = i * 7;
+
+	SP_XmlStringBuffer text;
+	scalarEncode( data, sizeof( data ), &text );
+
+	for( int c = 0; c < 256; c++ ) {
+		if( NULL != strchr( "\t\r\n =", c ) || ( c > 0 && NULL != strchr(
+				"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/", c ) ) ) {
+			continue;
+		}
+
+		for( int pos = 0; pos < text.getSize(); pos += 5 ) {
+			char * bad = strdup( text.getBuffer() );
+			bad[ pos ] = (char)c;
+
+			SP_XmlStringBuffer decoded;
+			SP_XmlStringSink sink( &decoded );
+			if( 0 == SP_XmlBase64::decode( bad, text.getSize(), &sink ) ) errors++;
+
+			free( bad );
+		}
+	}
+
+	const char * BAD[] = { "Zg", "Z===", "Zg=", "Zg==Zg==", "Zm9v=", "A" };
+	int accepted = 0;
+	for( int i = 0; i < (int)( sizeof( BAD ) / sizeof( BAD[0] ) ); i++ ) {
+		SP_XmlStringBuffer decoded;
+		SP_XmlStringSink sink( &decoded );
+		if( 0 == SP_XmlBase64::decode( BAD[i], strlen( BAD[i] ), &sink ) ) accepted++;
+	}
+
+	// only the unpadded "Zg" is fine
+	if( 1 != accepted ) errors++;
+
+	return errors;
+}
+
+static int testRpc()
+{
+	unsigned char data[ 1000 ];
+	for( int i = 0; i < (int)sizeof( data ); i++ ) data[i] = rand() & 0xFF;
+
+	SP_XmlStringBuffer xml;
+	{
+		SP_XmlRpcEncoder encoder( &xml );
+		encoder.startResponse();
+		encoder.addBase64( data, sizeof( data ) );
+		encoder.end();
+	}
+
+	SP_XmlRpcDecoder decoder;
+	decoder.append( xml.getBuffer(), xml.getSize() );
+
+	SP_XmlStringBuffer decoded;
+	{
+		SP_XmlStringSink sink( &decoded );
+		if( 1 != decoder.getParamCount() || 0 != decoder.getParam( 0 )->decodeBase64( &sink ) ) {
+			return 1;
+		}
+	}
+
+	SP_XmlStringBuffer doc;
+	{
+		SP_XmlWriter writer( &doc );
+		writer.startElement( "file" );
+		writer.base64( "foobar", 6 );
+		writer.endDocument();
+	}
+
+	return ( decoded.getSize() != (int)sizeof( data ) || 0 != memcmp( decoded.getBuffer(), data, sizeof( data ) )
+			|| 0 != strcmp( doc.getBuffer(), "<file>Zm9vYmFy</file>" ) ) ? 1 : 0;
+}
+
+class NullSink : public SP_XmlChunkSink {
+public:
+	NullSink() : SP_XmlChunkSink( 65536 ) {}
+	virtual ~NullSink() {}
+
+protected:
+	virtual int write( const char * data, int len ) { return 0; }
+};
+
+static double now()
+{
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void benchmark( int size )
+{
+	unsigned char * data = (unsigned char*)malloc( size );
+	for( int i = 0; i < size; i++ ) data[i] = rand() & 0xFF;
+
+	SP_XmlStringBuffer text;
+	{
+		SP_XmlStringSink sink( &text );
+		SP_XmlBase64::encode( data, size, &sink );
+	}
+
+	for( int i = 0; i < (int)( sizeof( IMPLS ) / sizeof( IMPLS[0] ) ); i++ ) {
+		if( 0 != SP_XmlBase64::setImpl( IMPLS[i] ) ) continue;
+
+		NullSink sink;
+
+		double start = now();
+		SP_XmlBase64::encode( data, size, &sink );
+		double encode = now() - start;
+
+		start = now();
+		SP_XmlBase64::decode( text.getBuffer(), text.getSize(), &sink );
+		double decode = now() - start;
+
+		printf( "bench %s: %d MB, encode %.0f MB/s, decode %.0f MB/s\n", IMPLS[i],
+				size >> 20, size / encode / 1e6, size / decode / 1e6 );
+	}
+
+	free( data );
+}
+
+int main( int argc, char * argv[] )
+{
+	int benchSize = 0;
+
+	extern char *optarg ;
+	int c ;
+
+	while( ( c = getopt( argc, argv, "b:v" ) ) != EOF ) {
+		switch ( c ) {
+			case 'b' :
+				benchSize = atoi( optarg ) << 20;
+				break;
+			case '?' :
+			case 'v' :
+				printf( "Usage: %s [-b <benchmark MB>]\n", argv[0] );
+				exit( 0 );
+		}
+	}
+
+	int errors = 0;
+
+	for( int i = 0; i < (int)( sizeof( IMPLS ) / sizeof( IMPLS[0] ) ); i++ ) {
+		if( 0 != SP_XmlBase64::setImpl( IMPLS[i] ) ) {
+			printf( "%s: not supported\n", IMPLS[i] );
+			continue;
+		}
+
+		srand( 1 );
+
+		int vectors = testVectors();
+		int random = testRandom();
+		int invalid = testInvalid();
+		int rpc = testRpc();
+
+		printf( "%s: vectors %d, random %d, invalid %d, rpc %d errors\n",
+				IMPLS[i], vectors, random, invalid, rpc );
+
+		errors += vectors + random + invalid + rpc;
+	}
+
+	if( benchSize > 0 ) benchmark( benchSize );
+
+	return 0 == errors ? 0 : -1;
+}
+
@@ -0,0 +1,278 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spxmlbatch.hpp"
+#include "spdomparser.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlutils.hpp"
+
+#include "testsupport.hpp"
+
+/* small messages, a few big ones, a few broken ones */
+static void makeMessages( int count, char *** sources, int ** lens, int isValid )
+{
+	*sources = (char**)malloc( count * sizeof( char * ) );
+	*lens = (int*)malloc( count * sizeof( int ) );
+
+	for( int i = 0; i < count; i++ ) {
+		SP_XmlStringBuffer buffer;
+		char line[ 256 ];
+
+		snprintf( line, sizeof( line ), "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+				"<message id=\"%d\" type=\"%s\"><from>node-%d</from>", i, i % 2 ? "order" : "quote", i % 7 );
+		buffer.append( line );
+
+		int items = 0 == i % 97 ? 500 : 1 + i % 4;
+		for( int j = 0; j < items; j++ ) {
+			snprintf( line, sizeof( line ), "<item sku=\"%d-%d\" qty=\"%d\">a &lt; b</item>", i, j, j + 1 );
+			buffer.append( line );
+		}
+		buffer.append( "<!-- end --></message>\n" );
+
+		if( ! isValid && 13 == i % 50 ) {
+			// truncated
+			(*sources)[i] = strndup( buffer.getBuffer(), buffer.getSize() / 2 );
+			(*lens)[i] = buffer.getSize() / 2;
+			continue;
+		}
+		if( ! isValid && 31 == i % 50 ) {
+			(*sources)[i] = strdup( "<message><from></to></message>" );
+			(*lens)[i] = strlen( (*sources)[i] );
+			continue;
+		}
+
+		(*sources)[i] = strdup( buffer.getBuffer() );
+		(*lens)[i] = buffer.getSize();
+	}
+}
+
+static void freeMessages( int count, char ** sources, int * lens )
+{
+	for( int i = 0; i < count; i++ ) free( sources[i] );
+	free( sources );
+	free( lens );
+}
+
+/* a fresh parser for each message, as it was done before */
+static int testResults( int count, char ** sources, int * lens )
+{
+	int errors = 0, failed = 0;
+
+	SP_XmlBatchParser batch( 4 );
+
+	// twice, the threads and their parsers are reused
+	for( int round = 0; round < 2; round++ ) {
+		int ret = batch.parse( count, (const char **)sources, lens );
+		failed = batch.getErrorCount();
+		if( ( 0 == ret ) != ( 0 == failed ) ) errors++;
+
+		for( int i = 0; i < count; i++ ) {
+			SP_XmlDomParser expected;
+			int expectedRet = expected.parse( sources[i], lens[i] );
+
+			if( ( 0 == expectedRet ) != ( NULL == batch.getError( i ) ) ) {
+				errors++;
+			} else if( 0 == expectedRet ) {
+				if( ! isSame( batch.getDocument( i ), expected.getDocument() ) ) errors++;
+			} else if( 0 != strcmp( batch.getError( i ), expected.getError() ) ) {
+				errors++;
+			}
+		}
+	}
+
+	SP_XmlDocument * doc = batch.takeDocument( 0 );
+	if( NULL == doc || NULL != batch.getDocument( 0 ) ) errors++;
+	delete doc;
+
+	printf( "results: %d documents, %d failed, %d errors\n", count, failed, errors );
+
+	return errors;
+}
+
+/* one parser reset between the messages gives the same as fresh ones */
+static int testReset( int count, char ** sources, int * lens )
+{
+	int errors = 0;
+
+	SP_XmlDomParser parser;
+	for( int i = 0; i < count; i++ ) {
+		SP_XmlDomParser expected;
+		int expectedRet = expected.parse( sources[i], lens[i] );
+
+		int ret = parser.parse( sources[i], lens[i] );
+		if( ret != expectedRet ) errors++;
+		if( 0 == ret && ! isSame( parser.getDocument(), expected.getDocument() ) ) errors++;
+		if( 0 == ret && 0 != strcmp( parser.getEncoding(), expected.getEncoding() ) ) errors++;
+
+		parser.reset();
+	}
+
+	// a reset in the middle of a document
+	parser.append( sources[1], lens[1] / 2 );
+	parser.reset();
+	if( 0 != parser.parse( sources[2], lens[2] ) ) errors++;
+
+	printf( "reset: %d errors\n", errors );
+
+	return errors;
+}
+
+typedef struct tagDelivery {
+	int * mSeen;
+	int mCount;
+	int mLast;
+	int mIsOrdered;
+	int mStopAt;
+} Delivery_t;
+
+static int onDocument( void * arg, int index, SP_XmlDocument * document, const char * error )
+{
+	Delivery_t * delivery = (Delivery_t*)arg;
+
+	if( ( NULL == document ) == ( NULL == error ) ) delivery->mIsOrdered = 0;
+	if( index != delivery->mLast + 1 ) delivery->mIsOrdered = 0;
+
+	delivery->mSeen[ index ]++;
+	delivery->mLast = index;
+	delivery->mCount++;
+
+	if( NULL != document ) delete document;
+
+	return delivery->mCount == delivery->mStopAt ? -1 : 0;
+}
+
+static int testCallback( int count, char ** sources, int * lens )
+{
+	int errors = 0;
+
+	SP_XmlBatchParser batch( 4 );
+
+	for( int order = SP_XmlBatchParser::eInputOrder;
+			order <= SP_XmlBatchParser::eCompletionOrder; order++ ) {
+		Delivery_t delivery = { (int*)calloc( count, sizeof( int ) ), 0, -1, 1, -1 };
+
+		batch.setDocumentCallback( onDocument, &delivery, order );
+		batch.parse( count, (const char **)sources, lens );
+
+		if( count != delivery.mCount ) errors++;
+		for( int i = 0; i < count; i++ ) {
+			if( 1 != delivery.mSeen[i] ) errors++;
+		}
+		if( SP_XmlBatchParser::eInputOrder == order && ! delivery.mIsOrdered ) errors++;
+
+		free( delivery.mSeen );
+	}
+
+	// stop early, no more is delivered
+	Delivery_t delivery = { (int*)calloc( count, sizeof( int ) ), 0, -1, 1, 10 };
+	batch.setDocumentCallback( onDocument, &delivery, SP_XmlBatchParser::eInputOrder );
+	if( 0 == batch.parse( count, (const char **)sources, lens ) || 10 != delivery.mCount ) errors++;
+	if( ! delivery.mIsOrdered ) errors++;
+	free( delivery.mSeen );
+
+	printf( "callback: %d errors\n", errors );
+
+	return errors;
+}
+
+static void benchmark( int count, int threads )
+{
+	char ** sources = NULL;
+	int * lens = NULL;
+	makeMessages( count, &sources, &lens, 1 );
+
+	long long bytes = 0;
+	for( int i = 0; i < count; i++ ) bytes += lens[i];
+
+	double start = now();
+	for( int i = 0; i < count; i++ ) {
+		SP_XmlDomParser parser;
+		parser.parse( sources[i], lens[i] );
+	}
+	double fresh = now() - start;
+
+	start = now();
+	{
+		SP_XmlDomParser parser;
+		for( int i = 0; i < count; i++ ) {
+			parser.parse( sources[i], lens[i] );
+			parser.reset();
+		}
+	}
+	double reused = now() - start;
+
+	printf( "bench: %d messages, %lld bytes\n", count, bytes );
+	printf( "bench: a new parser for each, %.3f s, %.2f us per message\n",
+			fresh, fresh * 1e6 / count );
+	printf( "bench: one parser reset for each, %.3f s, %.2f us per message\n",
+			reused, reused * 1e6 / count );
+
+	for( int i = 1; i <= threads; i *= 2 ) {
+		SP_XmlBatchParser batch( i );
+
+		// consume each document as it is ready, as an ingestion job does
+		Delivery_t delivery = { (int*)calloc( count, sizeof( int ) ), 0, -1, 1, -1 };
+		batch.setDocumentCallback( onDocument, &delivery, SP_XmlBatchParser::eCompletionOrder );
+
+		start = now();
+		batch.parse( count, (const char **)sources, lens );
+		double elapsed = now() - start;
+
+		free( delivery.mSeen );
+
+		printf( "bench: batch of %d threads, %.3f s, %.2f us per message, %.1f MB/s, %d steals\n",
+				i, elapsed, elapsed * 1e6 / count, bytes / elapsed / 1048576, batch.getStealCount() );
+	}
+
+	freeMessages( count, sources, lens );
+}
+
+int main( int argc, char * argv[] )
+{
+	int benchCount = 0;
+	int threads = (int)sysconf( _SC_NPROCESSORS_ONLN );
+
+	extern char *optarg ;
+	int c ;
+
+	while( ( c = getopt( argc, argv, "b:t:v" ) ) != EOF ) {
+		switch ( c ) {
+			case 'b' :
+				benchCount = atoi( optarg );
+				break;
+			case 't' :
+				threads = atoi( optarg );
+				break;
+			case '?' :
+			case 'v' :
+				printf( "Usage: %s [-b <benchmark message count>] [-t <max threads>]\n", argv[0] );
+				exit( 0 );
+		}
+	}
+
+	const int count = 1000;
+
+	char ** sources = NULL;
+	int * lens = NULL;
+	makeMessages( count, &sources, &lens, 0 );
+
+	int errors = testResults( count, sources, lens )
+			+ testReset( count, sources, lens )
+			+ testCallback( count, sources, lens );
+
+	freeMessages( count, sources, lens );
+
+	if( benchCount > 0 ) benchmark( benchCount, threads > 0 ? threads : 1 );
+
+	printf( "%d errors\n", errors );
+
+	return 0 == errors ? 0 : -1;
+}
+
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spxmldiff.hpp"
+#include "spdomparser.hpp"
+#include "spxmlnode.hpp"
+
+static const char * EDIT_NAMES[] = { "insert", "delete", "replace", "change-text",
+		"add-attr", "remove-attr", "change-attr" };
+
+void printDiff( const char * title, SP_XmlDiff * diff, int ret )
+{
+	printf( "%s : %s\n", title, 0 == ret ? "equal" : ( 1 == ret ? "different" : "error" ) );
+
+	if( ret < 0 ) printf( "\t%s\n", diff->getError() );
+
+	for( int i = 0; i < diff->getEditCount(); i++ ) {
+		const SP_XmlDiffEdit * edit = diff->getEdit( i );
+		printf( "\t%-12s %s", EDIT_NAMES[ edit->getType() ], edit->getPath() );
+		if( NULL != edit->getLeft() ) printf( " [%s]", edit->getLeft() );
+		if( NULL != edit->getRight() ) printf( " -> [%s]", edit->getRight() );
+		printf( "\n" );
+	}
+}
+
+int compareStream( SP_XmlDiff * diff, const char * left, const char * right )
+{
+	return diff->compare( left, strlen( left ), right, strlen( right ) );
+}
+
+int compareDom( SP_XmlDiff * diff, const char * left, const char * right )
+{
+	SP_XmlDomParser leftParser, rightParser;
+	leftParser.append( left, strlen( left ) );
+	rightParser.append( right, strlen( right ) );
+
+	return diff->compare( leftParser.getDocument(), rightParser.getDocument() );
+}
+
+int main( int argc, char * argv[] )
+{
+	const char * oldConfig =
+		"<?xml version=\"1.0\"?>\n"
+		"<!-- pushed by rollout 12 -->\n"
+		"<config version=\"12\" env=\"prod\">\n"
+		"  <server host=\"a.example.com\" port=\"80\"/>\n"
+		"  <server host=\"b.example.com\" port=\"80\"/>\n"
+		"  <timeout>30</timeout>\n"
+		"  <feature name=\"x\"/>\n"
+		"</config>\n";
+
+	const char * sameConfig =
+		"<config env=\"prod\" version=\"12\"><!-- reordered -->\n"
+		"  <server port=\"80\" host=\"a.example.com\"></server>\n"
+		"  <server port=\"80\" host=\"b.example.com\" />\n"
+		"  <timeout><![CDATA[30]]></timeout>\n"
+		"  <feature name=\"x\"/>\n"
+		"</config>";
+
+	const char * newConfig =
+		"<config version=\"13\" env=\"prod\" owner=\"ops\">\n"
+		"  <server host=\"a.example.com\" port=\"80\"/>\n"
+		"  <server host=\"b.example.com\" port=\"8080\"/>\n"
+		"  <timeout>  45 </timeout>\n"
+		"  <limits/>\n"
+		"  <feature name=\"x\"/>\n"
+		"  <feature name=\"y\"/>\n"
+		"</config>";
+
+	SP_XmlDiff diff;
+
+	printDiff( "same, stream", &diff, compareStream( &diff, oldConfig, sameConfig ) );
+	printDiff( "same, dom", &diff, compareDom( &diff, oldConfig, sameConfig ) );
+
+	printDiff( "changed, first difference", &diff, compareStream( &diff, oldConfig, newConfig ) );
+
+	diff.setMaxEdits( 100 );
+	diff.setFoldWhitespace( 1 );
+	printDiff( "changed, stream", &diff, compareStream( &diff, oldConfig, newConfig ) );
+	printDiff( "changed, dom", &diff, compareDom( &diff, oldConfig, newConfig ) );
+
+	printDiff( "whitespace only", &diff,
+			compareStream( &diff, "<a> x  y <b/></a>", "<a>\n\tx\ny<b></b>\n</a>" ) );
+
+	printDiff( "broken", &diff, compareStream( &diff, "<a><b></a>", "<a/>" ) );
+	printDiff( "truncated", &diff, compareStream( &diff, "<a><b/>", "<a><b/>" ) );
+
+	return 0;
+}
+
@@ -27,36 +27,46 @@ int main( int argc, char * argv[] )
 		filename = argv[1];
 	}
 
-	FILE * fp = fopen ( filename, "r" );
-	if( NULL == fp ) {
-		printf( "cannot not open %s\n", filename );
-		exit( -1 );
-	}
-
-	struct stat aStat;
-	char * source = NULL;
-	stat( filename, &aStat );
-	source = ( char * ) malloc ( aStat.st_size + 1 );
-	fread ( source, aStat.st_size, sizeof ( char ), fp );
-	fclose ( fp );
-	source[ aStat.st_size ] = 0;
-
+	// a parse error is reported after the partial tree
 	SP_XmlDomParser parser;
-	parser.append( source, strlen( source ) );
-	free( source );
+	parser.parseFile( filename );
 
 	SP_XmlDomBuffer buffer( parser.getDocument() );
 	puts( buffer.getBuffer() );
 
+	// getDumpSize is the exact length of every dump
+	const char * encodings[] = { "utf-8", "iso-8859-1", "gb2312" };
+	int mismatches = 0;
+
 	SP_DomIterator iter( parser.getDocument() );
 	for( const SP_XmlNode * node = iter.getNext();
 			NULL != node;
 			node = iter.getNext() ) {
 		//printf( "=============================== %p\n", node );
-		SP_XmlDomBuffer buffer2( node );
-		//puts( buffer2.getBuffer() );
+		for( int i = 0; i < (int)( sizeof( encodings ) / sizeof( encodings[0] ) ); i++ ) {
+			for( int indent = 0; indent <= 1; indent++ ) {
+				SP_XmlDomBuffer buffer2( encodings[i], node, indent );
+				//puts( buffer2.getBuffer() );
+				if( SP_XmlDomBuffer::getDumpSize( encodings[i], node, indent ? 0 : -1 )
+						!= (int)strlen( buffer2.getBuffer() ) ) mismatches++;
+			}
+		}
 	}
 
+	// empty elements are closed by "/>", with or without indent
+	{
+		SP_XmlDomParser empty;
+		const char * xml = "<a><b/><c></c><d x=\"1\"/></a>";
+		empty.append( xml, strlen( xml ) );
+
+		SP_XmlDomBuffer buffer3( empty.getDocument()->getRootElement(), 0 );
+		if( 0 != strcmp( buffer3.getBuffer(), "<a><b/><c/><d x=\"1\"/></a>" ) ) mismatches++;
+		if( SP_XmlDomBuffer::getDumpSize( "utf-8", empty.getDocument()->getRootElement(), -1 )
+				!= buffer3.getSize() ) mismatches++;
+	}
+
+	printf( "dump size: %d mismatches\n", mismatches );
+
 	if( NULL != parser.getError() ) {
 		printf( "\n\nerror: %s\n", parser.getError() );
 	}
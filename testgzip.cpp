@@ -0,0 +1,205 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "spxmlgzip.hpp"
+#include "spxmlsink.hpp"
+#include "spxmlutils.hpp"
+#include "spxmlwriter.hpp"
+#include "spxmlparser.hpp"
+#include "spxmlevent.hpp"
+#include "spdomparser.hpp"
+#include "spxmlnode.hpp"
+
+#include "testsupport.hpp"
+
+static char gPath[] = "/tmp/testgzipXXXXXX";
+
+/* hand over a buffer a few bytes at a time, like a slow pipe */
+class PieceSource : public SP_XmlInputSource {
+public:
+	PieceSource( const char * data, int len, int pieceSize )
+		: mData( data ), mLen( len ), mPos( 0 ), mPieceSize( pieceSize ) {}
+	virtual ~PieceSource() {}
+
+	virtual int read( const char ** data ) {
+		int len = mLen - mPos < mPieceSize ? mLen - mPos : mPieceSize;
+		*data = mData + mPos;
+		mPos += len;
+		return len;
+	}
+
+private:
+	const char * mData;
+	int mLen, mPos, mPieceSize;
+};
+
+static void writeRecords( SP_XmlOutputSink * sink, int count, SP_XmlOutputSink * flushSink )
+{
+	SP_XmlWriter writer( sink );
+	writer.startDocument();
+	writer.startElement( "records" );
+	for( int i = 0; i < count; i++ ) {
+		char id[ 16 ];
+		snprintf( id, sizeof( id ), "%d", i );
+		writer.startElement( "record" );
+		writer.attribute( "id", id );
+		writer.text( "some text which compresses well" );
+		writer.endElement();
+
+		// a sync flush in the middle must not break the stream
+		if( NULL != flushSink && i == count / 2 ) flushSink->flush();
+	}
+	writer.endDocument();
+}
+
+static int testRoundTrip()
+{
+	SP_XmlStringBuffer plain;
+	{
+		SP_XmlStringSink sink( &plain );
+		writeRecords( &sink, 20000, NULL );
+	}
+
+	int fd = open( gPath, O_WRONLY | O_TRUNC );
+	{
+		SP_XmlFdSink fdSink( fd );
+		SP_XmlGzipSink sink( &fdSink );
+		writeRecords( &sink, 20000, &sink );
+		if( 0 != sink.close() ) return 1;
+	}
+	off_t size = lseek( fd, 0, SEEK_END );
+	close( fd );
+
+	// parseFile reads plain files only, the gzip source goes in between
+	SP_XmlFileSource file( gPath );
+	SP_XmlGzipSource source( &file );
+	SP_XmlPullParser pull;
+	pull.setSource( &source );
+
+	SP_XmlDomParser parser;
+	for( SP_XmlPullEvent * event = pull.getNext(); NULL != event; event = pull.getNext() ) {
+		parser.addEvent( event );
+	}
+	if( NULL != pull.getError() ) {
+		printf( "round trip: %s\n", pull.getError() );
+		return 1;
+	}
+
+	// the same tree as the plain text gives
+	SP_XmlDomParser plainParser;
+	plainParser.append( plain.getBuffer(), plain.getSize() );
+
+	SP_XmlDomBuffer dumped( parser.getDocument()->getRootElement() );
+	SP_XmlDomBuffer expected( plainParser.getDocument()->getRootElement() );
+
+	int records = parser.getDocument()->getRootElement()->getChildren()->getLength();
+	int isSame = 0 == strcmp( dumped.getBuffer(), expected.getBuffer() );
+
+	printf( "round trip: %d records, compressed %s, %s\n", records,
+			(int)size < plain.getSize() / 10 ? "< 10%" : ">= 10%", isSame ? "same" : "different" );
+
+	return 20000 == records && isSame ? 0 : 1;
+}
+
+static int testMembers()
+{
+	// two members in one file, as cat a.gz b.gz > c.gz does
+	int fd = open( gPath, O_WRONLY | O_TRUNC );
+	{
+		SP_XmlFdSink fdSink( fd );
+		SP_XmlGzipSink sink( &fdSink );
+		sink.append( "<root><a>1</a>" );
+	}
+	{
+		SP_XmlFdSink fdSink( fd );
+		SP_XmlGzipSink sink( &fdSink );
+		sink.append( "<b>2</b></root>" );
+	}
+	close( fd );
+
+	SP_XmlFileSource file( gPath );
+	SP_XmlGzipSource source( &file );
+	SP_XmlPullParser parser;
+	parser.setSource( &source );
+	int events = countEvents( &parser );
+
+	printf( "members: %d events, %s\n", events, NULL == parser.getError() ? "ok" : parser.getError() );
+
+	return 10 == events && NULL == parser.getError() ? 0 : 1;
+}
+
+static int testPieces()
+{
+	SP_XmlStringBuffer compressed;
+	{
+		SP_XmlStringSink stringSink( &compressed );
+		SP_XmlGzipSink sink( &stringSink );
+		writeRecords( &sink, 100, NULL );
+	}
+
+	SP_XmlStringBuffer plain;
+	{
+		SP_XmlStringSink sink( &plain );
+		writeRecords( &sink, 100, NULL );
+	}
+
+	int errors = 0;
+
+	// the magic split over two pieces, and the plain input passed through
+	for( int size = 1; size <= 3; size++ ) {
+		PieceSource gzipPieces( compressed.getBuffer(), compressed.getSize(), size );
+		SP_XmlGzipSource gzipSource( &gzipPieces );
+		SP_XmlPullParser gzipParser;
+		gzipParser.setSource( &gzipSource );
+
+		PieceSource plainPieces( plain.getBuffer(), plain.getSize(), size );
+		SP_XmlGzipSource plainSource( &plainPieces );
+		SP_XmlPullParser plainParser;
+		plainParser.setSource( &plainSource );
+
+		int gzipEvents = countEvents( &gzipParser ), plainEvents = countEvents( &plainParser );
+
+		printf( "pieces of %d: gzip %d, %d events, plain %d, %d events\n", size,
+				gzipSource.isCompressed(), gzipEvents, plainSource.isCompressed(), plainEvents );
+
+		if( gzipEvents != plainEvents || NULL != gzipParser.getError() ) errors++;
+	}
+
+	// a truncated file
+	PieceSource truncated( compressed.getBuffer(), compressed.getSize() - 20, 64 );
+	SP_XmlGzipSource source( &truncated );
+	SP_XmlPullParser parser;
+	parser.setSource( &source );
+	countEvents( &parser );
+
+	printf( "truncated: %s\n", NULL != parser.getError() ? "error" : "no error" );
+
+	return errors + ( NULL != parser.getError() ? 0 : 1 );
+}
+
+int main( int argc, char * argv[] )
+{
+	int fd = mkstemp( gPath );
+	if( fd < 0 ) {
+		printf( "cannot create %s\n", gPath );
+		return -1;
+	}
+	close( fd );
+
+	int errors = testRoundTrip() + testMembers() + testPieces();
+
+	unlink( gPath );
+
+	printf( "%d errors\n", errors );
+
+	return 0 == errors ? 0 : -1;
+}
+
@@ -8,10 +8,64 @@
 #include <sys/stat.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
 #include "spdomparser.hpp"
 #include "spxmlnode.hpp"
 #include "spxmlhandle.hpp"
+#include "spxmlutils.hpp"
+
+static int linearFind( SP_XmlElementNode * parent, const char * name )
+{
+	const SP_XmlNodeList * children = parent->getChildren();
+	for( int i = 0; i < children->getLength(); i++ ) {
+		SP_XmlElementNode * iter = (SP_XmlElementNode*)children->get( i );
+		if( 0 == strcmp( name, iter->getName() ) ) return 1;
+	}
+
+	return 0;
+}
+
+static int elapsed( clock_t begin )
+{
+	return (int)( ( clock() - begin ) * 1000 / CLOCKS_PER_SEC );
+}
+
+static void benchWideElement( int count )
+{
+	SP_XmlElementNode root;
+	root.setName( "root" );
+
+	char name[ 32 ] = { 0 };
+
+	for( int i = 0; i < count; i++ ) {
+		SP_XmlElementNode * child = new SP_XmlElementNode();
+		snprintf( name, sizeof( name ), "item%d", i );
+		child->setName( name );
+		root.addChild( child );
+	}
+
+	clock_t begin;
+	int found = 0;
+
+	begin = clock();
+	for( int i = 0; i < count; i++ ) {
+		snprintf( name, sizeof( name ), "item%d", i );
+		found += linearFind( &root, name );
+	}
+	printf( "linear scan: %d lookups on %d children, found %d, %d ms\n",
+			count, count, found, elapsed( begin ) );
+
+	found = 0;
+	begin = clock();
+	SP_XmlHandle rootHandle( &root );
+	for( int i = 0; i < count; i++ ) {
+		snprintf( name, sizeof( name ), "item%d", i );
+		if( NULL != rootHandle.getChild( name ).toElement() ) found++;
+	}
+	printf( "name index : %d lookups on %d children, found %d, %d ms\n",
+			count, count, found, elapsed( begin ) );
+}
 
 int main( int argc, char * argv[] )
 {
@@ -49,6 +103,8 @@ int main( int argc, char * argv[] )
 	}
 
 	printf( "\n" );
+
+	benchWideElement( 5000 );
 
 #ifdef WIN32
 	getchar();
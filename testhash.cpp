@@ -0,0 +1,110 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "spxmlhash.hpp"
+#include "spcanonxml.hpp"
+#include "spdomparser.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlparser.hpp"
+
+int main( int argc, char * argv[] )
+{
+	// the test vectors of FIPS 180-2
+	{
+		char hex[ SP_XmlSha256Sink::DIGEST_SIZE * 2 + 1 ] = { 0 };
+
+		SP_XmlSha256Sink sink;
+		sink.getHexDigest( hex );
+		printf( "sha256( \"\" ) = %s\n", hex );
+
+		sink.append( "abc" );
+		sink.getHexDigest( hex );
+		printf( "sha256( \"abc\" ) = %s\n", hex );
+
+		sink.reset();
+		sink.append( "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq" );
+		sink.getHexDigest( hex );
+		printf( "sha256( \"abcdbcde...nopq\" ) = %s\n", hex );
+	}
+
+	if( argc < 2 ) {
+		printf( "Usage: %s <xml_file>\n", argv[0] );
+		exit( -1 );
+	}
+
+	char * source = NULL;
+	int len = 0;
+	{
+		FILE * fp = fopen( argv[1], "r" );
+		if( NULL == fp ) {
+			printf( "cannot not open input file: %s\n", argv[1] );
+			exit( -1 );
+		}
+
+		struct stat aStat;
+		stat( argv[1], &aStat );
+		len = aStat.st_size;
+		source = (char*)malloc( len + 1 );
+		len = fread( source, 1, len, fp );
+		source[ len ] = '\0';
+		fclose( fp );
+	}
+
+	SP_XmlDomParser parser;
+	parser.append( source, len );
+	if( NULL != parser.getError() ) {
+		printf( "error: %s\n", parser.getError() );
+		exit( -1 );
+	}
+
+	unsigned char domDigest[ SP_XmlSha256Sink::DIGEST_SIZE ];
+	SP_XmlFingerprint::sha256( parser.getDocument(), domDigest );
+
+	SP_XmlUint64_t domHash = SP_XmlFingerprint::hash64( parser.getDocument() );
+
+	// the same fingerprints from the pull parser, fed one byte at a time
+	unsigned char streamDigest[ SP_XmlSha256Sink::DIGEST_SIZE ];
+	SP_XmlUint64_t streamHash = 0;
+	{
+		SP_XmlSha256Sink shaSink( 16 );
+		SP_CanonXmlStream shaCanon( &shaSink );
+
+		SP_XmlHash64Sink hashSink( 0, 16 );
+		SP_CanonXmlStream hashCanon( &hashSink );
+
+		for( int i = 0; i < len; i++ ) {
+			shaCanon.append( source + i, 1 );
+			hashCanon.append( source + i, 1 );
+		}
+
+		shaSink.getDigest( streamDigest );
+		streamHash = hashSink.getHash();
+	}
+
+	printf( "sha256 dom == stream : %s\n",
+			0 == memcmp( domDigest, streamDigest, sizeof( domDigest ) ) ? "yes" : "no" );
+	printf( "hash64 dom == stream : %s\n", domHash == streamHash ? "yes" : "no" );
+
+	// the cache answers again without walking the tree
+	SP_XmlFingerprintCache cache;
+	const SP_XmlNode * root = parser.getDocument()->getRootElement();
+
+	SP_XmlUint64_t first = cache.hash64( root );
+	SP_XmlUint64_t second = cache.hash64( root );
+	printf( "cache hit : %s, count %d\n", first == second ? "yes" : "no", cache.getCount() );
+
+	cache.invalidate( root );
+	printf( "after invalidate, count %d\n", cache.getCount() );
+
+	free( source );
+
+	return 0;
+}
+
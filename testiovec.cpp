@@ -0,0 +1,168 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "spxmliovec.hpp"
+#include "spdomparser.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlevent.hpp"
+#include "spxmlutils.hpp"
+
+static const char * SOURCE =
+		"<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+		"<!-- head -->\n"
+		"<a x=\"1\">\n"
+		"  <b><c>x &amp; y</c></b>\n"
+		"  <d/>\n"
+		"</a>\n";
+
+/* the bytes of the iovec list */
+static void gather( const SP_XmlIovecBuffer * out, SP_XmlStringBuffer * buffer )
+{
+	for( int i = 0; i < out->getCount(); i++ ) {
+		buffer->append( (char*)out->getIovec()[i].iov_base, out->getIovec()[i].iov_len );
+	}
+}
+
+/* the output means the same document as SP_XmlDomBuffer gives */
+static int isSameDump( const SP_XmlIovecBuffer * out, const SP_XmlDocument * doc )
+{
+	SP_XmlStringBuffer bytes;
+	gather( out, &bytes );
+
+	SP_XmlDomParser parser;
+	parser.append( bytes.getBuffer(), bytes.getSize() );
+
+	SP_XmlDomBuffer expected( doc ), actual( parser.getDocument() );
+
+	return NULL == parser.getError() && bytes.getSize() == out->getSize()
+			&& 0 == strcmp( expected.getBuffer(), actual.getBuffer() );
+}
+
+static int testClean()
+{
+	int errors = 0;
+
+	SP_XmlDomParser parser;
+	parser.append( SOURCE, strlen( SOURCE ) );
+
+	const SP_XmlElementNode * a = parser.getDocument()->getRootElement();
+	SP_XmlElementNode * b = (SP_XmlElementNode*)a->getChildren()->findElement( "b" );
+	SP_XmlElementNode * c = (SP_XmlElementNode*)b->getChildren()->findElement( "c" );
+	SP_XmlElementNode * d = (SP_XmlElementNode*)a->getChildren()->findElement( "d" );
+
+	// the source range of an element covers its start-tag to its end-tag
+	if( 0 != strncmp( SOURCE + c->getSourceOffset(), "<c>x &amp; y</c>", c->getSourceLength() )
+			|| 16 != c->getSourceLength() ) errors++;
+	if( ! a->isClean() || ! c->isClean() || ! d->isClean() ) errors++;
+
+	// a change makes the node and its ancestors dirty, not the siblings
+	c->addAttr( "y", "2" );
+	if( c->isClean() || b->isClean() || a->isClean() || ! d->isClean() ) errors++;
+
+	// a new range makes it clean again, its ancestors stay dirty
+	b->setSourceRange( b->getSourceOffset(), b->getSourceLength() );
+	if( ! b->isClean() || a->isClean() ) errors++;
+	b->setDirty();
+
+	// a clean subtree is written from the source, the rest is generated
+	SP_XmlIovecBuffer out( SOURCE, strlen( SOURCE ), parser.getDocument() );
+	if( ! isSameDump( &out, parser.getDocument() ) ) errors++;
+	if( out.getSourceSize() <= 0 || out.getSourceSize() >= out.getSize() ) errors++;
+
+	printf( "clean: %d errors\n", errors );
+
+	return errors;
+}
+
+static int testDocument()
+{
+	int errors = 0;
+
+	SP_XmlDomParser parser;
+	parser.append( SOURCE, strlen( SOURCE ) );
+
+	SP_XmlDocument * doc = (SP_XmlDocument*)parser.getDocument();
+
+	// a whole clean document is one piece of the source
+	doc->setSourceRange( 0, strlen( SOURCE ) );
+	{
+		SP_XmlIovecBuffer out( SOURCE, strlen( SOURCE ), doc );
+		if( 1 != out.getCount() || (int)strlen( SOURCE ) != out.getSourceSize() ) errors++;
+	}
+
+	// a new declaration makes the document dirty, not the old bytes
+	SP_XmlDocDeclNode * docDecl = new SP_XmlDocDeclNode();
+	docDecl->setVersion( "1.0" );
+	docDecl->setEncoding( "iso-8859-1" );
+	doc->setDocDecl( docDecl );
+	if( doc->isClean() ) errors++;
+	{
+		SP_XmlIovecBuffer out( SOURCE, strlen( SOURCE ), doc );
+		SP_XmlStringBuffer bytes;
+		gather( &out, &bytes );
+		if( NULL == strstr( bytes.getBuffer(), "iso-8859-1" ) ) errors++;
+	}
+
+	doc->setSourceRange( 0, strlen( SOURCE ) );
+	doc->setDocType( new SP_XmlDocTypeNode() );
+	if( doc->isClean() ) errors++;
+
+	printf( "document: %d errors\n", errors );
+
+	return errors;
+}
+
+static int testFile( const char * path )
+{
+	int errors = 0;
+
+	FILE * fp = fopen( path, "r" );
+	if( NULL == fp ) {
+		printf( "cannot open %s\n", path );
+		return 1;
+	}
+
+	SP_XmlStringBuffer source;
+	char buffer[ 4096 ];
+	for( int len = 0; ( len = fread( buffer, 1, sizeof( buffer ), fp ) ) > 0; ) {
+		source.append( buffer, len );
+	}
+	fclose( fp );
+
+	SP_XmlDomParser parser;
+	parser.append( source.getBuffer(), source.getSize() );
+
+	// all from the source
+	{
+		SP_XmlIovecBuffer out( source.getBuffer(), source.getSize(), parser.getDocument() );
+		if( ! isSameDump( &out, parser.getDocument() ) ) errors++;
+	}
+
+	// the root changed, its clean children are still from the source
+	SP_XmlElementNode * root = (SP_XmlElementNode*)parser.getDocument()->getRootElement();
+	root->addAttr( "changed", "1" );
+	{
+		SP_XmlIovecBuffer out( source.getBuffer(), source.getSize(), parser.getDocument() );
+		if( ! isSameDump( &out, parser.getDocument() ) ) errors++;
+	}
+
+	printf( "file: %s, %d errors\n", path, errors );
+
+	return errors;
+}
+
+int main( int argc, char * argv[] )
+{
+	int errors = testClean() + testDocument() + testFile( argc > 1 ? argv[1] : "test.xml" );
+
+	printf( "%d errors\n", errors );
+
+	return 0 == errors ? 0 : -1;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "spdomparser.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlhandle.hpp"
+#include "spxmlpath.hpp"
+#include "spxmlutils.hpp"
+#include "spcanonxml.hpp"
+
+/* readers share one document, check the read-only contract of spxmlnode.hpp */
+
+enum { THREADS = 8, ROUNDS = 20, MEMBERS = 64 };
+
+typedef struct tagSharedDoc {
+	const SP_XmlDocument * mDoc;
+	const char * mExpectDump;
+	const char * mExpectCanon;
+	pthread_barrier_t * mBarrier;
+	int mErrors;
+} SharedDoc_t;
+
+static void * reader( void * arg )
+{
+	SharedDoc_t * shared = (SharedDoc_t*)arg;
+
+	// start together, so the lazy name index is built concurrently
+	pthread_barrier_wait( shared->mBarrier );
+
+	int errors = 0;
+
+	SP_XmlHandle root( shared->mDoc->getRootElement() );
+
+	char name[ 32 ];
+	for( int i = MEMBERS - 1; i >= 0; i-- ) {
+		snprintf( name, sizeof( name ), "member%d", i );
+		SP_XmlCDataNode * text = root.getChild( "struct" ).getChild( name )
+				.getChild( "value" ).getChild( 0 ).toCData();
+		if( NULL == text || atoi( text->getText() ) != i ) errors++;
+	}
+
+	SP_XmlPath path( "/doc/struct/*[@type='odd']" );
+	SP_XmlArrayList result;
+	if( MEMBERS / 2 != path.select( shared->mDoc, &result ) ) errors++;
+
+	SP_XmlDomBuffer dump( shared->mDoc );
+	if( 0 != strcmp( dump.getBuffer(), shared->mExpectDump ) ) errors++;
+
+	SP_CanonXmlBuffer canon( shared->mDoc );
+	if( 0 != strcmp( canon.getBuffer(), shared->mExpectCanon ) ) errors++;
+
+	if( errors > 0 ) __sync_fetch_and_add( &( shared->mErrors ), errors );
+
+	return NULL;
+}
+
+int main( int argc, char * argv[] )
+{
+	SP_XmlStringBuffer source;
+	source.append( "<?xml version=\"1.0\"?><doc><struct>" );
+
+	char temp[ 128 ];
+	for( int i = 0; i < MEMBERS; i++ ) {
+		snprintf( temp, sizeof( temp ), "<member%d type=\"%s\"><value>%d</value></member%d>",
+				i, i % 2 ? "odd" : "even", i, i );
+		source.append( temp );
+	}
+	source.append( "</struct></doc>" );
+
+	int errors = 0;
+
+	for( int round = 0; round < ROUNDS; round++ ) {
+		SP_XmlDomParser parser;
+		parser.append( source.getBuffer(), source.getSize() );
+
+		if( NULL != parser.getError() ) {
+			printf( "error: %s\n", parser.getError() );
+			return -1;
+		}
+
+		// the serializers do not touch the name index
+		SP_XmlDomBuffer expectDump( parser.getDocument() );
+		SP_CanonXmlBuffer expectCanon( parser.getDocument() );
+
+		pthread_barrier_t barrier;
+		pthread_barrier_init( &barrier, NULL, THREADS );
+
+		SharedDoc_t shared;
+		shared.mDoc = parser.getDocument();
+		shared.mExpectDump = expectDump.getBuffer();
+		shared.mExpectCanon = expectCanon.getBuffer();
+		shared.mBarrier = &barrier;
+		shared.mErrors = 0;
+
+		pthread_t threads[ THREADS ];
+		for( int i = 0; i < THREADS; i++ ) {
+			pthread_create( &( threads[i] ), NULL, reader, &shared );
+		}
+		for( int i = 0; i < THREADS; i++ ) {
+			pthread_join( threads[i], NULL );
+		}
+
+		pthread_barrier_destroy( &barrier );
+
+		errors += shared.mErrors;
+	}
+
+	printf( "%d threads x %d rounds, %d errors\n", THREADS, ROUNDS, errors );
+
+	return 0 == errors ? 0 : -1;
+}
+
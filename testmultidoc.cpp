@@ -0,0 +1,342 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spxmlparser.hpp"
+#include "spdomparser.hpp"
+#include "spxmlevent.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlsource.hpp"
+#include "spxmlutils.hpp"
+
+#include "testsupport.hpp"
+
+/* messages one per line, as a log or a socket gives them,
+ * offsets[ 2 * i ] and offsets[ 2 * i + 1 ] are the range of message i */
+static void makeStream( SP_XmlStringBuffer * xml, int count, int * offsets )
+{
+	for( int i = 0; i < count; i++ ) {
+		char line[ 256 ] = { 0 };
+
+		if( 0 == i % 3 ) {
+			snprintf( line, sizeof( line ), "<?xml version=\"1.0\" encoding=\"%s\"?>\n"
+					"<msg id=\"%d\"><body>hello &amp; %d</body><![CDATA[ <raw> ]]></msg>",
+					0 == i % 2 ? "utf-8" : "iso-8859-1", i, i );
+		} else if( 1 == i % 3 ) {
+			snprintf( line, sizeof( line ), "<!-- %d --><msg id=\"%d\"><body/></msg>", i, i );
+		} else {
+			snprintf( line, sizeof( line ), "<msg id=\"%d\"/>", i );
+		}
+
+		if( NULL != offsets ) offsets[ 2 * i ] = xml->getSize();
+		xml->append( line );
+		if( NULL != offsets ) offsets[ 2 * i + 1 ] = xml->getSize();
+
+		xml->append( 0 == i % 2 ? "\n" : " \r\n\t" );
+	}
+}
+
+/* the documents of the stream, built one by one from the events */
+typedef struct tagStreamResult {
+	SP_XmlArrayList * mDocuments;
+	SP_XmlInt64_t mStarts[ 256 ];
+	SP_XmlInt64_t mEnds[ 256 ];
+	int mStartCount;
+	int mEndCount;
+} StreamResult_t;
+
+static void pullAll( SP_XmlPullParser * parser, SP_XmlDomParser * builder, StreamResult_t * result )
+{
+	for( SP_XmlPullEvent * event = parser->getNext(); NULL != event; event = parser->getNext() ) {
+		if( SP_XmlPullEvent::eStartDocument == event->getEventType() ) {
+			if( result->mStartCount < 256 ) result->mStarts[ result->mStartCount ] = event->getSourceOffset();
+			result->mStartCount++;
+		}
+
+		if( SP_XmlPullEvent::eEndDocument == event->getEventType() ) {
+			if( result->mEndCount < 256 ) result->mEnds[ result->mEndCount ] = event->getSourceOffset();
+			result->mEndCount++;
+
+			delete event;
+
+			result->mDocuments->append( builder->takeDocument() );
+		} else {
+			builder->addEvent( event );
+		}
+	}
+}
+
+static void initResult( StreamResult_t * result )
+{
+	memset( result, 0, sizeof( StreamResult_t ) );
+	result->mDocuments = new SP_XmlArrayList();
+}
+
+static void freeResult( StreamResult_t * result )
+{
+	for( int i = 0; i < result->mDocuments->getCount(); i++ ) {
+		delete (SP_XmlDocument*)result->mDocuments->getItem( i );
+	}
+
+	delete result->mDocuments;
+}
+
+static int checkResult( const char * name, const SP_XmlStringBuffer * xml,
+		const int * offsets, int count, StreamResult_t * result )
+{
+	int errors = 0;
+
+	if( count != result->mDocuments->getCount() || count != result->mStartCount
+			|| count != result->mEndCount ) errors++;
+
+	for( int i = 0; i < count && i < result->mDocuments->getCount(); i++ ) {
+		const char * message = xml->getBuffer() + offsets[ 2 * i ];
+		int len = offsets[ 2 * i + 1 ] - offsets[ 2 * i ];
+
+		SP_XmlDomParser expected;
+		expected.parse( message, len );
+
+		const SP_XmlDocument * doc = (SP_XmlDocument*)result->mDocuments->getItem( i );
+		if( ! isSame( doc, expected.getDocument() ) ) errors++;
+
+		if( result->mStarts[i] != offsets[ 2 * i ] || result->mEnds[i] != offsets[ 2 * i + 1 ] ) errors++;
+
+		// node offsets are in the whole stream
+		const SP_XmlElementNode * root = doc->getRootElement();
+		if( NULL == root || 0 != strncmp( xml->getBuffer() + root->getSourceOffset(), "<msg", 4 )
+				|| root->getSourceOffset() + root->getSourceLength() != offsets[ 2 * i + 1 ] ) errors++;
+	}
+
+	printf( "%s: %d documents, %d errors\n", name, result->mDocuments->getCount(), errors );
+
+	return errors;
+}
+
+static int testStream()
+{
+	int errors = 0;
+
+	const int COUNT = 60;
+	int offsets[ 2 * COUNT ];
+
+	SP_XmlStringBuffer xml;
+	makeStream( &xml, COUNT, offsets );
+
+	// all the input at once
+	{
+		SP_XmlPullParser parser;
+		parser.setMultiDocument( 1 );
+		SP_XmlDomParser builder;
+
+		StreamResult_t result;
+		initResult( &result );
+
+		if( xml.getSize() != parser.append( xml.getBuffer(), xml.getSize() ) ) errors++;
+		pullAll( &parser, &builder, &result );
+		if( NULL != parser.getError() ) errors++;
+
+		errors += checkResult( "append", &xml, offsets, COUNT, &result );
+		freeResult( &result );
+	}
+
+	// a byte at a time, the documents are split across appends
+	{
+		SP_XmlPullParser parser;
+		parser.setMultiDocument( 1 );
+		SP_XmlDomParser builder;
+
+		StreamResult_t result;
+		initResult( &result );
+
+		for( int i = 0; i < xml.getSize(); i++ ) {
+			parser.append( xml.getBuffer() + i, 1 );
+			pullAll( &parser, &builder, &result );
+		}
+		if( NULL != parser.getError() ) errors++;
+
+		errors += checkResult( "split", &xml, offsets, COUNT, &result );
+		freeResult( &result );
+	}
+
+	// from a source, the whitespace after the last document is no error,
+	// the parser is reused after reset, keeping the mode
+	{
+		SP_XmlPullParser parser;
+		parser.setMultiDocument( 1 );
+		SP_XmlDomParser builder;
+
+		for( int round = 0; round < 2; round++ ) {
+			StreamResult_t result;
+			initResult( &result );
+
+			SP_XmlMemorySource source( xml.getBuffer(), xml.getSize() );
+			parser.setSource( &source );
+			pullAll( &parser, &builder, &result );
+			if( NULL != parser.getError() || 1 != parser.getMultiDocument() ) errors++;
+
+			errors += checkResult( "source", &xml, offsets, COUNT, &result );
+			freeResult( &result );
+
+			parser.reset();
+		}
+	}
+
+	return errors;
+}
+
+static int countDocuments( const char * xml, int len, const char ** error )
+{
+	static char lastError[ 512 ];
+
+	SP_XmlPullParser parser;
+	parser.setMultiDocument( 1 );
+
+	SP_XmlMemorySource source( xml, len );
+	parser.setSource( &source );
+
+	int count = 0;
+	for( SP_XmlPullEvent * event = parser.getNext(); NULL != event; event = parser.getNext() ) {
+		if( SP_XmlPullEvent::eEndDocument == event->getEventType() ) count++;
+		delete event;
+	}
+
+	snprintf( lastError, sizeof( lastError ), "%s", NULL != parser.getError() ? parser.getError() : "" );
+	*error = lastError;
+
+	return count;
+}
+
+static int testErrors()
+{
+	int errors = 0;
+
+	const char * error = NULL;
+
+	// no document at all is an empty stream
+	if( 0 != countDocuments( "", 0, &error ) || '\0' != *error ) errors++;
+	if( 0 != countDocuments( " \n ", 3, &error ) || '\0' != *error ) errors++;
+
+	// the end of input inside a document
+	const char * truncated = "<a/>\n<b><c/>";
+	if( 1 != countDocuments( truncated, strlen( truncated ), &error )
+			|| NULL == strstr( error, "unexpected end of input" ) ) errors++;
+
+	const char * prolog = "<a/>\n<!-- next -->";
+	if( 1 != countDocuments( prolog, strlen( prolog ), &error )
+			|| NULL == strstr( error, "unexpected end of input" ) ) errors++;
+
+	// text between two documents
+	const char * garbage = "<a/>\nnoise<b/>";
+	if( 1 != countDocuments( garbage, strlen( garbage ), &error )
+			|| NULL == strstr( error, "text outside the root element" ) ) errors++;
+
+	// utf-8 text, a no-break space is not xml whitespace
+	const char * utf8 = "<a/>\n\xc2\xa0<b/>";
+	if( 1 != countDocuments( utf8, strlen( utf8 ), &error )
+			|| NULL == strstr( error, "text outside the root element" ) ) errors++;
+
+	// a broken document stops the stream, the ones before it are complete
+	const char * broken = "<a/><b></c><d/>";
+	if( 1 != countDocuments( broken, strlen( broken ), &error )
+			|| NULL == strstr( error, "mismatched tag" ) ) errors++;
+
+	// without the mode, a single document is unchanged
+	{
+		SP_XmlPullParser parser;
+		parser.setMultiDocument( 1 );
+		parser.setMultiDocument( 0 );
+
+		const char * single = "<a/>";
+		parser.append( single, strlen( single ) );
+
+		SP_XmlPullEvent * event = parser.getNext();
+		if( NULL == event || SP_XmlPullEvent::eStartDocument != event->getEventType() ) errors++;
+		delete event;
+	}
+
+	printf( "errors: %d errors\n", errors );
+
+	return errors;
+}
+
+static void benchmark( int count )
+{
+	int * offsets = (int*)malloc( 2 * count * sizeof( int ) );
+
+	SP_XmlStringBuffer xml;
+	makeStream( &xml, count, offsets );
+
+	int events[ 3 ] = { 0 };
+	double elapsed[ 3 ] = { 0 };
+
+	// a new parser per message, the way it was done before the mode
+	double start = now();
+	for( int i = 0; i < count; i++ ) {
+		SP_XmlPullParser parser;
+		parser.append( xml.getBuffer() + offsets[ 2 * i ], offsets[ 2 * i + 1 ] - offsets[ 2 * i ] );
+		events[0] += countEvents( &parser );
+	}
+	elapsed[0] = now() - start;
+
+	// one parser reset per message
+	start = now();
+	{
+		SP_XmlPullParser parser;
+		for( int i = 0; i < count; i++ ) {
+			parser.append( xml.getBuffer() + offsets[ 2 * i ], offsets[ 2 * i + 1 ] - offsets[ 2 * i ] );
+			events[1] += countEvents( &parser );
+			parser.reset();
+		}
+	}
+	elapsed[1] = now() - start;
+
+	// one parser over the whole stream
+	start = now();
+	{
+		SP_XmlPullParser parser;
+		parser.setMultiDocument( 1 );
+		SP_XmlMemorySource source( xml.getBuffer(), xml.getSize() );
+		parser.setSource( &source );
+		events[2] += countEvents( &parser );
+	}
+	elapsed[2] = now() - start;
+
+	printf( "bench %d messages, %d bytes: new parser %.3f s, reset %.3f s, stream %.3f s, events %d / %d / %d\n",
+			count, xml.getSize(), elapsed[0], elapsed[1], elapsed[2], events[0], events[1], events[2] );
+
+	free( offsets );
+}
+
+int main( int argc, char * argv[] )
+{
+	int benchCount = 0;
+
+	extern char *optarg ;
+	int c ;
+
+	while( ( c = getopt( argc, argv, "b:v" ) ) != EOF ) {
+		switch ( c ) {
+			case 'b' :
+				benchCount = atoi( optarg );
+				break;
+			case '?' :
+			case 'v' :
+				printf( "Usage: %s [-b <benchmark message count>]\n", argv[0] );
+				exit( 0 );
+		}
+	}
+
+	int errors = testStream() + testErrors();
+
+	if( benchCount > 0 ) benchmark( benchCount );
+
+	printf( "%d errors\n", errors );
+
+	return 0 == errors ? 0 : -1;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <locale.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include "spxmlnumber.hpp"
+#include "spdomparser.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlhandle.hpp"
+
+static void testInt64()
+{
+	const char * CASES[] = { "0", " 42 ", "+7", "-9223372036854775808", "9223372036854775807",
+			"9223372036854775808", "-9223372036854775809", "12a", "", "+", "1 2", NULL };
+
+	for( int i = 0; ; i++ ) {
+		SP_XmlInt64_t value = 0;
+		int ret = SP_XmlNumber::parseInt64( CASES[i], &value );
+		printf( "int64 <%s>: %s, %lld\n", NULL != CASES[i] ? CASES[i] : "null",
+				SP_XmlNumber::getErrorText( ret ), (long long)value );
+		if( NULL == CASES[i] ) break;
+	}
+}
+
+static void testDouble()
+{
+	const char * CASES[] = { "1.5", "-0.25e2", " 3 ", ".5", "5.", "0.1", "1e23",
+			"123456789012345678901234567890", "4.9406564584124654e-324", "1e400", "1e-400",
+			"INF", "-INF", "NaN", "1,5", "e5", "1e", "0x10", "inf", NULL };
+
+	for( int i = 0; ; i++ ) {
+		double value = 0;
+		int ret = SP_XmlNumber::parseDouble( CASES[i], &value );
+		printf( "double <%s>: %s, %.17g\n", NULL != CASES[i] ? CASES[i] : "null",
+				SP_XmlNumber::getErrorText( ret ), value );
+		if( NULL == CASES[i] ) break;
+	}
+
+	const char * BOOLS[] = { "true", " false ", "1", "0", "yes", "True", NULL };
+	for( int i = 0; ; i++ ) {
+		int value = -1;
+		int ret = SP_XmlNumber::parseBool( BOOLS[i], &value );
+		printf( "bool <%s>: %s, %d\n", NULL != BOOLS[i] ? BOOLS[i] : "null",
+				SP_XmlNumber::getErrorText( ret ), value );
+		if( NULL == BOOLS[i] ) break;
+	}
+}
+
+static double randomDouble( int kind )
+{
+	if( 0 == kind ) {
+		// any finite bits
+		for( ; ; ) {
+			unsigned long long bits = ( (unsigned long long)rand() << 42 )
+					^ ( (unsigned long long)rand() << 21 ) ^ rand();
+			double value = 0;
+			memcpy( &value, &bits, sizeof( value ) );
+			if( ! isnan( value ) && ! isinf( value ) ) return value;
+		}
+	}
+
+	// telemetry like, a few decimals
+	return ( rand() % 2000000 - 1000000 ) / pow( 10, rand() % 7 );
+}
+
+/* the result is the same bits as strtod in the C locale */
+static int testRoundTrip()
+{
+	int errors = 0;
+	char buffer[ 64 ];
+
+	for( int i = 0; i < 200000; i++ ) {
+		double value = randomDouble( i % 2 );
+		snprintf( buffer, sizeof( buffer ), 0 == i % 4 ? "%.17g" : ( 1 == i % 4 ? "%.6f" : "%g" ), value );
+
+		double expect = strtod( buffer, NULL ), parsed = 0;
+		if( SP_XmlNumber::eOK != SP_XmlNumber::parseDouble( buffer, &parsed )
+				|| 0 != memcmp( &expect, &parsed, sizeof( double ) ) ) {
+			if( errors++ < 5 ) printf( "mismatch <%s>: %.17g\n", buffer, parsed );
+		}
+	}
+
+	return errors;
+}
+
+static void testNode()
+{
+	const char * xml = "<m t=\"21.5\" n=\"-7\" on=\"true\" bad=\"7x\"> 12e-1 </m>";
+
+	SP_XmlDomParser parser;
+	parser.append( xml, strlen( xml ) );
+
+	SP_XmlElementNode * root = SP_XmlHandle( parser.getDocument()->getRootElement() ).toElement();
+
+	double t = 0, text = 0;
+	SP_XmlInt64_t n = 0, bad = 0;
+	int on = 0;
+
+	int ret = root->getAttrDouble( "t", &t ) | root->getAttrInt64( "n", &n )
+			| root->getAttrBool( "on", &on );
+	int badRet = root->getAttrInt64( "bad", &bad );
+	int missing = root->getAttrDouble( "none", &t );
+
+	SP_XmlHandle( root ).getChild( 0 ).toCData()->getTextDouble( &text );
+
+	printf( "node: %s, t %g, n %lld, on %d, bad %s, none %s, text %g\n",
+			SP_XmlNumber::getErrorText( ret ), t, (long long)n, on,
+			SP_XmlNumber::getErrorText( badRet ), SP_XmlNumber::getErrorText( missing ), text );
+}
+
+static double now()
+{
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void benchmark( int count )
+{
+	char * texts = (char*)malloc( count * 16 );
+	for( int i = 0; i < count; i++ ) {
+		snprintf( texts + i * 16, 16, "%.*f", rand() % 4, randomDouble( 1 ) );
+	}
+
+	double sum = 0, value = 0;
+
+	double start = now();
+	for( int i = 0; i < count; i++ ) {
+		SP_XmlNumber::parseDouble( texts + i * 16, &value );
+		sum += value;
+	}
+	double fast = now() - start;
+
+	start = now();
+	for( int i = 0; i < count; i++ ) sum -= strtod( texts + i * 16, NULL );
+	double slow = now() - start;
+
+	printf( "bench: %d doubles, parseDouble %.1f ns, strtod %.1f ns, diff %g\n",
+			count, fast * 1e9 / count, slow * 1e9 / count, sum );
+
+	free( texts );
+}
+
+int main( int argc, char * argv[] )
+{
+	int benchCount = 0;
+
+	extern char *optarg ;
+	int c ;
+
+	while( ( c = getopt( argc, argv, "b:v" ) ) != EOF ) {
+		switch ( c ) {
+			case 'b' :
+				benchCount = atoi( optarg );
+				break;
+			case '?' :
+			case 'v' :
+				printf( "Usage: %s [-b <benchmark count>]\n", argv[0] );
+				exit( 0 );
+		}
+	}
+
+	srand( 1 );
+
+	testInt64();
+	testDouble();
+
+	int errors = testRoundTrip();
+	printf( "round trip: %d errors\n", errors );
+
+	// the result does not change with a decimal comma locale
+	if( NULL != setlocale( LC_NUMERIC, "de_DE.UTF-8" ) || NULL != setlocale( LC_NUMERIC, "de_DE" ) ) {
+		double value = 0;
+		SP_XmlNumber::parseDouble( "123456789012345678901234.5", &value );
+		if( value != 123456789012345678901234.5 ) errors++;
+		setlocale( LC_NUMERIC, "C" );
+	}
+
+	testNode();
+
+	if( benchCount > 0 ) benchmark( benchCount );
+
+	return 0 == errors ? 0 : -1;
+}
+
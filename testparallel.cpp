@@ -0,0 +1,253 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spxmlparallel.hpp"
+#include "spxmlparser.hpp"
+#include "spdomparser.hpp"
+#include "spxmlevent.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlutils.hpp"
+
+#include "testsupport.hpp"
+
+/* the same dump, the same source ranges and clean state, node by node */
+static int compareNode( const SP_XmlNode * node, const SP_XmlNode * expected )
+{
+	if( node->getType() != expected->getType()
+			|| node->getSourceOffset() != expected->getSourceOffset()
+			|| node->getSourceLength() != expected->getSourceLength()
+			|| node->isClean() != expected->isClean() ) {
+		return 1;
+	}
+
+	if( SP_XmlNode::eELEMENT != node->getType() ) return 0;
+
+	const SP_XmlNodeList * children = ((SP_XmlElementNode*)node)->getChildren();
+	const SP_XmlNodeList * expectedChildren = ((SP_XmlElementNode*)expected)->getChildren();
+	if( children->getLength() != expectedChildren->getLength() ) return 1;
+
+	for( int i = 0; i < children->getLength(); i++ ) {
+		if( 0 != compareNode( children->get( i ), expectedChildren->get( i ) ) ) return 1;
+	}
+
+	return 0;
+}
+
+static int compareDocument( const SP_XmlDocument * doc, const SP_XmlDocument * expected )
+{
+	if( NULL == doc || NULL == doc->getRootElement() ) return 1;
+
+	if( ! isSame( doc, expected ) ) return 1;
+
+	if( doc->isClean() != expected->isClean() ) return 1;
+
+	if( doc->getChildren()->getLength() != expected->getChildren()->getLength() ) return 1;
+	for( int i = 0; i < doc->getChildren()->getLength(); i++ ) {
+		if( 0 != compareNode( doc->getChildren()->get( i ), expected->getChildren()->get( i ) ) ) return 1;
+	}
+
+	return 0;
+}
+
+static int testTree( const char * name, const char * xml, int len, int chunkSize )
+{
+	SP_XmlDomParser expected;
+	expected.append( xml, len );
+
+	int errors = 0, merges = 0, chunks = 0;
+
+	for( int threads = 1; threads <= 4; threads += 3 ) {
+		SP_XmlParallelParser parser( threads, chunkSize );
+		if( 0 != parser.parse( xml, len ) ) {
+			printf( "%s: %s\n", name, parser.getError() );
+			errors++;
+			continue;
+		}
+
+		if( 0 != compareDocument( parser.getDocument(), expected.getDocument() ) ) errors++;
+		if( 0 != strcmp( parser.getEncoding(), expected.getEncoding() ) ) errors++;
+
+		parser.getStats( &chunks, &merges );
+	}
+
+	printf( "tree %s, chunk size %d: %s chunk, %s merge, %d errors\n", name, chunkSize,
+			chunks > 1 ? "more than one" : "one", merges > 0 ? "some" : "no", errors );
+
+	return errors;
+}
+
+typedef struct tagEventList {
+	SP_XmlStringBuffer * mText;
+	int mStopAt;
+	int mCount;
+} EventList_t;
+
+static void describeEvent( SP_XmlPullEvent * event, SP_XmlStringBuffer * text )
+{
+	char line[ 128 ];
+	snprintf( line, sizeof( line ), "%d %lld %lld ", event->getEventType(),
+			event->getSourceOffset(), event->getSourceLength() );
+	text->append( line );
+	if( SP_XmlPullEvent::eStartTag == event->getEventType() ) {
+		text->append( ((SP_XmlStartTagEvent*)event)->getName() );
+	}
+	text->append( "\n" );
+}
+
+static int onEvent( void * arg, SP_XmlPullEvent * event )
+{
+	EventList_t * list = (EventList_t*)arg;
+
+	describeEvent( event, list->mText );
+	delete event;
+
+	return ++list->mCount == list->mStopAt ? -1 : 0;
+}
+
+static int testEvents( const char * xml, int len )
+{
+	SP_XmlStringBuffer expected;
+	{
+		SP_XmlPullParser parser;
+		parser.append( xml, len );
+		for( SP_XmlPullEvent * event = parser.getNext(); NULL != event; event = parser.getNext() ) {
+			describeEvent( event, &expected );
+			delete event;
+		}
+	}
+
+	int errors = 0;
+
+	SP_XmlStringBuffer text;
+	EventList_t list = { &text, -1, 0 };
+
+	SP_XmlParallelParser parser( 4, 333 );
+	parser.setEventCallback( onEvent, &list );
+	if( 0 != parser.parse( xml, len ) || NULL != parser.getDocument() ) errors++;
+	if( 0 != strcmp( text.getBuffer(), expected.getBuffer() ) ) errors++;
+
+	// the callback stops it early
+	SP_XmlStringBuffer partial;
+	EventList_t stop = { &partial, 100, 0 };
+	parser.setEventCallback( onEvent, &stop );
+	if( 0 == parser.parse( xml, len ) || NULL == parser.getError()
+			|| NULL == strstr( parser.getError(), "stopped" ) ) {
+		errors++;
+	}
+	if( 100 != stop.mCount || 0 != strncmp( partial.getBuffer(), expected.getBuffer(), partial.getSize() ) ) {
+		errors++;
+	}
+
+	printf( "events: %d errors\n", errors );
+
+	return errors;
+}
+
+static int testInvalid( const char * xml, int len )
+{
+	int errors = 0;
+
+	// a mismatched tag in the middle, and a truncated document
+	char * bad = strdup( xml );
+	char * pos = strstr( bad + len / 2, "</name>" );
+	memcpy( pos, "</nome>", 7 );
+
+	SP_XmlParallelParser parser( 4, 300 );
+	if( 0 == parser.parse( bad, len ) || NULL == strstr( parser.getError(), "mismatched tag" ) ) errors++;
+	printf( "invalid: %s\n", NULL != parser.getError() ? "mismatched tag" : "no error" );
+
+	if( 0 == parser.parse( xml, len - 40 ) || NULL == strstr( parser.getError(), "unexpected end" ) ) errors++;
+	printf( "truncated: %s\n", NULL != parser.getError() ? "unexpected end" : "no error" );
+
+	free( bad );
+
+	return errors;
+}
+
+static void benchmark( const char * path, int threads, int chunkSize )
+{
+	double start = now();
+	{
+		SP_XmlDomParser parser;
+		parser.parseFile( path );
+	}
+	double sequential = now() - start;
+
+	start = now();
+	SP_XmlParallelParser parser( threads, chunkSize );
+	parser.parseFile( path );
+	double parallel = now() - start;
+
+	int chunks = 0, merges = 0;
+	parser.getStats( &chunks, &merges );
+
+	printf( "bench: sequential %.3f s, %d threads %.3f s, %d chunks, %d merges, %s\n",
+			sequential, threads, parallel, chunks, merges,
+			NULL == parser.getError() ? "ok" : parser.getError() );
+}
+
+int main( int argc, char * argv[] )
+{
+	const char * benchPath = NULL;
+	int threads = 0, chunkSize = SP_XmlParallelParser::DEFAULT_CHUNK_SIZE;
+
+	extern char *optarg ;
+	int c ;
+
+	while( ( c = getopt( argc, argv, "b:t:s:v" ) ) != EOF ) {
+		switch ( c ) {
+			case 'b' :
+				benchPath = optarg;
+				break;
+			case 't' :
+				threads = atoi( optarg );
+				break;
+			case 's' :
+				chunkSize = atoi( optarg ) * 1024;
+				break;
+			case '?' :
+			case 'v' :
+				printf( "Usage: %s [-b <benchmark xml file>] [-t <threads>] [-s <chunk KB>]\n", argv[0] );
+				exit( 0 );
+		}
+	}
+
+	int errors = 0;
+
+	SP_XmlStringBuffer test;
+	{
+		FILE * fp = fopen( "test.xml", "r" );
+		char buffer[ 4096 ];
+		for( int len = 0; NULL != fp && ( len = fread( buffer, 1, sizeof( buffer ), fp ) ) > 0; ) {
+			test.append( buffer, len );
+		}
+		if( NULL != fp ) fclose( fp );
+	}
+
+	errors += testTree( "test.xml", test.getBuffer(), test.getSize(), 16 );
+
+	SP_XmlStringBuffer records;
+	makeRecords( &records, 3000 );
+
+	const int SIZES[] = { 1, 37, 333, 4096, 1 << 20 };
+	for( int i = 0; i < (int)( sizeof( SIZES ) / sizeof( SIZES[0] ) ); i++ ) {
+		errors += testTree( "records", records.getBuffer(), records.getSize(), SIZES[i] );
+	}
+
+	errors += testEvents( records.getBuffer(), records.getSize() );
+	errors += testInvalid( records.getBuffer(), records.getSize() );
+
+	if( NULL != benchPath ) benchmark( benchPath, threads, chunkSize );
+
+	printf( "%d errors\n", errors );
+
+	return 0 == errors ? 0 : -1;
+}
+
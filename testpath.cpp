@@ -0,0 +1,161 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spdomparser.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlpath.hpp"
+#include "spxmlutils.hpp"
+#include "spxmlevent.hpp"
+
+/* the id of an element, or the text in it, "|" after each */
+static void describe( const SP_XmlNode * node, SP_XmlStringBuffer * out )
+{
+	if( SP_XmlNode::eCDATA == node->getType() ) {
+		out->append( ((SP_XmlCDataNode*)node)->getText() );
+	} else if( SP_XmlNode::eELEMENT == node->getType() ) {
+		const SP_XmlElementNode * element = (SP_XmlElementNode*)node;
+		const SP_XmlNodeList * children = element->getChildren();
+
+		if( NULL != element->getAttrValue( "id" ) ) {
+			out->append( element->getAttrValue( "id" ) );
+		} else if( children->getLength() > 0 && SP_XmlNode::eCDATA == children->get( 0 )->getType() ) {
+			out->append( ((SP_XmlCDataNode*)children->get( 0 ))->getText() );
+		}
+	}
+
+	out->append( "|" );
+}
+
+/* expected NULL : expr is rejected */
+static int testSelect( const SP_XmlNode * context, const char * expr, const char * expected )
+{
+	SP_XmlPath path( expr );
+
+	if( NULL != path.getError() ) {
+		printf( "%s\n\terror: %s\n", expr, path.getError() );
+		return NULL == expected ? 0 : 1;
+	}
+
+	SP_XmlArrayList result;
+	path.select( context, &result );
+
+	SP_XmlStringBuffer selected;
+
+	printf( "%s\n", expr );
+	for( int i = 0; i < result.getCount(); i++ ) {
+		SP_XmlDomBuffer buffer( (SP_XmlNode*)result.getItem( i ), 0 );
+		printf( "\t%s\n", buffer.getBuffer() );
+		describe( (SP_XmlNode*)result.getItem( i ), &selected );
+	}
+
+	if( NULL == expected || 0 != strcmp( expected, selected.getBuffer() ) ) {
+		printf( "\tmismatch: %s, expected %s\n", selected.getBuffer(), NULL == expected ? "an error" : expected );
+		return 1;
+	}
+
+	return 0;
+}
+
+/* print the matches, and keep "path:id or text|" of each */
+class SP_PrintHandler : public SP_XmlPathHandler {
+public:
+	virtual ~SP_PrintHandler() {}
+
+	virtual void onMatch( int id, const SP_XmlStartTagEvent * element, const char * text )
+	{
+		const char * value = element->getAttrValue( "id" );
+		printf( "\tpath %d : <%s> id %s, text \"%s\"\n", id, element->getName(),
+				NULL == value ? "NULL" : value, text );
+
+		char match[ 256 ] = { 0 };
+		snprintf( match, sizeof( match ), "%d:%s|", id, NULL == value ? text : value );
+		mMatched.append( match );
+	}
+
+	const char * getMatched() const
+	{
+		return mMatched.getBuffer();
+	}
+
+private:
+	SP_XmlStringBuffer mMatched;
+};
+
+static int testMatcher( const char * source )
+{
+	int errors = 0;
+
+	SP_PrintHandler handler;
+	SP_XmlPathMatcher matcher( &handler );
+
+	matcher.addPath( "//book[@lang='en']/title/text()" );
+	matcher.addPath( "/catalog/*[@id]" );
+	matcher.addPath( "/catalog/book/price" );
+
+	if( matcher.addPath( "//book[1]" ) < 0 ) {
+		printf( "error: %s\n", matcher.getError() );
+	} else {
+		errors++;
+	}
+
+	printf( "stream match\n" );
+
+	// feed in small pieces, as if reading from a socket
+	int len = strlen( source );
+	for( int pos = 0; pos < len; pos += 16 ) {
+		matcher.append( source + pos, len - pos > 16 ? 16 : len - pos );
+	}
+
+	const char * expected = "0:XML Basics|2:10|1:b1|2:20|1:b2|0:DOM Trees|1:m1|";
+	if( 0 != strcmp( expected, handler.getMatched() ) ) {
+		printf( "\tmismatch: %s, expected %s\n", handler.getMatched(), expected );
+		errors++;
+	}
+
+	return errors;
+}
+
+int main( int argc, char * argv[] )
+{
+	const char * source = "<?xml version=\"1.0\"?>"
+		"<catalog>"
+			"<book id=\"b1\" lang=\"en\"><title>XML Basics</title><price>10</price></book>"
+			"<book id=\"b2\" lang=\"zh\"><title>Pull Parsing</title><price>20</price></book>"
+			"<shelf><book id=\"b3\" lang=\"en\"><title>DOM Trees</title></book></shelf>"
+			"<magazine id=\"m1\"><title>Monthly</title></magazine>"
+		"</catalog>";
+
+	SP_XmlDomParser parser;
+	parser.append( source, strlen( source ) );
+
+	if( NULL != parser.getError() ) {
+		printf( "\n\nerror: %s\n", parser.getError() );
+		return -1;
+	}
+
+	const SP_XmlDocument * doc = parser.getDocument();
+
+	int errors = 0;
+
+	errors += testSelect( doc, "/catalog/book", "b1|b2|" );
+	errors += testSelect( doc, "/catalog/book[2]/title", "Pull Parsing|" );
+	errors += testSelect( doc, "//book[@lang='en']/title/text()", "XML Basics|DOM Trees|" );
+	errors += testSelect( doc, "//title", "XML Basics|Pull Parsing|DOM Trees|Monthly|" );
+	errors += testSelect( doc, "/catalog/*[last()]", "m1|" );
+	errors += testSelect( doc, "/catalog/book[@id]", "b1|b2|" );
+	errors += testSelect( doc->getRootElement(), "shelf/book/../../magazine", "m1|" );
+	errors += testSelect( doc, "/catalog/book[", NULL );
+
+	errors += testMatcher( source );
+
+	printf( "%d errors\n", errors );
+
+	return 0 == errors ? 0 : -1;
+}
+
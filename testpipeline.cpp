@@ -0,0 +1,360 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "spxmlpipeline.hpp"
+#include "spxmlparser.hpp"
+#include "spxmlsource.hpp"
+#include "spdomparser.hpp"
+#include "spxmlevent.hpp"
+#include "spxmlnode.hpp"
+#include "spxmlutils.hpp"
+
+#include "testsupport.hpp"
+
+typedef struct tagProducerArg {
+	SP_XmlEventRing * mRing;
+	int mCount;
+	int mPushed;
+} ProducerArg_t;
+
+static void * produce( void * arg )
+{
+	ProducerArg_t * producer = (ProducerArg_t*)arg;
+
+	for( int i = 0; i < producer->mCount; i++ ) {
+		SP_XmlPullEvent * event = new SP_XmlStartDocEvent();
+		event->setSourceRange( i, 1 );
+		if( 0 != producer->mRing->push( event ) ) {
+			delete event;
+			break;
+		}
+		producer->mPushed++;
+	}
+
+	producer->mRing->close();
+
+	return NULL;
+}
+
+static int testRing()
+{
+	int errors = 0;
+
+	const int CAPACITIES[] = { 1, 2, 64, 4096 };
+	for( int i = 0; i < (int)( sizeof( CAPACITIES ) / sizeof( CAPACITIES[0] ) ); i++ ) {
+		SP_XmlEventRing ring( CAPACITIES[i] );
+		ProducerArg_t arg = { &ring, 100000, 0 };
+
+		pthread_t thread;
+		pthread_create( &thread, NULL, produce, &arg );
+
+		int count = 0;
+		for( SP_XmlPullEvent * event = ring.pop(); NULL != event; event = ring.pop() ) {
+			if( event->getSourceOffset() != count ) errors++;
+			count++;
+			delete event;
+		}
+
+		pthread_join( thread, NULL );
+
+		if( 100000 != count ) errors++;
+	}
+
+	// the consumer gives up, the producer blocked on a full ring returns
+	{
+		SP_XmlEventRing ring( 4 );
+		ProducerArg_t arg = { &ring, 100000, 0 };
+
+		pthread_t thread;
+		pthread_create( &thread, NULL, produce, &arg );
+
+		for( int i = 0; i < 10; i++ ) delete ring.pop();
+		usleep( 10000 );
+		ring.abort();
+
+		pthread_join( thread, NULL );
+
+		if( arg.mPushed >= 100000 || NULL != ring.pop() ) errors++;
+	}
+
+	printf( "ring: %d errors\n", errors );
+
+	return errors;
+}
+
+static int testParse( const char * path )
+{
+	int errors = 0;
+
+	SP_XmlStringBuffer records;
+	makeRecords( &records, 5000 );
+
+	SP_XmlDomParser expected;
+	expected.parse( records.getBuffer(), records.getSize() );
+
+	const int CAPACITIES[] = { 1, 16, 4096 };
+	for( int i = 0; i < (int)( sizeof( CAPACITIES ) / sizeof( CAPACITIES[0] ) ); i++ ) {
+		SP_XmlPipelineParser parser( CAPACITIES[i] );
+
+		// twice, the parser is reused
+		for( int round = 0; round < 2; round++ ) {
+			if( 0 != parser.parse( records.getBuffer(), records.getSize() ) ) errors++;
+			if( ! isSame( parser.getDocument(), expected.getDocument() ) ) errors++;
+			if( 0 != strcmp( parser.getEncoding(), expected.getEncoding() ) ) errors++;
+		}
+	}
+
+	SP_XmlDomParser expectedFile;
+	expectedFile.parseFile( path );
+
+	SP_XmlPipelineParser parser;
+	if( 0 != parser.parseFile( path ) ) errors++;
+	if( ! isSame( parser.getDocument(), expectedFile.getDocument() ) ) errors++;
+
+	SP_XmlDocument * doc = parser.takeDocument();
+	if( NULL == doc || NULL == doc->getRootElement() || NULL != parser.getDocument()->getRootElement() ) errors++;
+	delete doc;
+
+	printf( "parse: %s and records, %d errors\n", path, errors );
+
+	return errors;
+}
+
+static int countEvent( void * arg, SP_XmlPullEvent * event )
+{
+	int * count = (int*)arg;
+
+	delete event;
+
+	return ++( *count ) == 50 ? -1 : 0;
+}
+
+static int testErrors()
+{
+	int errors = 0;
+
+	SP_XmlStringBuffer records;
+	makeRecords( &records, 100 );
+
+	SP_XmlPipelineParser parser( 8 );
+
+	// cut inside the root element
+	if( 0 == parser.parse( records.getBuffer(), records.getSize() - 60 )
+			|| NULL == strstr( parser.getError(), "unexpected end" ) ) errors++;
+
+	const char * bad = "<a><b></c></a>";
+	if( 0 == parser.parse( bad, strlen( bad ) ) || NULL == strstr( parser.getError(), "mismatched" ) ) errors++;
+
+	if( 0 == parser.parseFile( "/nonexistent/test.xml" ) ) errors++;
+
+	// the callback stops it, the tokenizer is blocked on a full ring
+	int count = 0;
+	parser.setEventCallback( countEvent, &count );
+	if( 0 == parser.parse( records.getBuffer(), records.getSize() ) || 50 != count
+			|| NULL == strstr( parser.getError(), "stopped" ) ) errors++;
+
+	printf( "errors: %d errors\n", errors );
+
+	return errors;
+}
+
+/* one small document, then the source blocks, as a socket between requests,
+ * until the consumer has seen the whole document, or a timeout */
+class BlockingSource : public SP_XmlInputSource {
+public:
+	BlockingSource( const char * xml ) {
+		mXml = xml;
+		mReads = 0;
+		mIsReleased = mIsTimedOut = 0;
+		pthread_mutex_init( &mMutex, NULL );
+		pthread_cond_init( &mReleased, NULL );
+	}
+
+	virtual ~BlockingSource() {
+		pthread_mutex_destroy( &mMutex );
+		pthread_cond_destroy( &mReleased );
+	}
+
+	virtual int read( const char ** data ) {
+		if( 0 == mReads++ ) {
+			*data = mXml;
+			return strlen( mXml );
+		}
+
+		struct timespec deadline;
+		clock_gettime( CLOCK_REALTIME, &deadline );
+		deadline.tv_sec += 5;
+
+		pthread_mutex_lock( &mMutex );
+		for( ; ! mIsReleased && ! mIsTimedOut; ) {
+			mIsTimedOut = 0 != pthread_cond_timedwait( &mReleased, &mMutex, &deadline );
+		}
+		pthread_mutex_unlock( &mMutex );
+
+		return 0;
+	}
+
+	void release() {
+		pthread_mutex_lock( &mMutex );
+		mIsReleased = 1;
+		pthread_cond_signal( &mReleased );
+		pthread_mutex_unlock( &mMutex );
+	}
+
+	int isTimedOut() const {
+		return mIsTimedOut;
+	}
+
+private:
+	const char * mXml;
+	int mReads;
+	int mIsReleased, mIsTimedOut;
+
+	pthread_mutex_t mMutex;
+	pthread_cond_t mReleased;
+};
+
+typedef struct tagBlockedArg {
+	BlockingSource * mSource;
+	int mDepth;
+	int mCount;
+} BlockedArg_t;
+
+static int releaseAtEnd( void * arg, SP_XmlPullEvent * event )
+{
+	BlockedArg_t * blocked = (BlockedArg_t*)arg;
+
+	blocked->mCount++;
+	if( SP_XmlPullEvent::eStartTag == event->getEventType() ) blocked->mDepth++;
+	if( SP_XmlPullEvent::eEndTag == event->getEventType() && 0 == --blocked->mDepth ) {
+		blocked->mSource->release();
+	}
+
+	delete event;
+
+	return 0;
+}
+
+static int testBlocked()
+{
+	int errors = 0;
+
+	BlockingSource source( "<request><id>1</id></request>" );
+	BlockedArg_t arg = { &source, 0, 0 };
+
+	// the events are handed over while the tokenizer waits for more input
+	SP_XmlPipelineParser parser;
+	parser.setEventCallback( releaseAtEnd, &arg );
+	if( 0 != parser.parse( &source ) ) errors++;
+	if( source.isTimedOut() || 7 != arg.mCount ) errors++;
+
+	printf( "blocked: %s, %d errors\n", source.isTimedOut() ? "timed out" : "released", errors );
+
+	return errors;
+}
+
+static int gWork = 0;
+static volatile unsigned int gSink = 0;
+
+/* a handler about as costly as the tokenizer, work loops per event */
+static int handleEvent( void * arg, SP_XmlPullEvent * event )
+{
+	unsigned int hash = event->getEventType();
+	for( int i = 0; i < gWork; i++ ) hash = hash * 31 + i;
+	gSink += hash;
+
+	delete event;
+
+	return 0;
+}
+
+/* the best of two runs, a run after a big document is freed pays for
+ * the allocator refilling its heap */
+static double timeRun( const char * path, int capacity, int isPipelined, int isHandler,
+		int * tokenizerWaits, int * consumerWaits )
+{
+	double best = 0;
+
+	for( int i = 0; i < 2; i++ ) {
+		double start = now();
+
+		if( isPipelined ) {
+			SP_XmlPipelineParser parser( capacity );
+			if( isHandler ) parser.setEventCallback( handleEvent, NULL );
+			parser.parseFile( path );
+			parser.getStats( tokenizerWaits, consumerWaits );
+		} else if( isHandler ) {
+			SP_XmlPullParser parser;
+			parser.parseFile( path );
+			for( SP_XmlPullEvent * event = parser.getNext(); NULL != event; event = parser.getNext() ) {
+				handleEvent( NULL, event );
+			}
+		} else {
+			SP_XmlDomParser parser;
+			parser.parseFile( path );
+		}
+
+		double elapsed = now() - start;
+		if( 0 == i || elapsed < best ) best = elapsed;
+	}
+
+	return best;
+}
+
+static void benchmark( const char * path, int capacity )
+{
+	for( int isHandler = 0; isHandler <= 1; isHandler++ ) {
+		int tokenizerWaits = 0, consumerWaits = 0;
+
+		double sequential = timeRun( path, capacity, 0, isHandler, NULL, NULL );
+		double pipelined = timeRun( path, capacity, 1, isHandler, &tokenizerWaits, &consumerWaits );
+
+		printf( "bench %s: sequential %.3f s, pipelined %.3f s, waits %d / %d\n",
+				isHandler ? "handler" : "dom", sequential, pipelined, tokenizerWaits, consumerWaits );
+	}
+}
+
+int main( int argc, char * argv[] )
+{
+	const char * benchPath = NULL;
+	int capacity = SP_XmlEventRing::DEFAULT_CAPACITY;
+
+	extern char *optarg ;
+	int c ;
+
+	while( ( c = getopt( argc, argv, "b:c:w:v" ) ) != EOF ) {
+		switch ( c ) {
+			case 'b' :
+				benchPath = optarg;
+				break;
+			case 'c' :
+				capacity = atoi( optarg );
+				break;
+			case 'w' :
+				gWork = atoi( optarg );
+				break;
+			case '?' :
+			case 'v' :
+				printf( "Usage: %s [-b <benchmark xml file>] [-c <ring capacity>] [-w <handler loops per event>]\n", argv[0] );
+				exit( 0 );
+		}
+	}
+
+	int errors = testRing() + testParse( "test.xml" ) + testErrors() + testBlocked();
+
+	if( NULL != benchPath ) benchmark( benchPath, capacity );
+
+	printf( "%d errors\n", errors );
+
+	return 0 == errors ? 0 : -1;
+}
+
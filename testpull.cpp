@@ -12,6 +12,105 @@
 #include "spxmlevent.hpp"
 #include "spxmlutils.hpp"
 #include "spxmlcodec.hpp"
+#include "spxmlnode.hpp"
+#include "spdomparser.hpp"
+#include "spxmlsource.hpp"
+
+static const char * RECORDS = "<records><record id=\"1\"><name>a &amp; b</name>"
+		"<items><item>x</item><!-- c --><item><![CDATA[y]]></item></items></record>"
+		"<record id=\"2\"/></records>";
+
+/* pull up to the first <record>, the parser has RECORDS or a part of it */
+static SP_XmlStartTagEvent * findRecord( SP_XmlPullParser * parser )
+{
+	for( SP_XmlPullEvent * event = parser->getNext(); NULL != event; event = parser->getNext() ) {
+		if( SP_XmlPullEvent::eStartTag == event->getEventType()
+				&& 0 == strcmp( ((SP_XmlStartTagEvent*)event)->getName(), "record" ) ) {
+			return (SP_XmlStartTagEvent*)event;
+		}
+		delete event;
+	}
+
+	return NULL;
+}
+
+static int testSubtree()
+{
+	int errors = 0;
+
+	// a nested record, then the rest of the document is pulled as usual
+	SP_XmlStringBuffer expected;
+	{
+		SP_XmlPullParser parser;
+		parser.append( RECORDS, strlen( RECORDS ) );
+
+		SP_XmlElementNode * record = parser.readSubtree( findRecord( &parser ) );
+		if( NULL == record || 2 != record->getChildren()->getLength() || 1 != parser.getLevel() ) errors++;
+
+		if( NULL != record ) {
+			SP_XmlDomBuffer buffer( record, 0 );
+			expected.append( buffer.getBuffer() );
+			delete record;
+		}
+
+		SP_XmlPullEvent * event = findRecord( &parser );
+		if( NULL == event || 2 != parser.getLevel() ) errors++;
+		delete event;
+	}
+
+	if( NULL == strstr( expected.getBuffer(), "<item>y</item></items></record>" ) ) errors++;
+
+	// split across appends, a byte at a time
+	{
+		SP_XmlPullParser parser;
+
+		SP_XmlStartTagEvent * start = NULL;
+		SP_XmlElementNode * record = NULL;
+		for( int i = 0; i < (int)strlen( RECORDS ) && NULL == record; i++ ) {
+			parser.append( RECORDS + i, 1 );
+			if( NULL == start ) {
+				start = findRecord( &parser );
+				if( NULL != start ) record = parser.readSubtree( start );
+			} else {
+				record = parser.readSubtree( NULL );
+			}
+		}
+
+		if( NULL == record ) {
+			errors++;
+		} else {
+			SP_XmlDomBuffer buffer( record, 0 );
+			if( 0 != strcmp( buffer.getBuffer(), expected.getBuffer() ) ) errors++;
+			delete record;
+		}
+	}
+
+	// the input ends inside the subtree, nothing pending, not a start-tag
+	{
+		SP_XmlMemorySource source( RECORDS, 40 );
+
+		SP_XmlPullParser parser;
+		parser.setSource( &source );
+
+		if( NULL != parser.readSubtree( findRecord( &parser ) ) ) errors++;
+		if( NULL == parser.getError() || NULL == strstr( parser.getError(), "unexpected end of input" ) ) errors++;
+		if( NULL != parser.readSubtree( NULL ) ) errors++;
+	}
+
+	{
+		SP_XmlPullParser parser;
+		if( NULL != parser.readSubtree( NULL ) ) errors++;
+
+		parser.append( RECORDS, strlen( RECORDS ) );
+		SP_XmlPullEvent * event = parser.getNext();
+		if( NULL != parser.readSubtree( (SP_XmlStartTagEvent*)event ) ) errors++;
+		delete event;
+	}
+
+	printf( "readSubtree: %d errors\n", errors );
+
+	return errors;
+}
 
 int main( int argc, char * argv[] )
 {
@@ -28,25 +127,12 @@ int main( int argc, char * argv[] )
 		filename = argv[1];
 	}
 
-	FILE * fp = fopen ( filename, "r" );
-	if( NULL == fp ) {
-		printf( "cannot not open %s\n", filename );
+	SP_XmlPullParser parser;
+	if( 0 != parser.parseFile( filename ) ) {
+		printf( "%s\n", parser.getError() );
 		exit( -1 );
 	}
 
-	struct stat aStat;
-	char * source = NULL;
-	stat( filename, &aStat );
-	source = ( char * ) malloc ( aStat.st_size + 1 );
-	fread ( source, aStat.st_size, sizeof ( char ), fp );
-	fclose ( fp );
-	source[ aStat.st_size ] = '\0';
-
-	SP_XmlPullParser parser;
-	parser.append( source, strlen( source ) );
-
-	free( source );
-
 	for( SP_XmlPullEvent * event = parser.getNext();
 			NULL != event;
 			event = parser.getNext() ) {
@@ -120,10 +206,12 @@ int main( int argc, char * argv[] )
 		printf( "\n\nerror: %s\n", parser.getError() );
 	}
 
+	int errors = testSubtree();
+
 #ifdef WIN32
 	getchar();
 #endif
 
-	return 0;
+	return 0 == errors ? 0 : -1;
 }
 
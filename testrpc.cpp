@@ -9,6 +9,8 @@
 #include "spxmlutils.hpp"
 #include "spxmlnode.hpp"
 #include "spdomparser.hpp"
+#include "spxmlrpcvalue.hpp"
+#include "spxmlsink.hpp"
 
 void testReq()
 {
@@ -62,6 +64,225 @@ void testError()
 	printf( "code %d, msg %s\n", respObject.getErrorCode(), respObject.getErrorMsg() );
 }
 
+void printValue( const SP_XmlRpcValue * value, int level )
+{
+	switch( value->getType() ) {
+		case SP_XmlRpcValue::eNil:
+			printf( "nil" );
+			break;
+		case SP_XmlRpcValue::eInt:
+			printf( "%lld", (long long)value->getInt64() );
+			break;
+		case SP_XmlRpcValue::eBoolean:
+			printf( "%s", value->getBoolean() ? "true" : "false" );
+			break;
+		case SP_XmlRpcValue::eDouble:
+			printf( "%g", value->getDouble() );
+			break;
+		case SP_XmlRpcValue::eArray:
+			printf( "[" );
+			for( int i = 0; i < value->getCount(); i++ ) {
+				if( i > 0 ) printf( ", " );
+				printValue( value->getItem( i ), level + 1 );
+			}
+			printf( "]" );
+			break;
+		case SP_XmlRpcValue::eStruct:
+			printf( "{" );
+			for( int i = 0; i < value->getCount(); i++ ) {
+				const SP_XmlRpcValue * member = NULL;
+				const char * name = value->getMember( i, &member );
+				printf( "%s%s: ", i > 0 ? ", " : "", name );
+				printValue( member, level + 1 );
+			}
+			printf( "}" );
+			break;
+		default:
+			printf( "\"%s\"", value->getString() );
+			break;
+	}
+}
+
+void testDecode()
+{
+	const char * req = "<?xml version=\"1.0\"?>\n"
+			"<methodCall>\n"
+			"  <methodName>user.update</methodName>\n"
+			"  <params>\n"
+			"    <param><value><i4>41</i4></value></param>\n"
+			"    <param><value><struct>\n"
+			"      <member><name>name</name><value>  Tom &amp; Jerry </value></member>\n"
+			"      <member><name>admin</name><value><boolean>1</boolean></value></member>\n"
+			"      <member><name>score</name><value><double> 2.5 </double></value></member>\n"
+			"      <member><name>id</name><value><i8>8589934592</i8></value></member>\n"
+			"      <member><name>tags</name><value><array><data>\n"
+			"        <value><string>a</string></value><value>b</value><value><nil/></value>\n"
+			"      </data></array></value></member>\n"
+			"      <member><name>since</name><value><dateTime.iso8601>19980717T14:08:55</dateTime.iso8601></value></member>\n"
+			"    </struct></value></param>\n"
+			"  </params>\n"
+			"</methodCall>";
+
+	SP_XmlRpcDecoder decoder;
+
+	// feed it in pieces, as it comes from a socket
+	for( int i = 0, len = strlen( req ); i < len; i += 7 ) {
+		decoder.append( req + i, len - i < 7 ? len - i : 7 );
+	}
+
+	printf( "decode: done %d, error %s, method %s\n", decoder.isDone(),
+			decoder.getError() ? decoder.getError() : "none", decoder.getMethod() );
+	for( int i = 0; i < decoder.getParamCount(); i++ ) {
+		printf( "\tparam %d: ", i );
+		printValue( decoder.getParam( i ), 0 );
+		printf( "\n" );
+	}
+
+	const SP_XmlRpcValue * user = decoder.getParam( 1 );
+	printf( "\tid %lld, tags %d\n", (long long)user->getMember( "id" )->getInt64(),
+			user->getMember( "tags" )->getCount() );
+
+	// a fault, then a broken message, with the same decoder
+	SP_XmlElementNode error;
+	error.setName( "struct" );
+	SP_XmlRpcUtils::setError( &error, 4, "Too many parameters." );
+
+	SP_XmlStringBuffer buffer;
+	SP_XmlRpcUtils::toRespBuffer( "", NULL, &error, &buffer );
+
+	decoder.reset();
+	decoder.append( buffer.getBuffer(), buffer.getSize() );
+	printf( "decode: fault %d, code %d, msg %s\n", decoder.isFault(),
+			decoder.getFaultCode(), decoder.getFaultString() );
+
+	const char * bad = "<methodResponse><params><param><value><int>4x</int>"
+			"</value></param></params></methodResponse>";
+	decoder.reset();
+	decoder.append( bad, strlen( bad ) );
+	printf( "decode: error %s\n", decoder.getError() ? decoder.getError() : "none" );
+}
+
+void testEncode()
+{
+	SP_XmlStringBuffer buffer;
+
+	SP_XmlRpcEncoder encoder( &buffer );
+	encoder.startCall( "user.update" );
+	encoder.addInt( 41 );
+	encoder.startStruct();
+	encoder.member( "name" );
+	encoder.addString( "Tom & Jerry" );
+	encoder.member( "id" );
+	encoder.addInt( 8589934592LL );
+	encoder.member( "score" );
+	encoder.addDouble( 0.1 );
+	encoder.member( "tags" );
+	encoder.startArray();
+	encoder.addBoolean( 1 );
+	encoder.addNil();
+	encoder.endArray();
+	encoder.endStruct();
+	encoder.end();
+
+	printf( "encode: %s\n", buffer.getBuffer() );
+
+	// decode it and write it again, the same bytes come out
+	SP_XmlRpcDecoder decoder;
+	decoder.append( buffer.getBuffer(), buffer.getSize() );
+
+	SP_XmlStringBuffer again;
+	SP_XmlRpcEncoder reencoder( &again );
+	reencoder.startCall( decoder.getMethod() );
+	for( int i = 0; i < decoder.getParamCount(); i++ ) reencoder.addValue( decoder.getParam( i ) );
+	reencoder.end();
+
+	printf( "encode: round trip %s\n", 0 == strcmp( buffer.getBuffer(), again.getBuffer() ) ? "same" : "differ" );
+
+	SP_XmlStringBuffer fault;
+	SP_XmlStringSink sink( &fault );
+	SP_XmlRpcEncoder::writeFault( &sink, 4, "Too <many> parameters." );
+
+	decoder.reset();
+	decoder.append( fault.getBuffer(), fault.getSize() );
+	printf( "encode: fault %d, code %d, msg %s\n", decoder.isFault(),
+			decoder.getFaultCode(), decoder.getFaultString() );
+
+	SP_XmlRpcEncoder broken( &again );
+	broken.startStruct();
+	broken.addInt( 1 );
+	printf( "encode: error %s\n", broken.getError() ? broken.getError() : "none" );
+}
+
+typedef struct tagStreamSum {
+	long long mSum;
+	int mCount;
+	int mStopAt;
+} StreamSum_t;
+
+static int sumItem( void * arg, int param, int index, const char * name,
+		const SP_XmlRpcValue * value )
+{
+	StreamSum_t * sum = (StreamSum_t*)arg;
+
+	if( NULL == name ) {
+		sum->mSum += value->getMember( "id" )->getInt64();
+	} else {
+		printf( "\tparam %d, member %d, %s: ", param, index, name );
+		printValue( value, 0 );
+		printf( "\n" );
+	}
+	sum->mCount++;
+
+	return sum->mCount == sum->mStopAt ? -1 : 0;
+}
+
+void testStream()
+{
+	enum { ITEMS = 100000 };
+
+	SP_XmlStringBuffer buffer;
+	{
+		SP_XmlRpcEncoder encoder( &buffer );
+		encoder.startCall( "export" );
+		encoder.startStruct();
+		encoder.member( "table" );
+		encoder.addString( "users" );
+		encoder.member( "limit" );
+		encoder.addInt( ITEMS );
+		encoder.endStruct();
+		encoder.startArray();
+		for( int i = 0; i < ITEMS; i++ ) {
+			encoder.startStruct();
+			encoder.member( "id" );
+			encoder.addInt( i );
+			encoder.member( "name" );
+			encoder.addString( "user" );
+			encoder.endStruct();
+		}
+		encoder.endArray();
+		encoder.end();
+	}
+
+	StreamSum_t sum = { 0, 0, 0 };
+
+	SP_XmlRpcDecoder decoder;
+	decoder.setItemCallback( sumItem, &sum );
+
+	for( int i = 0; i < buffer.getSize(); i += 4096 ) {
+		decoder.append( buffer.getBuffer() + i, buffer.getSize() - i < 4096 ? buffer.getSize() - i : 4096 );
+	}
+
+	printf( "stream: done %d, error %s, params %d, items %d, sum %lld, array count %d\n",
+			decoder.isDone(), decoder.getError() ? decoder.getError() : "none",
+			decoder.getParamCount(), sum.mCount, sum.mSum, decoder.getParam( 1 )->getCount() );
+
+	sum.mCount = 0;
+	sum.mStopAt = 10;
+	decoder.reset();
+	decoder.append( buffer.getBuffer(), buffer.getSize() );
+	printf( "stream: stop at %d, error %s\n", sum.mCount, decoder.getError() );
+}
+
 int main( int argc, char * argv[] )
 {
 	testReq();
@@ -70,6 +291,12 @@ int main( int argc, char * argv[] )
 
 	testError();
 
+	testDecode();
+
+	testEncode();
+
+	testStream();
+
 	return 0;
 }
 
@@ -0,0 +1,456 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "spxmlrpcserver.hpp"
+#include "spxmlrpcvalue.hpp"
+#include "spxmlrpc.hpp"
+#include "spxmlutils.hpp"
+
+/* check the server over loopback, then measure it with keep-alive clients */
+
+static int add( void * arg, int count, const SP_XmlRpcValue ** params,
+		SP_XmlRpcEncoder * result, SP_XmlStringBuffer * fault )
+{
+	if( 2 != count ) {
+		fault->append( "math.add takes 2 params" );
+		return SP_XmlRpcUtils::eInvalidParams;
+	}
+
+	return result->addInt( params[0]->getInt64() + params[1]->getInt64() );
+}
+
+static int echo( void * arg, int count, const SP_XmlRpcValue ** params,
+		SP_XmlRpcEncoder * result, SP_XmlStringBuffer * fault )
+{
+	result->startArray();
+	for( int i = 0; i < count; i++ ) result->addValue( params[i] );
+	return result->endArray();
+}
+
+static void * serve( void * arg )
+{
+	SP_XmlRpcServer * server = (SP_XmlRpcServer*)arg;
+
+	if( 0 != server->run() ) printf( "run: %s\n", server->getError() );
+
+	return NULL;
+}
+
+typedef struct tagAddress {
+	int mPort;
+	const char * mUnixPath;
+} Address_t;
+
+static int connectTo( const Address_t * address )
+{
+	int fd = -1;
+
+	if( NULL != address->mUnixPath ) {
+		struct sockaddr_un addr;
+		memset( &addr, 0, sizeof( addr ) );
+		addr.sun_family = AF_UNIX;
+		strncpy( addr.sun_path, address->mUnixPath, sizeof( addr.sun_path ) - 1 );
+
+		fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+		if( 0 != connect( fd, (struct sockaddr*)&addr, sizeof( addr ) ) ) {
+			close( fd );
+			return -1;
+		}
+	} else {
+		struct sockaddr_in addr;
+		memset( &addr, 0, sizeof( addr ) );
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons( address->mPort );
+		addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+		fd = socket( AF_INET, SOCK_STREAM, 0 );
+		if( 0 != connect( fd, (struct sockaddr*)&addr, sizeof( addr ) ) ) {
+			close( fd );
+			return -1;
+		}
+
+		int on = 1;
+		setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( on ) );
+	}
+
+	return fd;
+}
+
+static int sendAll( int fd, const char * data, int len )
+{
+	for( int pos = 0; pos < len; ) {
+		int ret = send( fd, data + pos, len - pos, MSG_NOSIGNAL );
+		if( ret <= 0 ) return -1;
+		pos += ret;
+	}
+
+	return 0;
+}
+
+static void toRequest( const char * body, const char * extraHeader, SP_XmlStringBuffer * request )
+{
+	char header[ 256 ] = { 0 };
+	snprintf( header, sizeof( header ), "POST /RPC2 HTTP/1.1\r\nHost: localhost\r\n"
+			"Content-Type: text/xml\r\nContent-Length: %d\r\n%s\r\n",
+			(int)strlen( body ), extraHeader );
+
+	request->append( header );
+	request->append( body );
+}
+
+/* read one response into the buffer, which keeps the bytes after it */
+static int readResponse( int fd, SP_XmlStringBuffer * input, SP_XmlStringBuffer * body )
+{
+	char buffer[ 4096 ];
+
+	for( ; ; ) {
+		const char * end = strstr( input->getBuffer(), "\r\n\r\n" );
+		if( NULL != end ) {
+			int status = atoi( input->getBuffer() + 9 );
+			const char * length = strstr( input->getBuffer(), "Content-Length: " );
+			int bodySize = NULL != length && length < end ? atoi( length + 16 ) : 0;
+
+			int headerSize = end + 4 - input->getBuffer();
+			if( input->getSize() >= headerSize + bodySize ) {
+				if( body->getSize() > 0 ) body->clean();
+				body->append( input->getBuffer() + headerSize, bodySize );
+
+				int rest = input->getSize() - headerSize - bodySize;
+				char * tail = strdup( input->getBuffer() + headerSize + bodySize );
+				if( input->getSize() > 0 ) input->clean();
+				input->append( tail, rest );
+				free( tail );
+
+				return status;
+			}
+		}
+
+		int len = recv( fd, buffer, sizeof( buffer ), 0 );
+		if( len <= 0 ) return -1;
+		input->append( buffer, len );
+	}
+}
+
+static const char * ADD_CALL = "<?xml version=\"1.0\"?><methodCall><methodName>math.add</methodName>"
+		"<params><param><value><int>%d</int></value></param>"
+		"<param><value><int>%d</int></value></param></params></methodCall>";
+
+static void testFunction( const Address_t * address )
+{
+	int fd = connectTo( address );
+
+	SP_XmlStringBuffer request, input, body;
+	SP_XmlRpcDecoder decoder;
+
+	// two calls in one write, the answers come back in order
+	char call[ 512 ] = { 0 };
+	snprintf( call, sizeof( call ), ADD_CALL, 40, 2 );
+	toRequest( call, "", &request );
+	toRequest( "<methodCall><methodName>no.such</methodName></methodCall>", "", &request );
+	sendAll( fd, request.getBuffer(), request.getSize() );
+
+	int status = readResponse( fd, &input, &body );
+	decoder.append( body.getBuffer(), body.getSize() );
+	printf( "call: status %d, result %d\n", status,
+			decoder.getParamCount() > 0 ? decoder.getParam( 0 )->getInt() : -1 );
+
+	status = readResponse( fd, &input, &body );
+	decoder.reset();
+	decoder.append( body.getBuffer(), body.getSize() );
+	printf( "unknown: status %d, fault %d, code %d, msg %s\n", status,
+			decoder.isFault(), decoder.getFaultCode(), decoder.getFaultString() );
+
+	// the sub-calls run on the worker pool
+	const char * multi = "<methodCall><methodName>system.multicall</methodName><params>"
+			"<param><value><array><data>"
+			"<value><struct><member><name>methodName</name><value>math.add</value></member>"
+			"<member><name>params</name><value><array><data><value><int>1</int></value>"
+			"<value><int>2</int></value></data></array></value></member></struct></value>"
+			"<value><struct><member><name>methodName</name><value>echo</value></member>"
+			"<member><name>params</name><value><array><data><value>x &amp; y</value>"
+			"<value><boolean>1</boolean></value></data></array></value></member></struct></value>"
+			"<value><struct><member><name>methodName</name><value>math.add</value></member>"
+			"</struct></value>"
+			"<value><struct><member><name>methodName</name><value>system.multicall</value></member>"
+			"</struct></value>"
+			"</data></array></value></param></params></methodCall>";
+
+	request.clean();
+	toRequest( multi, "", &request );
+	sendAll( fd, request.getBuffer(), request.getSize() );
+
+	status = readResponse( fd, &input, &body );
+	decoder.reset();
+	decoder.append( body.getBuffer(), body.getSize() );
+
+	const SP_XmlRpcValue * results = decoder.getParamCount() > 0 ? decoder.getParam( 0 ) : NULL;
+	printf( "multicall: status %d, count %d\n", status, NULL != results ? results->getCount() : -1 );
+	for( int i = 0; NULL != results && i < results->getCount(); i++ ) {
+		const SP_XmlRpcValue * item = results->getItem( i );
+		if( SP_XmlRpcValue::eArray == item->getType() ) {
+			const SP_XmlRpcValue * value = item->getItem( 0 );
+			if( SP_XmlRpcValue::eArray == value->getType() ) {
+				printf( "\t%d: [%s, %d]\n", i, value->getItem( 0 )->getString(),
+						value->getItem( 1 )->getBoolean() );
+			} else {
+				printf( "\t%d: %d\n", i, value->getInt() );
+			}
+		} else {
+			printf( "\t%d: fault %d, %s\n", i, item->getMember( "faultCode" )->getInt(),
+					item->getMember( "faultString" )->getString() );
+		}
+	}
+
+	request.clean();
+	snprintf( call, sizeof( call ), "GET / HTTP/1.1\r\n\r\n" );
+	sendAll( fd, call, strlen( call ) );
+	status = readResponse( fd, &input, &body );
+	printf( "get: status %d, closed %d\n", status, -1 == readResponse( fd, &input, &body ) );
+
+	close( fd );
+
+	// only plain digits are a length, a huge one is too large, not garbage
+	const char * LENGTHS[] = { "12abc", "-5", "+12", "", "99999999999999999999", "4294967296" };
+	printf( "length:" );
+	for( int i = 0; i < (int)( sizeof( LENGTHS ) / sizeof( LENGTHS[0] ) ); i++ ) {
+		fd = connectTo( address );
+		snprintf( call, sizeof( call ), "POST /RPC2 HTTP/1.1\r\nContent-Length: %s\r\n\r\n", LENGTHS[i] );
+		sendAll( fd, call, strlen( call ) );
+		printf( " %d", readResponse( fd, &input, &body ) );
+		close( fd );
+	}
+	printf( "\n" );
+}
+
+typedef struct tagPipeline {
+	int mFd;
+	SP_XmlStringBuffer * mRequests;
+} Pipeline_t;
+
+static void * sendPipeline( void * arg )
+{
+	Pipeline_t * pipeline = (Pipeline_t*)arg;
+
+	sendAll( pipeline->mFd, pipeline->mRequests->getBuffer(), pipeline->mRequests->getSize() );
+
+	return NULL;
+}
+
+/* many big answers pipelined before reading any, more than the server keeps */
+static void testPipeline( const Address_t * address )
+{
+	const int COUNT = 64, SIZE = 256 * 1024;
+
+	int fd = connectTo( address );
+
+	SP_XmlStringBuffer call, requests, input, body;
+	call.append( "<?xml version=\"1.0\"?><methodCall><methodName>echo</methodName>"
+			"<params><param><value><string>" );
+	for( int i = 0; i < SIZE; i++ ) call.append( 'a' + i % 26 );
+	call.append( "</string></value></param></params></methodCall>" );
+
+	for( int i = 0; i < COUNT; i++ ) toRequest( call.getBuffer(), "", &requests );
+
+	// the server stops reading, the sender blocks until the answers are read
+	Pipeline_t pipeline = { fd, &requests };
+	pthread_t thread;
+	pthread_create( &thread, NULL, sendPipeline, &pipeline );
+	usleep( 200 * 1000 );
+
+	int errors = 0;
+	SP_XmlRpcDecoder decoder;
+	for( int i = 0; i < COUNT; i++ ) {
+		int status = readResponse( fd, &input, &body );
+
+		decoder.reset();
+		if( 200 == status ) decoder.append( body.getBuffer(), body.getSize() );
+		const SP_XmlRpcValue * result = decoder.getParamCount() > 0 ? decoder.getParam( 0 ) : NULL;
+		if( 200 != status || NULL == result || 1 != result->getCount()
+				|| SIZE != result->getItem( 0 )->getCount() ) {
+			errors++;
+			if( status < 0 ) break;
+		}
+	}
+
+	pthread_join( thread, NULL );
+	close( fd );
+
+	printf( "pipeline: %d requests, %d errors\n", COUNT, errors );
+}
+
+typedef struct tagClient {
+	const Address_t * mAddress;
+	int mRequests;
+	double * mLatency;
+	int mErrors;
+} Client_t;
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void * runClient( void * arg )
+{
+	Client_t * client = (Client_t*)arg;
+
+	int fd = connectTo( client->mAddress );
+	if( fd < 0 ) {
+		client->mErrors = client->mRequests;
+		return NULL;
+	}
+
+	SP_XmlStringBuffer request, input, body;
+	SP_XmlRpcDecoder decoder;
+	char call[ 512 ] = { 0 };
+
+	for( int i = 0; i < client->mRequests; i++ ) {
+		snprintf( call, sizeof( call ), ADD_CALL, i, 1 );
+		if( request.getSize() > 0 ) request.clean();
+		toRequest( call, "", &request );
+
+		double start = now();
+		int status = -1;
+		if( 0 == sendAll( fd, request.getBuffer(), request.getSize() ) ) {
+			status = readResponse( fd, &input, &body );
+		}
+		client->mLatency[ i ] = now() - start;
+
+		decoder.reset();
+		if( 200 == status ) decoder.append( body.getBuffer(), body.getSize() );
+		if( 200 != status || 1 != decoder.getParamCount()
+				|| i + 1 != decoder.getParam( 0 )->getInt() ) {
+			client->mErrors++;
+			if( status < 0 ) break;
+		}
+	}
+
+	close( fd );
+
+	return NULL;
+}
+
+static int cmpDouble( const void * a, const void * b )
+{
+	double x = *(double*)a, y = *(double*)b;
+
+	return x < y ? -1 : ( x > y ? 1 : 0 );
+}
+
+static int testLoad( const Address_t * address, int clients, int requests )
+{
+	Client_t * client = (Client_t*)calloc( clients, sizeof( Client_t ) );
+	pthread_t * threads = (pthread_t*)calloc( clients, sizeof( pthread_t ) );
+	double * latency = (double*)calloc( clients * requests, sizeof( double ) );
+
+	double start = now();
+
+	for( int i = 0; i < clients; i++ ) {
+		client[i].mAddress = address;
+		client[i].mRequests = requests;
+		client[i].mLatency = latency + i * requests;
+		pthread_create( threads + i, NULL, runClient, client + i );
+	}
+
+	int errors = 0;
+	for( int i = 0; i < clients; i++ ) {
+		pthread_join( threads[i], NULL );
+		errors += client[i].mErrors;
+	}
+
+	double elapsed = now() - start;
+	int total = clients * requests;
+
+	qsort( latency, total, sizeof( double ), cmpDouble );
+
+	printf( "load: %d clients x %d requests, %d errors, %.0f req/s\n",
+			clients, requests, errors, total / elapsed );
+	printf( "\tlatency us: p50 %.0f, p99 %.0f, p99.9 %.0f, max %.0f\n",
+			latency[ total / 2 ] * 1e6, latency[ total * 99 / 100 ] * 1e6,
+			latency[ total * 999 / 1000 ] * 1e6, latency[ total - 1 ] * 1e6 );
+
+	free( client );
+	free( threads );
+	free( latency );
+
+	return errors;
+}
+
+int main( int argc, char * argv[] )
+{
+	int clients = 4, requests = 2000, workers = 4;
+	const char * unixPath = NULL;
+
+	extern char *optarg ;
+	int c ;
+
+	while( ( c = getopt( argc, argv, "c:n:w:u:v" ) ) != EOF ) {
+		switch ( c ) {
+			case 'c' :
+				clients = atoi( optarg );
+				break;
+			case 'n' :
+				requests = atoi( optarg );
+				break;
+			case 'w' :
+				workers = atoi( optarg );
+				break;
+			case 'u' :
+				unixPath = optarg;
+				break;
+			case '?' :
+			case 'v' :
+				printf( "Usage: %s [-c <clients>] [-n <requests per client>] "
+						"[-w <workers>] [-u <unix socket>]\n", argv[0] );
+				exit( 0 );
+		}
+	}
+
+	if( clients < 1 ) clients = 1;
+	if( requests < 1 ) requests = 1;
+
+	SP_XmlRpcServer server( workers );
+	server.addMethod( "math.add", add, NULL );
+	server.addMethod( "echo", echo, NULL );
+
+	char listen[ 256 ] = { 0 };
+	snprintf( listen, sizeof( listen ), NULL != unixPath ? "unix:%s" : "127.0.0.1:0", unixPath );
+	if( 0 != server.listen( listen ) ) {
+		printf( "listen: %s\n", server.getError() );
+		return -1;
+	}
+
+	Address_t address = { server.getPort(), unixPath };
+
+	pthread_t thread;
+	pthread_create( &thread, NULL, serve, &server );
+
+	testFunction( &address );
+	testPipeline( &address );
+
+	int errors = testLoad( &address, clients, requests );
+
+	server.shutdown();
+	pthread_join( thread, NULL );
+
+	return 0 == errors ? 0 : -1;
+}
+
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "spxmlsource.hpp"
+#include "spxmlgzip.hpp"
+#include "spxmlutils.hpp"
+#include "spxmlparser.hpp"
+#include "spxmlevent.hpp"
+
+#include "testsupport.hpp"
+
+/* a few pieces, then a failure */
+class FailingSource : public SP_XmlInputSource {
+public:
+	FailingSource( int pieces ) : mPieces( pieces ) {}
+	virtual ~FailingSource() {}
+
+	virtual int read( const char ** data ) {
+		if( mPieces-- <= 0 ) {
+			mError = EIO;
+			return -1;
+		}
+		*data = "<a>";
+		return 3;
+	}
+
+private:
+	int mPieces;
+};
+
+/* a slow disk, a fixed latency for each read */
+class SlowSource : public SP_XmlInputSource {
+public:
+	SlowSource( SP_XmlInputSource * source, int latency ) : mSource( source ), mLatency( latency ) {}
+	virtual ~SlowSource() { delete mSource; }
+
+	virtual int read( const char ** data ) {
+		if( mLatency > 0 ) usleep( mLatency * 1000 );
+		return mSource->read( data );
+	}
+
+private:
+	SP_XmlInputSource * mSource;
+	int mLatency;
+};
+
+static void readAll( SP_XmlInputSource * source, SP_XmlStringBuffer * buffer )
+{
+	const char * data = NULL;
+	for( int len = source->read( &data ); len > 0; len = source->read( &data ) ) {
+		buffer->append( data, len );
+	}
+}
+
+typedef struct tagPipeArg {
+	int mFd;
+	const SP_XmlStringBuffer * mBuffer;
+	int mTimes;
+} PipeArg_t;
+
+static void * writePipe( void * arg )
+{
+	PipeArg_t * pipeArg = (PipeArg_t*)arg;
+
+	for( int i = 0; i < pipeArg->mTimes; i++ ) {
+		const char * pos = pipeArg->mBuffer->getBuffer();
+		for( int len = pipeArg->mBuffer->getSize(); len > 0; ) {
+			int ret = write( pipeArg->mFd, pos, len );
+			if( ret <= 0 ) break;
+			pos += ret;
+			len -= ret;
+		}
+	}
+
+	close( pipeArg->mFd );
+
+	return NULL;
+}
+
+static int testBuffers( const char * path )
+{
+	SP_XmlStringBuffer expected;
+	{
+		SP_XmlFileSource source( path );
+		readAll( &source, &expected );
+	}
+
+	int errors = 0;
+
+	const int SIZES[][ 2 ] = { { 2, 1 }, { 2, 7 }, { 4, 4096 }, { 3, 65536 } };
+	for( int i = 0; i < (int)( sizeof( SIZES ) / sizeof( SIZES[0] ) ); i++ ) {
+		SP_XmlFileSource file( path );
+		SP_XmlReadAheadSource source( &file, 0, SIZES[i][0], SIZES[i][1] );
+
+		SP_XmlStringBuffer buffer;
+		readAll( &source, &buffer );
+
+		if( buffer.getSize() != expected.getSize()
+				|| 0 != memcmp( buffer.getBuffer(), expected.getBuffer(), expected.getSize() ) ) {
+			errors++;
+		}
+	}
+
+	// a pipe, not mapped, read ahead of a slower writer
+	int fds[ 2 ];
+	if( 0 != pipe( fds ) ) return errors + 1;
+
+	PipeArg_t arg = { fds[1], &expected, 50 };
+	pthread_t thread;
+	pthread_create( &thread, NULL, writePipe, &arg );
+
+	SP_XmlFileSource file( fds[0] );
+	SP_XmlReadAheadSource source( &file, 0, 3, 1000 );
+
+	SP_XmlStringBuffer buffer;
+	readAll( &source, &buffer );
+
+	pthread_join( thread, NULL );
+	close( fds[0] );
+
+	if( buffer.getSize() != 50 * expected.getSize() ) errors++;
+	for( int i = 0; i < 50 && 0 == errors; i++ ) {
+		if( 0 != memcmp( buffer.getBuffer() + i * expected.getSize(),
+				expected.getBuffer(), expected.getSize() ) ) errors++;
+	}
+
+	printf( "buffers: %s, pipe mapped %d, %d errors\n", path, file.isMapped(), errors );
+
+	return errors;
+}
+
+static int testErrors( const char * path )
+{
+	int errors = 0;
+
+	// the data read before the failure comes first, then the error
+	{
+		FailingSource failing( 5 );
+		SP_XmlReadAheadSource source( &failing, 0, 2, 4 );
+
+		SP_XmlStringBuffer buffer;
+		readAll( &source, &buffer );
+
+		const char * data = NULL;
+		if( 15 != buffer.getSize() || -1 != source.read( &data ) || EIO != source.getError() ) errors++;
+	}
+
+	// a bad descriptor or a missing file is an error of its own, not 0
+	{
+		SP_XmlFileSource badFd( -1 ), missing( "/nonexistent/test.xml" );
+
+		const char * data = NULL;
+		if( -1 != badFd.read( &data ) || EBADF != badFd.getError() ) errors++;
+		if( -1 != missing.read( &data ) || ENOENT != missing.getError() ) errors++;
+	}
+
+	// stop early, the reader thread is blocked on a full ring
+	{
+		SP_XmlReadAheadSource source( new SP_XmlFileSource( path ), 1, 2, 16 );
+
+		const char * data = NULL;
+		if( source.read( &data ) <= 0 ) errors++;
+		usleep( 10000 );
+	}
+
+	// the parser sees the failure
+	{
+		SP_XmlPullParser parser;
+		SP_XmlReadAheadSource source( new FailingSource( 2 ), 1 );
+		parser.setSource( &source );
+		countEvents( &parser );
+
+		if( NULL == parser.getError() || NULL == strstr( parser.getError(), "read error" ) ) errors++;
+	}
+
+	printf( "errors: %d errors\n", errors );
+
+	return errors;
+}
+
+static int testParser( const char * path )
+{
+	SP_XmlPullParser direct;
+	direct.parseFile( path );
+	int directEvents = countEvents( &direct );
+
+	SP_XmlPullParser parser;
+	SP_XmlReadAheadSource source( new SP_XmlGzipSource( new SP_XmlFileSource( path ), 1 ), 1, 2, 64 );
+	parser.setSource( &source );
+	int events = countEvents( &parser );
+
+	printf( "parser: %d events, %s\n", events, directEvents == events ? "same" : "different" );
+
+	return directEvents == events && NULL == parser.getError() ? 0 : 1;
+}
+
+static void benchmark( const char * path, int bufferCount, int bufferSize, int latency )
+{
+	for( int readAhead = 0; readAhead <= 1; readAhead++ ) {
+		SP_XmlInputSource * file = new SlowSource( new SP_XmlFileSource( path ), latency );
+		SP_XmlInputSource * gzip = new SP_XmlGzipSource( file, 1 );
+		SP_XmlReadAheadSource * ahead = readAhead ?
+				new SP_XmlReadAheadSource( gzip, 1, bufferCount, bufferSize ) : NULL;
+
+		SP_XmlPullParser parser;
+		parser.setSource( readAhead ? ahead : gzip );
+
+		double start = now();
+		int events = countEvents( &parser );
+		double elapsed = now() - start;
+
+		int readerWaits = 0, parserWaits = 0;
+		if( NULL != ahead ) ahead->getStats( &readerWaits, &parserWaits );
+
+		printf( "bench %s: %d events, %.3f s, reader waits %d, parser waits %d\n",
+				readAhead ? "read ahead" : "direct", events, elapsed, readerWaits, parserWaits );
+
+		if( NULL != ahead ) {
+			delete ahead;
+		} else {
+			delete gzip;
+		}
+	}
+}
+
+int main( int argc, char * argv[] )
+{
+	const char * benchPath = NULL;
+	int bufferCount = SP_XmlReadAheadSource::DEFAULT_BUFFER_COUNT;
+	int bufferSize = SP_XmlReadAheadSource::DEFAULT_BUFFER_SIZE;
+	int latency = 0;
+
+	extern char *optarg ;
+	int c ;
+
+	while( ( c = getopt( argc, argv, "b:c:s:l:v" ) ) != EOF ) {
+		switch ( c ) {
+			case 'b' :
+				benchPath = optarg;
+				break;
+			case 'c' :
+				bufferCount = atoi( optarg );
+				break;
+			case 's' :
+				bufferSize = atoi( optarg ) * 1024;
+				break;
+			case 'l' :
+				latency = atoi( optarg );
+				break;
+			case '?' :
+			case 'v' :
+				printf( "Usage: %s [-b <benchmark xml file>] [-c <buffer count>] [-s <buffer KB>] [-l <ms for each read>]\n", argv[0] );
+				exit( 0 );
+		}
+	}
+
+	const char * path = "test.xml";
+
+	int errors = testBuffers( path ) + testErrors( path ) + testParser( path );
+
+	if( NULL != benchPath ) benchmark( benchPath, bufferCount, bufferSize, latency );
+
+	return 0 == errors ? 0 : -1;
+}
+
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "testsupport.hpp"
+
+#include "spxmlparser.hpp"
+#include "spxmlevent.hpp"
+#include "spxmlnode.hpp"
+#include "spdomparser.hpp"
+#include "spxmlutils.hpp"
+
+double now()
+{
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int countEvents( SP_XmlPullParser * parser )
+{
+	int count = 0;
+	for( SP_XmlPullEvent * event = parser->getNext(); NULL != event; event = parser->getNext() ) {
+		count++;
+		delete event;
+	}
+
+	return count;
+}
+
+int isSame( const SP_XmlDocument * doc, const SP_XmlDocument * expected )
+{
+	if( NULL == doc || NULL == expected ) return doc == expected;
+
+	SP_XmlDomBuffer buffer( doc ), expectedBuffer( expected );
+
+	return 0 == strcmp( buffer.getBuffer(), expectedBuffer.getBuffer() );
+}
+
+void makeRecords( SP_XmlStringBuffer * xml, int count )
+{
+	xml->append( "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+			"<!DOCTYPE records [ <!ELEMENT record ANY> ]>\n"
+			"<!-- <record id=\"head\"> -->\n"
+			"<records version=\"1 > 0\">\n" );
+
+	for( int i = 0; i < count; i++ ) {
+		char line[ 512 ];
+		switch( i % 6 ) {
+			case 0:
+				snprintf( line, sizeof( line ), "  <record id=\"%d\"><name>item &amp; %d</name></record>\n", i, i );
+				break;
+			case 1:
+				snprintf( line, sizeof( line ), "  <record id=\"%d\"><!-- <record id=\"fake\"> --></record>\n", i );
+				break;
+			case 2:
+				snprintf( line, sizeof( line ), "  <record id=\"%d\"><![CDATA[ <record> </record> ]]></record>\n", i );
+				break;
+			case 3:
+				snprintf( line, sizeof( line ), "  <record id=\"%d\" cmp=\"a > b\"><record id=\"nested\">"
+						"<record/></record></record>\n", i );
+				break;
+			case 4:
+				snprintf( line, sizeof( line ), "  <?pi record ?><record id=\"%d\"/>\n", i );
+				break;
+			default:
+				snprintf( line, sizeof( line ), "  <recordSet id=\"%d\">text</recordSet>\n", i );
+				break;
+		}
+		xml->append( line );
+	}
+
+	xml->append( "</records>\n<!-- tail <record> -->\n<?done?>\n" );
+}
+
@@ -0,0 +1,31 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#ifndef __testsupport_hpp__
+#define __testsupport_hpp__
+
+class SP_XmlPullParser;
+class SP_XmlDocument;
+class SP_XmlStringBuffer;
+
+/* helpers shared by the test programs, not a part of libspxml */
+
+/// the wall clock in seconds, for the benchmarks
+double now();
+
+/// pull the events left in the parser and delete them
+/// @return how many events
+int countEvents( SP_XmlPullParser * parser );
+
+/// both are NULL, or their dumps are the same
+int isSame( const SP_XmlDocument * doc, const SP_XmlDocument * expected );
+
+/// <records><record>...</record>...</records>, with the traps of a guessed
+/// record boundary : a record name in comments, CDATA, PIs and nested
+/// records, '>' in attribute values
+void makeRecords( SP_XmlStringBuffer * xml, int count );
+
+#endif
+
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2010 Stephen Liu
+ * For license terms, see the file COPYING along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spxmlwriter.hpp"
+#include "spxmlsink.hpp"
+#include "spxmlutils.hpp"
+#include "spdomparser.hpp"
+#include "spxmlnode.hpp"
+
+void writeFault( SP_XmlWriter * writer, int code, const char * msg )
+{
+	char strCode[ 32 ] = { 0 };
+	snprintf( strCode, sizeof( strCode ), "%d", code );
+
+	writer->startDocument();
+	writer->startElement( "methodResponse" );
+	writer->startElement( "fault" );
+	writer->startElement( "value" );
+	writer->startElement( "struct" );
+
+	writer->startElement( "member" );
+	writer->element( "name", "faultCode" );
+	writer->startElement( "value" );
+	writer->element( "int", strCode );
+	writer->endElement();
+	writer->endElement();
+
+	writer->startElement( "member" );
+	writer->element( "name", "faultString" );
+	writer->startElement( "value" );
+	writer->element( "string", msg );
+	writer->endElement();
+	writer->endElement();
+
+	writer->endDocument();
+}
+
+int main( int argc, char * argv[] )
+{
+	// write to a string buffer, then parse it back
+	SP_XmlStringBuffer buffer;
+	{
+		SP_XmlWriter writer( &buffer );
+		writeFault( &writer, 4, "Too many <parameters> & \"quotes\"" );
+		if( NULL != writer.getError() ) printf( "error: %s\n", writer.getError() );
+	}
+
+	printf( "%s\n\n", buffer.getBuffer() );
+
+	SP_XmlDomParser parser;
+	parser.append( buffer.getBuffer(), buffer.getSize() );
+	if( NULL != parser.getError() ) {
+		printf( "parse error: %s\n", parser.getError() );
+	} else {
+		SP_XmlDomBuffer dump( parser.getDocument() );
+		printf( "%s\n", dump.getBuffer() );
+	}
+
+	// write to stdout directly, nothing is kept in memory
+	{
+		SP_XmlFileSink sink( stdout );
+		SP_XmlWriter writer( &sink );
+
+		writer.startElement( "catalog" );
+		writer.attribute( "count", "2" );
+		writer.comment( " written by SP_XmlWriter " );
+		writer.startElement( "book" );
+		writer.attribute( "id", "b1" );
+		writer.text( "Tom & Jerry" );
+		writer.endElement();
+		writer.startElement( "book" );
+		writer.attribute( "id", "b2" );
+		writer.endElement();
+		writer.endDocument();
+	}
+
+	printf( "\n\n" );
+
+	// nesting errors are reported, not written
+	{
+		SP_XmlStringBuffer temp;
+		SP_XmlWriter writer( &temp );
+
+		writer.startElement( "a" );
+		writer.endElement();
+		writer.endElement();
+
+		printf( "error: %s\n", writer.getError() ? writer.getError() : "none" );
+	}
+
+	// a slice which cuts a utf-8 character in half, its lead byte goes out as is
+	{
+		SP_XmlStringBuffer temp;
+		SP_XmlWriter writer( &temp );
+
+		writer.startElement( "a" );
+		writer.text( "x\xc3\xa9" "END", 2 );
+		writer.text( "\xc3\xa9", 2 );
+		writer.endDocument();
+
+		printf( "slice: %s\n", 0 == strcmp( temp.getBuffer(), "<a>x\xc3&#233;</a>" ) ? "ok" : "mismatch" );
+	}
+
+	return 0;
+}
+
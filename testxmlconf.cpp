@@ -11,14 +11,59 @@
 #include "spdomparser.hpp"
 #include "spxmlnode.hpp"
 #include "spcanonxml.hpp"
+#include "spxmlparser.hpp"
+#include "spxmlsink.hpp"
+
+// canonicalize while reading, without building a tree
+int streamCanon( const char * inFile, const char * outFile )
+{
+	FILE * fpIn = fopen( inFile, "r" );
+	if( NULL == fpIn ) {
+		printf( "cannot not open input file: %s\n", inFile );
+		return -1;
+	}
+
+	FILE * fpOut = fopen( outFile, "w" );
+	if( NULL == fpOut ) {
+		printf( "cannot not open output file: %s\n", outFile );
+		fclose( fpIn );
+		return -1;
+	}
+
+	SP_XmlFileSink sink( fpOut );
+	SP_CanonXmlStream canon( &sink );
+	canon.getParser()->setIgnoreWhitespace( 0 );
+
+	char buffer[ 4096 ] = { 0 };
+	for( size_t len = 0; ( len = fread( buffer, 1, sizeof( buffer ), fpIn ) ) > 0; ) {
+		canon.append( buffer, len );
+	}
+
+	sink.flush();
+
+	fclose( fpIn );
+	fclose( fpOut );
+
+	if( NULL != canon.getError() ) {
+		printf( "\n\nerror: %s\n", canon.getError() );
+		return -1;
+	}
+
+	return 0;
+}
 
 int main( int argc, char * argv[] )
 {
 	if( argc < 3 ) {
-		printf( "Usage: %s <in_file> <out_file>\n", argv[0] );
+		printf( "Usage: %s <in_file> <out_file> [-s]\n", argv[0] );
+		printf( "\t-s stream the canonical form from the pull parser\n" );
 		exit( -1 );
 	}
 
+	if( argc > 3 && 0 == strcmp( argv[3], "-s" ) ) {
+		return 0 == streamCanon( argv[1], argv[2] ) ? 0 : -1;
+	}
+
 	char * source = NULL;
 	{
 		FILE * fpIn = fopen ( argv[1], "r" );
@@ -113,6 +113,10 @@ SOURCE=..\spxmlnode.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\spxmlnumber.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\spxmlparser.cpp
 # End Source File
 # Begin Source File
@@ -121,6 +125,14 @@ SOURCE=..\spxmlreader.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\spxmlsink.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\spxmlsource.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\spxmlstag.cpp
 # End Source File
 # Begin Source File
@@ -161,6 +173,10 @@ SOURCE=..\spxmlnode.hpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\spxmlnumber.hpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\spxmlparser.hpp
 # End Source File
 # Begin Source File
@@ -169,6 +185,14 @@ SOURCE=..\spxmlreader.hpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\spxmlsink.hpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\spxmlsource.hpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\spxmlstag.hpp
 # End Source File
 # Begin Source File